@@ -0,0 +1,440 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class BinaryTraceReaderTests
+    {
+        private Dictionary<ulong, ModuleMessage> _modules = null!;
+        private Dictionary<ulong, Enter3Message> _functions = null!;
+        private HashSet<ulong> _jit = null!;
+        private List<string> _errors = null!;
+
+        [SetUp]
+        public void SetUp()
+        {
+            _modules = new Dictionary<ulong, ModuleMessage>();
+            _functions = new Dictionary<ulong, Enter3Message>();
+            _jit = new HashSet<ulong>();
+            _errors = new List<string>();
+        }
+
+        [Test]
+        public void Read_ModuleAndJitRecords_PopulatesMaps()
+        {
+            // Arrange
+            var trace = new TraceBuilder();
+            trace.Record(1, p => p.Varint(0x7FF812340000).Varint(0x1234).String(@"C:\app\Café.dll").String("Café").Varint(0));
+            trace.Record(2, p => p.Varint(0xAABBCCDD11));
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.AreEqual(1, _modules.Count);
+            var module = _modules[0x7FF812340000];
+            Assert.AreEqual(0x1234UL, module.AssemblyID);
+            Assert.AreEqual(@"C:\app\Café.dll", module.ModuleName);
+            Assert.AreEqual("Café", module.AssemblyName);
+            CollectionAssert.AreEquivalent(new[] { 0xAABBCCDD11UL }, _jit);
+        }
+
+        [Test]
+        public void Read_Enter3Record_RebuildsTypeArgTreeInPreorder()
+        {
+            // Arrange: Dictionary<int, List<string>>-shaped declaring type args, one method type arg
+            var trace = new TraceBuilder();
+            trace.Record(3, p => p
+                .Varint(0x100).Varint(0x200).Token(0x06000012).Varint(0x300).Token(0x02000005)
+                .Varint(2)
+                    .Varint(0x400).Token(0x02000001).Varint(0)
+                    .Varint(0x400).Token(0x02000002).Varint(1 << 1)
+                        .Varint(0x400).Token(0x02000003).Varint(0)
+                .Varint(1)
+                    .Varint(0x500).Token(0x02000004).Varint(0));
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            var msg = _functions[0x100];
+            Assert.AreEqual(0x200UL, msg.ModuleID);
+            Assert.AreEqual(0x06000012U, msg.MethodToken);
+            Assert.AreEqual(0x300UL, msg.DeclaringTypeModuleID);
+            Assert.AreEqual(0x02000005U, msg.DeclaringTypeToken);
+            Assert.AreEqual(2, msg.DeclaringTypeArgCount);
+            Assert.AreEqual(0x02000001U, msg.DeclaringTypeArgs[0].TypeDef);
+            Assert.IsNull(msg.DeclaringTypeArgs[0].Nested);
+            Assert.AreEqual(1, msg.DeclaringTypeArgs[1].NestedCount);
+            Assert.AreEqual(0x02000003U, msg.DeclaringTypeArgs[1].Nested[0].TypeDef);
+            Assert.AreEqual(1, msg.MethodTypeArgCount);
+            Assert.AreEqual(0x500UL, msg.MethodTypeArgs[0].ModuleID);
+        }
+
+        [Test]
+        public void Read_TruncatedTypeArg_KeepsCountWithoutChildren()
+        {
+            // Arrange
+            var trace = new TraceBuilder();
+            trace.Record(3, p => p
+                .Varint(0x100).Varint(0x200).Token(0x06000001).Varint(0x200).Token(0x02000001)
+                .Varint(1)
+                    .Varint(0x400).Token(0x02000002).Varint((3 << 1) | 1)
+                .Varint(0));
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            var typeArg = _functions[0x100].DeclaringTypeArgs[0];
+            Assert.AreEqual(3, typeArg.NestedCount);
+            Assert.IsNull(typeArg.Nested);
+        }
+
+        [Test]
+        public void Read_UnknownRecordType_IsSkipped()
+        {
+            // Arrange
+            var trace = new TraceBuilder();
+            trace.Record(200, p => p.Varint(1).Varint(2).Varint(3));
+            trace.Record(2, p => p.Varint(42));
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit);
+        }
+
+        [Test]
+        public void Read_JitFinishedRecord_AddsCompilation()
+        {
+            // Arrange: FunctionID, Start, Duration, CodeSize, HRESULT
+            var trace = new TraceBuilder();
+            trace.Record(2, p => p.Varint(42));
+            trace.Record(4, p => p.Varint(42).Varint(123456789).Varint(250000).Varint(96).Varint(0));
+            var events = new ProfilerEvents();
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors, events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit);
+            var compilation = events.JitCompilations.Single();
+            Assert.AreEqual(42UL, compilation.FunctionID);
+            Assert.AreEqual(123456789UL, compilation.Start);
+            Assert.AreEqual(123706789UL, compilation.Finish);
+            Assert.AreEqual(96UL, compilation.CodeSize);
+            Assert.IsTrue(compilation.Succeeded);
+        }
+
+        [Test]
+        public void Read_TierRecords_AddTierEvents()
+        {
+            // Arrange: a CacheHit, then the first JIT of the same function
+            var trace = new TraceBuilder();
+            trace.Record(6, p => p.Varint(42).Varint(900));
+            trace.Record(4, p => p.Varint(42).Varint(1000).Varint(500).Varint(96).Varint(0));
+            var events = new ProfilerEvents();
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors, events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            var hit = events.CacheHits.Single();
+            Assert.AreEqual(42UL, hit.FunctionID);
+            Assert.AreEqual(900UL, hit.Time);
+            Assert.AreEqual(1500UL, events.JitCompilations.Single().Finish);
+        }
+
+        [Test]
+        public void Read_ModuleRecords_AddLoadsAndUnloads()
+        {
+            // Arrange: a module logged at load, one logged on first use, an unload
+            var trace = new TraceBuilder();
+            trace.Record(1, p => p.Varint(7).Varint(8).String("App.dll").String("App").Varint(1000));
+            trace.Record(1, p => p.Varint(9).Varint(10).String("Lib.dll").String("Lib").Varint(0));
+            trace.Record(8, p => p.Varint(7).Varint(5000));
+            var events = new ProfilerEvents();
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors, events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.AreEqual(1000UL, _modules[7].LoadTime);
+            Assert.AreEqual(0UL, _modules[9].LoadTime);
+            Assert.AreEqual(2, events.ModuleLoads.Count);
+            var unload = events.ModuleUnloads.Single();
+            Assert.AreEqual(7UL, unload.ModuleID);
+            Assert.AreEqual(5000UL, unload.Time);
+        }
+
+        [Test]
+        public void Read_ThreadRecords_AddTagsAndThreadEvents()
+        {
+            // Arrange: thread index, a tagged JIT record, an untagged one, OS thread and name
+            var trace = new TraceBuilder();
+            trace.Record(9, p => p.Varint(1).Varint(99).Varint(900));
+            trace.Record(2, p => p.Varint(42).Varint(1).Varint(1).Varint(1000));
+            trace.Record(2, p => p.Varint(43));
+            trace.Record(12, p => p.Varint(99).Varint(4242));
+            trace.Record(13, p => p.Varint(99).String("Worker"));
+            var events = new ProfilerEvents();
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors, events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL, 43UL }, _jit);
+            var start = events.JitStarts.Single();
+            Assert.AreEqual(42UL, start.FunctionID);
+            Assert.AreEqual(1000UL, start.Time);
+            var threadEvents = events.ThreadEvents.ToList();
+            Assert.AreEqual(3, threadEvents.Count);
+            Assert.AreEqual(99UL, threadEvents[0].ThreadID);
+            Assert.AreEqual(4242u, threadEvents[1].OSThreadID);
+            Assert.AreEqual("Worker", threadEvents[2].Name);
+        }
+
+        [Test]
+        public void Read_CallCountRecord_AddsCount()
+        {
+            // Arrange: FunctionID, calls
+            var trace = new TraceBuilder();
+            trace.Record(14, p => p.Varint(42).Varint(5000000000));
+            var events = new ProfilerEvents();
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors, events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.IsEmpty(_jit);
+            var count = events.CallCounts.Single();
+            Assert.AreEqual(42UL, count.FunctionID);
+            Assert.AreEqual(5000000000UL, count.Count);
+        }
+
+        [Test]
+        public void Read_InliningRecord_AddsEdge()
+        {
+            // Arrange: caller, callee, callee ModuleID, callee MethodDef
+            var trace = new TraceBuilder();
+            trace.Record(5, p => p.Varint(42).Varint(77).Varint(0x200).Token(0x0600000F));
+            var events = new ProfilerEvents();
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors, events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.IsEmpty(_jit);
+            var inlining = events.Inlinings.Single();
+            Assert.AreEqual(42UL, inlining.Caller);
+            Assert.AreEqual(77UL, inlining.Callee);
+            Assert.AreEqual(0x200UL, inlining.CalleeModuleID);
+            Assert.AreEqual(0x0600000Fu, inlining.CalleeToken);
+        }
+
+        [Test]
+        public void Read_TruncatedTail_KeepsCompleteRecordsAndReportsError()
+        {
+            // Arrange
+            var trace = new TraceBuilder();
+            trace.Record(2, p => p.Varint(42));
+            trace.Raw(new byte[] { 3, 0, 0, 0, 64, 0 });
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit);
+            Assert.AreEqual(1, _errors.Count);
+        }
+
+        [Test]
+        public void Read_ZeroFilledTail_StopsWithoutError()
+        {
+            // Arrange
+            var trace = new TraceBuilder();
+            trace.Record(2, p => p.Varint(42));
+            trace.Raw(new byte[4096]);
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit);
+        }
+
+        [Test]
+        public void Read_ZeroGap_KeepsTheRecordsAfterIt()
+        {
+            // Arrange: a mapped trace of a killed process, with a record reserved but never
+            // copied between two that were
+            var trace = new TraceBuilder();
+            trace.Record(2, p => p.Varint(42));
+            trace.Raw(new byte[13]);
+            trace.Record(2, p => p.Varint(43));
+            trace.Raw(new byte[4096]);
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL, 43UL }, _jit);
+        }
+
+        [Test]
+        public void ReadFrom_ZeroGap_WaitsUntilTheEnd()
+        {
+            // Arrange
+            var trace = new TraceBuilder();
+            trace.Record(2, p => p.Varint(42));
+            trace.Raw(new byte[13]);
+            trace.Record(2, p => p.Varint(43));
+            var path = Path.Combine(Path.GetTempPath(), "BinaryTraceReaderTests_" + Guid.NewGuid().ToString("N") + ".bin");
+            File.WriteAllBytes(path, trace.ToArray());
+
+            try
+            {
+                // Act
+                long offset = BinaryTraceReader.ReadFrom(path, 0, false, _modules, _functions, _jit, _errors);
+                var whileLive = new HashSet<ulong>(_jit);
+                long end = BinaryTraceReader.ReadFrom(path, offset, true, _modules, _functions, _jit, _errors);
+
+                // Assert
+                Assert.IsEmpty(_errors);
+                CollectionAssert.AreEquivalent(new[] { 42UL }, whileLive);
+                CollectionAssert.AreEquivalent(new[] { 42UL, 43UL }, _jit);
+                Assert.AreEqual(new FileInfo(path).Length, end);
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
+
+        [Test]
+        public void Read_WrongVersion_ReportsError()
+        {
+            // Arrange
+            var trace = new TraceBuilder(version: 99);
+            trace.Record(2, p => p.Varint(42));
+
+            // Act
+            BinaryTraceReader.Read(trace.ToStream(), _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.AreEqual(1, _errors.Count);
+            Assert.IsEmpty(_jit);
+        }
+
+        [Test]
+        public void ReadFrom_RecordBeingWritten_IsLeftForTheNextCall()
+        {
+            // Arrange: a live trace whose last record is half written
+            var trace = new TraceBuilder();
+            trace.Record(2, p => p.Varint(42));
+            var next = new TraceBuilder();
+            next.Record(2, p => p.Varint(43));
+            var nextRecord = next.ToArray().AsSpan(16).ToArray();
+            var path = Path.Combine(Path.GetTempPath(), "BinaryTraceReaderTests_" + Guid.NewGuid().ToString("N") + ".bin");
+            File.WriteAllBytes(path, trace.ToArray().Concat(nextRecord.Take(5)).ToArray());
+
+            try
+            {
+                // Act
+                long offset = BinaryTraceReader.ReadFrom(path, 0, false, _modules, _functions, _jit, _errors);
+                var afterFirstCall = new HashSet<ulong>(_jit);
+                using (var stream = new FileStream(path, FileMode.Append))
+                    stream.Write(nextRecord, 5, nextRecord.Length - 5);
+                long end = BinaryTraceReader.ReadFrom(path, offset, false, _modules, _functions, _jit, _errors);
+
+                // Assert
+                Assert.IsEmpty(_errors);
+                CollectionAssert.AreEquivalent(new[] { 42UL }, afterFirstCall);
+                Assert.AreEqual(trace.ToArray().Length, offset);
+                CollectionAssert.AreEquivalent(new[] { 42UL, 43UL }, _jit);
+                Assert.AreEqual(new FileInfo(path).Length, end);
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
+
+        // Mirrors BinaryRecordBuilder in TraceFormat.h
+        private sealed class TraceBuilder
+        {
+            private readonly MemoryStream _stream = new MemoryStream();
+
+            public TraceBuilder(ushort version = BinaryTraceReader.SupportedVersion)
+            {
+                _stream.Write(Encoding.ASCII.GetBytes("SJPT"));
+                _stream.Write(BitConverter.GetBytes(version));
+                _stream.Write(BitConverter.GetBytes((ushort)16));
+                _stream.Write(new byte[8]);
+            }
+
+            public void Record(byte type, Action<Payload> build)
+            {
+                var payload = new Payload();
+                build(payload);
+                var bytes = payload.ToArray();
+                _stream.Write(new byte[] { type, 0, 0, 0 });
+                _stream.Write(BitConverter.GetBytes((uint)bytes.Length));
+                _stream.Write(bytes);
+            }
+
+            public void Raw(byte[] bytes) => _stream.Write(bytes);
+
+            public Stream ToStream() => new MemoryStream(_stream.ToArray());
+
+            public byte[] ToArray() => _stream.ToArray();
+        }
+
+        private sealed class Payload
+        {
+            private readonly MemoryStream _bytes = new MemoryStream();
+
+            public Payload Varint(ulong value)
+            {
+                while (value >= 0x80)
+                {
+                    _bytes.WriteByte((byte)(value | 0x80));
+                    value >>= 7;
+                }
+                _bytes.WriteByte((byte)value);
+                return this;
+            }
+
+            public Payload Token(uint token) => Varint(((token & 0x00FFFFFFUL) << 8) | (token >> 24));
+
+            public Payload String(string value)
+            {
+                var bytes = Encoding.UTF8.GetBytes(value);
+                Varint((ulong)bytes.Length);
+                _bytes.Write(bytes);
+                return this;
+            }
+
+            public byte[] ToArray() => _bytes.ToArray();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+﻿using System;
+using System.Linq;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class CallCountReportTests
+    {
+        private static CallCountMessage Calls(ulong functionId, ulong count) =>
+            new CallCountMessage { FunctionID = functionId, Count = count };
+
+        [Test]
+        public void Rank_SumsEachFunctionAndBucketsByPowersOfTen()
+        {
+            // Arrange: 20 is counted in two merge passes
+            var counts = new[] { Calls(10, 1), Calls(20, 60), Calls(30, 1000), Calls(20, 40), Calls(40, 7) };
+
+            // Act
+            var report = CallCountReport.Rank(counts);
+
+            // Assert
+            CollectionAssert.AreEqual(new ulong[] { 30, 20, 40, 10 }, report.Methods.Select(x => x.FunctionID));
+            Assert.AreEqual(100UL, report.Methods[1].Calls);
+            Assert.AreEqual(1108UL, report.TotalCalls);
+            CollectionAssert.AreEqual(new ulong[] { 1, 10, 100, 1000 }, report.Histogram.Select(x => x.UpTo));
+            Assert.IsTrue(report.Histogram.All(x => x.Methods == 1));
+        }
+
+        [Test]
+        public void ToReport_ShowsShareOfCalls()
+        {
+            // Arrange
+            var report = CallCountReport.Rank(new[] { Calls(10, 3), Calls(20, 1) });
+            report.Methods[0].Method = "MethodSample.InstanceNoArgs()";
+
+            // Act
+            var text = report.ToReport();
+
+            // Assert
+            StringAssert.Contains("4 calls to 2 methods", text);
+            StringAssert.Contains("                  10        1    75.00", text);
+            StringAssert.Contains("                   3    75.00  MethodSample.InstanceNoArgs()", text);
+            StringAssert.Contains("                   1    25.00  FunctionID 0x14", text);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Reflection;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class CaptureComparisonTests
+    {
+        private static readonly Type CanonType = typeof(object).Assembly.GetType(CaptureComparison.CanonTypeName, throwOnError: true)!;
+
+        private static MethodBase ListAdd(Type elementType) =>
+            typeof(List<>).MakeGenericType(elementType).GetMethod(nameof(List<int>.Add))!;
+
+        [Test]
+        public void Compare_SameMethods_AreAllCommon()
+        {
+            // Arrange
+            var methods = new[] { ListAdd(typeof(int)), ListAdd(typeof(string)) };
+
+            // Act
+            var result = CaptureComparison.Compare(methods, methods);
+
+            // Assert
+            Assert.AreEqual(2, result.Common.Count);
+            Assert.AreEqual(0, result.OnlyInBaseline.Count);
+            Assert.AreEqual(0, result.OnlyInCandidate.Count);
+        }
+
+        [Test]
+        public void Compare_CanonicalCandidate_CoversReferenceTypeInstantiations()
+        {
+            // Arrange
+            var enter3 = new[] { ListAdd(typeof(int)), ListAdd(typeof(string)), ListAdd(typeof(Uri)) };
+            var jit = new[] { ListAdd(typeof(int)), ListAdd(CanonType) };
+
+            // Act
+            var result = CaptureComparison.Compare(enter3, jit);
+
+            // Assert
+            Assert.AreEqual(1, result.Common.Count);
+            Assert.AreEqual(2, result.OnlyInBaseline.Count);
+            Assert.AreEqual(2, result.BaselineCoveredBySharedCode.Count);
+            Assert.AreEqual(1, result.OnlyInCandidate.Count);
+            Assert.AreEqual(1, result.CandidateCoveredBySharedCode.Count);
+        }
+
+        [Test]
+        public void Compare_ValueTypeInstantiation_IsNotCoveredByCanonicalCode()
+        {
+            // Arrange
+            var enter3 = new[] { ListAdd(typeof(long)) };
+            var jit = new[] { ListAdd(CanonType) };
+
+            // Act
+            var result = CaptureComparison.Compare(enter3, jit);
+
+            // Assert
+            Assert.AreEqual(1, result.OnlyInBaseline.Count);
+            Assert.AreEqual(0, result.BaselineCoveredBySharedCode.Count);
+            Assert.AreEqual(0, result.CandidateCoveredBySharedCode.Count);
+        }
+
+        [Test]
+        public void ToReport_ListsEachSection()
+        {
+            // Arrange
+            var enter3 = new[] { ListAdd(typeof(string)), ListAdd(typeof(long)) };
+            var jit = new[] { ListAdd(CanonType) };
+
+            // Act
+            var report = CaptureComparison.Compare(enter3, jit).ToReport("enter3", "jit");
+
+            // Assert
+            StringAssert.Contains("enter3: 2 methods, jit: 1 methods", report);
+            StringAssert.Contains("Only in enter3, shared code captured by jit: 1", report);
+            StringAssert.Contains("Only in enter3: 1", report);
+            StringAssert.Contains("Only in jit, covers instantiations in enter3: 1", report);
+        }
+    }
+}
@@ -0,0 +1,159 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+using System.Text.Json;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class IncrementalCollectorTests
+    {
+        private const ulong TestModuleId = 1;
+        private const ulong CoreLibModuleId = 2;
+
+        private string _folder = null!;
+
+        [SetUp]
+        public void SetUp()
+        {
+            _folder = Path.Combine(Path.GetTempPath(), "IncrementalCollectorTests_" + Guid.NewGuid().ToString("N"));
+            Directory.CreateDirectory(_folder);
+
+            Write("modules.json", Module(TestModuleId, typeof(MethodSample).Assembly) + Module(CoreLibModuleId, typeof(object).Assembly));
+            Write("enter3.json", "");
+            Write("jit.json", "");
+        }
+
+        [TearDown]
+        public void TearDown()
+        {
+            Directory.Delete(_folder, true);
+        }
+
+        [Test]
+        public void Collect_GrowingLogs_ResolvesOnlyTheNewFunctions()
+        {
+            // Arrange
+            var collector = NewCollector();
+            Append("enter3.json", Enter3(1, nameof(MethodSample.InstanceNoArgs)), Enter3(2, nameof(MethodSample.StaticNoArgs)));
+            Append("jit.json", Jit(1));
+            Append("jit.json", "{\"FunctionID\":"); // still being written
+
+            // Act
+            var first = collector.Collect(false, out string firstErrors);
+            Append("jit.json", "2}\n");
+            var second = collector.Collect(false, out string secondErrors);
+            var third = collector.Collect(false, out string thirdErrors);
+
+            // Assert
+            Assert.IsEmpty(firstErrors + secondErrors + thirdErrors);
+            CollectionAssert.AreEqual(new[] { nameof(MethodSample.InstanceNoArgs) }, first.Select(node => node.Name));
+            CollectionAssert.AreEqual(new[] { nameof(MethodSample.StaticNoArgs) }, second.Select(node => node.Name));
+            Assert.IsEmpty(third);
+            CollectionAssert.AreEqual(new[] { nameof(MethodSample.InstanceNoArgs), nameof(MethodSample.StaticNoArgs) },
+                ReadManifest().Select(node => node.Name));
+        }
+
+        [Test]
+        public void Collect_NewCollector_ResumesFromTheCheckpoint()
+        {
+            // Arrange
+            Append("enter3.json", Enter3(1, nameof(MethodSample.InstanceNoArgs)));
+            Append("jit.json", Jit(1));
+            NewCollector().Collect(false, out _);
+            Append("enter3.json", Enter3(2, nameof(MethodSample.StaticNoArgs)));
+            Append("jit.json", Jit(2));
+
+            // Act
+            var nodes = NewCollector().Collect(false, out string errors);
+
+            // Assert
+            Assert.IsEmpty(errors);
+            CollectionAssert.AreEqual(new[] { nameof(MethodSample.StaticNoArgs) }, nodes.Select(node => node.Name));
+            Assert.AreEqual(2, ReadManifest().Length);
+        }
+
+        [Test]
+        public void Collect_JitEventBeforeEnter3_WaitsForTheRecord()
+        {
+            // Arrange: JITCompilationStarted comes before the first call
+            var collector = NewCollector();
+            Append("jit.json", Jit(1), Jit(2));
+
+            // Act
+            var beforeEnter3 = collector.Collect(false, out string beforeErrors);
+            Append("enter3.json", Enter3(1, nameof(MethodSample.InstanceNoArgs)));
+            var afterEnter3 = collector.Collect(false, out string afterErrors);
+            var afterExit = collector.Collect(true, out string exitErrors);
+
+            // Assert
+            Assert.IsEmpty(beforeEnter3);
+            Assert.IsEmpty(beforeErrors + afterErrors);
+            Assert.AreEqual(1, afterEnter3.Length);
+            Assert.IsEmpty(afterExit);
+            StringAssert.StartsWith("FunctionID 0x2 from JIT log not found in Enter3 log", exitErrors);
+        }
+
+        [Test]
+        public void Collect_LogsOfANewRun_StartOver()
+        {
+            // Arrange
+            var collector = NewCollector();
+            Append("enter3.json", Enter3(1, nameof(MethodSample.InstanceNoArgs)));
+            Append("jit.json", Jit(1));
+            collector.Collect(false, out _);
+
+            // The profiler recreates its logs on the next launch, with other FunctionIDs
+            Write("enter3.json", Enter3(7, nameof(MethodSample.StaticNoArgs)));
+            Write("jit.json", Jit(7) + Jit(8));
+
+            // Act
+            var nodes = collector.Collect(false, out string errors);
+
+            // Assert
+            Assert.IsEmpty(errors);
+            CollectionAssert.AreEqual(new[] { nameof(MethodSample.StaticNoArgs) }, nodes.Select(node => node.Name));
+            CollectionAssert.AreEqual(new[] { nameof(MethodSample.StaticNoArgs) }, ReadManifest().Select(node => node.Name));
+        }
+
+        private IncrementalCollector NewCollector()
+        {
+            return new IncrementalCollector(_folder, Path.GetDirectoryName(typeof(MethodSample).Assembly.Location), fromMetadata: true);
+        }
+
+        private MethodBaseSerializer.MethodNode[] ReadManifest()
+        {
+            return JsonSerializer.Deserialize<MethodBaseSerializer.MethodNode[]>(File.ReadAllText(Path.Combine(_folder, IncrementalCollector.ManifestFileName)));
+        }
+
+        private static string Enter3(ulong functionId, string methodName)
+        {
+            var method = typeof(MethodSample).GetMethod(methodName);
+            return $"{{\"FunctionID\":{functionId},\"ModuleID\":{TestModuleId},\"MethodToken\":{method.MetadataToken}," +
+                $"\"DeclaringTypeModuleID\":{TestModuleId},\"DeclaringTypeToken\":{typeof(MethodSample).MetadataToken}," +
+                "\"DeclaringTypeArgCount\":0,\"MethodTypeArgCount\":0}\n";
+        }
+
+        private static string Module(ulong moduleId, Assembly assembly)
+        {
+            return $"{{\"ModuleID\":{moduleId},\"ModuleName\":{Quote(assembly.Location)},\"AssemblyID\":{moduleId},\"AssemblyName\":{Quote(assembly.GetName().Name)}}}\n";
+        }
+
+        private static string Jit(ulong functionId) => $"{{\"FunctionID\":{functionId}}}\n";
+
+        private static string Quote(string value) => JsonSerializer.Serialize(value);
+
+        private void Write(string fileName, string text)
+        {
+            File.WriteAllText(Path.Combine(_folder, fileName), text);
+        }
+
+        private void Append(string fileName, params string[] text)
+        {
+            File.AppendAllText(Path.Combine(_folder, fileName), string.Concat(text));
+        }
+    }
+}
@@ -0,0 +1,46 @@
+﻿using System.Linq;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class InliningGraphTests
+    {
+        private static InliningMessage Edge(ulong caller, ulong callee) =>
+            new InliningMessage { Caller = caller, Callee = callee };
+
+        [Test]
+        public void Build_RepeatedEdge_IsCountedOnce()
+        {
+            // Arrange
+            var inlinings = new[] { Edge(1, 2), Edge(1, 3), Edge(1, 2), Edge(4, 2) };
+
+            // Act
+            var graph = InliningGraph.Build(inlinings);
+
+            // Assert
+            Assert.AreEqual(3, graph.EdgeCount);
+            CollectionAssert.AreEqual(new ulong[] { 2, 3 }, graph.Methods[1].Callees.Select(x => x.FunctionID));
+            CollectionAssert.AreEqual(new ulong[] { 1, 4 }, graph.Methods[2].Callers.Select(x => x.FunctionID));
+            Assert.IsEmpty(graph.Methods[2].Callees);
+        }
+
+        [Test]
+        public void ToReport_RanksCalleesAndCallers()
+        {
+            // Arrange
+            var graph = InliningGraph.Build(new[] { Edge(1, 2), Edge(1, 3), Edge(4, 2) });
+            graph.Methods[2].Name = "String.get_Length()";
+
+            // Act
+            var report = graph.ToReport(top: 1);
+
+            // Assert
+            StringAssert.Contains("3 inlining edges, 2 callers, 2 callees", report);
+            StringAssert.Contains("       2  String.get_Length()", report);
+            StringAssert.Contains("       2  FunctionID 0x1", report);
+            StringAssert.Contains("            FunctionID 0x3", report);
+            StringAssert.DoesNotContain("FunctionID 0x4", report);
+        }
+    }
+}
@@ -0,0 +1,380 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Compression;
+using System.Linq;
+using System.Reflection;
+using System.Runtime.Loader;
+using System.Text.Json;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class JitProfilerLogParserTests
+    {
+        private const ulong TestModuleId = 1;
+        private const ulong CoreLibModuleId = 2;
+
+        private string _folder = null!;
+        private string _savedCurrentDirectory = null!;
+
+        [SetUp]
+        public void SetUp()
+        {
+            _folder = Path.Combine(Path.GetTempPath(), "JitProfilerLogParserTests_" + Guid.NewGuid().ToString("N"));
+            Directory.CreateDirectory(_folder);
+            // Resolution leaves the current directory at the executable's folder
+            _savedCurrentDirectory = Environment.CurrentDirectory;
+
+            var testAssembly = typeof(MethodSample).Assembly;
+            var coreLib = typeof(object).Assembly;
+            Write("modules.json",
+                Module(TestModuleId, testAssembly),
+                Module(CoreLibModuleId, coreLib));
+        }
+
+        [TearDown]
+        public void TearDown()
+        {
+            Environment.CurrentDirectory = _savedCurrentDirectory;
+            Directory.Delete(_folder, true);
+        }
+
+        [Test]
+        public void ParseProfilerLogs_ManyInstantiations_ResolvesEachFunction()
+        {
+            // Arrange: Dictionary<int, List<string>>.TryGetValue and MethodSample.GenericMethod<List<int>>,
+            // each under many FunctionIDs as a big trace repeats the same type arguments
+            var tryGetValue = typeof(Dictionary<,>).GetMethod("TryGetValue");
+            var genericMethod = typeof(MethodSample).GetMethod(nameof(MethodSample.GenericMethod));
+            var enter3 = new List<string>();
+            var jit = new List<string>();
+            for (ulong id = 1; id <= 1000; id++)
+            {
+                enter3.Add(id % 2 == 0
+                    ? Enter3(id, CoreLibModuleId, typeof(Dictionary<,>), tryGetValue,
+                        declaringTypeArgs: $"[{TypeArg(typeof(int))},{TypeArg(typeof(List<>), TypeArg(typeof(string)))}]", declaringCount: 2)
+                    : Enter3(id, TestModuleId, typeof(MethodSample), genericMethod,
+                        methodTypeArgs: $"[{TypeArg(typeof(List<>), TypeArg(typeof(int)))}]", methodCount: 1));
+                jit.Add($"{{\"FunctionID\":{id}}}");
+            }
+            Write("enter3.json", enter3.ToArray());
+            Write("jit.json", jit.ToArray());
+
+            // Act
+            var methods = Parse(out string errors);
+
+            // Assert
+            Assert.IsEmpty(errors);
+            Assert.AreEqual(1000, methods.Length);
+            Assert.AreEqual(500, methods.Count(m => m.DeclaringType == typeof(Dictionary<int, List<string>>) && m.Name == "TryGetValue"));
+            Assert.AreEqual(500, methods.Count(m => m is MethodInfo info && info.IsGenericMethod &&
+                info.GetGenericArguments().Single() == typeof(List<int>)));
+        }
+
+        [Test]
+        public void ParseProfilerLogs_UnknownFunctions_ReportedInJitOrder()
+        {
+            // Arrange
+            var instanceNoArgs = typeof(MethodSample).GetMethod(nameof(MethodSample.InstanceNoArgs));
+            Write("enter3.json", Enter3(5, TestModuleId, typeof(MethodSample), instanceNoArgs));
+            Write("jit.json", Enumerable.Range(1, 300).Select(id => $"{{\"FunctionID\":{id}}}").ToArray());
+
+            // Act
+            var methods = Parse(out string errors);
+
+            // Assert
+            Assert.AreEqual(instanceNoArgs, methods.Single());
+            var lines = errors.Split(Environment.NewLine);
+            Assert.AreEqual(299, lines.Length);
+            StringAssert.StartsWith("FunctionID 0x1 from JIT log", lines[0]);
+            StringAssert.StartsWith("FunctionID 0x12C from JIT log", lines[298]);
+        }
+
+        [Test]
+        public void ParseProfilerLogsToManifest_MatchesMethodBaseSerializer()
+        {
+            // Arrange: closed CoreLib generics, a byref of a type parameter, and test assembly
+            // signatures whose List`1 and Dictionary`2 references are forwarded to CoreLib
+            var tryGetValue = typeof(Dictionary<int, List<string>>).GetMethod("TryGetValue");
+            var genericMethod = typeof(MethodSample).GetMethod(nameof(MethodSample.GenericMethod)).MakeGenericMethod(typeof(List<int>));
+            var nestedGeneric = typeof(MethodSample).GetMethod(nameof(MethodSample.MethodWithNestedGeneric));
+            var ctor = typeof(MethodSample).GetConstructor(new[] { typeof(int) });
+            var listCtor = typeof(List<string>).GetConstructor(new[] { typeof(IEnumerable<string>) });
+            Write("enter3.json",
+                Enter3(1, CoreLibModuleId, typeof(Dictionary<,>), tryGetValue,
+                    declaringTypeArgs: $"[{TypeArg(typeof(int))},{TypeArg(typeof(List<>), TypeArg(typeof(string)))}]", declaringCount: 2),
+                Enter3(2, TestModuleId, typeof(MethodSample), genericMethod,
+                    methodTypeArgs: $"[{TypeArg(typeof(List<>), TypeArg(typeof(int)))}]", methodCount: 1),
+                Enter3(3, TestModuleId, typeof(MethodSample), nestedGeneric),
+                Enter3(4, TestModuleId, typeof(MethodSample), ctor),
+                Enter3(5, CoreLibModuleId, typeof(List<>), listCtor,
+                    declaringTypeArgs: $"[{TypeArg(typeof(string))}]", declaringCount: 1));
+            Write("jit.json", Enumerable.Range(1, 5).Select(id => $"{{\"FunctionID\":{id}}}").ToArray());
+
+            // Act
+            var nodes = ParseToManifest(out string errors);
+
+            // Assert
+            Assert.IsEmpty(errors);
+            var expected = new MethodBase[] { tryGetValue, genericMethod, nestedGeneric, ctor, listCtor }
+                .Select(method => JsonSerializer.Serialize(MethodBaseSerializer.ToNode(method)));
+            CollectionAssert.AreEquivalent(expected, nodes.Select(node => JsonSerializer.Serialize(node)));
+        }
+
+        [Test]
+        public void ParseProfilerLogsToManifest_DoesNotLoadTheAssemblies()
+        {
+            // Arrange: the application assembly at a path this process has never loaded
+            var copy = Path.Combine(_folder, "app", Path.GetFileName(typeof(MethodSample).Assembly.Location));
+            Directory.CreateDirectory(Path.GetDirectoryName(copy));
+            File.Copy(typeof(MethodSample).Assembly.Location, copy);
+            Write("modules.json",
+                $"{{\"ModuleID\":{TestModuleId},\"ModuleName\":{Quote(copy)},\"AssemblyID\":{TestModuleId},\"AssemblyName\":{Quote(typeof(MethodSample).Assembly.GetName().Name)}}}",
+                Module(CoreLibModuleId, typeof(object).Assembly));
+            var instanceWithArgs = typeof(MethodSample).GetMethod(nameof(MethodSample.InstanceWithArgs));
+            Write("enter3.json", Enter3(1, TestModuleId, typeof(MethodSample), instanceWithArgs));
+            Write("jit.json", "{\"FunctionID\":1}");
+
+            // Act
+            var nodes = ParseToManifest(out string errors);
+
+            // Assert
+            Assert.IsEmpty(errors);
+            Assert.AreEqual(JsonSerializer.Serialize(MethodBaseSerializer.ToNode(instanceWithArgs)), JsonSerializer.Serialize(nodes.Single()));
+            Assert.IsFalse(AppDomain.CurrentDomain.GetAssemblies().Any(assembly => !assembly.IsDynamic &&
+                string.Equals(assembly.Location, copy, StringComparison.OrdinalIgnoreCase)));
+        }
+
+        [Test]
+        public void ParseProfilerLogsToMibc_TokensResolveToTheCapturedInstantiations()
+        {
+            // Arrange
+            var tryGetValue = typeof(Dictionary<int, List<string>>).GetMethod("TryGetValue");
+            var genericMethod = typeof(MethodSample).GetMethod(nameof(MethodSample.GenericMethod)).MakeGenericMethod(typeof(List<int>));
+            var nestedGeneric = typeof(MethodSample).GetMethod(nameof(MethodSample.MethodWithNestedGeneric));
+            var ctor = typeof(MethodSample).GetConstructor(new[] { typeof(int) });
+            var listCtor = typeof(List<string>).GetConstructor(new[] { typeof(IEnumerable<string>) });
+            Write("enter3.json",
+                Enter3(1, CoreLibModuleId, typeof(Dictionary<,>), tryGetValue,
+                    declaringTypeArgs: $"[{TypeArg(typeof(int))},{TypeArg(typeof(List<>), TypeArg(typeof(string)))}]", declaringCount: 2),
+                Enter3(2, TestModuleId, typeof(MethodSample), genericMethod,
+                    methodTypeArgs: $"[{TypeArg(typeof(List<>), TypeArg(typeof(int)))}]", methodCount: 1),
+                Enter3(3, TestModuleId, typeof(MethodSample), nestedGeneric),
+                Enter3(4, TestModuleId, typeof(MethodSample), ctor),
+                Enter3(5, CoreLibModuleId, typeof(List<>), listCtor,
+                    declaringTypeArgs: $"[{TypeArg(typeof(string))}]", declaringCount: 1),
+                Enter3(6, CoreLibModuleId, typeof(List<>), listCtor,
+                    declaringTypeArgs: $"[{TypeArg(typeof(string))}]", declaringCount: 1));
+            Write("jit.json", Enumerable.Range(1, 6).Select(id => $"{{\"FunctionID\":{id}}}").ToArray());
+            var mibcPath = Path.Combine(_folder, "profile.mibc");
+
+            // Act
+            int count = JitProfilerLogParser.ParseProfilerLogsToMibc(
+                Path.Combine(_folder, "jit.json"),
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.GetDirectoryName(typeof(MethodSample).Assembly.Location),
+                mibcPath,
+                out string errors);
+
+            // Assert: the runtime binds every token to the method that ran, signature and instantiation included
+            Assert.IsEmpty(errors);
+            Assert.AreEqual(5, count);
+            var testAssembly = typeof(MethodSample).Assembly.GetName().Name;
+            var groups = ReadMibc(mibcPath);
+            CollectionAssert.AreEquivalent(new[] { "System.Private.CoreLib;", testAssembly + ";", testAssembly + ";System.Private.CoreLib;" }, groups.Keys);
+            CollectionAssert.AreEquivalent(new MethodBase[] { tryGetValue, listCtor }, groups["System.Private.CoreLib;"]);
+            CollectionAssert.AreEquivalent(new MethodBase[] { nestedGeneric, ctor }, groups[testAssembly + ";"]);
+            CollectionAssert.AreEquivalent(new MethodBase[] { genericMethod }, groups[testAssembly + ";System.Private.CoreLib;"]);
+        }
+
+        [Test]
+        public void ReadEvents_JitTimeReport_RanksNamedMethodsBySummedTime()
+        {
+            // Arrange: 2 is compiled twice (tier 0, then tier 1); 9 has no Enter3 record
+            var instanceWithArgs = typeof(MethodSample).GetMethod(nameof(MethodSample.InstanceWithArgs));
+            var genericMethod = typeof(MethodSample).GetMethod(nameof(MethodSample.GenericMethod)).MakeGenericMethod(typeof(List<int>));
+            Write("enter3.json",
+                Enter3(1, TestModuleId, typeof(MethodSample), instanceWithArgs),
+                Enter3(2, TestModuleId, typeof(MethodSample), genericMethod,
+                    methodTypeArgs: $"[{TypeArg(typeof(List<>), TypeArg(typeof(int)))}]", methodCount: 1));
+            Write("jit.json",
+                "{\"FunctionID\":1}",
+                "{\"FunctionID\":1,\"Event\":\"JitFinished\",\"Start\":1000,\"Finish\":3000000,\"CodeSize\":48,\"HResult\":0}",
+                "{\"FunctionID\":2}",
+                "{\"FunctionID\":2,\"Event\":\"JitFinished\",\"Start\":4000000,\"Finish\":6000000,\"CodeSize\":90,\"HResult\":0}",
+                "{\"FunctionID\":2,\"Event\":\"JitFinished\",\"Start\":9000000,\"Finish\":11500000,\"CodeSize\":0,\"HResult\":0}",
+                "{\"FunctionID\":9,\"Event\":\"JitFinished\",\"Start\":12000000,\"Finish\":12100000,\"CodeSize\":0,\"HResult\":2147500037}");
+
+            // Act
+            var run = JitProfilerLogParser.ReadEvents(_folder, out string readErrors);
+            var errors = new List<string>();
+            var report = JitTimeReport.Rank(run, Path.GetDirectoryName(typeof(MethodSample).Assembly.Location), errors);
+
+            // Assert
+            Assert.IsEmpty(readErrors);
+            StringAssert.StartsWith("FunctionID 0x9 from JIT log not found in Enter3 log", errors.FirstOrDefault());
+            CollectionAssert.AreEqual(new ulong[] { 2, 1, 9 }, report.Methods.Select(x => x.FunctionID));
+            Assert.AreEqual("MethodSample.GenericMethod<List<Int32>>(List<Int32>)", report.Methods[0].Method);
+            Assert.AreEqual("MethodSample.InstanceWithArgs(String, Int32)", report.Methods[1].Method);
+            Assert.IsNull(report.Methods[2].Method);
+            Assert.AreEqual(4500000UL, report.Methods[0].TotalTime);
+            Assert.AreEqual(2, report.Methods[0].Compilations);
+            Assert.AreEqual(90UL, report.Methods[0].CodeSize);
+            Assert.AreEqual(1, report.Methods[2].Failures);
+        }
+
+        [Test]
+        public void ReadEvents_OlderTraceInFolder_ReadsNewerJsonLogs()
+        {
+            // Arrange: a trace.bin left by an earlier binary run, then a JSON run into the same folder
+            Write(BinaryTraceReader.DefaultFileName, "not a trace");
+            File.SetLastWriteTimeUtc(Path.Combine(_folder, BinaryTraceReader.DefaultFileName), DateTime.UtcNow.AddHours(-1));
+            Write("enter3.json");
+            Write("modules.json");
+            Write("jit.json", "{\"FunctionID\":1,\"Event\":\"JitFinished\",\"Start\":1000,\"Finish\":2000,\"CodeSize\":48,\"HResult\":0}");
+
+            // Act
+            var binary = JitProfilerLogParser.IsBinaryRun(_folder);
+            var run = JitProfilerLogParser.ReadEvents(_folder, out string errors);
+
+            // Assert
+            Assert.IsFalse(binary);
+            Assert.IsEmpty(errors);
+            Assert.AreEqual(1UL, run.Events.JitCompilations.Single().FunctionID);
+        }
+
+        [Test]
+        public void ReadEvents_InliningGraph_NamesCalleesThatNeverRan()
+        {
+            // Arrange: 1 ran and has an Enter3 record; its inlinees 5 and 6 only have their definitions
+            var instanceWithArgs = typeof(MethodSample).GetMethod(nameof(MethodSample.InstanceWithArgs));
+            var staticNoArgs = typeof(MethodSample).GetMethod(nameof(MethodSample.StaticNoArgs));
+            var genericMethod = typeof(MethodSample).GetMethod(nameof(MethodSample.GenericMethod));
+            Write("enter3.json", Enter3(1, TestModuleId, typeof(MethodSample), instanceWithArgs));
+            Write("jit.json",
+                "{\"FunctionID\":1}",
+                $"{{\"FunctionID\":1,\"Event\":\"Inlined\",\"Callee\":5,\"CalleeModuleID\":{TestModuleId},\"CalleeToken\":{staticNoArgs.MetadataToken}}}",
+                $"{{\"FunctionID\":1,\"Event\":\"Inlined\",\"Callee\":6,\"CalleeModuleID\":{TestModuleId},\"CalleeToken\":{genericMethod.MetadataToken}}}",
+                $"{{\"FunctionID\":9,\"Event\":\"Inlined\",\"Callee\":5,\"CalleeModuleID\":{TestModuleId},\"CalleeToken\":{staticNoArgs.MetadataToken}}}");
+
+            // Act
+            var run = JitProfilerLogParser.ReadEvents(_folder, out string readErrors);
+            var errors = new List<string>();
+            var graph = InliningGraph.Build(run, Path.GetDirectoryName(typeof(MethodSample).Assembly.Location), errors);
+
+            // Assert
+            Assert.IsEmpty(readErrors);
+            Assert.IsEmpty(errors);
+            Assert.AreEqual(3, graph.EdgeCount);
+            var caller = graph.Methods[1];
+            Assert.AreEqual("MethodSample.InstanceWithArgs(String, Int32)", caller.Name);
+            CollectionAssert.AreEquivalent(new[] { "MethodSample.StaticNoArgs()", "MethodSample.GenericMethod(TResult)" },
+                caller.Callees.Select(x => x.Name));
+            CollectionAssert.AreEquivalent(new ulong[] { 1, 9 }, graph.Methods[5].Callers.Select(x => x.FunctionID));
+            Assert.IsNull(graph.Methods[9].Name);
+        }
+
+        private MethodBase[] Parse(out string errors)
+        {
+            return JitProfilerLogParser.ParseProfilerLogs(
+                Path.Combine(_folder, "jit.json"),
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.GetDirectoryName(typeof(MethodSample).Assembly.Location),
+                out errors);
+        }
+
+        private MethodBaseSerializer.MethodNode[] ParseToManifest(out string errors)
+        {
+            return JitProfilerLogParser.ParseProfilerLogsToManifest(
+                Path.Combine(_folder, "jit.json"),
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.GetDirectoryName(typeof(MethodSample).Assembly.Location),
+                out errors);
+        }
+
+        // Walks the profile as crossgen2 does: AssemblyDictionary's ldstr/ldtoken pairs, then each group's ldtokens
+        private static Dictionary<string, List<MethodBase>> ReadMibc(string mibcPath)
+        {
+            byte[] image;
+            using (var zip = ZipFile.OpenRead(mibcPath))
+            using (var entry = zip.Entries.Single().Open())
+            using (var buffer = new MemoryStream())
+            {
+                entry.CopyTo(buffer);
+                image = buffer.ToArray();
+            }
+
+            var loadContext = new AssemblyLoadContext(null, isCollectible: true);
+            try
+            {
+                var module = loadContext.LoadFromStream(new MemoryStream(image)).ManifestModule;
+                var root = module.GetMethods().Single(method => method.Name == "AssemblyDictionary");
+                var groups = new Dictionary<string, List<MethodBase>>();
+                string groupName = null;
+                foreach (var (opcode, token) in ReadTokens(root))
+                {
+                    if (opcode == 0x72) // ldstr
+                        groupName = module.ResolveString(token);
+                    else
+                        groups.Add(groupName, ReadTokens(module.ResolveMethod(token)).Select(entry => module.ResolveMethod(entry.Token)).ToList());
+                }
+                return groups;
+            }
+            finally
+            {
+                loadContext.Unload();
+            }
+        }
+
+        // A MIBC body is ldstr, ldtoken, pop and ret only
+        private static List<(byte Opcode, int Token)> ReadTokens(MethodBase method)
+        {
+            var il = method.GetMethodBody().GetILAsByteArray();
+            var tokens = new List<(byte Opcode, int Token)>();
+            for (int i = 0; i < il.Length; i++)
+            {
+                if (il[i] == 0x72 || il[i] == 0xD0)
+                {
+                    tokens.Add((il[i], BitConverter.ToInt32(il, i + 1)));
+                    i += 4;
+                }
+            }
+            return tokens;
+        }
+
+        private static string Module(ulong moduleId, Assembly assembly)
+        {
+            return $"{{\"ModuleID\":{moduleId},\"ModuleName\":{Quote(assembly.Location)},\"AssemblyID\":{moduleId},\"AssemblyName\":{Quote(assembly.FullName)}}}";
+        }
+
+        private static string Enter3(ulong functionId, ulong moduleId, Type declaringType, MethodBase method,
+            string declaringTypeArgs = null, int declaringCount = 0, string methodTypeArgs = null, int methodCount = 0)
+        {
+            return $"{{\"FunctionID\":{functionId},\"ModuleID\":{moduleId},\"MethodToken\":{method.MetadataToken}," +
+                $"\"DeclaringTypeModuleID\":{moduleId},\"DeclaringTypeToken\":{declaringType.MetadataToken}," +
+                $"\"DeclaringTypeArgCount\":{declaringCount}" + (declaringTypeArgs != null ? $",\"DeclaringTypeArgs\":{declaringTypeArgs}" : "") +
+                $",\"MethodTypeArgCount\":{methodCount}" + (methodTypeArgs != null ? $",\"MethodTypeArgs\":{methodTypeArgs}" : "") + "}";
+        }
+
+        // Every type argument here lives in CoreLib
+        private static string TypeArg(Type type, params string[] nested)
+        {
+            var json = $"{{\"ModuleID\":{CoreLibModuleId},\"TypeDef\":{type.MetadataToken},\"NestedCount\":{nested.Length}";
+            if (nested.Length > 0)
+                json += $",\"Nested\":[{string.Join(",", nested)}]";
+            return json + "}";
+        }
+
+        private static string Quote(string value) => System.Text.Json.JsonSerializer.Serialize(value);
+
+        private void Write(string fileName, params string[] lines)
+        {
+            File.WriteAllText(Path.Combine(_folder, fileName), string.Concat(lines.Select(line => line + "\n")));
+        }
+    }
+}
@@ -0,0 +1,65 @@
+﻿using System.Linq;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class JitTimeReportTests
+    {
+        private const uint E_FAIL = 0x80004005;
+
+        private static JitCompilationMessage Compilation(ulong functionId, ulong start, ulong finish, ulong codeSize = 64, uint hresult = 0) =>
+            new JitCompilationMessage { FunctionID = functionId, Start = start, Finish = finish, CodeSize = codeSize, HResult = hresult };
+
+        [Test]
+        public void Rank_RecompiledMethod_SumsItsCompilations()
+        {
+            // Arrange: tier 1 finishes last but is logged first, as threads flush in any order;
+            // only the first compilation has a code size
+            var compilations = new[]
+            {
+                Compilation(1, 5000, 8000, codeSize: 0),
+                Compilation(1, 0, 2000, codeSize: 90),
+                Compilation(2, 2000, 6000),
+                Compilation(1, 9000, 9500, codeSize: 0, hresult: E_FAIL),
+            };
+
+            // Act
+            var report = JitTimeReport.Rank(compilations);
+
+            // Assert
+            CollectionAssert.AreEqual(new ulong[] { 1, 2 }, report.Methods.Select(x => x.FunctionID));
+            var method = report.Methods[0];
+            Assert.AreEqual(3, method.Compilations);
+            Assert.AreEqual(1, method.Failures);
+            Assert.AreEqual(5500UL, method.TotalTime);
+            Assert.AreEqual(3000UL, method.MaxTime);
+            Assert.AreEqual(90UL, method.CodeSize);
+            Assert.AreEqual(4, report.CompilationCount);
+            Assert.AreEqual(9500UL, report.TotalTime);
+        }
+
+        [Test]
+        public void ToReport_ListsTheSlowestMethods()
+        {
+            // Arrange
+            var report = JitTimeReport.Rank(new[]
+            {
+                Compilation(1, 0, 1500000),
+                Compilation(2, 0, 2500000),
+                Compilation(3, 0, 500000, codeSize: 0, hresult: E_FAIL),
+            });
+            report.Methods[0].Method = "Program.Main(String[])";
+
+            // Act
+            var text = report.ToReport(top: 2);
+
+            // Assert
+            StringAssert.Contains("3 compilations of 3 methods, 4.500 ms in the JIT, 1 failed", text);
+            StringAssert.Contains("2.500      2.500      1       64  Program.Main(String[])", text);
+            StringAssert.Contains("FunctionID 0x1", text);
+            StringAssert.DoesNotContain("FunctionID 0x3", text);
+            StringAssert.Contains("... 1 more", text);
+        }
+    }
+}
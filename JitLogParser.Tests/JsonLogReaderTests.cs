@@ -0,0 +1,382 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class JsonLogReaderTests
+    {
+        private string _folder = null!;
+        private ConcurrentDictionary<ulong, ModuleMessage> _modules = null!;
+        private ConcurrentDictionary<ulong, Enter3Message> _functions = null!;
+        private ConcurrentDictionary<ulong, byte> _jit = null!;
+        private List<string> _errors = null!;
+
+        [SetUp]
+        public void SetUp()
+        {
+            _folder = Path.Combine(Path.GetTempPath(), "JsonLogReaderTests_" + Guid.NewGuid().ToString("N"));
+            Directory.CreateDirectory(_folder);
+            _modules = new ConcurrentDictionary<ulong, ModuleMessage>();
+            _functions = new ConcurrentDictionary<ulong, Enter3Message>();
+            _jit = new ConcurrentDictionary<ulong, byte>();
+            _errors = new List<string>();
+        }
+
+        [TearDown]
+        public void TearDown()
+        {
+            Directory.Delete(_folder, true);
+        }
+
+        [Test]
+        public void Read_AllFiles_PopulatesMaps()
+        {
+            // Arrange
+            Write("modules.json", "{\"ModuleID\":7,\"ModuleName\":\"C:\\\\app\\\\App.dll\",\"AssemblyID\":8,\"AssemblyName\":\"App\"}");
+            Write("enter3.json", "{\"FunctionID\":256,\"ModuleID\":7,\"MethodToken\":100663297,\"DeclaringTypeModuleID\":7,\"DeclaringTypeToken\":33554434,\"DeclaringTypeArgCount\":0,\"MethodTypeArgCount\":0}");
+            Write("jit.json", "{\"FunctionID\":256}", "{\"FunctionID\":512}");
+
+            // Act
+            Read();
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.AreEqual(@"C:\app\App.dll", _modules[7].ModuleName);
+            Assert.AreEqual("App", _modules[7].AssemblyName);
+            Assert.AreEqual(8UL, _modules[7].AssemblyID);
+            Assert.AreEqual(0x06000001u, _functions[256].MethodToken);
+            Assert.AreEqual(0x02000002u, _functions[256].DeclaringTypeToken);
+            Assert.IsNull(_functions[256].DeclaringTypeArgs);
+            CollectionAssert.AreEquivalent(new[] { 256UL, 512UL }, _jit.Keys);
+        }
+
+        [Test]
+        public void Read_NestedTypeArgs_AreRebuilt()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json", "{\"FunctionID\":1,\"DeclaringTypeArgCount\":1,\"DeclaringTypeArgs\":[" +
+                "{\"ModuleID\":7,\"TypeDef\":33554435,\"NestedCount\":2,\"Nested\":[" +
+                "{\"ModuleID\":7,\"TypeDef\":33554436,\"NestedCount\":0},{\"ModuleID\":9,\"TypeDef\":33554437,\"NestedCount\":0}]}]," +
+                "\"MethodTypeArgCount\":1,\"MethodTypeArgs\":[{\"ModuleID\":9,\"TypeDef\":33554438,\"NestedCount\":0}]}");
+            Write("jit.json");
+
+            // Act
+            Read();
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            var typeArg = _functions[1].DeclaringTypeArgs.Single();
+            Assert.AreEqual(0x02000003u, typeArg.TypeDef);
+            Assert.AreEqual(2, typeArg.NestedCount);
+            CollectionAssert.AreEqual(new[] { 0x02000004u, 0x02000005u }, typeArg.Nested.Select(n => n.TypeDef));
+            Assert.AreEqual(9UL, _functions[1].MethodTypeArgs.Single().ModuleID);
+        }
+
+        [Test]
+        public void Read_LinesAcrossChunkBoundaries_AreAllRead()
+        {
+            // Arrange: chunks far smaller than the file, and than some of its lines
+            var ids = Enumerable.Range(1, 2000).Select(i => (ulong)i * 1000003).ToList();
+            Write("modules.json");
+            Write("enter3.json", ids.Select(id => $"{{\"FunctionID\":{id},\"ModuleID\":7,\"MethodToken\":{id % 1000},\"DeclaringTypeArgCount\":0,\"MethodTypeArgCount\":0}}").ToArray());
+            Write("jit.json", ids.Select(id => $"{{\"FunctionID\":{id}}}").ToArray());
+
+            // Act
+            Read(chunkSize: 64);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(ids, _functions.Keys);
+            CollectionAssert.AreEquivalent(ids, _jit.Keys);
+            Assert.AreEqual((uint)(ids[5] % 1000), _functions[ids[5]].MethodToken);
+        }
+
+        [Test]
+        public void Read_UnknownProperties_AreSkipped()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json");
+            Write("jit.json", "{\"Future\":{\"A\":[1,2,{\"B\":null}]},\"FunctionID\":42,\"Other\":\"x\"}");
+
+            // Act
+            Read();
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit.Keys);
+        }
+
+        [Test]
+        public void Read_JitEvents_AreKeptApartFromJitCompiledFunctions()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json");
+            Write("jit.json",
+                "{\"FunctionID\":42}",
+                "{\"FunctionID\":42,\"Event\":\"JitFinished\",\"Start\":1000,\"Finish\":251000,\"CodeSize\":96,\"HResult\":0}",
+                "{\"FunctionID\":43,\"Event\":\"JitFinished\",\"Start\":2000,\"Finish\":3000,\"CodeSize\":0,\"HResult\":2147500037}",
+                "{\"FunctionID\":44,\"Event\":\"FromTheFuture\"}");
+            var events = new ProfilerEvents();
+
+            // Act
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, events: events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit.Keys);
+            var compilations = events.JitCompilations.OrderBy(x => x.FunctionID).ToList();
+            Assert.AreEqual(2, compilations.Count);
+            Assert.AreEqual(250000UL, compilations[0].Duration);
+            Assert.AreEqual(96UL, compilations[0].CodeSize);
+            Assert.IsTrue(compilations[0].Succeeded);
+            Assert.AreEqual(0x80004005u, compilations[1].HResult);
+            Assert.IsFalse(compilations[1].Succeeded);
+        }
+
+        [Test]
+        public void Read_InlinedEvents_CarryTheCalleeDefinition()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json");
+            Write("jit.json",
+                "{\"FunctionID\":42}",
+                "{\"FunctionID\":42,\"Event\":\"Inlined\",\"Callee\":77,\"CalleeModuleID\":7,\"CalleeToken\":100663311}");
+            var events = new ProfilerEvents();
+
+            // Act
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, events: events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit.Keys);
+            var inlining = events.Inlinings.Single();
+            Assert.AreEqual(42UL, inlining.Caller);
+            Assert.AreEqual(77UL, inlining.Callee);
+            Assert.AreEqual(7UL, inlining.CalleeModuleID);
+            Assert.AreEqual(0x0600000Fu, inlining.CalleeToken);
+        }
+
+        [Test]
+        public void Read_TierEvents_AreDispatchedByName()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json");
+            Write("jit.json",
+                "{\"FunctionID\":42,\"Event\":\"CacheHit\",\"Time\":500}",
+                "{\"FunctionID\":42,\"Event\":\"JitFinished\",\"Start\":1000,\"Finish\":2000,\"CodeSize\":96,\"HResult\":0}",
+                "{\"FunctionID\":42,\"Event\":\"SomethingNew\",\"Time\":1}");
+            var events = new ProfilerEvents();
+
+            // Act
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, events: events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.IsEmpty(_jit);
+            Assert.AreEqual(500UL, events.CacheHits.Single().Time);
+            Assert.AreEqual(2000UL, events.JitCompilations.Single().Finish);
+        }
+
+        [Test]
+        public void Read_ModuleEvents_KeepTheModuleRecord()
+        {
+            // Arrange
+            Write("modules.json",
+                "{\"ModuleID\":7,\"ModuleName\":\"App.dll\",\"AssemblyID\":8,\"AssemblyName\":\"App\",\"LoadTime\":1000}",
+                "{\"ModuleID\":7,\"Event\":\"Unloaded\",\"Time\":5000}");
+            Write("enter3.json");
+            Write("jit.json");
+            var events = new ProfilerEvents();
+
+            // Act
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, events: events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            Assert.AreEqual("App.dll", _modules[7].ModuleName);
+            Assert.AreEqual(1000UL, events.ModuleLoads.Single().LoadTime);
+            var unload = events.ModuleUnloads.Single();
+            Assert.AreEqual(7UL, unload.ModuleID);
+            Assert.AreEqual(5000UL, unload.Time);
+        }
+
+        [Test]
+        public void Read_ThreadTags_AreKeptWithTheirRecords()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json",
+                "{\"FunctionID\":42,\"ModuleID\":7,\"MethodToken\":100663311,\"DeclaringTypeModuleID\":7,\"DeclaringTypeToken\":33554434," +
+                "\"DeclaringTypeArgCount\":0,\"MethodTypeArgCount\":0,\"Thread\":1,\"Seq\":2,\"Time\":2000}");
+            Write("jit.json",
+                "{\"Event\":\"Thread\",\"Thread\":1,\"ThreadID\":99,\"Time\":900}",
+                "{\"FunctionID\":42,\"Thread\":1,\"Seq\":1,\"Time\":1000}",
+                "{\"Event\":\"ThreadName\",\"ThreadID\":99,\"Name\":\"Worker\"}");
+            var events = new ProfilerEvents();
+
+            // Act
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, events: events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit.Keys);
+            Assert.AreEqual(2UL, _functions[42].Seq);
+            var start = events.JitStarts.Single();
+            Assert.AreEqual(1u, start.Thread);
+            Assert.AreEqual(1000UL, start.Time);
+            var threadEvents = events.ThreadEvents.OrderBy(x => x.Kind).ToList();
+            Assert.AreEqual(ThreadEventKind.Indexed, threadEvents[0].Kind);
+            Assert.AreEqual(99UL, threadEvents[0].ThreadID);
+            Assert.AreEqual("Worker", threadEvents[1].Name);
+        }
+
+        [Test]
+        public void Read_CallCountEvents_AreNotJitRecords()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json");
+            Write("jit.json",
+                "{\"FunctionID\":42}",
+                "{\"FunctionID\":42,\"Event\":\"CallCount\",\"Count\":5000000000}",
+                "{\"FunctionID\":43,\"Event\":\"CallCount\",\"Count\":1}");
+            var events = new ProfilerEvents();
+
+            // Act
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, events: events);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 42UL }, _jit.Keys);
+            var counts = events.CallCounts.OrderBy(x => x.FunctionID).ToList();
+            Assert.AreEqual(2, counts.Count);
+            Assert.AreEqual(5000000000UL, counts[0].Count);
+            Assert.AreEqual(43UL, counts[1].FunctionID);
+        }
+
+        [Test]
+        public void Read_MalformedLine_IsReportedAndOthersKept()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("enter3.json");
+            Write("jit.json", "{\"FunctionID\":1}", "{\"FunctionID\":", "{\"FunctionID\":\"text\"}", "{\"FunctionID\":3}");
+
+            // Act
+            Read();
+
+            // Assert
+            Assert.AreEqual(2, _errors.Count);
+            CollectionAssert.AreEquivalent(new[] { 1UL, 3UL }, _jit.Keys);
+        }
+
+        [Test]
+        public void Read_ZeroFilledLog_SkipsTheZeros()
+        {
+            // Arrange: a mapped log from a killed process, with a never-copied record in the middle
+            Write("modules.json");
+            Write("enter3.json");
+            File.WriteAllBytes(Path.Combine(_folder, "jit.json"), Encoding.UTF8.GetBytes("{\"FunctionID\":1}\n\0\0\0\0{\"FunctionID\":2}\n")
+                .Concat(new byte[4096]).ToArray());
+
+            // Act
+            Read();
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 1UL, 2UL }, _jit.Keys);
+        }
+
+        [Test]
+        public void Read_MissingFile_ReportsError()
+        {
+            // Arrange
+            Write("modules.json");
+            Write("jit.json", "{\"FunctionID\":1}");
+
+            // Act
+            Read();
+
+            // Assert
+            Assert.AreEqual(1, _errors.Count);
+            StringAssert.StartsWith("Enter3 file not found", _errors[0]);
+            CollectionAssert.AreEquivalent(new[] { 1UL }, _jit.Keys);
+        }
+
+        [Test]
+        public void ReadFrom_LineBeingWritten_IsLeftForTheNextCall()
+        {
+            // Arrange: a live log ending in half a line, then the zeros of a mapped log
+            Write("modules.json");
+            Write("enter3.json");
+            var jitPath = Path.Combine(_folder, "jit.json");
+            File.WriteAllBytes(jitPath, Encoding.UTF8.GetBytes("{\"FunctionID\":1}\n{\"Funct").Concat(new byte[64]).ToArray());
+            var offsets = new JsonLogOffsets();
+
+            // Act
+            JsonLogReader.ReadFrom(offsets, false, Path.Combine(_folder, "modules.json"), Path.Combine(_folder, "enter3.json"), jitPath,
+                _modules, _functions, _jit, _errors);
+            var afterFirstCall = _jit.Keys.ToList();
+            long firstOffset = offsets.Jit;
+            File.WriteAllText(jitPath, "{\"FunctionID\":1}\n{\"FunctionID\":2}\n{\"FunctionID\":3}\n");
+            JsonLogReader.ReadFrom(offsets, false, Path.Combine(_folder, "modules.json"), Path.Combine(_folder, "enter3.json"), jitPath,
+                _modules, _functions, _jit, _errors);
+
+            // Assert
+            Assert.IsEmpty(_errors);
+            CollectionAssert.AreEquivalent(new[] { 1UL }, afterFirstCall);
+            Assert.AreEqual(17L, firstOffset);
+            CollectionAssert.AreEquivalent(new[] { 1UL, 2UL, 3UL }, _jit.Keys);
+            Assert.AreEqual(new FileInfo(jitPath).Length, offsets.Jit);
+        }
+
+        private void Write(string fileName, params string[] lines)
+        {
+            File.WriteAllText(Path.Combine(_folder, fileName), string.Concat(lines.Select(line => line + "\n")));
+        }
+
+        private void Read(int chunkSize = JsonLogReader.DefaultChunkSize)
+        {
+            JsonLogReader.Read(
+                Path.Combine(_folder, "modules.json"),
+                Path.Combine(_folder, "enter3.json"),
+                Path.Combine(_folder, "jit.json"),
+                _modules, _functions, _jit, _errors, chunkSize);
+        }
+    }
+}
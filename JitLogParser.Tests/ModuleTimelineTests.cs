@@ -0,0 +1,50 @@
+﻿using System;
+using System.Linq;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class ModuleTimelineTests
+    {
+        private static ModuleMessage Load(ulong moduleId, string name, ulong loadTime) =>
+            new ModuleMessage { ModuleID = moduleId, ModuleName = name, AssemblyName = name, LoadTime = loadTime };
+
+        private static ModuleUnloadMessage Unload(ulong moduleId, ulong time) =>
+            new ModuleUnloadMessage { ModuleID = moduleId, Time = time };
+
+        [Test]
+        public void Build_ReusedModuleId_PairsEachUnloadWithItsLoad()
+        {
+            // Arrange: 7 is unloaded, then reused for another module; 9 was logged on first use
+            var loads = new[] { Load(9, "Lazy", 0), Load(7, "Second", 6000), Load(7, "First", 2000), Load(8, "Other", 1000) };
+            var unloads = new[] { Unload(7, 5000) };
+
+            // Act
+            var timeline = ModuleTimeline.Build(loads, unloads);
+
+            // Assert
+            CollectionAssert.AreEqual(new[] { "Other", "First", "Second", "Lazy" }, timeline.Modules.Select(x => x.ModuleName));
+            Assert.AreEqual(1000UL, timeline.Start);
+            Assert.AreEqual(5000UL, timeline.Modules[1].UnloadTime);
+            Assert.IsNull(timeline.Modules[2].UnloadTime);
+        }
+
+        [Test]
+        public void ToReport_CountsFromTheFirstLoad()
+        {
+            // Arrange
+            var timeline = ModuleTimeline.Build(
+                new[] { Load(8, "App.dll", 1000000), Load(7, "Lib.dll", 3000000), Load(9, "Lazy.dll", 0) },
+                new[] { Unload(7, 4000000) });
+
+            // Act
+            var report = timeline.ToReport();
+
+            // Assert
+            StringAssert.Contains("3 modules, 1 unloaded, 1 logged on first use; loads span 2.000 ms", report);
+            StringAssert.Contains("     2.000      3.000  Lib.dll [Lib.dll]", report);
+            StringAssert.Contains("         -             Lazy.dll [Lazy.dll]", report);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+﻿using System;
+using System.Linq;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class ThreadTimelineTests
+    {
+        private static JitStartMessage JitStart(ulong functionId, uint thread, ulong seq, ulong time) =>
+            new JitStartMessage { FunctionID = functionId, Thread = thread, Seq = seq, Time = time };
+
+        private static Enter3Message Enter3(ulong functionId, uint thread, ulong seq, ulong time) =>
+            new Enter3Message { FunctionID = functionId, Thread = thread, Seq = seq, Time = time };
+
+        [Test]
+        public void Build_AttributesFirstCompilationsToTheStartingThread()
+        {
+            // Arrange: thread 1 is named, thread 2 starts later and compiles the slow method
+            var threadEvents = new[]
+            {
+                new ThreadEventMessage { Kind = ThreadEventKind.Indexed, Thread = 1, ThreadID = 99 },
+                new ThreadEventMessage { Kind = ThreadEventKind.Named, ThreadID = 99, Name = "Main" },
+                new ThreadEventMessage { Kind = ThreadEventKind.Indexed, Thread = 2, ThreadID = 0 },
+            };
+            var jitStarts = new[] { JitStart(10, 1, 1, 1000), JitStart(20, 2, 1, 5000) };
+            var enter3 = new[] { Enter3(10, 1, 2, 3000), Enter3(30, 0, 0, 0) };
+            var compilations = new[]
+            {
+                new JitCompilationMessage { FunctionID = 20, Start = 5000, Finish = 9000 },
+                new JitCompilationMessage { FunctionID = 20, Start = 20000, Finish = 90000 },
+            };
+
+            // Act
+            var timeline = ThreadTimeline.Build(threadEvents, jitStarts, enter3, compilations);
+
+            // Assert
+            CollectionAssert.AreEqual(new uint[] { 1, 2 }, timeline.Threads.Select(x => x.Index));
+            Assert.AreEqual(1000UL, timeline.Start);
+            Assert.AreEqual("Main", timeline.Threads[0].ToString());
+            Assert.AreEqual(3000UL, timeline.Threads[0].LastTime);
+            Assert.AreEqual("unmanaged", timeline.Threads[1].ToString());
+            Assert.AreEqual(4000UL, timeline.Threads[1].JitTime);
+            Assert.AreEqual(0UL, timeline.Threads[0].JitTime);
+        }
+
+        [Test]
+        public void ToReport_ListsThreadsFromTheFirstRecord()
+        {
+            // Arrange
+            var timeline = ThreadTimeline.Build(
+                new[] { new ThreadEventMessage { Kind = ThreadEventKind.Indexed, Thread = 1, ThreadID = 0x63 } },
+                new[] { JitStart(10, 1, 1, 1000000), JitStart(11, 1, 3, 4000000) },
+                new[] { Enter3(10, 1, 2, 2000000) },
+                Array.Empty<JitCompilationMessage>());
+
+            // Act
+            var report = timeline.ToReport();
+
+            // Assert
+            StringAssert.Contains("1 threads, 2 JIT starts, 1 first calls", report);
+            StringAssert.Contains("     0.000      3.000      2      1      0.000  #1 ThreadID 0x63", report);
+        }
+    }
+}
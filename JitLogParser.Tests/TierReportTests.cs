@@ -0,0 +1,61 @@
+﻿using System;
+using System.Linq;
+using JitLogParser;
+
+namespace YourNamespace.Tests
+{
+    [TestFixture]
+    public class TierReportTests
+    {
+        private static JitCompilationMessage Compilation(ulong functionId, ulong start, ulong finish, uint hresult = 0) =>
+            new JitCompilationMessage { FunctionID = functionId, Start = start, Finish = finish, HResult = hresult };
+
+        [Test]
+        public void Build_NumbersRecompilesFromTheFirstCode()
+        {
+            // Arrange: 1 is jitted then recompiled twice, e.g. OSR then tier 1; 2 ran precompiled
+            // code first; 3's only recompile failed
+            var compilations = new[]
+            {
+                Compilation(1, 70000, 80000),
+                Compilation(1, 1000, 2000),
+                Compilation(1, 50000, 60000),
+                Compilation(2, 30000, 40000),
+                Compilation(3, 5000, 6000),
+                Compilation(3, 7000, 8000, hresult: 0x80004005),
+            };
+            var cacheHits = new[] { new CacheHitMessage { FunctionID = 2, Time = 100 } };
+
+            // Act
+            var report = TierReport.Build(compilations, cacheHits);
+
+            // Assert
+            CollectionAssert.AreEqual(new ulong[] { 1, 2, 3 }, report.Methods.Select(x => x.FunctionID));
+            Assert.AreEqual(2, report.Methods[0].LastRecompile);
+            Assert.AreEqual(79000UL, report.Methods[0].TimeToLastRecompile);
+            Assert.AreEqual(3, report.Methods[0].Compilations);
+            Assert.AreEqual(1, report.Methods[1].LastRecompile);
+            Assert.AreEqual(39900UL, report.Methods[1].TimeToLastRecompile);
+            Assert.IsTrue(report.Methods[1].Precompiled);
+            Assert.AreEqual(0, report.Methods[2].LastRecompile);
+            Assert.IsNull(report.Methods[2].TimeToLastRecompile);
+        }
+
+        [Test]
+        public void ToReport_LabelsTheLastRecompile()
+        {
+            // Arrange
+            var compilations = new[] { Compilation(1, 1000, 2000), Compilation(1, 3000, 4000) };
+            var report = TierReport.Build(compilations, Array.Empty<CacheHitMessage>());
+            report.Methods[0].Method = "MethodSample.InstanceNoArgs()";
+
+            // Act
+            var text = report.ToReport();
+
+            // Assert
+            StringAssert.Contains("1 methods, 0 precompiled, 1 recompiled", text);
+            StringAssert.Contains("The tier of a", text);
+            StringAssert.Contains("     0.003 recompile 1       2       MethodSample.InstanceNoArgs()", text);
+        }
+    }
+}
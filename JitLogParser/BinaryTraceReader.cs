@@ -0,0 +1,523 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace JitLogParser
+{
+    /// <summary>
+    /// Reader for the binary trace written by the profiler when SIG_JIT_PROFILER_FORMAT=binary.
+    /// See TraceFormat.h in JitProfilerPlugin for the layout.
+    /// </summary>
+    public static class BinaryTraceReader
+    {
+        public const string DefaultFileName = "trace.bin";
+
+        public const ushort SupportedVersion = 1;
+
+        private static readonly byte[] Magic = { (byte)'S', (byte)'J', (byte)'P', (byte)'T' };
+
+        private const int RecordHeaderSize = 8;
+
+        private enum RecordType : byte
+        {
+            // Never written; the unused tail of a mapped trace whose process was killed
+            Unwritten = 0,
+            Module = 1,
+            Jit = 2,
+            Enter3 = 3,
+            JitFinished = 4,
+            Inlining = 5,
+            CacheHit = 6,
+            ModuleUnload = 8,
+            Thread = 9,
+            ThreadCreated = 10,
+            ThreadDestroyed = 11,
+            ThreadAssigned = 12,
+            ThreadName = 13,
+            CallCount = 14,
+        }
+
+        /// <summary>
+        /// Reads a binary trace and fills the same maps the JSON parser builds from modules.json, enter3.json and jit.json.
+        /// </summary>
+        /// <param name="filePath">Path to the trace.bin file</param>
+        /// <param name="moduleMap">Receives ModuleID -> module record</param>
+        /// <param name="functionMap">Receives FunctionID -> Enter3 record</param>
+        /// <param name="jitFunctionIds">Receives the FunctionIDs that were JIT compiled</param>
+        /// <param name="errors">Receives format errors; reading stops at the first one</param>
+        /// <param name="events">Receives the other events in the trace, e.g. JIT timings; null to skip them</param>
+        public static void Read(
+            string filePath,
+            Dictionary<ulong, ModuleMessage> moduleMap,
+            Dictionary<ulong, Enter3Message> functionMap,
+            HashSet<ulong> jitFunctionIds,
+            List<string> errors,
+            ProfilerEvents events = null)
+        {
+            if (!File.Exists(filePath))
+            {
+                errors.Add($"Binary trace file not found: {filePath}");
+                return;
+            }
+
+            try
+            {
+                using (var stream = new FileStream(filePath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite, 1 << 16, FileOptions.SequentialScan))
+                {
+                    Read(stream, moduleMap, functionMap, jitFunctionIds, errors, events);
+                }
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Error reading binary trace file: {ex.Message}");
+            }
+        }
+
+        /// <summary>
+        /// Reads a binary trace from a stream positioned at the file header.
+        /// </summary>
+        public static void Read(
+            Stream stream,
+            Dictionary<ulong, ModuleMessage> moduleMap,
+            Dictionary<ulong, Enter3Message> functionMap,
+            HashSet<ulong> jitFunctionIds,
+            List<string> errors,
+            ProfilerEvents events = null)
+        {
+            int headerSize = ReadHeader(stream, errors);
+            if (headerSize > 0)
+                ReadRecords(stream, headerSize, false, moduleMap, functionMap, jitFunctionIds, errors, events);
+        }
+
+        /// <summary>
+        /// Reads the records a trace the profiler is still writing gained since offset. Only whole
+        /// records are read: one still being written, or in a mapped trace the first one the profiler
+        /// has reserved but not copied yet, and everything after it, is left for the next call.
+        /// </summary>
+        /// <param name="filePath">Path to the trace.bin file</param>
+        /// <param name="offset">Where the previous call stopped, 0 the first time</param>
+        /// <param name="toEnd">The profiler has stopped writing: as in Read, a truncated last record is an error and the records after a zero gap are read</param>
+        /// <param name="moduleMap">Receives ModuleID -> module record</param>
+        /// <param name="functionMap">Receives FunctionID -> Enter3 record</param>
+        /// <param name="jitFunctionIds">Receives the FunctionIDs that were JIT compiled</param>
+        /// <param name="errors">Receives format errors; reading stops at the first one</param>
+        /// <param name="events">Receives the other events in the trace, e.g. JIT timings; null to skip them</param>
+        /// <returns>The offset after the last record read</returns>
+        public static long ReadFrom(
+            string filePath,
+            long offset,
+            bool toEnd,
+            Dictionary<ulong, ModuleMessage> moduleMap,
+            Dictionary<ulong, Enter3Message> functionMap,
+            HashSet<ulong> jitFunctionIds,
+            List<string> errors,
+            ProfilerEvents events = null)
+        {
+            if (!File.Exists(filePath))
+            {
+                errors.Add($"Binary trace file not found: {filePath}");
+                return offset;
+            }
+
+            try
+            {
+                using (var stream = new FileStream(filePath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite, 1 << 16, FileOptions.SequentialScan))
+                {
+                    if (offset == 0)
+                    {
+                        // The profiler writes the header first; until it is all there, there is nothing to read
+                        if (stream.Length < 16 || stream.Length < BitConverter.ToUInt16(ReadPrefix(stream, 8), 6))
+                            return 0;
+
+                        stream.Position = 0;
+                        offset = ReadHeader(stream, errors);
+                        if (offset <= 0)
+                            return 0;
+                    }
+
+                    stream.Position = offset;
+                    return ReadRecords(stream, offset, !toEnd, moduleMap, functionMap, jitFunctionIds, errors, events);
+                }
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Error reading binary trace file: {ex.Message}");
+                return offset;
+            }
+        }
+
+        // Returns the header size, which is where the records start, or 0 after adding an error.
+        private static int ReadHeader(Stream stream, List<string> errors)
+        {
+            var fileHeader = new byte[16];
+            if (!ReadExactly(stream, fileHeader, fileHeader.Length))
+            {
+                errors.Add("Binary trace is too short to contain a header");
+                return 0;
+            }
+
+            for (int i = 0; i < Magic.Length; i++)
+            {
+                if (fileHeader[i] != Magic[i])
+                {
+                    errors.Add("Binary trace has an invalid signature");
+                    return 0;
+                }
+            }
+
+            ushort version = BitConverter.ToUInt16(fileHeader, 4);
+            ushort headerSize = BitConverter.ToUInt16(fileHeader, 6);
+            if (version != SupportedVersion)
+            {
+                errors.Add($"Binary trace version {version} is not supported (expected {SupportedVersion})");
+                return 0;
+            }
+
+            // Skip header fields added by later minor revisions
+            if (headerSize > fileHeader.Length && !Skip(stream, headerSize - fileHeader.Length))
+            {
+                errors.Add("Binary trace header is truncated");
+                return 0;
+            }
+
+            return Math.Max(headerSize, fileHeader.Length);
+        }
+
+        // Returns the offset after the last whole record. A truncated record is an error unless
+        // the trace is still being written.
+        private static long ReadRecords(
+            Stream stream,
+            long offset,
+            bool live,
+            Dictionary<ulong, ModuleMessage> moduleMap,
+            Dictionary<ulong, Enter3Message> functionMap,
+            HashSet<ulong> jitFunctionIds,
+            List<string> errors,
+            ProfilerEvents events)
+        {
+            var recordHeader = new byte[RecordHeaderSize];
+            var payload = new byte[256];
+
+            while (true)
+            {
+                int read = ReadUpTo(stream, recordHeader, RecordHeaderSize);
+
+                // SIG_JIT_PROFILER_SINK=mapped reserves a record before copying it, so a killed
+                // process can leave zeros in front of records that were copied. A live trace
+                // stops there instead, as the copy may still be under way.
+                if (!live && read > 0 && recordHeader[0] == (byte)RecordType.Unwritten)
+                    read = SkipUnwritten(stream, recordHeader, read, ref offset);
+
+                if (read == 0)
+                    break;
+
+                // A process killed mid-write leaves a partial record at the end
+                if (read < RecordHeaderSize)
+                {
+                    if (!live)
+                        errors.Add($"Binary trace ends with a truncated record header at offset {offset}");
+                    break;
+                }
+
+                var type = (RecordType)recordHeader[0];
+                int length = (int)BitConverter.ToUInt32(recordHeader, 4);
+
+                // A mapped trace grows in zeroed extents that are only trimmed on a clean
+                // shutdown, and a live one may have a record reserved but not copied yet
+                if (type == RecordType.Unwritten)
+                    break;
+
+                if (payload.Length < length)
+                    payload = new byte[Math.Max(length, payload.Length * 2)];
+
+                if (!ReadExactly(stream, payload, length))
+                {
+                    if (!live)
+                        errors.Add($"Binary trace ends with a truncated record at offset {offset}");
+                    break;
+                }
+
+                try
+                {
+                    var reader = new PayloadReader(payload, length);
+                    switch (type)
+                    {
+                        case RecordType.Module:
+                            {
+                                var msg = ReadModule(ref reader);
+                                moduleMap[msg.ModuleID] = msg;
+                                events?.ModuleLoads.Enqueue(msg);
+                                break;
+                            }
+                        case RecordType.Jit:
+                            {
+                                ulong functionId = reader.ReadVarint();
+                                jitFunctionIds.Add(functionId);
+                                // The thread tag of SIG_JIT_PROFILER_THREADS=1
+                                if (!reader.AtEnd)
+                                    events?.JitStarts.Enqueue(new JitStartMessage { FunctionID = functionId, Thread = (uint)reader.ReadVarint(), Seq = reader.ReadVarint(), Time = reader.ReadVarint() });
+                                break;
+                            }
+                        case RecordType.Enter3:
+                            {
+                                var msg = ReadEnter3(ref reader);
+                                functionMap[msg.FunctionID] = msg;
+                                break;
+                            }
+                        case RecordType.JitFinished:
+                            events?.JitCompilations.Enqueue(ReadJitFinished(ref reader));
+                            break;
+                        case RecordType.Inlining:
+                            events?.Inlinings.Enqueue(ReadInlining(ref reader));
+                            break;
+                        case RecordType.CacheHit:
+                            events?.CacheHits.Enqueue(new CacheHitMessage { FunctionID = reader.ReadVarint(), Time = reader.ReadVarint() });
+                            break;
+                        case RecordType.Thread:
+                            events?.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Indexed, Thread = (uint)reader.ReadVarint(), ThreadID = reader.ReadVarint(), Time = reader.ReadVarint() });
+                            break;
+                        case RecordType.ThreadCreated:
+                            events?.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Created, ThreadID = reader.ReadVarint(), Time = reader.ReadVarint() });
+                            break;
+                        case RecordType.ThreadDestroyed:
+                            events?.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Destroyed, ThreadID = reader.ReadVarint(), Time = reader.ReadVarint() });
+                            break;
+                        case RecordType.ThreadAssigned:
+                            events?.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Assigned, ThreadID = reader.ReadVarint(), OSThreadID = (uint)reader.ReadVarint() });
+                            break;
+                        case RecordType.ThreadName:
+                            events?.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Named, ThreadID = reader.ReadVarint(), Name = reader.ReadString() });
+                            break;
+                        case RecordType.CallCount:
+                            events?.CallCounts.Enqueue(new CallCountMessage { FunctionID = reader.ReadVarint(), Count = reader.ReadVarint() });
+                            break;
+                        case RecordType.ModuleUnload:
+                            events?.ModuleUnloads.Enqueue(new ModuleUnloadMessage { ModuleID = reader.ReadVarint(), Time = reader.ReadVarint() });
+                            break;
+                        default:
+                            // Unknown record types from newer profilers are skipped by length
+                            break;
+                    }
+                }
+                catch (FormatException ex)
+                {
+                    errors.Add($"Malformed {type} record at offset {offset}: {ex.Message}");
+                }
+
+                offset += RecordHeaderSize + length;
+            }
+
+            return offset;
+        }
+
+        private static ModuleMessage ReadModule(ref PayloadReader reader)
+        {
+            return new ModuleMessage
+            {
+                ModuleID = reader.ReadVarint(),
+                AssemblyID = reader.ReadVarint(),
+                ModuleName = reader.ReadString(),
+                AssemblyName = reader.ReadString(),
+                LoadTime = reader.ReadVarint()
+            };
+        }
+
+        private static JitCompilationMessage ReadJitFinished(ref PayloadReader reader)
+        {
+            var msg = new JitCompilationMessage
+            {
+                FunctionID = reader.ReadVarint(),
+                Start = reader.ReadVarint()
+            };
+
+            msg.Finish = msg.Start + reader.ReadVarint();
+            msg.CodeSize = reader.ReadVarint();
+            msg.HResult = (uint)reader.ReadVarint();
+            return msg;
+        }
+
+        private static InliningMessage ReadInlining(ref PayloadReader reader)
+        {
+            return new InliningMessage
+            {
+                Caller = reader.ReadVarint(),
+                Callee = reader.ReadVarint(),
+                CalleeModuleID = reader.ReadVarint(),
+                CalleeToken = reader.ReadToken()
+            };
+        }
+
+        private static Enter3Message ReadEnter3(ref PayloadReader reader)
+        {
+            var msg = new Enter3Message
+            {
+                FunctionID = reader.ReadVarint(),
+                ModuleID = reader.ReadVarint(),
+                MethodToken = reader.ReadToken(),
+                DeclaringTypeModuleID = reader.ReadVarint(),
+                DeclaringTypeToken = reader.ReadToken()
+            };
+
+            msg.DeclaringTypeArgCount = (int)reader.ReadVarint();
+            msg.DeclaringTypeArgs = ReadTypeArgs(ref reader, msg.DeclaringTypeArgCount);
+            msg.MethodTypeArgCount = (int)reader.ReadVarint();
+            msg.MethodTypeArgs = ReadTypeArgs(ref reader, msg.MethodTypeArgCount);
+
+            // The thread tag of SIG_JIT_PROFILER_THREADS=1
+            if (!reader.AtEnd)
+            {
+                msg.Thread = (uint)reader.ReadVarint();
+                msg.Seq = reader.ReadVarint();
+                msg.Time = reader.ReadVarint();
+            }
+            return msg;
+        }
+
+        private static List<TypeArgMessage> ReadTypeArgs(ref PayloadReader reader, int count)
+        {
+            if (count == 0)
+                return null;
+
+            var list = new List<TypeArgMessage>(count);
+            for (int i = 0; i < count; i++)
+            {
+                list.Add(ReadTypeArg(ref reader));
+            }
+            return list;
+        }
+
+        private static TypeArgMessage ReadTypeArg(ref PayloadReader reader)
+        {
+            var msg = new TypeArgMessage
+            {
+                ModuleID = reader.ReadVarint(),
+                TypeDef = reader.ReadToken()
+            };
+
+            ulong nested = reader.ReadVarint();
+            bool truncated = (nested & 1) != 0;
+            msg.NestedCount = (int)(nested >> 1);
+
+            if (!truncated && msg.NestedCount > 0)
+            {
+                msg.Nested = ReadTypeArgs(ref reader, msg.NestedCount);
+            }
+
+            return msg;
+        }
+
+        private static bool ReadExactly(Stream stream, byte[] buffer, int count)
+        {
+            return ReadUpTo(stream, buffer, count) == count;
+        }
+
+        private static int ReadUpTo(Stream stream, byte[] buffer, int count)
+        {
+            return ReadUpTo(stream, buffer, 0, count);
+        }
+
+        private static int ReadUpTo(Stream stream, byte[] buffer, int start, int count)
+        {
+            int total = 0;
+            while (total < count)
+            {
+                int read = stream.Read(buffer, start + total, count - total);
+                if (read == 0)
+                    break;
+                total += read;
+            }
+            return total;
+        }
+
+        // Skips zeros until the first byte of the next record, which is never zero, and
+        // moves it to the front of the header. Returns the header bytes read, 0 when only
+        // zeros were left.
+        private static int SkipUnwritten(Stream stream, byte[] header, int read, ref long offset)
+        {
+            while (true)
+            {
+                int zeros = 0;
+                while (zeros < read && header[zeros] == 0)
+                    zeros++;
+                offset += zeros;
+
+                if (zeros < read)
+                {
+                    read -= zeros;
+                    Buffer.BlockCopy(header, zeros, header, 0, read);
+                    return read + ReadUpTo(stream, header, read, header.Length - read);
+                }
+
+                read = ReadUpTo(stream, header, header.Length);
+                if (read == 0)
+                    return 0;
+            }
+        }
+
+        private static bool Skip(Stream stream, int count)
+        {
+            var scratch = new byte[count];
+            return ReadExactly(stream, scratch, count);
+        }
+
+        private static byte[] ReadPrefix(Stream stream, int count)
+        {
+            var prefix = new byte[count];
+            ReadExactly(stream, prefix, count);
+            return prefix;
+        }
+
+        private struct PayloadReader
+        {
+            private readonly byte[] _buffer;
+            private readonly int _length;
+            private int _position;
+
+            public PayloadReader(byte[] buffer, int length)
+            {
+                _buffer = buffer;
+                _length = length;
+                _position = 0;
+            }
+
+            public bool AtEnd => _position >= _length;
+
+            public ulong ReadVarint()
+            {
+                ulong value = 0;
+                int shift = 0;
+                while (true)
+                {
+                    if (_position >= _length)
+                        throw new FormatException("varint runs past the end of the record");
+                    if (shift > 63)
+                        throw new FormatException("varint is too long");
+
+                    byte b = _buffer[_position++];
+                    value |= (ulong)(b & 0x7F) << shift;
+                    if ((b & 0x80) == 0)
+                        return value;
+                    shift += 7;
+                }
+            }
+
+            public uint ReadToken()
+            {
+                ulong encoded = ReadVarint();
+                return (uint)((encoded >> 8) | ((encoded & 0xFF) << 24));
+            }
+
+            public string ReadString()
+            {
+                int length = (int)ReadVarint();
+                if (length < 0 || _position + length > _length)
+                    throw new FormatException("string runs past the end of the record");
+
+                var value = Encoding.UTF8.GetString(_buffer, _position, length);
+                _position += length;
+                return value;
+            }
+        }
+    }
+}
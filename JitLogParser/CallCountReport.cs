@@ -0,0 +1,116 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Globalization;
+    using System.Linq;
+    using System.Text;
+
+    /// <summary>
+    /// Ranks the methods of a run by how often they were called, from the CallCount records the
+    /// profiler writes with SIG_JIT_PROFILER_CALL_COUNTS=1, and groups them into a histogram of
+    /// calls per method by powers of ten. Each record holds the calls since the function's
+    /// previous one, so a run that was killed still ranks what it counted until shortly before.
+    /// </summary>
+    public sealed class CallCountReport
+    {
+        public sealed class MethodCalls
+        {
+            public ulong FunctionID { get; set; }
+
+            // Pretty signature, or null when the function has no Enter3 record
+            public string Method { get; set; }
+
+            public ulong Calls { get; set; }
+        }
+
+        public sealed class Bucket
+        {
+            // Methods called more than the previous bucket's UpTo and at most UpTo times
+            public ulong UpTo { get; set; }
+
+            public int Methods { get; set; }
+
+            public ulong Calls { get; set; }
+        }
+
+        // Most called first
+        public List<MethodCalls> Methods { get; } = new List<MethodCalls>();
+
+        // From the fewest calls up, without empty buckets
+        public List<Bucket> Histogram { get; } = new List<Bucket>();
+
+        public ulong TotalCalls => Methods.Aggregate(0UL, (sum, x) => sum + x.Calls);
+
+        // Ranks a run read by JitProfilerLogParser.ReadEvents and names its methods from PE metadata
+        public static CallCountReport Rank(ProfilerRun run, string executablePath, List<string> errors)
+        {
+            var report = Rank(run.Events.CallCounts);
+            var names = JitProfilerLogParser.NameMethods(run, report.Methods.Select(x => x.FunctionID).ToList(), executablePath, errors);
+            for (int i = 0; i < names.Length; i++)
+                report.Methods[i].Method = names[i];
+            return report;
+        }
+
+        public static CallCountReport Rank(IEnumerable<CallCountMessage> callCounts)
+        {
+            if (callCounts == null) throw new ArgumentNullException(nameof(callCounts));
+
+            // A function's records add up to its calls
+            var byFunction = new Dictionary<ulong, MethodCalls>();
+            foreach (var message in callCounts)
+            {
+                if (!byFunction.TryGetValue(message.FunctionID, out var entry))
+                {
+                    entry = new MethodCalls { FunctionID = message.FunctionID };
+                    byFunction.Add(message.FunctionID, entry);
+                }
+                entry.Calls += message.Count;
+            }
+
+            var report = new CallCountReport();
+            report.Methods.AddRange(byFunction.Values.OrderByDescending(x => x.Calls).ThenBy(x => x.FunctionID));
+
+            foreach (var group in report.Methods.GroupBy(x => UpperBound(x.Calls)).OrderBy(g => g.Key))
+                report.Histogram.Add(new Bucket { UpTo = group.Key, Methods = group.Count(), Calls = group.Aggregate(0UL, (sum, x) => sum + x.Calls) });
+            return report;
+        }
+
+        public string ToReport(int top = 50)
+        {
+            ulong total = TotalCalls;
+            var sb = new StringBuilder();
+            sb.AppendLine($"{total} calls to {Methods.Count} methods");
+            sb.AppendLine();
+            sb.AppendLine($"{"Calls <=",20} {"Methods",8} {"% calls",8}");
+            foreach (var bucket in Histogram)
+                sb.AppendLine($"{bucket.UpTo,20} {bucket.Methods,8} {FormatPercent(bucket.Calls, total),8}");
+
+            sb.AppendLine();
+            sb.AppendLine($"{"Calls",20} {"% calls",8}  Method");
+            foreach (var method in Methods.Take(top))
+            {
+                var name = method.Method ?? $"FunctionID 0x{method.FunctionID:X}";
+                sb.AppendLine($"{method.Calls,20} {FormatPercent(method.Calls, total),8}  {name}");
+            }
+
+            if (Methods.Count > top)
+                sb.AppendLine($"... {Methods.Count - top} more");
+            return sb.ToString();
+        }
+
+        // The smallest power of ten at or above calls
+        private static ulong UpperBound(ulong calls)
+        {
+            ulong bound = 1;
+            while (bound < calls && bound <= ulong.MaxValue / 10)
+                bound *= 10;
+            return bound < calls ? ulong.MaxValue : bound;
+        }
+
+        private static string FormatPercent(ulong calls, ulong total)
+        {
+            return (total != 0 ? 100.0 * calls / total : 0).ToString("0.00", CultureInfo.InvariantCulture);
+        }
+    }
+}
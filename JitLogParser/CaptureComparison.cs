@@ -0,0 +1,128 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Linq;
+    using System.Reflection;
+    using System.Text;
+
+    /// <summary>
+    /// Compares the methods captured by two profiler runs, typically the same workload
+    /// under two SIG_JIT_PROFILER_CAPTURE_MODE settings (enter3 against jit).
+    /// Methods are matched on their pretty signature. A method seen by one run only is
+    /// still "covered" when the other run captured the same shared code, that is the
+    /// same definition with reference type arguments replaced by System.__Canon.
+    /// </summary>
+    public sealed class CaptureComparison
+    {
+        public const string CanonTypeName = "System.__Canon";
+
+        public List<MethodBase> Common { get; } = new List<MethodBase>();
+
+        public List<MethodBase> OnlyInBaseline { get; } = new List<MethodBase>();
+
+        public List<MethodBase> OnlyInCandidate { get; } = new List<MethodBase>();
+
+        // Subsets of OnlyInBaseline / OnlyInCandidate whose shared code the other run captured
+        public List<MethodBase> BaselineCoveredBySharedCode { get; } = new List<MethodBase>();
+
+        public List<MethodBase> CandidateCoveredBySharedCode { get; } = new List<MethodBase>();
+
+        public static CaptureComparison Compare(IEnumerable<MethodBase> baseline, IEnumerable<MethodBase> candidate)
+        {
+            if (baseline == null) throw new ArgumentNullException(nameof(baseline));
+            if (candidate == null) throw new ArgumentNullException(nameof(candidate));
+
+            var baselineBySignature = IndexBySignature(baseline);
+            var candidateBySignature = IndexBySignature(candidate);
+            var baselineShared = new HashSet<string>(baselineBySignature.Values.Select(GetSharedCodeKey));
+            var candidateShared = new HashSet<string>(candidateBySignature.Values.Select(GetSharedCodeKey));
+
+            var result = new CaptureComparison();
+            foreach (var entry in baselineBySignature)
+            {
+                if (candidateBySignature.ContainsKey(entry.Key))
+                {
+                    result.Common.Add(entry.Value);
+                    continue;
+                }
+
+                result.OnlyInBaseline.Add(entry.Value);
+                if (candidateShared.Contains(GetSharedCodeKey(entry.Value)))
+                    result.BaselineCoveredBySharedCode.Add(entry.Value);
+            }
+
+            foreach (var entry in candidateBySignature)
+            {
+                if (baselineBySignature.ContainsKey(entry.Key))
+                    continue;
+
+                result.OnlyInCandidate.Add(entry.Value);
+                if (baselineShared.Contains(GetSharedCodeKey(entry.Value)))
+                    result.CandidateCoveredBySharedCode.Add(entry.Value);
+            }
+
+            return result;
+        }
+
+        public string ToReport(string baselineName = "baseline", string candidateName = "candidate")
+        {
+            var sb = new StringBuilder();
+            sb.AppendLine($"{baselineName}: {Common.Count + OnlyInBaseline.Count} methods, {candidateName}: {Common.Count + OnlyInCandidate.Count} methods");
+            sb.AppendLine($"Captured by both: {Common.Count}");
+
+            AppendSection(sb, $"Only in {baselineName}, shared code captured by {candidateName}", BaselineCoveredBySharedCode);
+            AppendSection(sb, $"Only in {baselineName}", OnlyInBaseline.Except(BaselineCoveredBySharedCode));
+            AppendSection(sb, $"Only in {candidateName}, covers instantiations in {baselineName}", CandidateCoveredBySharedCode);
+            AppendSection(sb, $"Only in {candidateName}", OnlyInCandidate.Except(CandidateCoveredBySharedCode));
+            return sb.ToString();
+        }
+
+        /// <summary>
+        /// Identity of the native code a method shares with its sibling instantiations:
+        /// the method definition plus its type arguments, with every reference type
+        /// argument written as System.__Canon.
+        /// </summary>
+        public static string GetSharedCodeKey(MethodBase method)
+        {
+            var typeArgs = new List<Type>();
+            if (method.DeclaringType != null && method.DeclaringType.IsGenericType)
+                typeArgs.AddRange(method.DeclaringType.GetGenericArguments());
+            if (method.IsGenericMethod)
+                typeArgs.AddRange(method.GetGenericArguments());
+
+            return $"{method.Module.ModuleVersionId}:{method.MetadataToken:X8}<{string.Join(",", typeArgs.Select(GetSharedTypeName))}>";
+        }
+
+        private static string GetSharedTypeName(Type type)
+        {
+            if (type.IsGenericParameter)
+                return type.Name;
+            if (!type.IsValueType)
+                return CanonTypeName;
+            if (type.IsGenericType)
+                return $"{type.GetGenericTypeDefinition().FullName}[{string.Join(",", type.GetGenericArguments().Select(GetSharedTypeName))}]";
+            return type.FullName ?? type.Name;
+        }
+
+        private static Dictionary<string, MethodBase> IndexBySignature(IEnumerable<MethodBase> methods)
+        {
+            var index = new Dictionary<string, MethodBase>();
+            foreach (var method in methods)
+            {
+                if (method != null)
+                    index.TryAdd(method.ToPrettySignature(), method);
+            }
+            return index;
+        }
+
+        private static void AppendSection(StringBuilder sb, string title, IEnumerable<MethodBase> methods)
+        {
+            var signatures = methods.Select(x => x.ToPrettySignature()).OrderBy(x => x, StringComparer.Ordinal).ToList();
+            sb.AppendLine();
+            sb.AppendLine($"{title}: {signatures.Count}");
+            foreach (var signature in signatures)
+                sb.AppendLine("  " + signature);
+        }
+    }
+}
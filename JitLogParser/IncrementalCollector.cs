@@ -0,0 +1,390 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Text.Json;
+
+namespace JitLogParser
+{
+    /// <summary>
+    /// Collects the manifest of a process while it runs. Each pass reads only what the logs gained
+    /// since the previous one, resolves the functions whose JIT event and Enter3 record have both
+    /// arrived, and appends their nodes to jitManifest.json.
+    /// Where each file was read up to, the module records, the records still waiting for their
+    /// other half and the FunctionIDs already resolved are saved to a checkpoint next to the logs,
+    /// so a later collector on the same folder carries on instead of starting over.
+    /// One pass at a time; passes are not thread-safe.
+    /// </summary>
+    public sealed class IncrementalCollector
+    {
+        public const string CheckpointFileName = "jitCheckpoint.json";
+        public const string ManifestFileName = "jitManifest.json";
+
+        private const string JsonFormat = "json";
+        private const string BinaryFormat = "binary";
+
+        // Leading bytes of each log kept in the checkpoint; a new run of the profiler rewrites them
+        private const int FingerprintSize = 256;
+
+        private static readonly JsonSerializerOptions ManifestOptions = new JsonSerializerOptions { WriteIndented = true };
+
+        private readonly string _folder;
+        private readonly string _executablePath;
+        private readonly bool _fromMetadata;
+
+        private Checkpoint _checkpoint;
+        private Dictionary<ulong, ModuleMessage> _modules;
+        private Dictionary<ulong, Enter3Message> _pendingFunctions;
+        private HashSet<ulong> _pendingJitFunctionIds;
+        private HashSet<ulong> _resolvedFunctionIds;
+
+        /// <param name="logFolder">SIG_JIT_PROFILER_LOG_PATH of the profiled process; the checkpoint and manifest go there too</param>
+        /// <param name="executablePath">Path to the profiled executable (used to set assembly resolution context)</param>
+        /// <param name="fromMetadata">Resolve from PE metadata, as ParseProfilerLogsToManifest does, instead of loading the assemblies</param>
+        public IncrementalCollector(string logFolder, string executablePath, bool fromMetadata)
+        {
+            _folder = logFolder;
+            _executablePath = executablePath;
+            _fromMetadata = fromMetadata;
+        }
+
+        public string CheckpointPath => Path.Combine(_folder, CheckpointFileName);
+
+        public string ManifestPath => Path.Combine(_folder, ManifestFileName);
+
+        /// <summary>
+        /// Number of JIT-compiled functions handled so far, resolved or reported.
+        /// </summary>
+        public int ResolvedCount => _resolvedFunctionIds?.Count ?? 0;
+
+        /// <summary>
+        /// Runs one pass and returns the nodes it appended to the manifest.
+        /// </summary>
+        /// <param name="processExited">The profiler has stopped writing: read to the end of the logs, and
+        /// report the JIT-compiled functions that never got an Enter3 record</param>
+        /// <param name="errors">Output parameter containing this pass's errors (multiline string)</param>
+        public MethodBaseSerializer.MethodNode[] Collect(bool processExited, out string errors)
+        {
+            var errorList = new List<string>();
+            var nodes = Array.Empty<MethodBaseSerializer.MethodNode>();
+
+            try
+            {
+                if (_checkpoint == null)
+                    LoadCheckpoint();
+
+                // Logs rewritten by a new run of the profiler: the checkpoint and manifest are stale
+                if (!IsSameRun())
+                {
+                    StartOver();
+                    File.Delete(ManifestPath);
+                }
+
+                ReadIncrement(processExited, errorList);
+
+                var ready = _pendingJitFunctionIds.Where(_pendingFunctions.ContainsKey).ToList();
+                if (ready.Count > 0)
+                    nodes = Resolve(ready, errorList);
+
+                foreach (var functionId in ready)
+                    Complete(functionId);
+
+                if (processExited)
+                {
+                    foreach (var functionId in _pendingJitFunctionIds.OrderBy(id => id).ToList())
+                    {
+                        errorList.Add($"FunctionID 0x{functionId:X} from JIT log not found in Enter3 log");
+                        Complete(functionId);
+                    }
+                }
+
+                // Manifest first: a crash in between repeats methods rather than losing them
+                AppendToManifest(nodes);
+                SaveCheckpoint();
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return nodes;
+        }
+
+        private void ReadIncrement(bool processExited, List<string> errorList)
+        {
+            if (_checkpoint.Format == BinaryFormat)
+            {
+                var moduleMap = new Dictionary<ulong, ModuleMessage>();
+                var functionMap = new Dictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new HashSet<ulong>();
+                _checkpoint.TraceOffset = BinaryTraceReader.ReadFrom(Path.Combine(_folder, BinaryTraceReader.DefaultFileName),
+                    _checkpoint.TraceOffset, processExited, moduleMap, functionMap, jitFunctionIds, errorList);
+                Merge(moduleMap, functionMap, jitFunctionIds);
+            }
+            else
+            {
+                var moduleMap = new ConcurrentDictionary<ulong, ModuleMessage>();
+                var functionMap = new ConcurrentDictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new ConcurrentDictionary<ulong, byte>();
+                JsonLogReader.ReadFrom(_checkpoint.JsonOffsets, processExited,
+                    Path.Combine(_folder, "modules.json"), Path.Combine(_folder, "enter3.json"), Path.Combine(_folder, "jit.json"),
+                    moduleMap, functionMap, jitFunctionIds, errorList);
+                Merge(moduleMap, functionMap, jitFunctionIds.Keys);
+            }
+        }
+
+        private void Merge(IEnumerable<KeyValuePair<ulong, ModuleMessage>> modules, IEnumerable<KeyValuePair<ulong, Enter3Message>> functions, IEnumerable<ulong> jitFunctionIds)
+        {
+            foreach (var module in modules)
+                _modules[module.Key] = module.Value;
+
+            // A function is resolved once; later records of it (a re-JIT) add nothing to the manifest
+            foreach (var function in functions)
+            {
+                if (!_resolvedFunctionIds.Contains(function.Key))
+                    _pendingFunctions[function.Key] = function.Value;
+            }
+
+            foreach (var functionId in jitFunctionIds)
+            {
+                if (!_resolvedFunctionIds.Contains(functionId))
+                    _pendingJitFunctionIds.Add(functionId);
+            }
+        }
+
+        private void Complete(ulong functionId)
+        {
+            _resolvedFunctionIds.Add(functionId);
+            _pendingJitFunctionIds.Remove(functionId);
+            _pendingFunctions.Remove(functionId);
+        }
+
+        private MethodBaseSerializer.MethodNode[] Resolve(List<ulong> functionIds, List<string> errorList)
+        {
+            var functionMap = functionIds.ToDictionary(id => id, id => _pendingFunctions[id]);
+            if (_fromMetadata)
+                return JitProfilerLogParser.ResolveManifest(_modules, functionMap, functionIds, _executablePath, errorList);
+
+            string loadErrors = "";
+            var methods = JitProfilerLogParser.ResolveMethods(_modules, functionMap, functionIds, _executablePath, errorList, ref loadErrors);
+            if (!string.IsNullOrWhiteSpace(loadErrors))
+                errorList.Insert(0, loadErrors.TrimEnd());
+
+            var nodes = new List<MethodBaseSerializer.MethodNode>(methods.Length);
+            foreach (var method in methods)
+            {
+                try
+                {
+                    nodes.Add(MethodBaseSerializer.ToNode(method));
+                }
+                catch (Exception ex)
+                {
+                    errorList.Add($"Failed to serialize method {method.Name}: {ex.Message}");
+                }
+            }
+            return nodes.ToArray();
+        }
+
+        #region Manifest
+
+        /// <summary>
+        /// Adds nodes to the manifest's JSON array in place: the closing bracket is cut and written
+        /// again after them, so the file is a valid manifest after every pass.
+        /// </summary>
+        private void AppendToManifest(MethodBaseSerializer.MethodNode[] nodes)
+        {
+            if (nodes.Length == 0 && File.Exists(ManifestPath))
+                return;
+
+            using (var stream = new FileStream(ManifestPath, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.Read))
+            {
+                long end = FindClosingBracket(stream, out bool hasItems);
+                var text = new StringBuilder();
+                if (end < 0)
+                {
+                    end = 0;
+                    hasItems = false;
+                    text.Append('[').Append(Environment.NewLine);
+                }
+
+                foreach (var node in nodes)
+                {
+                    if (hasItems)
+                        text.Append(',').Append(Environment.NewLine);
+                    hasItems = true;
+                    text.Append(JsonSerializer.Serialize(node, ManifestOptions)).Append(Environment.NewLine);
+                }
+                text.Append(']').Append(Environment.NewLine);
+
+                stream.SetLength(end);
+                stream.Position = end;
+                var bytes = Encoding.UTF8.GetBytes(text.ToString());
+                stream.Write(bytes, 0, bytes.Length);
+            }
+        }
+
+        // Offset of the array's closing bracket, or -1 when the file does not end in one
+        private static long FindClosingBracket(Stream stream, out bool hasItems)
+        {
+            hasItems = false;
+            int closing = LastNonSpace(stream, stream.Length, out long position);
+            if (closing != ']')
+                return -1;
+
+            hasItems = LastNonSpace(stream, position, out _) != '[';
+            return position;
+        }
+
+        private static int LastNonSpace(Stream stream, long before, out long position)
+        {
+            for (position = before - 1; position >= 0; position--)
+            {
+                stream.Position = position;
+                int value = stream.ReadByte();
+                if (value != ' ' && value != '\r' && value != '\n' && value != '\t')
+                    return value;
+            }
+            return -1;
+        }
+
+        #endregion
+
+        #region Checkpoint
+
+        private sealed class Checkpoint
+        {
+            public string Format { get; set; }
+            public JsonLogOffsets JsonOffsets { get; set; } = new JsonLogOffsets();
+            public long TraceOffset { get; set; }
+
+            // File name -> base64 of its first bytes, up to FingerprintSize of those already read
+            public Dictionary<string, string> Fingerprints { get; set; } = new Dictionary<string, string>();
+
+            public List<ModuleMessage> Modules { get; set; } = new List<ModuleMessage>();
+            public List<Enter3Message> PendingFunctions { get; set; } = new List<Enter3Message>();
+            public List<ulong> PendingJitFunctionIds { get; set; } = new List<ulong>();
+            public List<ulong> ResolvedFunctionIds { get; set; } = new List<ulong>();
+        }
+
+        private void LoadCheckpoint()
+        {
+            Checkpoint checkpoint = null;
+            if (File.Exists(CheckpointPath))
+            {
+                try
+                {
+                    checkpoint = JsonSerializer.Deserialize<Checkpoint>(File.ReadAllText(CheckpointPath));
+                }
+                catch (JsonException)
+                {
+                    // Unreadable: start over
+                }
+            }
+
+            // Without a checkpoint the manifest cannot be extended, only rewritten
+            if (checkpoint == null)
+            {
+                StartOver();
+                File.Delete(ManifestPath);
+                return;
+            }
+
+            _checkpoint = checkpoint;
+            _modules = checkpoint.Modules.ToDictionary(module => module.ModuleID);
+            _pendingFunctions = checkpoint.PendingFunctions.ToDictionary(function => function.FunctionID);
+            _pendingJitFunctionIds = new HashSet<ulong>(checkpoint.PendingJitFunctionIds);
+            _resolvedFunctionIds = new HashSet<ulong>(checkpoint.ResolvedFunctionIds);
+        }
+
+        private void StartOver()
+        {
+            bool binary = JitProfilerLogParser.IsBinaryRun(_folder);
+
+            _checkpoint = new Checkpoint { Format = binary ? BinaryFormat : JsonFormat };
+            _modules = new Dictionary<ulong, ModuleMessage>();
+            _pendingFunctions = new Dictionary<ulong, Enter3Message>();
+            _pendingJitFunctionIds = new HashSet<ulong>();
+            _resolvedFunctionIds = new HashSet<ulong>();
+        }
+
+        private IEnumerable<(string FileName, long Offset)> ReadPositions()
+        {
+            if (_checkpoint.Format == BinaryFormat)
+            {
+                yield return (BinaryTraceReader.DefaultFileName, _checkpoint.TraceOffset);
+            }
+            else
+            {
+                yield return ("modules.json", _checkpoint.JsonOffsets.Modules);
+                yield return ("enter3.json", _checkpoint.JsonOffsets.Enter3);
+                yield return ("jit.json", _checkpoint.JsonOffsets.Jit);
+            }
+        }
+
+        // The logs still start with the bytes already read, and have not shrunk below them
+        private bool IsSameRun()
+        {
+            foreach (var (fileName, offset) in ReadPositions())
+            {
+                if (offset == 0)
+                    continue;
+
+                var path = Path.Combine(_folder, fileName);
+                if (!File.Exists(path) || !_checkpoint.Fingerprints.TryGetValue(fileName, out var fingerprint))
+                    return false;
+
+                using (var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite))
+                {
+                    if (stream.Length < offset || ReadFingerprint(stream, offset) != fingerprint)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        private static string ReadFingerprint(Stream stream, long offset)
+        {
+            var bytes = new byte[(int)Math.Min(offset, FingerprintSize)];
+            int total = 0;
+            while (total < bytes.Length)
+            {
+                int read = stream.Read(bytes, total, bytes.Length - total);
+                if (read == 0)
+                    break;
+                total += read;
+            }
+            return Convert.ToBase64String(bytes, 0, total);
+        }
+
+        private void SaveCheckpoint()
+        {
+            _checkpoint.Fingerprints.Clear();
+            foreach (var (fileName, offset) in ReadPositions())
+            {
+                var path = Path.Combine(_folder, fileName);
+                if (offset == 0 || !File.Exists(path))
+                    continue;
+
+                using (var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite))
+                {
+                    _checkpoint.Fingerprints[fileName] = ReadFingerprint(stream, offset);
+                }
+            }
+
+            _checkpoint.Modules = _modules.Values.ToList();
+            _checkpoint.PendingFunctions = _pendingFunctions.Values.ToList();
+            _checkpoint.PendingJitFunctionIds = _pendingJitFunctionIds.ToList();
+            _checkpoint.ResolvedFunctionIds = _resolvedFunctionIds.ToList();
+
+            // Written aside and moved over, so a crash leaves the old checkpoint or the new one
+            var temporaryPath = CheckpointPath + ".tmp";
+            File.WriteAllText(temporaryPath, JsonSerializer.Serialize(_checkpoint));
+            File.Move(temporaryPath, CheckpointPath, true);
+        }
+
+        #endregion
+    }
+}
@@ -0,0 +1,117 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Linq;
+    using System.Text;
+
+    /// <summary>
+    /// Which methods the JIT inlined into which, from the JITInlining events logged with
+    /// SIG_JIT_PROFILER_INLINING=1. A caller is the method being compiled; a callee inlined
+    /// through another inlinee still appears under that outer method.
+    /// </summary>
+    public sealed class InliningGraph
+    {
+        public sealed class Method
+        {
+            public ulong FunctionID { get; set; }
+
+            // Pretty signature, or null when the function could not be named
+            public string Name { get; set; }
+
+            public List<Method> Callees { get; } = new List<Method>();
+
+            public List<Method> Callers { get; } = new List<Method>();
+
+            // Where a callee is defined, for callees that never ran on their own
+            internal ulong ModuleID { get; set; }
+
+            internal uint MethodToken { get; set; }
+
+            public override string ToString() => Name ?? $"FunctionID 0x{FunctionID:X}";
+        }
+
+        public Dictionary<ulong, Method> Methods { get; } = new Dictionary<ulong, Method>();
+
+        public int EdgeCount { get; private set; }
+
+        // Builds the graph of a run read by JitProfilerLogParser.ReadEvents and names its methods from PE
+        // metadata, falling back to the definition logged with the edge for callees that never ran
+        public static InliningGraph Build(ProfilerRun run, string executablePath, List<string> errors)
+        {
+            var graph = Build(run.Events.Inlinings);
+            var methods = graph.Methods.Values.OrderBy(x => x.FunctionID).ToList();
+            var names = JitProfilerLogParser.NameMethods(run, methods.Select(x => x.FunctionID).ToList(), executablePath, errors,
+                i => (methods[i].ModuleID, methods[i].MethodToken));
+            for (int i = 0; i < names.Length; i++)
+                methods[i].Name = names[i];
+            return graph;
+        }
+
+        public static InliningGraph Build(IEnumerable<InliningMessage> inlinings)
+        {
+            if (inlinings == null) throw new ArgumentNullException(nameof(inlinings));
+
+            var graph = new InliningGraph();
+            var edges = new HashSet<(ulong Caller, ulong Callee)>();
+            foreach (var inlining in inlinings)
+            {
+                // The profiler logs each pair once per run; a log read twice repeats them
+                if (!edges.Add((inlining.Caller, inlining.Callee)))
+                    continue;
+
+                var caller = graph.GetMethod(inlining.Caller);
+                var callee = graph.GetMethod(inlining.Callee);
+                if (inlining.CalleeModuleID != 0)
+                {
+                    callee.ModuleID = inlining.CalleeModuleID;
+                    callee.MethodToken = inlining.CalleeToken;
+                }
+
+                caller.Callees.Add(callee);
+                callee.Callers.Add(caller);
+                graph.EdgeCount++;
+            }
+            return graph;
+        }
+
+        public string ToReport(int top = 50)
+        {
+            var callers = Methods.Values.Where(x => x.Callees.Count > 0).ToList();
+            var callees = Methods.Values.Where(x => x.Callers.Count > 0).ToList();
+
+            var sb = new StringBuilder();
+            sb.AppendLine($"{EdgeCount} inlining edges, {callers.Count} callers, {callees.Count} callees");
+
+            sb.AppendLine();
+            sb.AppendLine("Most inlined callees (callers):");
+            foreach (var callee in Rank(callees, x => x.Callers.Count).Take(top))
+                sb.AppendLine($"{callee.Callers.Count,8}  {callee}");
+
+            sb.AppendLine();
+            sb.AppendLine("Callers with the most inlinees (callees):");
+            foreach (var caller in Rank(callers, x => x.Callees.Count).Take(top))
+            {
+                sb.AppendLine($"{caller.Callees.Count,8}  {caller}");
+                foreach (var callee in caller.Callees.Select(x => x.ToString()).OrderBy(x => x, StringComparer.Ordinal))
+                    sb.AppendLine($"{"",8}    {callee}");
+            }
+            return sb.ToString();
+        }
+
+        private Method GetMethod(ulong functionId)
+        {
+            if (!Methods.TryGetValue(functionId, out var method))
+            {
+                method = new Method { FunctionID = functionId };
+                Methods.Add(functionId, method);
+            }
+            return method;
+        }
+
+        private static IEnumerable<Method> Rank(IEnumerable<Method> methods, Func<Method, int> count)
+        {
+            return methods.OrderByDescending(count).ThenBy(x => x.ToString(), StringComparer.Ordinal);
+        }
+    }
+}
@@ -1,9 +1,11 @@
 ﻿using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.IO;
+using System.Linq;
 using System.Reflection;
 using System.Text;
-using System.Text.Json;
+using System.Threading.Tasks;
 
 namespace JitLogParser
 {
@@ -24,65 +26,565 @@ namespace JitLogParser
         public static MethodBase[] ParseProfilerLogs(string jitFilePath, string modulesFilePath, string enter3FilePath, string executablePath, out string errors)
         {
             var errorList = new List<string>();
-            var methods = new List<MethodBase>();
+            MethodBase[] methods = Array.Empty<MethodBase>();
             errors = "";
 
             try
             {
-                // Step 1: Parse modules file to build ModuleID -> Assembly mapping
-                var moduleMap = ParseModulesFile(modulesFilePath, errorList);
+                // Steps 1-3: stream the modules, enter3 and jit files in parallel into
+                // ModuleID -> module, FunctionID -> Enter3Message and the set of JIT-compiled FunctionIDs
+                var moduleMap = new ConcurrentDictionary<ulong, ModuleMessage>();
+                var functionMap = new ConcurrentDictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new ConcurrentDictionary<ulong, byte>();
+                JsonLogReader.Read(modulesFilePath, enter3FilePath, jitFilePath, moduleMap, functionMap, jitFunctionIds, errorList);
+
+                // Step 4: Resolve MethodBase objects
+                methods = ResolveMethods(moduleMap, functionMap, jitFunctionIds.Keys, executablePath, errorList, ref errors);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
 
-                // Step 2: Parse enter3 file to build FunctionID -> Enter3Message mapping
-                var functionMap = ParseEnter3File(enter3FilePath, errorList);
+            errors += string.Join(Environment.NewLine, errorList);
+            return methods;
+        }
 
-                // Step 3: Parse jit file to get FunctionIDs that were JIT compiled
-                var jitFunctionIds = ParseJitFile(jitFilePath, errorList);
+        /// <summary>
+        /// Parses a binary trace (SIG_JIT_PROFILER_FORMAT=binary) and returns MethodBase objects for each JIT-compiled method.
+        /// </summary>
+        /// <param name="traceFilePath">Path to the trace.bin file</param>
+        /// <param name="executablePath">Path to the profiled executable (used to set assembly resolution context)</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>Array of MethodBase objects, one per JIT-compiled method, or empty array if parsing fails</returns>
+        public static MethodBase[] ParseProfilerTrace(string traceFilePath, string executablePath, out string errors)
+        {
+            var errorList = new List<string>();
+            MethodBase[] methods = Array.Empty<MethodBase>();
+            errors = "";
 
-                // Create custom assembly load context for resolution
-                var loadContext = new ProfilerAssemblyLoadContext(executablePath);
-                if (!String.IsNullOrEmpty(loadContext.ModuleInspectError))
-                    errors += loadContext.ModuleInspectError + "\r\n";
+            try
+            {
+                // Steps 1-3: a single pass over the trace builds all three maps
+                var moduleMap = new Dictionary<ulong, ModuleMessage>();
+                var functionMap = new Dictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new HashSet<ulong>();
+                BinaryTraceReader.Read(traceFilePath, moduleMap, functionMap, jitFunctionIds, errorList);
+
+                // Step 4: Resolve MethodBase objects
+                methods = ResolveMethods(moduleMap, functionMap, jitFunctionIds, executablePath, errorList, ref errors);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
 
-                try
+            errors += string.Join(Environment.NewLine, errorList);
+            return methods;
+        }
+
+        /// <summary>
+        /// Parses the three profiler JSON log files and returns the manifest node of each JIT-compiled method,
+        /// resolved from PE metadata without loading the profiled application's assemblies.
+        /// </summary>
+        /// <param name="jitFilePath">Path to the jit.json file containing JITCompilationStarted events</param>
+        /// <param name="modulesFilePath">Path to the modules.json file containing module/assembly mappings</param>
+        /// <param name="enter3FilePath">Path to the enter3.json file containing detailed method metadata</param>
+        /// <param name="executablePath">Path to the profiled executable (probed for assemblies the module log does not place)</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>Array of the nodes MethodBaseSerializer would write, one per JIT-compiled method, or empty array if parsing fails</returns>
+        public static MethodBaseSerializer.MethodNode[] ParseProfilerLogsToManifest(string jitFilePath, string modulesFilePath, string enter3FilePath, string executablePath, out string errors)
+        {
+            var errorList = new List<string>();
+            var nodes = Array.Empty<MethodBaseSerializer.MethodNode>();
+
+            try
+            {
+                var moduleMap = new ConcurrentDictionary<ulong, ModuleMessage>();
+                var functionMap = new ConcurrentDictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new ConcurrentDictionary<ulong, byte>();
+                JsonLogReader.Read(modulesFilePath, enter3FilePath, jitFilePath, moduleMap, functionMap, jitFunctionIds, errorList);
+
+                nodes = ResolveManifest(moduleMap, functionMap, jitFunctionIds.Keys, executablePath, errorList);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return nodes;
+        }
+
+        /// <summary>
+        /// Parses a binary trace and returns the manifest node of each JIT-compiled method,
+        /// resolved from PE metadata without loading the profiled application's assemblies.
+        /// </summary>
+        /// <param name="traceFilePath">Path to the trace.bin file</param>
+        /// <param name="executablePath">Path to the profiled executable (probed for assemblies the module records do not place)</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>Array of the nodes MethodBaseSerializer would write, one per JIT-compiled method, or empty array if parsing fails</returns>
+        public static MethodBaseSerializer.MethodNode[] ParseProfilerTraceToManifest(string traceFilePath, string executablePath, out string errors)
+        {
+            var errorList = new List<string>();
+            var nodes = Array.Empty<MethodBaseSerializer.MethodNode>();
+
+            try
+            {
+                var moduleMap = new Dictionary<ulong, ModuleMessage>();
+                var functionMap = new Dictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new HashSet<ulong>();
+                BinaryTraceReader.Read(traceFilePath, moduleMap, functionMap, jitFunctionIds, errorList);
+
+                nodes = ResolveManifest(moduleMap, functionMap, jitFunctionIds, executablePath, errorList);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return nodes;
+        }
+
+        /// <summary>
+        /// Parses the three profiler JSON log files and writes the JIT-compiled methods as a MIBC profile
+        /// for crossgen2 --mibc, generic instantiations included, resolved from PE metadata.
+        /// </summary>
+        /// <param name="jitFilePath">Path to the jit.json file containing JITCompilationStarted events</param>
+        /// <param name="modulesFilePath">Path to the modules.json file containing module/assembly mappings</param>
+        /// <param name="enter3FilePath">Path to the enter3.json file containing detailed method metadata</param>
+        /// <param name="executablePath">Path to the profiled executable (probed for assemblies the module log does not place)</param>
+        /// <param name="mibcFilePath">Path of the .mibc file to write</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>Number of methods written to the profile, or 0 if parsing fails</returns>
+        public static int ParseProfilerLogsToMibc(string jitFilePath, string modulesFilePath, string enter3FilePath, string executablePath, string mibcFilePath, out string errors)
+        {
+            var errorList = new List<string>();
+            int count = 0;
+
+            try
+            {
+                var moduleMap = new ConcurrentDictionary<ulong, ModuleMessage>();
+                var functionMap = new ConcurrentDictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new ConcurrentDictionary<ulong, byte>();
+                JsonLogReader.Read(modulesFilePath, enter3FilePath, jitFilePath, moduleMap, functionMap, jitFunctionIds, errorList);
+
+                count = WriteMibc(moduleMap, functionMap, jitFunctionIds.Keys, executablePath, mibcFilePath, errorList);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return count;
+        }
+
+        /// <summary>
+        /// Parses a binary trace and writes the JIT-compiled methods as a MIBC profile for crossgen2 --mibc,
+        /// generic instantiations included, resolved from PE metadata.
+        /// </summary>
+        /// <param name="traceFilePath">Path to the trace.bin file</param>
+        /// <param name="executablePath">Path to the profiled executable (probed for assemblies the module records do not place)</param>
+        /// <param name="mibcFilePath">Path of the .mibc file to write</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>Number of methods written to the profile, or 0 if parsing fails</returns>
+        public static int ParseProfilerTraceToMibc(string traceFilePath, string executablePath, string mibcFilePath, out string errors)
+        {
+            var errorList = new List<string>();
+            int count = 0;
+
+            try
+            {
+                var moduleMap = new Dictionary<ulong, ModuleMessage>();
+                var functionMap = new Dictionary<ulong, Enter3Message>();
+                var jitFunctionIds = new HashSet<ulong>();
+                BinaryTraceReader.Read(traceFilePath, moduleMap, functionMap, jitFunctionIds, errorList);
+
+                count = WriteMibc(moduleMap, functionMap, jitFunctionIds, executablePath, mibcFilePath, errorList);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return count;
+        }
+
+        /// <summary>
+        /// Whether a run's log folder is read from trace.bin rather than from the JSON logs. Runs are written
+        /// into the same folder, so it can hold both formats from earlier runs; the newer one wins.
+        /// </summary>
+        /// <param name="logFolder">Folder the profiler wrote its logs to (SIG_JIT_PROFILER_LOG_PATH)</param>
+        public static bool IsBinaryRun(string logFolder)
+        {
+            var tracePath = Path.Combine(logFolder, BinaryTraceReader.DefaultFileName);
+            var jitPath = Path.Combine(logFolder, "jit.json");
+            return File.Exists(tracePath) &&
+                (!File.Exists(jitPath) || File.GetLastWriteTimeUtc(tracePath) >= File.GetLastWriteTimeUtc(jitPath));
+        }
+
+        /// <summary>
+        /// Reads a run's log folder: trace.bin if the newer run there wrote a binary trace, else jit.json, modules.json
+        /// and enter3.json. The reports are built from the returned run, e.g. JitTimeReport.Rank(run, executablePath, errors).
+        /// </summary>
+        /// <param name="logFolder">Folder the profiler wrote its logs to (SIG_JIT_PROFILER_LOG_PATH)</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>The run, empty if parsing fails</returns>
+        public static ProfilerRun ReadEvents(string logFolder, out string errors)
+        {
+            return IsBinaryRun(logFolder)
+                ? ReadTraceEvents(Path.Combine(logFolder, BinaryTraceReader.DefaultFileName), out errors)
+                : ReadEvents(
+                    Path.Combine(logFolder, "jit.json"),
+                    Path.Combine(logFolder, "modules.json"),
+                    Path.Combine(logFolder, "enter3.json"),
+                    out errors);
+        }
+
+        /// <summary>
+        /// Reads the three profiler JSON log files into their module and function records and events.
+        /// </summary>
+        /// <param name="jitFilePath">Path to the jit.json file containing JITCompilationStarted records and the other JIT events</param>
+        /// <param name="modulesFilePath">Path to the modules.json file containing module/assembly mappings</param>
+        /// <param name="enter3FilePath">Path to the enter3.json file containing detailed method metadata</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>The run, empty if parsing fails</returns>
+        public static ProfilerRun ReadEvents(string jitFilePath, string modulesFilePath, string enter3FilePath, out string errors)
+        {
+            var errorList = new List<string>();
+            var run = new ProfilerRun(new Dictionary<ulong, ModuleMessage>(), new Dictionary<ulong, Enter3Message>(), new ProfilerEvents());
+
+            try
+            {
+                var moduleMap = new ConcurrentDictionary<ulong, ModuleMessage>();
+                var functionMap = new ConcurrentDictionary<ulong, Enter3Message>();
+                var events = new ProfilerEvents();
+                JsonLogReader.Read(modulesFilePath, enter3FilePath, jitFilePath, moduleMap, functionMap, new ConcurrentDictionary<ulong, byte>(), errorList, events: events);
+
+                run = new ProfilerRun(moduleMap, functionMap, events);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return run;
+        }
+
+        /// <summary>
+        /// Reads a binary trace (SIG_JIT_PROFILER_FORMAT=binary) into its module and function records and events.
+        /// </summary>
+        /// <param name="traceFilePath">Path to the trace.bin file</param>
+        /// <param name="errors">Output parameter containing any parsing errors (multiline string)</param>
+        /// <returns>The run, empty if parsing fails</returns>
+        public static ProfilerRun ReadTraceEvents(string traceFilePath, out string errors)
+        {
+            var errorList = new List<string>();
+            var run = new ProfilerRun(new Dictionary<ulong, ModuleMessage>(), new Dictionary<ulong, Enter3Message>(), new ProfilerEvents());
+
+            try
+            {
+                var moduleMap = new Dictionary<ulong, ModuleMessage>();
+                var functionMap = new Dictionary<ulong, Enter3Message>();
+                var events = new ProfilerEvents();
+                BinaryTraceReader.Read(traceFilePath, moduleMap, functionMap, new HashSet<ulong>(), errorList, events);
+
+                run = new ProfilerRun(moduleMap, functionMap, events);
+            }
+            catch (Exception ex)
+            {
+                errorList.Add($"Critical error during parsing: {ex.Message}");
+            }
+
+            errors = string.Join(Environment.NewLine, errorList);
+            return run;
+        }
+
+        /// <summary>
+        /// Names functions of a run as pretty signatures from PE metadata, in the order given; null for one that could not be named.
+        /// Without definitionOf a function is named from its Enter3 record, which has the instantiation that ran, and one
+        /// without a record is an error. With it, such a function is named from the definition it returns for that index
+        /// instead, and one with neither stays unnamed: callees may never have run on their own.
+        /// </summary>
+        /// <param name="run">The run the functions come from</param>
+        /// <param name="functionIds">FunctionIDs to name</param>
+        /// <param name="executablePath">Path to the profiled executable (probed for assemblies the module records do not place)</param>
+        /// <param name="errors">Receives the resolution errors</param>
+        /// <param name="definitionOf">Module and method token of the function at an index, ModuleID 0 when unknown</param>
+        /// <returns>One name per FunctionID</returns>
+        public static string[] NameMethods(
+            ProfilerRun run,
+            IReadOnlyList<ulong> functionIds,
+            string executablePath,
+            List<string> errors,
+            Func<int, (ulong ModuleID, uint MethodToken)> definitionOf = null)
+        {
+            var names = new string[functionIds.Count];
+            using (var resolver = new MetadataResolver(run.Modules, executablePath))
+            {
+                if (definitionOf == null)
+                {
+                    var nodes = ResolveEachFunction(run.Functions, functionIds, resolver.Resolve, errors);
+                    for (int i = 0; i < nodes.Length; i++)
+                        names[i] = nodes[i]?.ToPrettySignature();
+                    return names;
+                }
+
+                for (int i = 0; i < names.Length; i++)
                 {
-                    // Step 4: For each JIT-compiled function, try to resolve its MethodBase
-                    foreach (var functionId in jitFunctionIds)
+                    MethodBaseSerializer.MethodNode node = null;
+                    if (run.Functions.TryGetValue(functionIds[i], out var enter3Message))
                     {
-                        if (functionMap.TryGetValue(functionId, out var enter3Message))
+                        node = resolver.Resolve(enter3Message, errors);
+                    }
+                    else
+                    {
+                        var definition = definitionOf(i);
+                        if (definition.ModuleID != 0)
+                            node = resolver.ResolveDefinition(definition.ModuleID, definition.MethodToken, errors);
+                    }
+                    names[i] = node?.ToPrettySignature();
+                }
+            }
+            return names;
+        }
+
+        internal static MethodBase[] ResolveMethods(
+            IReadOnlyDictionary<ulong, ModuleMessage> moduleMap,
+            IReadOnlyDictionary<ulong, Enter3Message> functionMap,
+            IEnumerable<ulong> jitFunctionIds,
+            string executablePath,
+            List<string> errorList,
+            ref string errors)
+        {
+            // Create custom assembly load context for resolution
+            var loadContext = new ProfilerAssemblyLoadContext(executablePath);
+            if (!String.IsNullOrEmpty(loadContext.ModuleInspectError))
+                errors += loadContext.ModuleInspectError + "\r\n";
+
+            var context = new ResolutionContext(moduleMap, loadContext);
+            try
+            {
+                return ResolveFunctions(functionMap, jitFunctionIds,
+                    (enter3Message, errorsInRange) => ResolveMethodBase(enter3Message, context, errorsInRange), errorList);
+            }
+            finally
+            {
+                loadContext.Finish();
+            }
+        }
+
+        internal static MethodBaseSerializer.MethodNode[] ResolveManifest(
+            IReadOnlyDictionary<ulong, ModuleMessage> moduleMap,
+            IReadOnlyDictionary<ulong, Enter3Message> functionMap,
+            IEnumerable<ulong> jitFunctionIds,
+            string executablePath,
+            List<string> errorList)
+        {
+            using (var resolver = new MetadataResolver(moduleMap, executablePath))
+            {
+                return ResolveFunctions(functionMap, jitFunctionIds, resolver.Resolve, errorList);
+            }
+        }
+
+        internal static int WriteMibc(
+            IReadOnlyDictionary<ulong, ModuleMessage> moduleMap,
+            IReadOnlyDictionary<ulong, Enter3Message> functionMap,
+            IEnumerable<ulong> jitFunctionIds,
+            string executablePath,
+            string mibcFilePath,
+            List<string> errorList)
+        {
+            using (var resolver = new MetadataResolver(moduleMap, executablePath))
+            {
+                // Resolution runs in parallel; the profile's metadata is built on one thread
+                var methods = ResolveFunctions(functionMap, jitFunctionIds, resolver.ResolveMethod, errorList);
+                var writer = new MibcWriter(resolver);
+                foreach (var method in methods)
+                    writer.Add(method, errorList);
+
+                writer.Write(mibcFilePath);
+                return writer.MethodCount;
+            }
+        }
+
+        /// <summary>
+        /// Resolves each JIT-compiled function on all cores, in ranges. Each range keeps its own errors,
+        /// merged in range order so the report reads the same from run to run.
+        /// </summary>
+        private static T[] ResolveFunctions<T>(
+            IReadOnlyDictionary<ulong, Enter3Message> functionMap,
+            IEnumerable<ulong> jitFunctionIds,
+            Func<Enter3Message, List<string>, T> resolve,
+            List<string> errorList) where T : class
+        {
+            return ResolveEachFunction(functionMap, jitFunctionIds, resolve, errorList).Where(item => item != null).ToArray();
+        }
+
+        // As ResolveFunctions, keeping a null in place of each function that did not resolve
+        private static T[] ResolveEachFunction<T>(
+            IReadOnlyDictionary<ulong, Enter3Message> functionMap,
+            IEnumerable<ulong> jitFunctionIds,
+            Func<Enter3Message, List<string>, T> resolve,
+            List<string> errorList) where T : class
+        {
+            var functionIds = jitFunctionIds.ToArray();
+            var resolved = new T[functionIds.Length];
+            int rangeSize = Math.Max(64, functionIds.Length / (Environment.ProcessorCount * 8) + 1);
+            var rangeErrors = new List<string>[(functionIds.Length + rangeSize - 1) / rangeSize];
+
+            Parallel.ForEach(Partitioner.Create(0, functionIds.Length, rangeSize), range =>
+            {
+                var errorsInRange = new List<string>();
+                for (int i = range.Item1; i < range.Item2; i++)
+                {
+                    var functionId = functionIds[i];
+                    if (functionMap.TryGetValue(functionId, out var enter3Message))
+                    {
+                        try
                         {
-                            try
-                            {
-                                var methodBase = ResolveMethodBase(enter3Message, moduleMap, loadContext, errorList);
-                                if (methodBase != null)
-                                {
-                                    methods.Add(methodBase);
-                                }
-                            }
-                            catch (Exception ex)
-                            {
-                                errorList.Add($"Failed to resolve method for FunctionID 0x{functionId:X}: {ex.Message}");
-                            }
+                            resolved[i] = resolve(enter3Message, errorsInRange);
                         }
-                        else
+                        catch (Exception ex)
                         {
-                            errorList.Add($"FunctionID 0x{functionId:X} from JIT log not found in Enter3 log");
+                            errorsInRange.Add($"Failed to resolve method for FunctionID 0x{functionId:X}: {ex.Message}");
                         }
                     }
+                    else
+                    {
+                        errorsInRange.Add($"FunctionID 0x{functionId:X} from JIT log not found in Enter3 log");
+                    }
                 }
-                finally
-                {
-                    loadContext.Finish();
-                }
+                rangeErrors[range.Item1 / rangeSize] = errorsInRange;
+            });
+
+            foreach (var errorsInRange in rangeErrors)
+                errorList.AddRange(errorsInRange);
+
+            return resolved;
+        }
+
+        #region Resolution Context
+
+        /// <summary>
+        /// What resolution shares across functions and threads: the module records, the
+        /// assembly loader, and memo caches. A trace names the same type arguments and
+        /// declaring types over and over; each (module, TypeDef) is resolved once, each
+        /// instantiation constructed once, and each closed type's methods indexed by token once.
+        /// </summary>
+        private sealed class ResolutionContext
+        {
+            private readonly ConcurrentDictionary<(ulong ModuleId, uint TypeDef), Type> _definitions =
+                new ConcurrentDictionary<(ulong ModuleId, uint TypeDef), Type>();
+            private readonly ConcurrentDictionary<ConstructedTypeKey, Type> _constructedTypes =
+                new ConcurrentDictionary<ConstructedTypeKey, Type>();
+            private readonly ConcurrentDictionary<Type, Dictionary<int, MethodBase>> _methodsByToken =
+                new ConcurrentDictionary<Type, Dictionary<int, MethodBase>>();
+
+            public ResolutionContext(IReadOnlyDictionary<ulong, ModuleMessage> moduleMap, ProfilerAssemblyLoadContext loadContext)
+            {
+                ModuleMap = moduleMap;
+                LoadContext = loadContext;
             }
-            catch (Exception ex)
+
+            public IReadOnlyDictionary<ulong, ModuleMessage> ModuleMap { get; }
+
+            public ProfilerAssemblyLoadContext LoadContext { get; }
+
+            /// <summary>
+            /// The type a TypeDef token names in a loaded module. Throws like Module.ResolveType;
+            /// failures are not cached.
+            /// </summary>
+            public Type ResolveType(ModuleMessage moduleMessage, uint typeDef)
             {
-                errorList.Add($"Critical error during parsing: {ex.Message}");
+                var key = (moduleMessage.ModuleID, typeDef);
+                if (_definitions.TryGetValue(key, out var type))
+                    return type;
+
+                type = moduleMessage.LoadedAssembly.ManifestModule.ResolveType((int)typeDef);
+                return _definitions.GetOrAdd(key, type);
             }
 
-            errors += string.Join(Environment.NewLine, errorList);
-            return methods.ToArray();
+            /// <summary>
+            /// ConstructGenericType, remembering the instantiations that succeeded.
+            /// </summary>
+            public Type ConstructType(Type genericTypeDefinition, Type[] typeArguments, int expectedCount, List<string> errors)
+            {
+                var key = new ConstructedTypeKey(genericTypeDefinition, typeArguments);
+                if (_constructedTypes.TryGetValue(key, out var type))
+                    return type;
+
+                type = ConstructGenericType(genericTypeDefinition, typeArguments, expectedCount, errors);
+                return type == null ? null : _constructedTypes.GetOrAdd(key, type);
+            }
+
+            /// <summary>
+            /// The method or constructor of a closed generic type with the given definition token.
+            /// </summary>
+            public MethodBase FindMethod(Type closedGenericType, int metadataToken)
+            {
+                var index = _methodsByToken.GetOrAdd(closedGenericType, IndexMethods);
+                return index.TryGetValue(metadataToken, out var method) ? method : null;
+            }
+
+            // Methods before constructors, first one wins, as the linear search did.
+            private static Dictionary<int, MethodBase> IndexMethods(Type closedGenericType)
+            {
+                var bindingFlags = BindingFlags.Public | BindingFlags.NonPublic | BindingFlags.Instance | BindingFlags.Static;
+                var index = new Dictionary<int, MethodBase>();
+
+                foreach (var method in closedGenericType.GetMethods(bindingFlags))
+                    index.TryAdd(method.MetadataToken, method);
+
+                foreach (var ctor in closedGenericType.GetConstructors(bindingFlags))
+                    index.TryAdd(ctor.MetadataToken, ctor);
+
+                return index;
+            }
+
+            private readonly struct ConstructedTypeKey : IEquatable<ConstructedTypeKey>
+            {
+                private readonly Type _definition;
+                private readonly Type[] _arguments;
+                private readonly int _hashCode;
+
+                public ConstructedTypeKey(Type definition, Type[] arguments)
+                {
+                    _definition = definition;
+                    _arguments = arguments;
+
+                    var hash = new HashCode();
+                    hash.Add(definition);
+                    foreach (var argument in arguments)
+                        hash.Add(argument);
+                    _hashCode = hash.ToHashCode();
+                }
+
+                public bool Equals(ConstructedTypeKey other)
+                {
+                    if (_definition != other._definition || _arguments.Length != other._arguments.Length)
+                        return false;
+
+                    for (int i = 0; i < _arguments.Length; i++)
+                    {
+                        if (_arguments[i] != other._arguments[i])
+                            return false;
+                    }
+                    return true;
+                }
+
+                public override bool Equals(object obj) => obj is ConstructedTypeKey other && Equals(other);
+
+                public override int GetHashCode() => _hashCode;
+            }
         }
 
+        #endregion
+
         #region Assembly Load Context
 
         /// <summary>
@@ -189,116 +691,24 @@ namespace JitLogParser
 
         #endregion
 
-        #region Parsing Methods
+        #region Method Resolution
 
         /// <summary>
-        /// Generic method to parse JSON log files line-by-line
+        /// Loads assembly for a module, with error handling
         /// </summary>
-        private static TResult ParseJsonLogFile<TMessage, TResult>(
-            string filePath,
-            string fileDescription,
-            TResult defaultResult,
-            Func<TMessage, TResult, bool> processMessage,
-            List<string> errors)
+        private static bool EnsureModuleAssemblyLoaded(ModuleMessage moduleMessage, ProfilerAssemblyLoadContext loadContext, List<string> errors)
         {
-            if (!File.Exists(filePath))
-            {
-                errors.Add($"{fileDescription} file not found: {filePath}");
-                return defaultResult;
-            }
-
-            try
-            {
-                var lines = File.ReadAllLines(filePath);
-                var options = new JsonSerializerOptions
-                {
-                    PropertyNameCaseInsensitive = false
-                };
-
-                foreach (var line in lines)
-                {
-                    if (string.IsNullOrWhiteSpace(line))
-                        continue;
+            if (moduleMessage.LoadedAssembly != null)
+                return true;
 
-                    try
-                    {
-                        var msg = JsonSerializer.Deserialize<TMessage>(line, options);
-                        if (msg != null)
-                        {
-                            if (!processMessage(msg, defaultResult))
-                            {
-                                // If processMessage returns false, it means there was an error processing
-                                // but we continue to the next line
-                            }
-                        }
-                    }
-                    catch (JsonException ex)
-                    {
-                        errors.Add($"JSON parse error in {fileDescription} file: {ex.Message} | Line: {line}");
-                    }
-                }
-            }
-            catch (Exception ex)
+            // The load context's caches are not thread-safe, and one load per module is enough
+            lock (loadContext)
             {
-                errors.Add($"Error reading {fileDescription} file: {ex.Message}");
+                return LoadModuleAssembly(moduleMessage, loadContext, errors);
             }
-
-            return defaultResult;
-        }
-
-        private static Dictionary<ulong, ModuleMessage> ParseModulesFile(string filePath, List<string> errors)
-        {
-            var moduleMap = new Dictionary<ulong, ModuleMessage>();
-            return ParseJsonLogFile<ModuleMessage, Dictionary<ulong, ModuleMessage>>(
-                filePath,
-                "Modules",
-                moduleMap,
-                (msg, map) =>
-                {
-                    map[msg.ModuleID] = msg;
-                    return true;
-                },
-                errors);
         }
 
-        private static Dictionary<ulong, Enter3Message> ParseEnter3File(string filePath, List<string> errors)
-        {
-            var functionMap = new Dictionary<ulong, Enter3Message>();
-            return ParseJsonLogFile<Enter3Message, Dictionary<ulong, Enter3Message>>(
-                filePath,
-                "Enter3",
-                functionMap,
-                (msg, map) =>
-                {
-                    map[msg.FunctionID] = msg;
-                    return true;
-                },
-                errors);
-        }
-
-        private static HashSet<ulong> ParseJitFile(string filePath, List<string> errors)
-        {
-            var functionIds = new HashSet<ulong>();
-            return ParseJsonLogFile<JitMessage, HashSet<ulong>>(
-                filePath,
-                "JIT",
-                functionIds,
-                (msg, set) =>
-                {
-                    set.Add(msg.FunctionID);
-                    return true;
-                },
-                errors);
-        }
-
-        #endregion
-
-        #region Method Resolution
-
-        /// <summary>
-        /// Loads assembly for a module, with error handling
-        /// </summary>
-        private static bool EnsureModuleAssemblyLoaded(ModuleMessage moduleMessage, ProfilerAssemblyLoadContext loadContext, List<string> errors)
+        private static bool LoadModuleAssembly(ModuleMessage moduleMessage, ProfilerAssemblyLoadContext loadContext, List<string> errors)
         {
             if (moduleMessage.LoadedAssembly != null)
                 return true;
@@ -320,35 +730,32 @@ namespace JitLogParser
             }
         }
 
-        private static MethodBase ResolveMethodBase(Enter3Message enter3Msg, Dictionary<ulong, ModuleMessage> moduleMap, ProfilerAssemblyLoadContext loadContext, List<string> errors)
+        private static MethodBase ResolveMethodBase(Enter3Message enter3Msg, ResolutionContext context, List<string> errors)
         {
             // Get the module containing the declaring type
-            if (!moduleMap.TryGetValue(enter3Msg.DeclaringTypeModuleID, out ModuleMessage typeModuleMessage))
+            if (!context.ModuleMap.TryGetValue(enter3Msg.DeclaringTypeModuleID, out ModuleMessage typeModuleMessage))
             {
                 errors.Add($"Module 0x{enter3Msg.DeclaringTypeModuleID:X} not found for declaring type token 0x{enter3Msg.DeclaringTypeToken:X}");
                 return null;
             }
 
             // Load the assembly containing the declaring type if needed
-            if (!EnsureModuleAssemblyLoaded(typeModuleMessage, loadContext, errors))
+            if (!EnsureModuleAssemblyLoaded(typeModuleMessage, context.LoadContext, errors))
                 return null;
 
             try
             {
-                // Get the module from the assembly
-                var typeModule = typeModuleMessage.LoadedAssembly.ManifestModule;
-
                 // Resolve the declaring type using its token
-                var declaringType = typeModule.ResolveType((int)enter3Msg.DeclaringTypeToken);
+                var declaringType = context.ResolveType(typeModuleMessage, enter3Msg.DeclaringTypeToken);
 
                 // If the declaring type is generic and has type arguments, construct the closed generic type
                 if (enter3Msg.DeclaringTypeArgCount > 0 && declaringType.IsGenericTypeDefinition)
                 {
-                    var typeArgs = ResolveTypeArguments(enter3Msg.DeclaringTypeArgs, moduleMap, loadContext, errors);
+                    var typeArgs = ResolveTypeArguments(enter3Msg.DeclaringTypeArgs, context, errors);
                     if (typeArgs == null)
                         return null;
 
-                    declaringType = ConstructGenericType(declaringType, typeArgs, enter3Msg.DeclaringTypeArgCount, errors);
+                    declaringType = context.ConstructType(declaringType, typeArgs, enter3Msg.DeclaringTypeArgCount, errors);
                     if (declaringType == null)
                         return null;
                 }
@@ -370,7 +777,7 @@ namespace JitLogParser
                 // If we constructed a closed generic declaring type, find the corresponding method on it
                 if (enter3Msg.DeclaringTypeArgCount > 0 && declaringType.IsConstructedGenericType)
                 {
-                    var closedMethod = FindMethodOnClosedGenericType(declaringType, (int)enter3Msg.MethodToken);
+                    var closedMethod = context.FindMethod(declaringType, (int)enter3Msg.MethodToken);
                     if (closedMethod != null)
                     {
                         method = closedMethod;
@@ -391,7 +798,7 @@ namespace JitLogParser
                 {
                     try
                     {
-                        var methodTypeArgs = ResolveTypeArguments(enter3Msg.MethodTypeArgs, moduleMap, loadContext, errors);
+                        var methodTypeArgs = ResolveTypeArguments(enter3Msg.MethodTypeArgs, context, errors);
                         if (methodTypeArgs != null)
                         {
                             method = ConstructGenericMethod(methodInfo, methodTypeArgs, enter3Msg.MethodTypeArgCount, errors);
@@ -412,55 +819,32 @@ namespace JitLogParser
             }
         }
 
-        private static MethodBase FindMethodOnClosedGenericType(Type closedGenericType, int metadataToken)
-        {
-
-            var bindingFlags = BindingFlags.Public | BindingFlags.NonPublic | BindingFlags.Instance | BindingFlags.Static;
-
-            // Search methods
-            foreach (var method in closedGenericType.GetMethods(bindingFlags))
-            {
-                if (method.MetadataToken == metadataToken)
-                    return method;
-            }
-
-            // Search constructors
-            foreach (var ctor in closedGenericType.GetConstructors(bindingFlags))
-            {
-                if (ctor.MetadataToken == metadataToken)
-                    return ctor;
-            }
-
-            return null;
-        }
-
         /// <summary>
         /// Unified type resolution method that handles both single types and collections with recursive generic type construction
         /// </summary>
-        private static Type ResolveTypeFromInfo(TypeArgMessage typeArgMsg, Dictionary<ulong, ModuleMessage> moduleMap, ProfilerAssemblyLoadContext loadContext, List<string> errors)
+        private static Type ResolveTypeFromInfo(TypeArgMessage typeArgMsg, ResolutionContext context, List<string> errors)
         {
-            if (!moduleMap.TryGetValue(typeArgMsg.ModuleID, out var moduleMessage))
+            if (!context.ModuleMap.TryGetValue(typeArgMsg.ModuleID, out var moduleMessage))
             {
                 errors.Add($"Module 0x{typeArgMsg.ModuleID:X} not found for type 0x{typeArgMsg.TypeDef:X}");
                 return null;
             }
 
-            if (!EnsureModuleAssemblyLoaded(moduleMessage, loadContext, errors))
+            if (!EnsureModuleAssemblyLoaded(moduleMessage, context.LoadContext, errors))
                 return null;
 
             try
             {
-                var module = moduleMessage.LoadedAssembly.ManifestModule;
-                var type = module.ResolveType((int)typeArgMsg.TypeDef);
+                var type = context.ResolveType(moduleMessage, typeArgMsg.TypeDef);
 
                 // If this type has nested generic arguments, construct the closed generic type recursively
                 if (typeArgMsg.Nested != null && typeArgMsg.Nested.Count > 0 && type.IsGenericTypeDefinition)
                 {
-                    var nestedTypes = ResolveTypeArguments(typeArgMsg.Nested, moduleMap, loadContext, errors);
+                    var nestedTypes = ResolveTypeArguments(typeArgMsg.Nested, context, errors);
                     if (nestedTypes == null)
                         return null;
 
-                    type = ConstructGenericType(type, nestedTypes, typeArgMsg.Nested.Count, errors);
+                    type = context.ConstructType(type, nestedTypes, typeArgMsg.Nested.Count, errors);
                 }
 
                 return type;
@@ -475,12 +859,12 @@ namespace JitLogParser
         /// <summary>
         /// Resolves a collection of type arguments by delegating to the unified type resolver
         /// </summary>
-        private static Type[] ResolveTypeArguments(List<TypeArgMessage> typeArgMessages, Dictionary<ulong, ModuleMessage> moduleMap, ProfilerAssemblyLoadContext loadContext, List<string> errors)
+        private static Type[] ResolveTypeArguments(List<TypeArgMessage> typeArgMessages, ResolutionContext context, List<string> errors)
         {
             var types = new List<Type>();
             foreach (var typeArgMsg in typeArgMessages)
             {
-                var type = ResolveTypeFromInfo(typeArgMsg, moduleMap, loadContext, errors);
+                var type = ResolveTypeFromInfo(typeArgMsg, context, errors);
                 if (type == null)
                 {
                     errors.Add($"Failed to resolve type argument for ModuleID=0x{typeArgMsg.ModuleID:X}, TypeDef=0x{typeArgMsg.TypeDef:X}");
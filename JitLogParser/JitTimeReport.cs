@@ -0,0 +1,114 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Globalization;
+    using System.Linq;
+    using System.Text;
+
+    /// <summary>
+    /// Ranks the JIT-compiled methods of a run by the time the JIT spent on them, from the
+    /// JITCompilationFinished events logged with SIG_JIT_PROFILER_JIT_TIMING=1. A method compiled
+    /// more than once, e.g. at tier 0 and again at tier 1, is one entry with all its compilations.
+    /// </summary>
+    public sealed class JitTimeReport
+    {
+        public sealed class MethodTime
+        {
+            public ulong FunctionID { get; set; }
+
+            // Pretty signature, or null when the function has no Enter3 record
+            public string Method { get; set; }
+
+            public int Compilations { get; set; }
+
+            public int Failures { get; set; }
+
+            // Nanoseconds
+            public ulong TotalTime { get; set; }
+
+            public ulong MaxTime { get; set; }
+
+            // Native code bytes of the first successful compilation; 0 when the method ran precompiled
+            // code first, as the runtime only reports the code a method currently runs and a
+            // recompilation is not running yet when it finishes
+            public ulong CodeSize { get; set; }
+        }
+
+        // Slowest first
+        public List<MethodTime> Methods { get; } = new List<MethodTime>();
+
+        public int CompilationCount => Methods.Sum(x => x.Compilations);
+
+        public ulong TotalTime => Methods.Aggregate(0UL, (sum, x) => sum + x.TotalTime);
+
+        // Ranks a run read by JitProfilerLogParser.ReadEvents and names its methods from PE metadata
+        public static JitTimeReport Rank(ProfilerRun run, string executablePath, List<string> errors)
+        {
+            var report = Rank(run.Events.JitCompilations);
+            var names = JitProfilerLogParser.NameMethods(run, report.Methods.Select(x => x.FunctionID).ToList(), executablePath, errors);
+            for (int i = 0; i < names.Length; i++)
+                report.Methods[i].Method = names[i];
+            return report;
+        }
+
+        public static JitTimeReport Rank(IEnumerable<JitCompilationMessage> compilations)
+        {
+            if (compilations == null) throw new ArgumentNullException(nameof(compilations));
+
+            var byFunction = new Dictionary<ulong, MethodTime>();
+            foreach (var compilation in compilations)
+            {
+                if (!byFunction.TryGetValue(compilation.FunctionID, out var entry))
+                {
+                    entry = new MethodTime { FunctionID = compilation.FunctionID };
+                    byFunction.Add(compilation.FunctionID, entry);
+                }
+
+                entry.Compilations++;
+                entry.TotalTime += compilation.Duration;
+                entry.MaxTime = Math.Max(entry.MaxTime, compilation.Duration);
+
+                if (!compilation.Succeeded)
+                {
+                    entry.Failures++;
+                }
+                else if (compilation.CodeSize != 0)
+                {
+                    // The profiler sizes only the first compilation
+                    entry.CodeSize = compilation.CodeSize;
+                }
+            }
+
+            var result = new JitTimeReport();
+            result.Methods.AddRange(byFunction.Values.OrderByDescending(x => x.TotalTime).ThenBy(x => x.FunctionID));
+            return result;
+        }
+
+        public string ToReport(int top = 50)
+        {
+            var sb = new StringBuilder();
+            sb.AppendLine($"{CompilationCount} compilations of {Methods.Count} methods, {FormatMs(TotalTime)} ms in the JIT, {Methods.Sum(x => x.Failures)} failed");
+            sb.AppendLine("Bytes is the native code of a method's first compilation, 0 when it ran precompiled code first:");
+            sb.AppendLine("the runtime reports only the code a method runs, and a recompile is not running yet when it finishes.");
+            sb.AppendLine();
+            sb.AppendLine($"{"Total ms",10} {"Max ms",10} {"Count",6} {"Bytes",8}  Method");
+            foreach (var method in Methods.Take(top))
+            {
+                var name = method.Method ?? $"FunctionID 0x{method.FunctionID:X}";
+                if (method.Failures > 0)
+                    name += $" ({method.Failures} failed)";
+                sb.AppendLine($"{FormatMs(method.TotalTime),10} {FormatMs(method.MaxTime),10} {method.Compilations,6} {method.CodeSize,8}  {name}");
+            }
+
+            if (Methods.Count > top)
+                sb.AppendLine($"... {Methods.Count - top} more");
+            return sb.ToString();
+        }
+
+        private static string FormatMs(ulong nanoseconds)
+        {
+            return (nanoseconds / 1e6).ToString("0.000", CultureInfo.InvariantCulture);
+        }
+    }
+}
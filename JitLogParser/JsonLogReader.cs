@@ -0,0 +1,589 @@
+﻿using System;
+using System.Buffers;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Text.Json;
+using System.Threading.Tasks;
+
+namespace JitLogParser
+{
+    /// <summary>
+    /// Streaming reader for the JSON log files the profiler writes by default
+    /// (modules.json, enter3.json and jit.json, one record per line).
+    /// Each file is read in pooled chunks cut at line boundaries, and the chunks of all
+    /// three files are parsed with Utf8JsonReader on every core into concurrent maps.
+    /// Memory use follows the number of distinct records, not the size of the files.
+    /// </summary>
+    public static class JsonLogReader
+    {
+        public const int DefaultChunkSize = 4 << 20;
+
+        private enum LogKind
+        {
+            Modules,
+            Enter3,
+            Jit,
+        }
+
+        private readonly struct Chunk
+        {
+            public Chunk(LogKind kind, byte[] buffer, int length)
+            {
+                Kind = kind;
+                Buffer = buffer;
+                Length = length;
+            }
+
+            public LogKind Kind { get; }
+            public byte[] Buffer { get; }
+            public int Length { get; }
+        }
+
+        /// <summary>
+        /// Reads the three JSON log files and fills the maps ResolveMethods works from.
+        /// A record repeated in a file replaces the earlier one, in no particular order.
+        /// </summary>
+        /// <param name="modulesFilePath">Path to modules.json</param>
+        /// <param name="enter3FilePath">Path to enter3.json</param>
+        /// <param name="jitFilePath">Path to jit.json</param>
+        /// <param name="moduleMap">Receives ModuleID -> module record</param>
+        /// <param name="functionMap">Receives FunctionID -> Enter3 record</param>
+        /// <param name="jitFunctionIds">Receives the FunctionIDs that were JIT compiled, as keys</param>
+        /// <param name="errors">Receives missing files and malformed lines; the other lines are still read</param>
+        /// <param name="chunkSize">Bytes read from a file at a time; longer lines get a larger chunk</param>
+        /// <param name="events">Receives the other events in the logs, e.g. JIT timings; null to skip them</param>
+        public static void Read(
+            string modulesFilePath,
+            string enter3FilePath,
+            string jitFilePath,
+            ConcurrentDictionary<ulong, ModuleMessage> moduleMap,
+            ConcurrentDictionary<ulong, Enter3Message> functionMap,
+            ConcurrentDictionary<ulong, byte> jitFunctionIds,
+            List<string> errors,
+            int chunkSize = DefaultChunkSize,
+            ProfilerEvents events = null)
+        {
+            Read(modulesFilePath, enter3FilePath, jitFilePath, new JsonLogOffsets(), false,
+                moduleMap, functionMap, jitFunctionIds, errors, chunkSize, events);
+        }
+
+        /// <summary>
+        /// Reads what the three JSON log files gained since offsets, for logs the profiler is still writing.
+        /// Only whole lines are read: a line still being written, or in a mapped log the first record
+        /// the profiler has reserved but not copied yet, and everything after it, is left for the next call.
+        /// </summary>
+        /// <param name="offsets">Where the previous call stopped in each file; advanced past what this call read</param>
+        /// <param name="toEnd">The profiler has stopped writing: read everything, as Read does</param>
+        /// <param name="modulesFilePath">Path to modules.json</param>
+        /// <param name="enter3FilePath">Path to enter3.json</param>
+        /// <param name="jitFilePath">Path to jit.json</param>
+        /// <param name="moduleMap">Receives ModuleID -> module record</param>
+        /// <param name="functionMap">Receives FunctionID -> Enter3 record</param>
+        /// <param name="jitFunctionIds">Receives the FunctionIDs that were JIT compiled, as keys</param>
+        /// <param name="errors">Receives missing files and malformed lines; the other lines are still read</param>
+        /// <param name="chunkSize">Bytes read from a file at a time; longer lines get a larger chunk</param>
+        /// <param name="events">Receives the other events in the logs, e.g. JIT timings; null to skip them</param>
+        public static void ReadFrom(
+            JsonLogOffsets offsets,
+            bool toEnd,
+            string modulesFilePath,
+            string enter3FilePath,
+            string jitFilePath,
+            ConcurrentDictionary<ulong, ModuleMessage> moduleMap,
+            ConcurrentDictionary<ulong, Enter3Message> functionMap,
+            ConcurrentDictionary<ulong, byte> jitFunctionIds,
+            List<string> errors,
+            int chunkSize = DefaultChunkSize,
+            ProfilerEvents events = null)
+        {
+            Read(modulesFilePath, enter3FilePath, jitFilePath, offsets, !toEnd,
+                moduleMap, functionMap, jitFunctionIds, errors, chunkSize, events);
+        }
+
+        private static void Read(
+            string modulesFilePath,
+            string enter3FilePath,
+            string jitFilePath,
+            JsonLogOffsets offsets,
+            bool wholeLinesOnly,
+            ConcurrentDictionary<ulong, ModuleMessage> moduleMap,
+            ConcurrentDictionary<ulong, Enter3Message> functionMap,
+            ConcurrentDictionary<ulong, byte> jitFunctionIds,
+            List<string> errors,
+            int chunkSize,
+            ProfilerEvents events)
+        {
+            int workerCount = Environment.ProcessorCount;
+
+            // Bounded, so a fast disk cannot queue up more of the file than the workers keep up with
+            using (var chunks = new BlockingCollection<Chunk>(workerCount * 2))
+            {
+                var workers = new Task[workerCount];
+                for (int i = 0; i < workers.Length; i++)
+                {
+                    workers[i] = Task.Factory.StartNew(() =>
+                    {
+                        foreach (var chunk in chunks.GetConsumingEnumerable())
+                        {
+                            ParseChunk(chunk, moduleMap, functionMap, jitFunctionIds, errors, events);
+                            ArrayPool<byte>.Shared.Return(chunk.Buffer);
+                        }
+                    }, TaskCreationOptions.LongRunning);
+                }
+
+                try
+                {
+                    var modules = Task.Run(() => SplitFile(LogKind.Modules, modulesFilePath, offsets.Modules, wholeLinesOnly, chunks, chunkSize, errors));
+                    var enter3 = Task.Run(() => SplitFile(LogKind.Enter3, enter3FilePath, offsets.Enter3, wholeLinesOnly, chunks, chunkSize, errors));
+                    var jit = Task.Run(() => SplitFile(LogKind.Jit, jitFilePath, offsets.Jit, wholeLinesOnly, chunks, chunkSize, errors));
+                    Task.WaitAll(modules, enter3, jit);
+
+                    offsets.Modules = modules.Result;
+                    offsets.Enter3 = enter3.Result;
+                    offsets.Jit = jit.Result;
+                }
+                finally
+                {
+                    chunks.CompleteAdding();
+                    Task.WaitAll(workers);
+                }
+            }
+        }
+
+        private static string Describe(LogKind kind)
+        {
+            return kind switch
+            {
+                LogKind.Modules => "Modules",
+                LogKind.Enter3 => "Enter3",
+                _ => "JIT",
+            };
+        }
+
+        private static void AddError(List<string> errors, string error)
+        {
+            lock (errors)
+            {
+                errors.Add(error);
+            }
+        }
+
+        /// <summary>
+        /// Queues the file from start in chunks that end after a newline (or at the end of the file,
+        /// unless only whole lines are wanted). Returns the offset after the last byte queued.
+        /// </summary>
+        private static long SplitFile(LogKind kind, string filePath, long start, bool wholeLinesOnly, BlockingCollection<Chunk> chunks, int chunkSize, List<string> errors)
+        {
+            if (!File.Exists(filePath))
+            {
+                AddError(errors, $"{Describe(kind)} file not found: {filePath}");
+                return start;
+            }
+
+            long queued = start;
+            byte[] buffer = null;
+            try
+            {
+                // No FileStream buffer: every read already asks for a whole chunk
+                using (var stream = new FileStream(filePath, FileMode.Open, FileAccess.Read, FileShare.ReadWrite, 1, FileOptions.SequentialScan))
+                {
+                    stream.Position = start;
+                    buffer = ArrayPool<byte>.Shared.Rent(chunkSize);
+                    int length = 0;
+                    bool reachedUnwritten = false;
+                    while (!reachedUnwritten)
+                    {
+                        // A line longer than the buffer: keep reading into a larger one
+                        if (length == buffer.Length)
+                        {
+                            var larger = ArrayPool<byte>.Shared.Rent(buffer.Length * 2);
+                            Buffer.BlockCopy(buffer, 0, larger, 0, length);
+                            ArrayPool<byte>.Shared.Return(buffer);
+                            buffer = larger;
+                        }
+
+                        int read = stream.Read(buffer, length, buffer.Length - length);
+                        if (read == 0)
+                            break;
+
+                        // A live mapped log is zero past the records copied so far
+                        int limit = length + read;
+                        if (wholeLinesOnly)
+                        {
+                            int zero = buffer.AsSpan(length, read).IndexOf((byte)0);
+                            if (zero >= 0)
+                            {
+                                limit = length + zero;
+                                reachedUnwritten = true;
+                            }
+                        }
+                        length += read;
+
+                        int end = buffer.AsSpan(0, limit).LastIndexOf((byte)'\n') + 1;
+                        if (end == 0)
+                            continue;
+
+                        // The partial line after the last newline starts the next chunk
+                        var next = ArrayPool<byte>.Shared.Rent(Math.Max(chunkSize, length - end));
+                        Buffer.BlockCopy(buffer, end, next, 0, length - end);
+                        chunks.Add(new Chunk(kind, buffer, end));
+                        queued += end;
+                        buffer = next;
+                        length -= end;
+                    }
+
+                    if (length > 0 && !wholeLinesOnly)
+                    {
+                        chunks.Add(new Chunk(kind, buffer, length));
+                        queued += length;
+                        buffer = null;
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                AddError(errors, $"Error reading {Describe(kind)} file: {ex.Message}");
+            }
+            finally
+            {
+                if (buffer != null)
+                    ArrayPool<byte>.Shared.Return(buffer);
+            }
+            return queued;
+        }
+
+        private static void ParseChunk(
+            Chunk chunk,
+            ConcurrentDictionary<ulong, ModuleMessage> moduleMap,
+            ConcurrentDictionary<ulong, Enter3Message> functionMap,
+            ConcurrentDictionary<ulong, byte> jitFunctionIds,
+            List<string> errors,
+            ProfilerEvents events)
+        {
+            var remaining = new ReadOnlySpan<byte>(chunk.Buffer, 0, chunk.Length);
+            while (!remaining.IsEmpty)
+            {
+                int newline = remaining.IndexOf((byte)'\n');
+                var line = newline < 0 ? remaining : remaining.Slice(0, newline);
+                remaining = newline < 0 ? ReadOnlySpan<byte>.Empty : remaining.Slice(newline + 1);
+
+                // A mapped log of a killed process ends in zeros, and a record that was
+                // reserved but never copied leaves zeros in front of the next line
+                line = line.Trim((byte)0).Trim(" \t\r"u8);
+                if (line.IsEmpty)
+                    continue;
+
+                try
+                {
+                    var reader = new Utf8JsonReader(line);
+                    reader.Read();
+                    ExpectObject(ref reader);
+                    switch (chunk.Kind)
+                    {
+                        case LogKind.Modules:
+                            ReadModule(ref reader, moduleMap, events);
+                            break;
+                        case LogKind.Enter3:
+                            {
+                                var msg = ReadEnter3(ref reader);
+                                functionMap[msg.FunctionID] = msg;
+                                break;
+                            }
+                        default:
+                            ReadJit(ref reader, jitFunctionIds, events);
+                            break;
+                    }
+                }
+                catch (Exception ex) when (ex is JsonException || ex is InvalidOperationException || ex is FormatException)
+                {
+                    AddError(errors, $"JSON parse error in {Describe(chunk.Kind)} file: {ex.Message} | Line: {Encoding.UTF8.GetString(line)}");
+                }
+            }
+        }
+
+        #region Records
+
+        // Each reader starts on the record's StartObject and ends on its EndObject.
+        // Properties it does not know, e.g. from newer profilers, are skipped.
+
+        // modules.json holds module records, which have no "Event", and "Unloaded" events
+        private static void ReadModule(ref Utf8JsonReader reader, ConcurrentDictionary<ulong, ModuleMessage> moduleMap, ProfilerEvents events)
+        {
+            var msg = new ModuleMessage();
+            string eventName = null;
+            ulong time = 0;
+            while (NextProperty(ref reader))
+            {
+                if (reader.ValueTextEquals("ModuleID"u8))
+                    msg.ModuleID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("ModuleName"u8))
+                    msg.ModuleName = ReadString(ref reader);
+                else if (reader.ValueTextEquals("AssemblyID"u8))
+                    msg.AssemblyID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("AssemblyName"u8))
+                    msg.AssemblyName = ReadString(ref reader);
+                else if (reader.ValueTextEquals("LoadTime"u8))
+                    msg.LoadTime = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("Event"u8))
+                    eventName = ReadString(ref reader);
+                else if (reader.ValueTextEquals("Time"u8))
+                    time = ReadUInt64(ref reader);
+                else
+                    SkipValue(ref reader);
+            }
+
+            if (eventName == null)
+            {
+                moduleMap[msg.ModuleID] = msg;
+                events?.ModuleLoads.Enqueue(msg);
+            }
+            else if (eventName == "Unloaded")
+            {
+                events?.ModuleUnloads.Enqueue(new ModuleUnloadMessage { ModuleID = msg.ModuleID, Time = time });
+            }
+        }
+
+        // Every property of the records in jit.json; "Event" says which of them a record has
+        private struct JitRecord
+        {
+            public ulong FunctionID;
+            public string Event;
+            public ulong Start;
+            public ulong Finish;
+            public ulong CodeSize;
+            public uint HResult;
+            public ulong Time;
+            public ulong Callee;
+            public ulong CalleeModuleID;
+            public uint CalleeToken;
+            public uint Thread;
+            public ulong Seq;
+            public ulong ThreadID;
+            public uint OSThreadID;
+            public string Name;
+            public ulong Count;
+        }
+
+        // jit.json holds JITCompilationStarted records, which have no "Event", and
+        // the events named by it. Events this reader does not know are skipped.
+        private static void ReadJit(ref Utf8JsonReader reader, ConcurrentDictionary<ulong, byte> jitFunctionIds, ProfilerEvents events)
+        {
+            var record = new JitRecord();
+            while (NextProperty(ref reader))
+            {
+                if (reader.ValueTextEquals("FunctionID"u8))
+                    record.FunctionID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("Event"u8))
+                    record.Event = ReadString(ref reader);
+                else if (reader.ValueTextEquals("Start"u8))
+                    record.Start = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("Finish"u8))
+                    record.Finish = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("CodeSize"u8))
+                    record.CodeSize = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("HResult"u8))
+                    record.HResult = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("Time"u8))
+                    record.Time = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("Callee"u8))
+                    record.Callee = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("CalleeModuleID"u8))
+                    record.CalleeModuleID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("CalleeToken"u8))
+                    record.CalleeToken = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("Thread"u8))
+                    record.Thread = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("Seq"u8))
+                    record.Seq = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("ThreadID"u8))
+                    record.ThreadID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("OSThreadID"u8))
+                    record.OSThreadID = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("Name"u8))
+                    record.Name = ReadString(ref reader);
+                else if (reader.ValueTextEquals("Count"u8))
+                    record.Count = ReadUInt64(ref reader);
+                else
+                    SkipValue(ref reader);
+            }
+
+            if (record.Event == null)
+            {
+                jitFunctionIds.TryAdd(record.FunctionID, 0);
+                if (record.Thread != 0)
+                    events?.JitStarts.Enqueue(new JitStartMessage { FunctionID = record.FunctionID, Thread = record.Thread, Seq = record.Seq, Time = record.Time });
+                return;
+            }
+
+            if (events == null)
+                return;
+
+            switch (record.Event)
+            {
+                case "JitFinished":
+                    events.JitCompilations.Enqueue(new JitCompilationMessage
+                    {
+                        FunctionID = record.FunctionID,
+                        Start = record.Start,
+                        Finish = record.Finish,
+                        CodeSize = record.CodeSize,
+                        HResult = record.HResult
+                    });
+                    break;
+                case "Inlined":
+                    events.Inlinings.Enqueue(new InliningMessage
+                    {
+                        Caller = record.FunctionID,
+                        Callee = record.Callee,
+                        CalleeModuleID = record.CalleeModuleID,
+                        CalleeToken = record.CalleeToken
+                    });
+                    break;
+                case "CacheHit":
+                    events.CacheHits.Enqueue(new CacheHitMessage { FunctionID = record.FunctionID, Time = record.Time });
+                    break;
+                case "Thread":
+                    events.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Indexed, Thread = record.Thread, ThreadID = record.ThreadID, Time = record.Time });
+                    break;
+                case "ThreadCreated":
+                    events.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Created, ThreadID = record.ThreadID, Time = record.Time });
+                    break;
+                case "ThreadDestroyed":
+                    events.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Destroyed, ThreadID = record.ThreadID, Time = record.Time });
+                    break;
+                case "ThreadAssigned":
+                    events.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Assigned, ThreadID = record.ThreadID, OSThreadID = record.OSThreadID });
+                    break;
+                case "ThreadName":
+                    events.ThreadEvents.Enqueue(new ThreadEventMessage { Kind = ThreadEventKind.Named, ThreadID = record.ThreadID, Name = record.Name });
+                    break;
+                case "CallCount":
+                    events.CallCounts.Enqueue(new CallCountMessage { FunctionID = record.FunctionID, Count = record.Count });
+                    break;
+            }
+        }
+
+        private static Enter3Message ReadEnter3(ref Utf8JsonReader reader)
+        {
+            var msg = new Enter3Message();
+            while (NextProperty(ref reader))
+            {
+                if (reader.ValueTextEquals("FunctionID"u8))
+                    msg.FunctionID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("ModuleID"u8))
+                    msg.ModuleID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("MethodToken"u8))
+                    msg.MethodToken = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("DeclaringTypeModuleID"u8))
+                    msg.DeclaringTypeModuleID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("DeclaringTypeToken"u8))
+                    msg.DeclaringTypeToken = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("DeclaringTypeArgCount"u8))
+                    msg.DeclaringTypeArgCount = ReadInt32(ref reader);
+                else if (reader.ValueTextEquals("DeclaringTypeArgs"u8))
+                    msg.DeclaringTypeArgs = ReadTypeArgs(ref reader);
+                else if (reader.ValueTextEquals("MethodTypeArgCount"u8))
+                    msg.MethodTypeArgCount = ReadInt32(ref reader);
+                else if (reader.ValueTextEquals("MethodTypeArgs"u8))
+                    msg.MethodTypeArgs = ReadTypeArgs(ref reader);
+                else if (reader.ValueTextEquals("Thread"u8))
+                    msg.Thread = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("Seq"u8))
+                    msg.Seq = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("Time"u8))
+                    msg.Time = ReadUInt64(ref reader);
+                else
+                    SkipValue(ref reader);
+            }
+            return msg;
+        }
+
+        private static List<TypeArgMessage> ReadTypeArgs(ref Utf8JsonReader reader)
+        {
+            reader.Read();
+            if (reader.TokenType == JsonTokenType.Null)
+                return null;
+            if (reader.TokenType != JsonTokenType.StartArray)
+                throw new JsonException($"Expected an array of type arguments, found {reader.TokenType}");
+
+            var typeArgs = new List<TypeArgMessage>();
+            while (reader.Read() && reader.TokenType != JsonTokenType.EndArray)
+            {
+                ExpectObject(ref reader);
+                typeArgs.Add(ReadTypeArg(ref reader));
+            }
+            return typeArgs;
+        }
+
+        private static TypeArgMessage ReadTypeArg(ref Utf8JsonReader reader)
+        {
+            var msg = new TypeArgMessage();
+            while (NextProperty(ref reader))
+            {
+                if (reader.ValueTextEquals("ModuleID"u8))
+                    msg.ModuleID = ReadUInt64(ref reader);
+                else if (reader.ValueTextEquals("TypeDef"u8))
+                    msg.TypeDef = ReadUInt32(ref reader);
+                else if (reader.ValueTextEquals("NestedCount"u8))
+                    msg.NestedCount = ReadInt32(ref reader);
+                else if (reader.ValueTextEquals("Nested"u8))
+                    msg.Nested = ReadTypeArgs(ref reader);
+                else
+                    SkipValue(ref reader);
+            }
+            return msg;
+        }
+
+        private static void ExpectObject(ref Utf8JsonReader reader)
+        {
+            if (reader.TokenType != JsonTokenType.StartObject)
+                throw new JsonException($"Expected an object, found {reader.TokenType}");
+        }
+
+        // Moves to the next property name of the current object; false at its end.
+        private static bool NextProperty(ref Utf8JsonReader reader)
+        {
+            if (!reader.Read())
+                throw new JsonException("Record ends inside an object");
+            if (reader.TokenType == JsonTokenType.EndObject)
+                return false;
+            if (reader.TokenType != JsonTokenType.PropertyName)
+                throw new JsonException($"Expected a property name, found {reader.TokenType}");
+            return true;
+        }
+
+        private static ulong ReadUInt64(ref Utf8JsonReader reader)
+        {
+            reader.Read();
+            return reader.GetUInt64();
+        }
+
+        private static uint ReadUInt32(ref Utf8JsonReader reader)
+        {
+            reader.Read();
+            return reader.GetUInt32();
+        }
+
+        private static int ReadInt32(ref Utf8JsonReader reader)
+        {
+            reader.Read();
+            return reader.GetInt32();
+        }
+
+        private static string ReadString(ref Utf8JsonReader reader)
+        {
+            reader.Read();
+            return reader.GetString();
+        }
+
+        private static void SkipValue(ref Utf8JsonReader reader)
+        {
+            reader.Read();
+            reader.Skip();
+        }
+
+        #endregion
+    }
+}
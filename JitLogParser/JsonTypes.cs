@@ -17,6 +17,84 @@ namespace JitLogParser
         public ulong FunctionID { get; set; }
     }
 
+    // JITCompilationFinished, logged with SIG_JIT_PROFILER_JIT_TIMING=1. Times are
+    // nanoseconds on the profiled machine's monotonic clock.
+    public class JitCompilationMessage
+    {
+        [JsonPropertyName("FunctionID")]
+        public ulong FunctionID { get; set; }
+
+        [JsonPropertyName("Start")]
+        public ulong Start { get; set; }
+
+        [JsonPropertyName("Finish")]
+        public ulong Finish { get; set; }
+
+        // Native code bytes, hot and cold regions together, of a function's first compilation; 0 for
+        // recompilations, for the first compilation of precompiled code and when compilation failed
+        [JsonPropertyName("CodeSize")]
+        public ulong CodeSize { get; set; }
+
+        [JsonPropertyName("HResult")]
+        public uint HResult { get; set; }
+
+        [JsonIgnore]
+        public ulong Duration => Finish - Start;
+
+        [JsonIgnore]
+        public bool Succeeded => (int)HResult >= 0;
+    }
+
+    // JITInlining, logged once per pair with SIG_JIT_PROFILER_INLINING=1. The callee's
+    // definition names it when it never ran on its own and so has no Enter3 record.
+    public class InliningMessage
+    {
+        [JsonPropertyName("FunctionID")]
+        public ulong Caller { get; set; }
+
+        [JsonPropertyName("Callee")]
+        public ulong Callee { get; set; }
+
+        // 0 when the profiler could not look the callee up
+        [JsonPropertyName("CalleeModuleID")]
+        public ulong CalleeModuleID { get; set; }
+
+        [JsonPropertyName("CalleeToken")]
+        public uint CalleeToken { get; set; }
+    }
+
+    // The first time the runtime used precompiled (ReadyToRun) code for a function,
+    // logged with SIG_JIT_PROFILER_TIERS=1; same clock as JitCompilationMessage
+    public class CacheHitMessage
+    {
+        [JsonPropertyName("FunctionID")]
+        public ulong FunctionID { get; set; }
+
+        [JsonPropertyName("Time")]
+        public ulong Time { get; set; }
+    }
+
+    // The calls of a function since its previous CallCount record, logged a few times a second with
+    // SIG_JIT_PROFILER_CALL_COUNTS=1; a function's records add up to its calls
+    public class CallCountMessage
+    {
+        [JsonPropertyName("FunctionID")]
+        public ulong FunctionID { get; set; }
+
+        [JsonPropertyName("Count")]
+        public ulong Count { get; set; }
+    }
+
+    // ModuleUnloadStarted of a module that was logged; in modules.json an "Event":"Unloaded" line
+    public class ModuleUnloadMessage
+    {
+        [JsonPropertyName("ModuleID")]
+        public ulong ModuleID { get; set; }
+
+        [JsonPropertyName("Time")]
+        public ulong Time { get; set; }
+    }
+
     public class ModuleMessage
     {
         [JsonPropertyName("ModuleID")]
@@ -31,10 +109,24 @@ namespace JitLogParser
         [JsonPropertyName("AssemblyName")]
         public string AssemblyName { get; set; }
 
+        // Profiler clock, nanoseconds; 0 when the module loaded while capture was off
+        // and was logged when a record first referred to it
+        [JsonPropertyName("LoadTime")]
+        public ulong LoadTime { get; set; }
+
         // Cached assembly for this module
+        [JsonIgnore]
         public Assembly LoadedAssembly { get; set; }
     }
 
+    // How far JsonLogReader.ReadFrom has read each log file
+    public class JsonLogOffsets
+    {
+        public long Modules { get; set; }
+        public long Enter3 { get; set; }
+        public long Jit { get; set; }
+    }
+
     public class TypeArgMessage
     {
         [JsonPropertyName("ModuleID")]
@@ -78,5 +170,62 @@ namespace JitLogParser
 
         [JsonPropertyName("MethodTypeArgs")]
         public List<TypeArgMessage> MethodTypeArgs { get; set; }
+
+        // With SIG_JIT_PROFILER_THREADS=1: index of the thread that made the record,
+        // 0 when untagged, its record count on that thread, and profiler clock nanoseconds
+        [JsonPropertyName("Thread")]
+        public uint Thread { get; set; }
+
+        [JsonPropertyName("Seq")]
+        public ulong Seq { get; set; }
+
+        [JsonPropertyName("Time")]
+        public ulong Time { get; set; }
+    }
+
+    // A JITCompilationStarted record tagged with SIG_JIT_PROFILER_THREADS=1
+    public class JitStartMessage
+    {
+        [JsonPropertyName("FunctionID")]
+        public ulong FunctionID { get; set; }
+
+        [JsonPropertyName("Thread")]
+        public uint Thread { get; set; }
+
+        [JsonPropertyName("Seq")]
+        public ulong Seq { get; set; }
+
+        [JsonPropertyName("Time")]
+        public ulong Time { get; set; }
+    }
+
+    public enum ThreadEventKind
+    {
+        // The first tagged record of a thread: Thread, ThreadID (0 for a thread the runtime
+        // does not manage) and Time
+        Indexed,
+        // ThreadID, Time
+        Created,
+        Destroyed,
+        // ThreadID, OSThreadID
+        Assigned,
+        // ThreadID, Name
+        Named
+    }
+
+    // Thread events, logged with SIG_JIT_PROFILER_THREADS=1; which properties are set depends on Kind
+    public class ThreadEventMessage
+    {
+        public ThreadEventKind Kind { get; set; }
+
+        public uint Thread { get; set; }
+
+        public ulong ThreadID { get; set; }
+
+        public ulong Time { get; set; }
+
+        public uint OSThreadID { get; set; }
+
+        public string Name { get; set; }
     }
 }
@@ -0,0 +1,800 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Collections.Immutable;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Linq;
+using System.Reflection;
+using System.Reflection.Metadata;
+using System.Reflection.Metadata.Ecma335;
+using System.Reflection.PortableExecutable;
+
+namespace JitLogParser
+{
+    /// <summary>
+    /// Resolves profiler functions to manifest nodes from PE metadata alone. Assemblies are
+    /// memory-mapped and read with MetadataReader, never loaded, so the parser's process stays
+    /// clean and the target may use a framework the host runtime cannot run. The nodes are the
+    /// ones MethodBaseSerializer.ToNode makes of the same methods.
+    /// Thread-safe: resolution runs on all cores against shared images and caches.
+    /// </summary>
+    public sealed class MetadataResolver : IDisposable
+    {
+        // Forwarders are followed at most this deep, in case two facades point at each other
+        private const int MaxForwardingDepth = 16;
+
+        private readonly IReadOnlyDictionary<ulong, ModuleMessage> _moduleMap;
+        private readonly Dictionary<string, string> _pathsByAssemblyName = new Dictionary<string, string>(StringComparer.OrdinalIgnoreCase);
+        private readonly List<string> _probeDirectories = new List<string>();
+        private readonly ConcurrentDictionary<string, Lazy<MetadataImage>> _imagesByPath =
+            new ConcurrentDictionary<string, Lazy<MetadataImage>>(StringComparer.OrdinalIgnoreCase);
+        private readonly ConcurrentDictionary<string, Lazy<MetadataImage>> _imagesByName =
+            new ConcurrentDictionary<string, Lazy<MetadataImage>>(StringComparer.OrdinalIgnoreCase);
+        private readonly ConcurrentDictionary<MetadataReader, MetadataImage> _imagesByReader =
+            new ConcurrentDictionary<MetadataReader, MetadataImage>();
+        private readonly SignatureTypeProvider _provider;
+        private readonly Lazy<MetadataImage> _coreLibrary;
+
+        /// <param name="moduleMap">ModuleID -> module record; its paths are where the runtime bound each assembly</param>
+        /// <param name="executablePath">Folder of the profiled executable, probed for assemblies no module names</param>
+        public MetadataResolver(IReadOnlyDictionary<ulong, ModuleMessage> moduleMap, string executablePath)
+        {
+            _moduleMap = moduleMap;
+            _provider = new SignatureTypeProvider(this);
+            _coreLibrary = new Lazy<MetadataImage>(() => FindAssembly("System.Private.CoreLib") ?? FindAssembly("mscorlib"));
+
+            AddProbeDirectory(executablePath);
+            foreach (var module in moduleMap.Values)
+            {
+                if (string.IsNullOrEmpty(module.ModuleName))
+                    continue;
+
+                // The shared framework folder comes in through CoreLib's module
+                AddProbeDirectory(Path.GetDirectoryName(module.ModuleName));
+
+                var name = GetSimpleName(module.AssemblyName);
+                if (name != null && !_pathsByAssemblyName.ContainsKey(name))
+                    _pathsByAssemblyName[name] = module.ModuleName;
+            }
+        }
+
+        // Null when neither System.Private.CoreLib nor mscorlib can be found
+        internal MetadataImage CoreLibrary => _coreLibrary.Value;
+
+        /// <summary>
+        /// The manifest node of the function an Enter3 record describes, or null with the reason in errors.
+        /// </summary>
+        public MethodBaseSerializer.MethodNode Resolve(Enter3Message enter3Msg, List<string> errors)
+        {
+            return ResolveMethod(enter3Msg, errors)?.ToNode();
+        }
+
+        /// <summary>
+        /// The manifest node of a method definition, for functions logged without an Enter3 record.
+        /// Generic definitions come back open, over their own type parameters.
+        /// </summary>
+        public MethodBaseSerializer.MethodNode ResolveDefinition(ulong moduleId, uint methodToken, List<string> errors)
+        {
+            if (!_moduleMap.TryGetValue(moduleId, out ModuleMessage moduleMessage))
+            {
+                errors.Add($"Module 0x{moduleId:X} not found for method token 0x{methodToken:X}");
+                return null;
+            }
+
+            var image = GetModuleImage(moduleMessage, errors);
+            if (image == null)
+                return null;
+
+            uint declaringTypeToken;
+            try
+            {
+                var methodHandle = MetadataTokens.MethodDefinitionHandle((int)(methodToken & 0xFFFFFF));
+                declaringTypeToken = (uint)MetadataTokens.GetToken(image.Reader.GetMethodDefinition(methodHandle).GetDeclaringType());
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Failed to resolve method token 0x{methodToken:X}: {ex.Message}");
+                return null;
+            }
+
+            return Resolve(new Enter3Message
+            {
+                ModuleID = moduleId,
+                MethodToken = methodToken,
+                DeclaringTypeModuleID = moduleId,
+                DeclaringTypeToken = declaringTypeToken
+            }, errors);
+        }
+
+        /// <summary>
+        /// The definition of the function an Enter3 record describes and the instantiation it ran
+        /// as, or null with the reason in errors.
+        /// </summary>
+        internal ResolvedMethod ResolveMethod(Enter3Message enter3Msg, List<string> errors)
+        {
+            if (!_moduleMap.TryGetValue(enter3Msg.DeclaringTypeModuleID, out ModuleMessage typeModuleMessage))
+            {
+                errors.Add($"Module 0x{enter3Msg.DeclaringTypeModuleID:X} not found for declaring type token 0x{enter3Msg.DeclaringTypeToken:X}");
+                return null;
+            }
+
+            var image = GetModuleImage(typeModuleMessage, errors);
+            if (image == null)
+                return null;
+
+            try
+            {
+                var declaringType = image.GetDefinition(ToTypeDefinitionHandle(enter3Msg.DeclaringTypeToken));
+                var typeDefinition = image.Reader.GetTypeDefinition(declaringType.Handle);
+                int typeParameterCount = typeDefinition.GetGenericParameters().Count;
+                var typeArguments = GenericParameters(image, typeDefinition.GetGenericParameters());
+
+                // If the declaring type is generic and has type arguments, close it over them
+                if (enter3Msg.DeclaringTypeArgCount > 0 && typeParameterCount > 0)
+                {
+                    typeArguments = ResolveTypeArguments(enter3Msg.DeclaringTypeArgs, errors);
+                    if (typeArguments == null)
+                        return null;
+
+                    declaringType = Instantiate(declaringType, typeArguments, enter3Msg.DeclaringTypeArgCount, errors);
+                    if (declaringType == null)
+                        return null;
+                }
+
+                if ((enter3Msg.MethodToken >> 24) != (uint)TableIndex.MethodDef)
+                    throw new BadImageFormatException($"0x{enter3Msg.MethodToken:X} is not a MethodDef token");
+
+                var methodHandle = MetadataTokens.MethodDefinitionHandle((int)(enter3Msg.MethodToken & 0xFFFFFF));
+                var methodDefinition = image.Reader.GetMethodDefinition(methodHandle);
+                var methodName = image.Reader.GetString(methodDefinition.Name);
+                var methodParameters = methodDefinition.GetGenericParameters();
+                var methodArguments = GenericParameters(image, methodParameters);
+                bool methodClosed = false;
+
+                // If the method itself is generic, close it over the captured type arguments
+                if (enter3Msg.MethodTypeArgCount > 0 && methodParameters.Count > 0)
+                {
+                    var resolvedArguments = ResolveTypeArguments(enter3Msg.MethodTypeArgs, errors);
+                    if (resolvedArguments != null)
+                    {
+                        if (resolvedArguments.Length != enter3Msg.MethodTypeArgCount)
+                        {
+                            errors.Add($"Method type argument count mismatch for {methodName}: expected {enter3Msg.MethodTypeArgCount}, got {resolvedArguments.Length}");
+                            return null;
+                        }
+                        if (resolvedArguments.Length != methodParameters.Count)
+                        {
+                            errors.Add($"Failed to construct generic method {methodName}: it takes {methodParameters.Count} type arguments, got {resolvedArguments.Length}");
+                            return null;
+                        }
+
+                        methodArguments = resolvedArguments;
+                        methodClosed = true;
+                    }
+                }
+
+                var signature = methodDefinition.DecodeSignature(_provider, new GenericContext(typeArguments, methodArguments));
+                bool typeClosed = typeParameterCount == 0 || declaringType.GenericArguments != null;
+                return new ResolvedMethod(image, methodHandle, declaringType, methodName, methodDefinition.Attributes,
+                    methodClosed ? methodArguments : null, signature.ParameterTypes.ToArray(),
+                    isOpen: !typeClosed || (methodParameters.Count > 0 && !methodClosed), typeClosed);
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Failed to resolve method token 0x{enter3Msg.MethodToken:X}: {ex.Message}");
+                return null;
+            }
+        }
+
+        public void Dispose()
+        {
+            foreach (var image in _imagesByPath.Values)
+            {
+                if (image.IsValueCreated)
+                {
+                    try
+                    {
+                        image.Value?.Dispose();
+                    }
+                    catch
+                    {
+                        // The open failed; nothing is mapped
+                    }
+                }
+            }
+            _imagesByPath.Clear();
+            _imagesByName.Clear();
+            _imagesByReader.Clear();
+        }
+
+        #region Type Arguments
+
+        private SignatureType ResolveTypeFromInfo(TypeArgMessage typeArgMsg, List<string> errors)
+        {
+            if (!_moduleMap.TryGetValue(typeArgMsg.ModuleID, out var moduleMessage))
+            {
+                errors.Add($"Module 0x{typeArgMsg.ModuleID:X} not found for type 0x{typeArgMsg.TypeDef:X}");
+                return null;
+            }
+
+            var image = GetModuleImage(moduleMessage, errors);
+            if (image == null)
+                return null;
+
+            try
+            {
+                var type = image.GetDefinition(ToTypeDefinitionHandle(typeArgMsg.TypeDef));
+
+                // If this type has nested generic arguments, close it over them recursively
+                if (typeArgMsg.Nested != null && typeArgMsg.Nested.Count > 0 &&
+                    image.Reader.GetTypeDefinition(type.Handle).GetGenericParameters().Count > 0)
+                {
+                    var nestedTypes = ResolveTypeArguments(typeArgMsg.Nested, errors);
+                    if (nestedTypes == null)
+                        return null;
+
+                    type = Instantiate(type, nestedTypes, typeArgMsg.Nested.Count, errors);
+                }
+
+                return type;
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Failed to resolve type 0x{typeArgMsg.TypeDef:X} in module {moduleMessage.ModuleName}: {ex.Message}");
+                return null;
+            }
+        }
+
+        private SignatureType[] ResolveTypeArguments(List<TypeArgMessage> typeArgMessages, List<string> errors)
+        {
+            var types = new SignatureType[typeArgMessages?.Count ?? 0];
+            for (int i = 0; i < types.Length; i++)
+            {
+                var typeArgMsg = typeArgMessages[i];
+                types[i] = ResolveTypeFromInfo(typeArgMsg, errors);
+                if (types[i] == null)
+                {
+                    errors.Add($"Failed to resolve type argument for ModuleID=0x{typeArgMsg.ModuleID:X}, TypeDef=0x{typeArgMsg.TypeDef:X}");
+                    return null;
+                }
+            }
+            return types;
+        }
+
+        private SignatureType Instantiate(SignatureType genericTypeDefinition, SignatureType[] typeArguments, int expectedCount, List<string> errors)
+        {
+            if (typeArguments.Length != expectedCount)
+            {
+                errors.Add($"Type argument count mismatch for {genericTypeDefinition.Name}: expected {expectedCount}, got {typeArguments.Length}");
+                return null;
+            }
+
+            int parameterCount = genericTypeDefinition.Image.Reader.GetTypeDefinition(genericTypeDefinition.Handle).GetGenericParameters().Count;
+            if (typeArguments.Length != parameterCount)
+            {
+                errors.Add($"Failed to construct generic type {genericTypeDefinition.Name}: it takes {parameterCount} type arguments, got {typeArguments.Length}");
+                return null;
+            }
+
+            return SignatureType.Instantiate(genericTypeDefinition, typeArguments);
+        }
+
+        // Stand-ins for the parameters of an open definition, named as reflection names them
+        private static SignatureType[] GenericParameters(MetadataImage image, GenericParameterHandleCollection parameters)
+        {
+            var types = new SignatureType[parameters.Count];
+            int i = 0;
+            foreach (var parameter in parameters)
+                types[i++] = SignatureType.GenericParameter(image, image.Reader.GetString(image.Reader.GetGenericParameter(parameter).Name));
+            return types;
+        }
+
+        private static TypeDefinitionHandle ToTypeDefinitionHandle(uint token)
+        {
+            if ((token >> 24) != (uint)TableIndex.TypeDef)
+                throw new BadImageFormatException($"0x{token:X} is not a TypeDef token");
+
+            return MetadataTokens.TypeDefinitionHandle((int)(token & 0xFFFFFF));
+        }
+
+        #endregion
+
+        #region Assembly Lookup
+
+        private MetadataImage GetModuleImage(ModuleMessage moduleMessage, List<string> errors)
+        {
+            try
+            {
+                // The recorded path is where the runtime bound the module; logs from another
+                // machine fall back to the assembly name
+                var image = !string.IsNullOrEmpty(moduleMessage.ModuleName) && File.Exists(moduleMessage.ModuleName)
+                    ? OpenImage(moduleMessage.ModuleName)
+                    : FindAssembly(GetSimpleName(moduleMessage.AssemblyName));
+                if (image == null)
+                    errors.Add($"Failed to load assembly {moduleMessage.AssemblyName} (path: {moduleMessage.ModuleName})");
+                return image;
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Failed to load assembly {moduleMessage.AssemblyName}: {ex.Message}");
+                return null;
+            }
+        }
+
+        /// <summary>
+        /// The image of an assembly by simple name: where a module record put it, else the
+        /// first probe folder holding name.dll or name.exe. Null when there is none.
+        /// </summary>
+        private MetadataImage FindAssembly(string simpleName)
+        {
+            if (string.IsNullOrEmpty(simpleName))
+                return null;
+
+            return _imagesByName.GetOrAdd(simpleName, name => new Lazy<MetadataImage>(() =>
+            {
+                if (_pathsByAssemblyName.TryGetValue(name, out var recordedPath) && File.Exists(recordedPath))
+                    return OpenImage(recordedPath);
+
+                foreach (var directory in _probeDirectories)
+                {
+                    foreach (var extension in new[] { ".dll", ".exe" })
+                    {
+                        var path = Path.Combine(directory, name + extension);
+                        if (File.Exists(path))
+                            return OpenImage(path);
+                    }
+                }
+                return null;
+            })).Value;
+        }
+
+        private MetadataImage FindAssembly(MetadataImage referencingImage, AssemblyReferenceHandle handle)
+        {
+            var reader = referencingImage.Reader;
+            var name = reader.GetString(reader.GetAssemblyReference(handle).Name);
+            return FindAssembly(name)
+                ?? throw new FileNotFoundException($"Assembly {name} referenced by {referencingImage.SimpleName} not found");
+        }
+
+        private MetadataImage OpenImage(string path)
+        {
+            var image = _imagesByPath.GetOrAdd(Path.GetFullPath(path), fullPath => new Lazy<MetadataImage>(() => MetadataImage.Open(fullPath))).Value;
+            _imagesByReader.TryAdd(image.Reader, image);
+            return image;
+        }
+
+        private void AddProbeDirectory(string directory)
+        {
+            if (!string.IsNullOrEmpty(directory) && !_probeDirectories.Contains(directory, StringComparer.OrdinalIgnoreCase))
+                _probeDirectories.Add(directory);
+        }
+
+        // The profiler logs simple names; other producers may log display names
+        private static string GetSimpleName(string assemblyName)
+        {
+            if (string.IsNullOrEmpty(assemblyName))
+                return null;
+
+            try
+            {
+                return new AssemblyName(assemblyName).Name;
+            }
+            catch
+            {
+                return assemblyName;
+            }
+        }
+
+        #endregion
+
+        #region Type Resolution
+
+        /// <summary>
+        /// A top-level type by name, following type forwarders (System.Runtime's List`1 is
+        /// CoreLib's) to the assembly that defines it.
+        /// </summary>
+        private SignatureType ResolveTopLevelType(MetadataImage image, string ns, string name, int depth = 0)
+        {
+            if (image.TryGetTopLevelType(ns, name, out var definition))
+                return image.GetDefinition(definition);
+
+            if (depth < MaxForwardingDepth && image.TryGetExportedType(ns, name, out var exported))
+            {
+                var implementation = image.Reader.GetExportedType(exported).Implementation;
+                if (implementation.Kind == HandleKind.AssemblyReference)
+                    return ResolveTopLevelType(FindAssembly(image, (AssemblyReferenceHandle)implementation), ns, name, depth + 1);
+            }
+
+            throw new TypeLoadException($"Could not find type '{JoinName(ns, name)}' in assembly '{image.FullName}'");
+        }
+
+        internal SignatureType ResolveTypeReference(MetadataImage image, TypeReferenceHandle handle)
+        {
+            return image.GetReference(handle, () =>
+            {
+                var reader = image.Reader;
+                var typeReference = reader.GetTypeReference(handle);
+                var ns = reader.GetString(typeReference.Namespace);
+                var name = reader.GetString(typeReference.Name);
+                var scope = typeReference.ResolutionScope;
+
+                switch (scope.Kind)
+                {
+                    case HandleKind.AssemblyReference:
+                        return ResolveTopLevelType(FindAssembly(image, (AssemblyReferenceHandle)scope), ns, name);
+
+                    case HandleKind.ModuleDefinition:
+                        return ResolveTopLevelType(image, ns, name);
+
+                    case HandleKind.TypeReference:
+                        var declaringType = ResolveTypeReference(image, (TypeReferenceHandle)scope);
+                        var declaringReader = declaringType.Image.Reader;
+                        foreach (var nested in declaringReader.GetTypeDefinition(declaringType.Handle).GetNestedTypes())
+                        {
+                            if (declaringReader.StringComparer.Equals(declaringReader.GetTypeDefinition(nested).Name, name))
+                                return declaringType.Image.GetDefinition(nested);
+                        }
+                        throw new TypeLoadException($"Could not find nested type '{name}' in '{declaringType.FullName}'");
+
+                    default:
+                        throw new NotSupportedException($"Type reference '{JoinName(ns, name)}' has an unsupported resolution scope ({scope.Kind})");
+                }
+            });
+        }
+
+        private static string JoinName(string ns, string name)
+        {
+            return string.IsNullOrEmpty(ns) ? name : ns + "." + name;
+        }
+
+        #endregion
+
+        #region Metadata Image
+
+        /// <summary>
+        /// One assembly file, mapped read-only for the life of the resolver, with its type lookups.
+        /// </summary>
+        internal sealed class MetadataImage : IDisposable
+        {
+            private readonly MemoryMappedFile _file;
+            private readonly MemoryMappedViewAccessor _view;
+            private readonly PEReader _peReader;
+            private readonly bool _pointerAcquired;
+            private readonly Dictionary<(string Namespace, string Name), TypeDefinitionHandle> _topLevelTypes =
+                new Dictionary<(string Namespace, string Name), TypeDefinitionHandle>();
+            private readonly Dictionary<(string Namespace, string Name), ExportedTypeHandle> _exportedTypes =
+                new Dictionary<(string Namespace, string Name), ExportedTypeHandle>();
+            private readonly ConcurrentDictionary<TypeDefinitionHandle, SignatureType> _definitions =
+                new ConcurrentDictionary<TypeDefinitionHandle, SignatureType>();
+            private readonly ConcurrentDictionary<TypeReferenceHandle, SignatureType> _references =
+                new ConcurrentDictionary<TypeReferenceHandle, SignatureType>();
+
+            private unsafe MetadataImage(string path)
+            {
+                long length = new FileInfo(path).Length;
+                _file = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+                try
+                {
+                    _view = _file.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+                    byte* pointer = null;
+                    _view.SafeMemoryMappedViewHandle.AcquirePointer(ref pointer);
+                    _pointerAcquired = true;
+                    _peReader = new PEReader(pointer + _view.PointerOffset, (int)length);
+                    if (!_peReader.HasMetadata)
+                        throw new BadImageFormatException($"{path} is not a managed assembly");
+
+                    Reader = _peReader.GetMetadataReader();
+                    var assemblyName = Reader.GetAssemblyDefinition().GetAssemblyName();
+                    SimpleName = assemblyName.Name;
+                    FullName = assemblyName.FullName;
+                }
+                catch
+                {
+                    Dispose();
+                    throw;
+                }
+
+                foreach (var handle in Reader.TypeDefinitions)
+                {
+                    var type = Reader.GetTypeDefinition(handle);
+                    if (!type.IsNested)
+                        _topLevelTypes.TryAdd((Reader.GetString(type.Namespace), Reader.GetString(type.Name)), handle);
+                }
+
+                foreach (var handle in Reader.ExportedTypes)
+                {
+                    var type = Reader.GetExportedType(handle);
+                    if (type.Implementation.Kind != HandleKind.ExportedType)
+                        _exportedTypes.TryAdd((Reader.GetString(type.Namespace), Reader.GetString(type.Name)), handle);
+                }
+            }
+
+            public MetadataReader Reader { get; }
+
+            public string SimpleName { get; }
+
+            // Display name, as Assembly.FullName gives it for assembly-qualified type arguments
+            public string FullName { get; }
+
+            public static MetadataImage Open(string path) => new MetadataImage(path);
+
+            public bool TryGetTopLevelType(string ns, string name, out TypeDefinitionHandle handle) => _topLevelTypes.TryGetValue((ns, name), out handle);
+
+            public bool TryGetExportedType(string ns, string name, out ExportedTypeHandle handle) => _exportedTypes.TryGetValue((ns, name), out handle);
+
+            // Structs and enums derive from System.ValueType or System.Enum; System.Enum itself is a class
+            public bool IsValueType(TypeDefinitionHandle handle)
+            {
+                var baseType = Reader.GetTypeDefinition(handle).BaseType;
+                if (baseType.IsNil)
+                    return false;
+
+                StringHandle ns, name;
+                switch (baseType.Kind)
+                {
+                    case HandleKind.TypeReference:
+                        var reference = Reader.GetTypeReference((TypeReferenceHandle)baseType);
+                        (ns, name) = (reference.Namespace, reference.Name);
+                        break;
+                    case HandleKind.TypeDefinition:
+                        var definition = Reader.GetTypeDefinition((TypeDefinitionHandle)baseType);
+                        (ns, name) = (definition.Namespace, definition.Name);
+                        break;
+                    default:
+                        return false;
+                }
+
+                if (!Reader.StringComparer.Equals(ns, "System"))
+                    return false;
+                return Reader.StringComparer.Equals(name, "Enum") ||
+                    (Reader.StringComparer.Equals(name, "ValueType") && GetDefinition(handle).FullName != "System.Enum");
+            }
+
+            public SignatureType GetDefinition(TypeDefinitionHandle handle)
+            {
+                if (_definitions.TryGetValue(handle, out var type))
+                    return type;
+
+                var definition = Reader.GetTypeDefinition(handle);
+                var name = Reader.GetString(definition.Name);
+                var declaringHandle = definition.GetDeclaringType();
+                var fullName = declaringHandle.IsNil
+                    ? JoinName(Reader.GetString(definition.Namespace), name)
+                    : GetDefinition(declaringHandle).FullName + "+" + name;
+
+                return _definitions.GetOrAdd(handle, SignatureType.ForDefinition(this, handle, name, fullName));
+            }
+
+            // Failures are not cached, the next function reports them again
+            public SignatureType GetReference(TypeReferenceHandle handle, Func<SignatureType> resolve)
+            {
+                if (_references.TryGetValue(handle, out var type))
+                    return type;
+
+                return _references.GetOrAdd(handle, resolve());
+            }
+
+            public void Dispose()
+            {
+                _peReader?.Dispose();
+                if (_pointerAcquired)
+                    _view.SafeMemoryMappedViewHandle.ReleasePointer();
+                _view?.Dispose();
+                _file.Dispose();
+            }
+        }
+
+        #endregion
+
+        #region Resolved Method
+
+        /// <summary>
+        /// A method definition and the instantiation a function ran as. MethodArguments is null
+        /// unless the method is generic and was closed over captured arguments; IsOpen says some
+        /// type or method parameter is still unbound.
+        /// </summary>
+        internal sealed class ResolvedMethod
+        {
+            private readonly bool _typeClosed;
+
+            public ResolvedMethod(MetadataImage image, MethodDefinitionHandle handle, SignatureType declaringType, string name,
+                MethodAttributes attributes, SignatureType[] methodArguments, SignatureType[] parameterTypes, bool isOpen, bool typeClosed)
+            {
+                Image = image;
+                Handle = handle;
+                DeclaringType = declaringType;
+                Name = name;
+                Attributes = attributes;
+                MethodArguments = methodArguments;
+                ParameterTypes = parameterTypes;
+                IsOpen = isOpen;
+                _typeClosed = typeClosed;
+            }
+
+            public MetadataImage Image { get; }
+
+            public MethodDefinitionHandle Handle { get; }
+
+            public SignatureType DeclaringType { get; }
+
+            public string Name { get; }
+
+            public MethodAttributes Attributes { get; }
+
+            public SignatureType[] MethodArguments { get; }
+
+            public SignatureType[] ParameterTypes { get; }
+
+            public bool IsOpen { get; }
+
+            public MethodBaseSerializer.MethodNode ToNode()
+            {
+                // Reflection lists no generic arguments for a method that still has open parameters
+                return new MethodBaseSerializer.MethodNode
+                {
+                    DeclaringType = DeclaringType.ToNode(),
+                    Name = Name,
+                    IsConstructor = (Attributes & MethodAttributes.RTSpecialName) != 0 && (Name == ".ctor" || Name == ".cctor"),
+                    IsStatic = (Attributes & MethodAttributes.Static) != 0,
+                    GenericArguments = MethodArguments != null && _typeClosed ? MethodArguments.Select(type => type.ToNode()).ToList() : new List<TypeNode>(),
+                    ParameterTypes = ParameterTypes.Select(type => type.ToNode()).ToList()
+                };
+            }
+        }
+
+        #endregion
+
+        #region Signature Decoding
+
+        /// <summary>
+        /// A type as reflection would name it: FullName the way Type.FullName spells it (null while
+        /// it contains generic parameters), and for instantiations the definition plus arguments.
+        /// </summary>
+        internal sealed class SignatureType
+        {
+            private SignatureType(MetadataImage image, string name, string fullName)
+            {
+                Image = image;
+                Name = name;
+                FullName = fullName;
+            }
+
+            // The assembly Type.Assembly reports: the definition's, or the element type's
+            public MetadataImage Image { get; }
+
+            public string Name { get; }
+
+            public string FullName { get; }
+
+            public TypeDefinitionHandle Handle { get; private set; }
+
+            public SignatureType Definition { get; private set; }
+
+            public SignatureType[] GenericArguments { get; private set; }
+
+            public static SignatureType ForDefinition(MetadataImage image, TypeDefinitionHandle handle, string name, string fullName)
+            {
+                return new SignatureType(image, name, fullName) { Handle = handle };
+            }
+
+            public static SignatureType GenericParameter(MetadataImage image, string name)
+            {
+                return new SignatureType(image, name, null);
+            }
+
+            public static SignatureType Instantiate(SignatureType definition, SignatureType[] arguments)
+            {
+                // List`1[[System.Int32, System.Private.CoreLib, Version=...]]
+                var fullName = arguments.All(argument => argument.FullName != null)
+                    ? definition.FullName + "[" + string.Join(",", arguments.Select(argument => "[" + argument.FullName + ", " + argument.Image.FullName + "]")) + "]"
+                    : null;
+                return new SignatureType(definition.Image, definition.Name, fullName)
+                {
+                    Handle = definition.Handle,
+                    Definition = definition,
+                    GenericArguments = arguments
+                };
+            }
+
+            // Arrays, pointers and byrefs
+            public SignatureType Decorate(string suffix)
+            {
+                return new SignatureType(Image, Name + suffix, FullName == null ? null : FullName + suffix);
+            }
+
+            public TypeNode ToNode()
+            {
+                if (GenericArguments != null)
+                {
+                    return new TypeNode
+                    {
+                        Name = Definition.FullName,
+                        Assembly = Image.SimpleName,
+                        GenericArguments = GenericArguments.Select(argument => argument.ToNode()).ToList()
+                    };
+                }
+
+                return new TypeNode
+                {
+                    Name = FullName ?? Name,
+                    Assembly = Image.SimpleName,
+                    GenericArguments = null
+                };
+            }
+        }
+
+        private readonly struct GenericContext
+        {
+            public GenericContext(SignatureType[] typeArguments, SignatureType[] methodArguments)
+            {
+                TypeArguments = typeArguments;
+                MethodArguments = methodArguments;
+            }
+
+            public SignatureType[] TypeArguments { get; }
+
+            public SignatureType[] MethodArguments { get; }
+        }
+
+        private sealed class SignatureTypeProvider : ISignatureTypeProvider<SignatureType, GenericContext>
+        {
+            private readonly MetadataResolver _resolver;
+
+            public SignatureTypeProvider(MetadataResolver resolver)
+            {
+                _resolver = resolver;
+            }
+
+            public SignatureType GetPrimitiveType(PrimitiveTypeCode typeCode)
+            {
+                var coreLibrary = _resolver._coreLibrary.Value
+                    ?? throw new FileNotFoundException("Core library not found");
+                // PrimitiveTypeCode names are the System type names
+                return _resolver.ResolveTopLevelType(coreLibrary, "System", typeCode.ToString());
+            }
+
+            public SignatureType GetTypeFromDefinition(MetadataReader reader, TypeDefinitionHandle handle, byte rawTypeKind)
+            {
+                return _resolver._imagesByReader[reader].GetDefinition(handle);
+            }
+
+            public SignatureType GetTypeFromReference(MetadataReader reader, TypeReferenceHandle handle, byte rawTypeKind)
+            {
+                return _resolver.ResolveTypeReference(_resolver._imagesByReader[reader], handle);
+            }
+
+            public SignatureType GetTypeFromSpecification(MetadataReader reader, GenericContext genericContext, TypeSpecificationHandle handle, byte rawTypeKind)
+            {
+                return reader.GetTypeSpecification(handle).DecodeSignature(this, genericContext);
+            }
+
+            public SignatureType GetGenericInstantiation(SignatureType genericType, ImmutableArray<SignatureType> typeArguments)
+            {
+                return SignatureType.Instantiate(genericType, typeArguments.ToArray());
+            }
+
+            public SignatureType GetGenericTypeParameter(GenericContext genericContext, int index) => genericContext.TypeArguments[index];
+
+            public SignatureType GetGenericMethodParameter(GenericContext genericContext, int index) => genericContext.MethodArguments[index];
+
+            public SignatureType GetSZArrayType(SignatureType elementType) => elementType.Decorate("[]");
+
+            // Reflection spells a rank-1 multidimensional array [*]
+            public SignatureType GetArrayType(SignatureType elementType, ArrayShape shape) =>
+                elementType.Decorate(shape.Rank == 1 ? "[*]" : "[" + new string(',', shape.Rank - 1) + "]");
+
+            public SignatureType GetByReferenceType(SignatureType elementType) => elementType.Decorate("&");
+
+            public SignatureType GetPointerType(SignatureType elementType) => elementType.Decorate("*");
+
+            public SignatureType GetPinnedType(SignatureType elementType) => elementType;
+
+            public SignatureType GetModifiedType(SignatureType modifier, SignatureType unmodifiedType, bool isRequired) => unmodifiedType;
+
+            public SignatureType GetFunctionPointerType(MethodSignature<SignatureType> signature) => GetPrimitiveType(PrimitiveTypeCode.IntPtr);
+        }
+
+        #endregion
+    }
+}
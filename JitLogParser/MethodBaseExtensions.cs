@@ -48,6 +48,43 @@
             return sb.ToString();
         }
 
+        /// <summary>
+        /// The same signature for a manifest node, without loading its assemblies.
+        /// Parameters are listed by type only, as nodes do not keep their names.
+        /// </summary>
+        public static string ToPrettySignature(this MethodBaseSerializer.MethodNode node)
+        {
+            var sb = new StringBuilder();
+
+            if (node.DeclaringType != null && !string.IsNullOrEmpty(node.DeclaringType.Name))
+            {
+                sb.Append(GetFriendlyTypeName(node.DeclaringType));
+                sb.Append('.');
+            }
+
+            if (node.IsConstructor)
+            {
+                sb.Append(node.IsStatic ? "cctor" : "ctor");
+            }
+            else
+            {
+                sb.Append(node.Name);
+                if (node.GenericArguments != null && node.GenericArguments.Count > 0)
+                {
+                    sb.Append('<');
+                    sb.Append(string.Join(", ", node.GenericArguments.Select(GetFriendlyTypeName)));
+                    sb.Append('>');
+                }
+            }
+
+            sb.Append('(');
+            if (node.ParameterTypes != null)
+                sb.Append(string.Join(", ", node.ParameterTypes.Select(GetFriendlyTypeName)));
+            sb.Append(')');
+
+            return sb.ToString();
+        }
+
         private static string FormatParameter(ParameterInfo p)
         {
             var type = p.ParameterType;
@@ -112,6 +149,23 @@
 
             return type.Name;
         }
+
+        // Node names are full names: drop the namespace, keep nesting and array suffixes
+        private static string GetFriendlyTypeName(TypeNode node)
+        {
+            var name = node.Name;
+            int suffix = name.IndexOfAny(new[] { '[', '*', '&' });
+            var baseName = suffix >= 0 ? name[..suffix] : name;
+            var typeSuffix = suffix >= 0 ? name[suffix..] : string.Empty;
+
+            baseName = string.Join(".", baseName[(baseName.LastIndexOf('.') + 1)..].Split('+').Select(StripGenericArity));
+
+            if (node.GenericArguments != null && node.GenericArguments.Count > 0)
+                baseName += "<" + string.Join(", ", node.GenericArguments.Select(GetFriendlyTypeName)) + ">";
+
+            return baseName + typeSuffix;
+        }
+
         private static string StripGenericArity(string name)
         {
             var tickIndex = name.IndexOf('`');
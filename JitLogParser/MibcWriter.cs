@@ -0,0 +1,454 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Collections.Immutable;
+using System.IO;
+using System.IO.Compression;
+using System.Linq;
+using System.Reflection;
+using System.Reflection.Metadata;
+using System.Reflection.Metadata.Ecma335;
+using System.Reflection.PortableExecutable;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace JitLogParser
+{
+    /// <summary>
+    /// Writes resolved methods as a MIBC profile, the format dotnet-pgo writes and crossgen2 --mibc
+    /// reads: a zipped, metadata-only assembly whose global AssemblyDictionary method loads each
+    /// group's name and method token, and whose group methods are one "ldtoken method; pop" per
+    /// profiled method. A group holds the methods that touch the same set of assemblies, the
+    /// defining one first, so crossgen2 picks the groups of the assemblies it compiles.
+    /// Methods are MemberRefs into their defining assemblies, instantiations MethodSpecs and
+    /// TypeSpecs over them, so the captured instantiations are precompiled as they ran.
+    /// </summary>
+    internal sealed class MibcWriter
+    {
+        private const string RootMethodName = "AssemblyDictionary";
+        private const int MaxStack = 8;
+
+        private static readonly Dictionary<string, PrimitiveTypeCode> s_primitiveTypes = new Dictionary<string, PrimitiveTypeCode>
+        {
+            ["System.Boolean"] = PrimitiveTypeCode.Boolean,
+            ["System.Char"] = PrimitiveTypeCode.Char,
+            ["System.SByte"] = PrimitiveTypeCode.SByte,
+            ["System.Byte"] = PrimitiveTypeCode.Byte,
+            ["System.Int16"] = PrimitiveTypeCode.Int16,
+            ["System.UInt16"] = PrimitiveTypeCode.UInt16,
+            ["System.Int32"] = PrimitiveTypeCode.Int32,
+            ["System.UInt32"] = PrimitiveTypeCode.UInt32,
+            ["System.Int64"] = PrimitiveTypeCode.Int64,
+            ["System.UInt64"] = PrimitiveTypeCode.UInt64,
+            ["System.Single"] = PrimitiveTypeCode.Single,
+            ["System.Double"] = PrimitiveTypeCode.Double,
+            ["System.IntPtr"] = PrimitiveTypeCode.IntPtr,
+            ["System.UIntPtr"] = PrimitiveTypeCode.UIntPtr,
+            ["System.String"] = PrimitiveTypeCode.String,
+            ["System.Object"] = PrimitiveTypeCode.Object,
+            ["System.TypedReference"] = PrimitiveTypeCode.TypedReference,
+            ["System.Void"] = PrimitiveTypeCode.Void
+        };
+
+        private readonly MetadataResolver _resolver;
+        private readonly MetadataBuilder _metadata = new MetadataBuilder();
+        private readonly SortedDictionary<string, InstructionEncoder> _groups = new SortedDictionary<string, InstructionEncoder>(StringComparer.Ordinal);
+        private readonly HashSet<string> _methods = new HashSet<string>(StringComparer.Ordinal);
+        private readonly Dictionary<string, AssemblyReferenceHandle> _assemblyReferences = new Dictionary<string, AssemblyReferenceHandle>(StringComparer.OrdinalIgnoreCase);
+        private readonly Dictionary<MetadataResolver.SignatureType, TypeReferenceHandle> _typeReferences =
+            new Dictionary<MetadataResolver.SignatureType, TypeReferenceHandle>();
+        private readonly Dictionary<string, TypeSpecificationHandle> _typeSpecifications = new Dictionary<string, TypeSpecificationHandle>(StringComparer.Ordinal);
+        private readonly Dictionary<string, MemberReferenceHandle> _memberReferences = new Dictionary<string, MemberReferenceHandle>(StringComparer.Ordinal);
+
+        public MibcWriter(MetadataResolver resolver)
+        {
+            _resolver = resolver;
+        }
+
+        public int MethodCount => _methods.Count;
+
+        /// <summary>
+        /// Adds a method to its group. Open methods, which crossgen2 cannot precompile, and
+        /// repeats of a method already added are left out; the former with the reason in errors.
+        /// </summary>
+        public void Add(MetadataResolver.ResolvedMethod method, List<string> errors)
+        {
+            if (method.IsOpen)
+            {
+                errors.Add($"{method.DeclaringType.Name}.{method.Name} still has open generic parameters; left out of the MIBC profile");
+                return;
+            }
+
+            var key = MethodKey(method);
+            if (_methods.Contains(key))
+                return;
+
+            EntityHandle token;
+            try
+            {
+                token = GetMethodReference(method);
+            }
+            catch (Exception ex)
+            {
+                errors.Add($"Failed to write {method.DeclaringType.Name}.{method.Name} to the MIBC profile: {ex.Message}");
+                return;
+            }
+            _methods.Add(key);
+
+            var groupName = GroupName(method);
+            if (!_groups.TryGetValue(groupName, out var il))
+            {
+                il = new InstructionEncoder(new BlobBuilder());
+                _groups.Add(groupName, il);
+            }
+
+            il.OpCode(ILOpCode.Ldtoken);
+            il.Token(token);
+            il.OpCode(ILOpCode.Pop);
+        }
+
+        /// <summary>
+        /// Writes the profile to a zip holding the assembly as name.dll, as dotnet-pgo does.
+        /// </summary>
+        public void Write(string mibcFilePath)
+        {
+            var name = Path.GetFileName(mibcFilePath);
+            var image = Serialize(Path.GetFileNameWithoutExtension(mibcFilePath));
+
+            using (var file = new FileStream(mibcFilePath, FileMode.Create, FileAccess.Write))
+            using (var zip = new ZipArchive(file, ZipArchiveMode.Create))
+            using (var entry = zip.CreateEntry(name + ".dll", CompressionLevel.Optimal).Open())
+            {
+                image.WriteContentTo(entry);
+            }
+        }
+
+        private BlobBuilder Serialize(string assemblyName)
+        {
+            var ilStream = new BlobBuilder();
+            var bodies = new MethodBodyStreamEncoder(ilStream);
+            var voidSignature = new BlobBuilder();
+            new BlobEncoder(voidSignature).MethodSignature().Parameters(0, returnType => returnType.Void(), parameters => { });
+            var voidSignatureHandle = _metadata.GetOrAddBlob(voidSignature);
+
+            MethodDefinitionHandle AddGlobalMethod(string name, InstructionEncoder il)
+            {
+                il.OpCode(ILOpCode.Ret);
+                return _metadata.AddMethodDefinition(
+                    MethodAttributes.Public | MethodAttributes.Static,
+                    MethodImplAttributes.IL,
+                    _metadata.GetOrAddString(name),
+                    voidSignatureHandle,
+                    bodies.AddMethodBody(il, MaxStack),
+                    MetadataTokens.ParameterHandle(1));
+            }
+
+            // The root names every group and loads its method: ldstr name; ldtoken group; pop
+            var root = new InstructionEncoder(new BlobBuilder());
+            foreach (var group in _groups)
+            {
+                var groupMethod = AddGlobalMethod(group.Key, group.Value);
+                root.LoadString(_metadata.GetOrAddUserString(group.Key));
+                root.OpCode(ILOpCode.Ldtoken);
+                root.Token(groupMethod);
+                root.OpCode(ILOpCode.Pop);
+            }
+            AddGlobalMethod(RootMethodName, root);
+
+            // The same methods make the same module version id, so an unchanged profile is an unchanged file
+            byte[] hash;
+            using (var sha = SHA256.Create())
+                hash = sha.ComputeHash(Encoding.UTF8.GetBytes(string.Join("\n", _methods.OrderBy(method => method, StringComparer.Ordinal))));
+
+            _metadata.AddModule(0, _metadata.GetOrAddString(assemblyName + ".dll"), _metadata.GetOrAddGuid(new Guid(hash.AsSpan(0, 16))), default, default);
+            _metadata.AddAssembly(_metadata.GetOrAddString(assemblyName), new Version(1, 0, 0, 0), default, default, 0, AssemblyHashAlgorithm.None);
+
+            // <Module> owns every method
+            _metadata.AddTypeDefinition(default, default, _metadata.GetOrAddString("<Module>"), default,
+                MetadataTokens.FieldDefinitionHandle(1), MetadataTokens.MethodDefinitionHandle(1));
+
+            var peBuilder = new ManagedPEBuilder(
+                new PEHeaderBuilder(imageCharacteristics: Characteristics.Dll | Characteristics.ExecutableImage),
+                new MetadataRootBuilder(_metadata),
+                ilStream,
+                flags: CorFlags.ILOnly,
+                deterministicIdProvider: content => new BlobContentId(new Guid(hash.AsSpan(0, 16)), BitConverter.ToUInt32(hash, 16)));
+
+            var image = new BlobBuilder();
+            peBuilder.Serialize(image);
+            return image;
+        }
+
+        #region Groups
+
+        // "Defining;Other;...;" with the assemblies of the type arguments sorted after the defining one
+        private static string GroupName(MetadataResolver.ResolvedMethod method)
+        {
+            var definingAssembly = method.DeclaringType.Image.SimpleName;
+            var assemblies = new SortedSet<string>(StringComparer.Ordinal);
+            AddArgumentAssemblies(method.DeclaringType, assemblies);
+            foreach (var argument in method.MethodArguments ?? Array.Empty<MetadataResolver.SignatureType>())
+            {
+                assemblies.Add(argument.Image.SimpleName);
+                AddArgumentAssemblies(argument, assemblies);
+            }
+            assemblies.Remove(definingAssembly);
+
+            var builder = new StringBuilder(definingAssembly).Append(';');
+            foreach (var assembly in assemblies)
+                builder.Append(assembly).Append(';');
+            return builder.ToString();
+        }
+
+        private static void AddArgumentAssemblies(MetadataResolver.SignatureType type, SortedSet<string> assemblies)
+        {
+            if (type.GenericArguments == null)
+                return;
+
+            foreach (var argument in type.GenericArguments)
+            {
+                assemblies.Add(argument.Image.SimpleName);
+                AddArgumentAssemblies(argument, assemblies);
+            }
+        }
+
+        private static string MethodKey(MetadataResolver.ResolvedMethod method)
+        {
+            var key = $"{method.DeclaringType.FullName}, {method.Image.FullName}::{MetadataTokens.GetToken(method.Handle):X8}";
+            return method.MethodArguments == null
+                ? key
+                : key + "[" + string.Join(",", method.MethodArguments.Select(argument => "[" + argument.FullName + ", " + argument.Image.FullName + "]")) + "]";
+        }
+
+        #endregion
+
+        #region Method References
+
+        private EntityHandle GetMethodReference(MetadataResolver.ResolvedMethod method)
+        {
+            var memberKey = $"{method.DeclaringType.FullName}, {method.Image.FullName}::{MetadataTokens.GetToken(method.Handle):X8}";
+            if (!_memberReferences.TryGetValue(memberKey, out var memberReference))
+            {
+                // A MemberRef carries the definition's signature, parameters of the generic type as !0, !1...
+                var definition = method.Image.Reader.GetMethodDefinition(method.Handle);
+                var signature = definition.DecodeSignature(new DefinitionSignatureEncoder(this, method.Image), null);
+                var signatureBlob = new BlobBuilder();
+                WriteMethodSignature(signatureBlob, signature);
+
+                var parent = method.DeclaringType.GenericArguments != null
+                    ? (EntityHandle)GetTypeSpecification(method.DeclaringType)
+                    : GetTypeReference(method.DeclaringType);
+                memberReference = _metadata.AddMemberReference(parent, _metadata.GetOrAddString(method.Name), _metadata.GetOrAddBlob(signatureBlob));
+                _memberReferences.Add(memberKey, memberReference);
+            }
+
+            if (method.MethodArguments == null)
+                return memberReference;
+
+            var instantiation = new BlobBuilder();
+            instantiation.WriteByte((byte)SignatureKind.MethodSpecification);
+            instantiation.WriteCompressedInteger(method.MethodArguments.Length);
+            foreach (var argument in method.MethodArguments)
+                WriteType(instantiation, argument);
+            return _metadata.AddMethodSpecification(memberReference, _metadata.GetOrAddBlob(instantiation));
+        }
+
+        private static void WriteMethodSignature(BlobBuilder builder, MethodSignature<Action<BlobBuilder>> signature)
+        {
+            builder.WriteByte(signature.Header.RawValue);
+            if (signature.Header.IsGeneric)
+                builder.WriteCompressedInteger(signature.GenericParameterCount);
+            builder.WriteCompressedInteger(signature.ParameterTypes.Length);
+            signature.ReturnType(builder);
+            foreach (var parameterType in signature.ParameterTypes)
+                parameterType(builder);
+        }
+
+        #endregion
+
+        #region Type References
+
+        // A closed type captured by the profiler: a definition or an instantiation of one
+        private void WriteType(BlobBuilder builder, MetadataResolver.SignatureType type)
+        {
+            if (type.GenericArguments != null)
+            {
+                builder.WriteByte((byte)SignatureTypeCode.GenericTypeInstance);
+                WriteDefinition(builder, type.Definition);
+                builder.WriteCompressedInteger(type.GenericArguments.Length);
+                foreach (var argument in type.GenericArguments)
+                    WriteType(builder, argument);
+                return;
+            }
+
+            if (type.Handle.IsNil || type.FullName == null)
+                throw new NotSupportedException($"Type {type.Name} cannot be written to a MIBC profile");
+
+            WriteDefinition(builder, type);
+        }
+
+        // Signatures spell CoreLib's primitives as element types, everything else as CLASS or VALUETYPE token
+        private void WriteDefinition(BlobBuilder builder, MetadataResolver.SignatureType definition)
+        {
+            if (definition.Image == _resolver.CoreLibrary && s_primitiveTypes.TryGetValue(definition.FullName, out var typeCode))
+            {
+                builder.WriteByte((byte)typeCode);
+                return;
+            }
+
+            builder.WriteByte((byte)(definition.Image.IsValueType(definition.Handle) ? SignatureTypeKind.ValueType : SignatureTypeKind.Class));
+            builder.WriteCompressedInteger(CodedIndex.TypeDefOrRefOrSpec(GetTypeReference(definition)));
+        }
+
+        private TypeSpecificationHandle GetTypeSpecification(MetadataResolver.SignatureType instantiation)
+        {
+            var key = instantiation.FullName + ", " + instantiation.Image.FullName;
+            if (!_typeSpecifications.TryGetValue(key, out var handle))
+            {
+                var signature = new BlobBuilder();
+                WriteType(signature, instantiation);
+                handle = _metadata.AddTypeSpecification(_metadata.GetOrAddBlob(signature));
+                _typeSpecifications.Add(key, handle);
+            }
+            return handle;
+        }
+
+        // Nested types are scoped to their declaring type's reference, top-level ones to their assembly
+        private TypeReferenceHandle GetTypeReference(MetadataResolver.SignatureType definition)
+        {
+            if (_typeReferences.TryGetValue(definition, out var handle))
+                return handle;
+
+            var reader = definition.Image.Reader;
+            var typeDefinition = reader.GetTypeDefinition(definition.Handle);
+            var declaringHandle = typeDefinition.GetDeclaringType();
+            var scope = declaringHandle.IsNil
+                ? (EntityHandle)GetAssemblyReference(definition.Image)
+                : GetTypeReference(definition.Image.GetDefinition(declaringHandle));
+
+            handle = _metadata.AddTypeReference(scope,
+                declaringHandle.IsNil ? _metadata.GetOrAddString(reader.GetString(typeDefinition.Namespace)) : default,
+                _metadata.GetOrAddString(reader.GetString(typeDefinition.Name)));
+            _typeReferences.Add(definition, handle);
+            return handle;
+        }
+
+        private AssemblyReferenceHandle GetAssemblyReference(MetadataResolver.MetadataImage image)
+        {
+            if (_assemblyReferences.TryGetValue(image.FullName, out var handle))
+                return handle;
+
+            var assemblyName = image.Reader.GetAssemblyDefinition().GetAssemblyName();
+            var publicKeyToken = assemblyName.GetPublicKeyToken();
+            handle = _metadata.AddAssemblyReference(
+                _metadata.GetOrAddString(assemblyName.Name),
+                assemblyName.Version ?? new Version(0, 0, 0, 0),
+                string.IsNullOrEmpty(assemblyName.CultureName) ? default : _metadata.GetOrAddString(assemblyName.CultureName),
+                publicKeyToken == null || publicKeyToken.Length == 0 ? default : _metadata.GetOrAddBlob(publicKeyToken),
+                default,
+                default);
+            _assemblyReferences.Add(image.FullName, handle);
+            return handle;
+        }
+
+        #endregion
+
+        #region Signature Encoding
+
+        /// <summary>
+        /// Re-encodes a signature of the defining assembly against the profile's references:
+        /// each type becomes the writer that puts it in a blob. Generic parameters stay parameters
+        /// and modifiers are kept, so the MemberRef matches its definition.
+        /// </summary>
+        private sealed class DefinitionSignatureEncoder : ISignatureTypeProvider<Action<BlobBuilder>, object>
+        {
+            private readonly MibcWriter _writer;
+            private readonly MetadataResolver.MetadataImage _image;
+
+            public DefinitionSignatureEncoder(MibcWriter writer, MetadataResolver.MetadataImage image)
+            {
+                _writer = writer;
+                _image = image;
+            }
+
+            public Action<BlobBuilder> GetPrimitiveType(PrimitiveTypeCode typeCode) => builder => builder.WriteByte((byte)typeCode);
+
+            public Action<BlobBuilder> GetTypeFromDefinition(MetadataReader reader, TypeDefinitionHandle handle, byte rawTypeKind)
+            {
+                var definition = _image.GetDefinition(handle);
+                return builder => _writer.WriteDefinition(builder, definition);
+            }
+
+            public Action<BlobBuilder> GetTypeFromReference(MetadataReader reader, TypeReferenceHandle handle, byte rawTypeKind)
+            {
+                var definition = _writer._resolver.ResolveTypeReference(_image, handle);
+                return builder => _writer.WriteDefinition(builder, definition);
+            }
+
+            public Action<BlobBuilder> GetTypeFromSpecification(MetadataReader reader, object genericContext, TypeSpecificationHandle handle, byte rawTypeKind)
+            {
+                return reader.GetTypeSpecification(handle).DecodeSignature(this, genericContext);
+            }
+
+            public Action<BlobBuilder> GetGenericInstantiation(Action<BlobBuilder> genericType, ImmutableArray<Action<BlobBuilder>> typeArguments) => builder =>
+            {
+                builder.WriteByte((byte)SignatureTypeCode.GenericTypeInstance);
+                genericType(builder);
+                builder.WriteCompressedInteger(typeArguments.Length);
+                foreach (var typeArgument in typeArguments)
+                    typeArgument(builder);
+            };
+
+            public Action<BlobBuilder> GetGenericTypeParameter(object genericContext, int index) => builder =>
+            {
+                builder.WriteByte((byte)SignatureTypeCode.GenericTypeParameter);
+                builder.WriteCompressedInteger(index);
+            };
+
+            public Action<BlobBuilder> GetGenericMethodParameter(object genericContext, int index) => builder =>
+            {
+                builder.WriteByte((byte)SignatureTypeCode.GenericMethodParameter);
+                builder.WriteCompressedInteger(index);
+            };
+
+            public Action<BlobBuilder> GetSZArrayType(Action<BlobBuilder> elementType) => Prefix(SignatureTypeCode.SZArray, elementType);
+
+            public Action<BlobBuilder> GetArrayType(Action<BlobBuilder> elementType, ArrayShape shape) => builder =>
+            {
+                builder.WriteByte((byte)SignatureTypeCode.Array);
+                elementType(builder);
+                new ArrayShapeEncoder(builder).Shape(shape.Rank, shape.Sizes, shape.LowerBounds);
+            };
+
+            public Action<BlobBuilder> GetByReferenceType(Action<BlobBuilder> elementType) => Prefix(SignatureTypeCode.ByReference, elementType);
+
+            public Action<BlobBuilder> GetPointerType(Action<BlobBuilder> elementType) => Prefix(SignatureTypeCode.Pointer, elementType);
+
+            public Action<BlobBuilder> GetPinnedType(Action<BlobBuilder> elementType) => Prefix(SignatureTypeCode.Pinned, elementType);
+
+            // The modifier decodes as CLASS token; the blob wants the bare token after the modifier code
+            public Action<BlobBuilder> GetModifiedType(Action<BlobBuilder> modifier, Action<BlobBuilder> unmodifiedType, bool isRequired) => builder =>
+            {
+                builder.WriteByte((byte)(isRequired ? SignatureTypeCode.RequiredModifier : SignatureTypeCode.OptionalModifier));
+                var modifierType = new BlobBuilder();
+                modifier(modifierType);
+                var bytes = modifierType.ToArray();
+                builder.WriteBytes(bytes, 1, bytes.Length - 1);
+                unmodifiedType(builder);
+            };
+
+            public Action<BlobBuilder> GetFunctionPointerType(MethodSignature<Action<BlobBuilder>> signature) => builder =>
+            {
+                builder.WriteByte((byte)SignatureTypeCode.FunctionPointer);
+                WriteMethodSignature(builder, signature);
+            };
+
+            private static Action<BlobBuilder> Prefix(SignatureTypeCode code, Action<BlobBuilder> elementType) => builder =>
+            {
+                builder.WriteByte((byte)code);
+                elementType(builder);
+            };
+        }
+
+        #endregion
+    }
+}
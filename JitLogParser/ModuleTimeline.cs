@@ -0,0 +1,105 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Globalization;
+    using System.IO;
+    using System.Linq;
+    using System.Text;
+
+    /// <summary>
+    /// When each module of a run loaded and unloaded, from the module records the profiler writes
+    /// in ModuleLoadFinished and its ModuleUnloadStarted events. A ModuleID the runtime reused after
+    /// an unload is one entry per load.
+    /// </summary>
+    public sealed class ModuleTimeline
+    {
+        public sealed class Module
+        {
+            public ulong ModuleID { get; set; }
+
+            public string ModuleName { get; set; }
+
+            public string AssemblyName { get; set; }
+
+            // Profiler clock, nanoseconds; 0 for a module logged on first use, whose load was not seen
+            public ulong LoadTime { get; set; }
+
+            // Null while the module stayed loaded
+            public ulong? UnloadTime { get; set; }
+
+            public override string ToString() => ModuleName != null ? Path.GetFileName(ModuleName) : $"ModuleID 0x{ModuleID:X}";
+        }
+
+        // In load order, then the modules logged on first use
+        public List<Module> Modules { get; } = new List<Module>();
+
+        // Load time of the first module, which the report counts from
+        public ulong Start { get; private set; }
+
+        public static ModuleTimeline Build(ProfilerRun run) => Build(run.Events.ModuleLoads, run.Events.ModuleUnloads);
+
+        public static ModuleTimeline Build(IEnumerable<ModuleMessage> loads, IEnumerable<ModuleUnloadMessage> unloads)
+        {
+            if (loads == null) throw new ArgumentNullException(nameof(loads));
+            if (unloads == null) throw new ArgumentNullException(nameof(unloads));
+
+            var timeline = new ModuleTimeline();
+            var seen = new HashSet<(ulong ModuleID, ulong LoadTime)>();
+            foreach (var load in loads.OrderBy(x => x.LoadTime == 0).ThenBy(x => x.LoadTime).ThenBy(x => x.ModuleID))
+            {
+                // A log read twice repeats its records
+                if (!seen.Add((load.ModuleID, load.LoadTime)))
+                    continue;
+
+                timeline.Modules.Add(new Module
+                {
+                    ModuleID = load.ModuleID,
+                    ModuleName = load.ModuleName,
+                    AssemblyName = load.AssemblyName,
+                    LoadTime = load.LoadTime
+                });
+            }
+
+            // An unload belongs to the latest load of its ModuleID before it
+            var byId = timeline.Modules.ToLookup(x => x.ModuleID);
+            foreach (var unload in unloads.OrderBy(x => x.Time))
+            {
+                var module = byId[unload.ModuleID].LastOrDefault(x => x.LoadTime <= unload.Time && x.UnloadTime == null);
+                if (module != null)
+                    module.UnloadTime = unload.Time;
+            }
+
+            timeline.Start = timeline.Modules.Where(x => x.LoadTime != 0).Select(x => x.LoadTime).DefaultIfEmpty().Min();
+            return timeline;
+        }
+
+        public string ToReport(int top = 50)
+        {
+            var loaded = Modules.Where(x => x.LoadTime != 0).ToList();
+            var sb = new StringBuilder();
+            sb.Append($"{Modules.Count} modules, {Modules.Count(x => x.UnloadTime != null)} unloaded, {Modules.Count - loaded.Count} logged on first use");
+            if (loaded.Count > 0)
+                sb.Append($"; loads span {FormatMs(loaded.Max(x => x.LoadTime) - Start)} ms");
+            sb.AppendLine();
+            sb.AppendLine();
+            sb.AppendLine($"{"Load ms",10} {"Unload ms",10}  Module");
+            foreach (var module in Modules.Take(top))
+            {
+                var load = module.LoadTime != 0 ? FormatMs(module.LoadTime - Start) : "-";
+                var unload = module.UnloadTime is ulong time ? FormatMs(time - Start) : "";
+                var assembly = module.AssemblyName != null ? $" [{module.AssemblyName}]" : "";
+                sb.AppendLine($"{load,10} {unload,10}  {module}{assembly}");
+            }
+
+            if (Modules.Count > top)
+                sb.AppendLine($"... {Modules.Count - top} more");
+            return sb.ToString();
+        }
+
+        private static string FormatMs(ulong nanoseconds)
+        {
+            return (nanoseconds / 1e6).ToString("0.000", CultureInfo.InvariantCulture);
+        }
+    }
+}
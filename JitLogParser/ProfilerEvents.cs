@@ -0,0 +1,35 @@
+﻿namespace JitLogParser
+{
+    using System.Collections.Concurrent;
+
+    /// <summary>
+    /// Receives the events the readers find beside the records a manifest is built from.
+    /// The JSON reader parses on every core, so each kind of event is a concurrent collection.
+    /// </summary>
+    public sealed class ProfilerEvents
+    {
+        // JITCompilationFinished, with SIG_JIT_PROFILER_JIT_TIMING=1; one per compilation, tier-up recompilations included
+        public ConcurrentQueue<JitCompilationMessage> JitCompilations { get; } = new ConcurrentQueue<JitCompilationMessage>();
+
+        // JITInlining, with SIG_JIT_PROFILER_INLINING=1; one per caller/callee pair
+        public ConcurrentQueue<InliningMessage> Inlinings { get; } = new ConcurrentQueue<InliningMessage>();
+
+        // First use of precompiled code per function, with SIG_JIT_PROFILER_TIERS=1
+        public ConcurrentQueue<CacheHitMessage> CacheHits { get; } = new ConcurrentQueue<CacheHitMessage>();
+
+        // Every module record, including those of a ModuleID the runtime reused after an unload,
+        // which the module map keeps only one record of
+        public ConcurrentQueue<ModuleMessage> ModuleLoads { get; } = new ConcurrentQueue<ModuleMessage>();
+
+        public ConcurrentQueue<ModuleUnloadMessage> ModuleUnloads { get; } = new ConcurrentQueue<ModuleUnloadMessage>();
+
+        // Tagged JITCompilationStarted records and thread events, with SIG_JIT_PROFILER_THREADS=1;
+        // tagged Enter3 records carry their tag themselves
+        public ConcurrentQueue<JitStartMessage> JitStarts { get; } = new ConcurrentQueue<JitStartMessage>();
+
+        public ConcurrentQueue<ThreadEventMessage> ThreadEvents { get; } = new ConcurrentQueue<ThreadEventMessage>();
+
+        // Calls since a function's previous record, with SIG_JIT_PROFILER_CALL_COUNTS=1; a function's records add up
+        public ConcurrentQueue<CallCountMessage> CallCounts { get; } = new ConcurrentQueue<CallCountMessage>();
+    }
+}
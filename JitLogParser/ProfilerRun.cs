@@ -0,0 +1,29 @@
+﻿namespace JitLogParser
+{
+    using System.Collections.Generic;
+
+    /// <summary>
+    /// What JitProfilerLogParser.ReadEvents reads from one run's logs: the module and function
+    /// records methods are named from, and the events the reports are built from.
+    /// </summary>
+    public sealed class ProfilerRun
+    {
+        public ProfilerRun(
+            IReadOnlyDictionary<ulong, ModuleMessage> modules,
+            IReadOnlyDictionary<ulong, Enter3Message> functions,
+            ProfilerEvents events)
+        {
+            Modules = modules;
+            Functions = functions;
+            Events = events;
+        }
+
+        // ModuleID -> module record, one per ModuleID; Events.ModuleLoads has every load
+        public IReadOnlyDictionary<ulong, ModuleMessage> Modules { get; }
+
+        // FunctionID -> Enter3 record
+        public IReadOnlyDictionary<ulong, Enter3Message> Functions { get; }
+
+        public ProfilerEvents Events { get; }
+    }
+}
@@ -0,0 +1,193 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Globalization;
+    using System.Linq;
+    using System.Text;
+
+    /// <summary>
+    /// What each thread compiled and called first during a run, from the records tagged with
+    /// SIG_JIT_PROFILER_THREADS=1. With SIG_JIT_PROFILER_JIT_TIMING=1 as well, the first
+    /// compilation of a function counts towards the thread that started it, which shows the
+    /// threads that spent their warmup waiting on the JIT.
+    /// </summary>
+    public sealed class ThreadTimeline
+    {
+        public enum RecordKind
+        {
+            Jit,
+            Enter3
+        }
+
+        public sealed class Record
+        {
+            public RecordKind Kind { get; set; }
+
+            public ulong FunctionID { get; set; }
+
+            public ulong Seq { get; set; }
+
+            // Profiler clock, nanoseconds
+            public ulong Time { get; set; }
+        }
+
+        public sealed class Thread
+        {
+            // The tag's dense index
+            public uint Index { get; set; }
+
+            // 0 for a thread the runtime does not manage
+            public ulong ThreadID { get; set; }
+
+            public uint OSThreadID { get; set; }
+
+            public string Name { get; set; }
+
+            public ulong? Created { get; set; }
+
+            public ulong? Destroyed { get; set; }
+
+            // In sequence order
+            public List<Record> Records { get; } = new List<Record>();
+
+            public ulong FirstTime => Records.Count > 0 ? Records[0].Time : 0;
+
+            public ulong LastTime => Records.Count > 0 ? Records[Records.Count - 1].Time : 0;
+
+            // Nanoseconds in the first compilation of the functions this thread started compiling
+            public ulong JitTime { get; set; }
+
+            public override string ToString()
+            {
+                if (Name != null)
+                    return Name;
+                return ThreadID != 0 ? $"ThreadID 0x{ThreadID:X}" : "unmanaged";
+            }
+        }
+
+        // By first record
+        public List<Thread> Threads { get; } = new List<Thread>();
+
+        // Time of the first tagged record, which the report counts from
+        public ulong Start { get; private set; }
+
+        public static ThreadTimeline Build(ProfilerRun run) =>
+            Build(run.Events.ThreadEvents, run.Events.JitStarts, run.Functions.Values, run.Events.JitCompilations);
+
+        public static ThreadTimeline Build(
+            IEnumerable<ThreadEventMessage> threadEvents,
+            IEnumerable<JitStartMessage> jitStarts,
+            IEnumerable<Enter3Message> enter3,
+            IEnumerable<JitCompilationMessage> compilations)
+        {
+            if (threadEvents == null) throw new ArgumentNullException(nameof(threadEvents));
+            if (jitStarts == null) throw new ArgumentNullException(nameof(jitStarts));
+            if (enter3 == null) throw new ArgumentNullException(nameof(enter3));
+            if (compilations == null) throw new ArgumentNullException(nameof(compilations));
+
+            var byIndex = new Dictionary<uint, Thread>();
+            Thread GetThread(uint index)
+            {
+                if (!byIndex.TryGetValue(index, out var thread))
+                {
+                    thread = new Thread { Index = index };
+                    byIndex.Add(index, thread);
+                }
+                return thread;
+            }
+
+            var names = new Dictionary<ulong, string>();
+            var osThreads = new Dictionary<ulong, uint>();
+            var created = new Dictionary<ulong, ulong>();
+            var destroyed = new Dictionary<ulong, ulong>();
+            foreach (var e in threadEvents)
+            {
+                switch (e.Kind)
+                {
+                    case ThreadEventKind.Indexed:
+                        GetThread(e.Thread).ThreadID = e.ThreadID;
+                        break;
+                    case ThreadEventKind.Created:
+                        created[e.ThreadID] = e.Time;
+                        break;
+                    case ThreadEventKind.Destroyed:
+                        destroyed[e.ThreadID] = e.Time;
+                        break;
+                    case ThreadEventKind.Assigned:
+                        osThreads[e.ThreadID] = e.OSThreadID;
+                        break;
+                    case ThreadEventKind.Named:
+                        names[e.ThreadID] = string.IsNullOrEmpty(e.Name) ? null : e.Name;
+                        break;
+                }
+            }
+
+            var startedBy = new Dictionary<ulong, Thread>();
+            foreach (var start in jitStarts)
+            {
+                if (start.Thread == 0)
+                    continue;
+                var thread = GetThread(start.Thread);
+                thread.Records.Add(new Record { Kind = RecordKind.Jit, FunctionID = start.FunctionID, Seq = start.Seq, Time = start.Time });
+                startedBy[start.FunctionID] = thread;
+            }
+
+            foreach (var message in enter3)
+            {
+                if (message.Thread == 0)
+                    continue;
+                GetThread(message.Thread).Records.Add(new Record { Kind = RecordKind.Enter3, FunctionID = message.FunctionID, Seq = message.Seq, Time = message.Time });
+            }
+
+            // Only the first compilation of a function is tagged; tier-ups run on a background thread
+            foreach (var first in compilations.GroupBy(x => x.FunctionID).Select(g => g.OrderBy(x => x.Start).First()))
+            {
+                if (startedBy.TryGetValue(first.FunctionID, out var thread))
+                    thread.JitTime += first.Duration;
+            }
+
+            var timeline = new ThreadTimeline();
+            foreach (var thread in byIndex.Values)
+            {
+                thread.Records.Sort((a, b) => a.Seq.CompareTo(b.Seq));
+                if (thread.ThreadID != 0)
+                {
+                    thread.Name = names.TryGetValue(thread.ThreadID, out var name) ? name : null;
+                    thread.OSThreadID = osThreads.TryGetValue(thread.ThreadID, out var osThreadId) ? osThreadId : 0;
+                    thread.Created = created.TryGetValue(thread.ThreadID, out var createdTime) ? createdTime : null;
+                    thread.Destroyed = destroyed.TryGetValue(thread.ThreadID, out var destroyedTime) ? destroyedTime : null;
+                }
+            }
+
+            timeline.Threads.AddRange(byIndex.Values.Where(x => x.Records.Count > 0).OrderBy(x => x.FirstTime).ThenBy(x => x.Index));
+            timeline.Start = timeline.Threads.Select(x => x.FirstTime).DefaultIfEmpty().Min();
+            return timeline;
+        }
+
+        public string ToReport(int top = 50)
+        {
+            var sb = new StringBuilder();
+            sb.AppendLine($"{Threads.Count} threads, {Threads.Sum(x => x.Records.Count(r => r.Kind == RecordKind.Jit))} JIT starts, " +
+                $"{Threads.Sum(x => x.Records.Count(r => r.Kind == RecordKind.Enter3))} first calls");
+            sb.AppendLine();
+            sb.AppendLine($"{"First ms",10} {"Last ms",10} {"JIT",6} {"Calls",6} {"JIT ms",10}  Thread");
+            foreach (var thread in Threads.Take(top))
+            {
+                int jits = thread.Records.Count(r => r.Kind == RecordKind.Jit);
+                int calls = thread.Records.Count - jits;
+                var os = thread.OSThreadID != 0 ? $" (OS thread {thread.OSThreadID})" : "";
+                sb.AppendLine($"{FormatMs(thread.FirstTime - Start),10} {FormatMs(thread.LastTime - Start),10} {jits,6} {calls,6} {FormatMs(thread.JitTime),10}  #{thread.Index} {thread}{os}");
+            }
+
+            if (Threads.Count > top)
+                sb.AppendLine($"... {Threads.Count - top} more");
+            return sb.ToString();
+        }
+
+        private static string FormatMs(ulong nanoseconds)
+        {
+            return (nanoseconds / 1e6).ToString("0.000", CultureInfo.InvariantCulture);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+﻿namespace JitLogParser
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Globalization;
+    using System.Linq;
+    using System.Text;
+
+    /// <summary>
+    /// When each method was recompiled, from the JitFinished and CacheHit events logged with
+    /// SIG_JIT_PROFILER_TIERS=1. A method is first seen when the runtime used its precompiled code,
+    /// or else when its first compilation started. That first code is its initial tier; every later
+    /// compilation is a recompile, numbered in start order. The profiling API does not say which tier
+    /// a recompile is for: without OSR or instrumented tiers recompile 1 is tier 1, and in general the
+    /// last recompile of a run that went on long enough is.
+    /// </summary>
+    public sealed class TierReport
+    {
+        public sealed class MethodTiers
+        {
+            public ulong FunctionID { get; set; }
+
+            // Pretty signature, or null when the function has no Enter3 record
+            public string Method { get; set; }
+
+            // Ran ReadyToRun code before it was jitted, if it ever was
+            public bool Precompiled { get; set; }
+
+            public int Compilations { get; set; }
+
+            // Number of the last successful recompile, 0 while the method has not been recompiled
+            public int LastRecompile { get; set; }
+
+            // Profiler clock, nanoseconds
+            public ulong FirstSeen { get; set; }
+
+            // When the last successful recompile finished, null while there is none
+            public ulong? LastRecompileTime { get; set; }
+
+            public ulong? TimeToLastRecompile => LastRecompileTime - FirstSeen;
+        }
+
+        // Slowest to its last recompile first, then the methods never recompiled
+        public List<MethodTiers> Methods { get; } = new List<MethodTiers>();
+
+        // Builds the report of a run read by JitProfilerLogParser.ReadEvents and names its methods from PE metadata
+        public static TierReport Build(ProfilerRun run, string executablePath, List<string> errors)
+        {
+            var report = Build(run.Events.JitCompilations, run.Events.CacheHits);
+            var names = JitProfilerLogParser.NameMethods(run, report.Methods.Select(x => x.FunctionID).ToList(), executablePath, errors);
+            for (int i = 0; i < names.Length; i++)
+                report.Methods[i].Method = names[i];
+            return report;
+        }
+
+        public static TierReport Build(IEnumerable<JitCompilationMessage> compilations, IEnumerable<CacheHitMessage> cacheHits)
+        {
+            if (compilations == null) throw new ArgumentNullException(nameof(compilations));
+            if (cacheHits == null) throw new ArgumentNullException(nameof(cacheHits));
+
+            var byFunction = new Dictionary<ulong, MethodTiers>();
+            MethodTiers GetMethod(ulong functionId, ulong time)
+            {
+                if (!byFunction.TryGetValue(functionId, out var entry))
+                {
+                    entry = new MethodTiers { FunctionID = functionId, FirstSeen = time };
+                    byFunction.Add(functionId, entry);
+                }
+                else if (time < entry.FirstSeen)
+                {
+                    entry.FirstSeen = time;
+                }
+                return entry;
+            }
+
+            foreach (var hit in cacheHits)
+                GetMethod(hit.FunctionID, hit.Time).Precompiled = true;
+
+            // Compilations of one method never overlap, so start order is recompile order
+            foreach (var compilation in compilations.OrderBy(x => x.Start))
+            {
+                var entry = GetMethod(compilation.FunctionID, compilation.Start);
+                int recompile = entry.Precompiled ? entry.Compilations + 1 : entry.Compilations;
+                entry.Compilations++;
+
+                if (recompile >= 1 && compilation.Succeeded)
+                {
+                    entry.LastRecompile = recompile;
+                    entry.LastRecompileTime = compilation.Finish;
+                }
+            }
+
+            var report = new TierReport();
+            report.Methods.AddRange(byFunction.Values
+                .OrderBy(x => x.LastRecompileTime == null)
+                .ThenByDescending(x => x.TimeToLastRecompile)
+                .ThenBy(x => x.FunctionID));
+            return report;
+        }
+
+        public string ToReport(int top = 50)
+        {
+            var recompiled = Methods.Where(x => x.LastRecompileTime != null).ToList();
+            var sb = new StringBuilder();
+            sb.AppendLine($"{Methods.Count} methods, {Methods.Count(x => x.Precompiled)} precompiled, {recompiled.Count} recompiled");
+            sb.AppendLine("Recompile N is a method's Nth compilation after its first code, jitted or precompiled. The tier of a");
+            sb.AppendLine("recompile is not reported: OSR and instrumented tiers add recompiles before tier 1, which is usually the last.");
+            if (recompiled.Count > 0)
+            {
+                var times = recompiled.Select(x => x.TimeToLastRecompile.Value).OrderBy(x => x).ToList();
+                sb.AppendLine($"Time to last recompile: median {FormatMs(times[times.Count / 2])} ms, max {FormatMs(times[times.Count - 1])} ms");
+            }
+
+            sb.AppendLine();
+            sb.AppendLine($"{"Last ms",10} {"Last",-12} {"Count",6} {"R2R",4}  Method");
+            foreach (var method in Methods.Take(top))
+            {
+                var time = method.TimeToLastRecompile is ulong last ? FormatMs(last) : "-";
+                var label = method.LastRecompile > 0 ? $"recompile {method.LastRecompile}" : "-";
+                var name = method.Method ?? $"FunctionID 0x{method.FunctionID:X}";
+                sb.AppendLine($"{time,10} {label,-12} {method.Compilations,6} {(method.Precompiled ? "yes" : ""),4}  {name}");
+            }
+
+            if (Methods.Count > top)
+                sb.AppendLine($"... {Methods.Count - top} more");
+            return sb.ToString();
+        }
+
+        private static string FormatMs(ulong nanoseconds)
+        {
+            return (nanoseconds / 1e6).ToString("0.000", CultureInfo.InvariantCulture);
+        }
+    }
+}
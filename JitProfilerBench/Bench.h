@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Each benchmark prints its own table and returns non-zero if a
+// correctness check failed along the way.
+int RunConcurrentIdSetBench();
+int RunJsonWriterBench();
+#ifdef JITPROFILERBENCH_PROFILER
+int RunProfilerBench();
+#endif
+
+// One measurement for --json. Names are '/'-separated, e.g.
+// "profiler/enter3/first_call/threads:4". bytesPerItem < 0 leaves it out.
+struct BenchResult
+{
+    std::string name;
+    uint64_t iterations;
+    double nanosecondsPerOp;
+    double bytesPerItem;
+};
+
+void ReportResult(const std::string& name, uint64_t iterations, double nanosecondsPerOp, double bytesPerItem = -1);
@@ -0,0 +1,203 @@
+#include "Bench.h"
+#include "../JitProfilerPlugin/ConcurrentIdSet.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <mutex>
+#endif
+
+namespace
+{
+    // The dedup sets as the plugin used to have them: one unordered_set behind one lock.
+    class LockedIdSet
+    {
+    public:
+        LockedIdSet()
+        {
+#ifdef _WIN32
+            InitializeCriticalSection(&lock);
+#endif
+        }
+
+        ~LockedIdSet()
+        {
+#ifdef _WIN32
+            DeleteCriticalSection(&lock);
+#endif
+        }
+
+        bool InsertIfAbsent(uintptr_t id)
+        {
+#ifdef _WIN32
+            EnterCriticalSection(&lock);
+            bool inserted = ids.insert(id).second;
+            LeaveCriticalSection(&lock);
+            return inserted;
+#else
+            std::lock_guard<std::mutex> guard(lock);
+            return ids.insert(id).second;
+#endif
+        }
+
+    private:
+        std::unordered_set<uintptr_t> ids;
+#ifdef _WIN32
+        CRITICAL_SECTION lock;
+#else
+        std::mutex lock;
+#endif
+    };
+
+    // FunctionIDs are MethodDesc pointers: aligned, clustered, never 0.
+    std::vector<uintptr_t> MakeIds(size_t count, uint32_t seed)
+    {
+        std::mt19937_64 random(seed);
+        std::vector<uintptr_t> ids(count);
+        uintptr_t next = (uintptr_t)0x7ff800000000ULL;
+        for (size_t i = 0; i < count; i++)
+        {
+            next += 0x18 + (random() & 0x7) * 8;
+            ids[i] = next;
+        }
+        std::shuffle(ids.begin(), ids.end(), random);
+        return ids;
+    }
+
+    // Runs one pass with 'threads' workers, each walking its own key list. Returns
+    // the elapsed seconds and the number of calls that reported a new ID.
+    template <typename Set>
+    double RunPass(Set& set, const std::vector<std::vector<uintptr_t>>& work, size_t& inserted)
+    {
+        std::atomic<size_t> ready(0);
+        std::atomic<bool> go(false);
+        std::atomic<size_t> newIds(0);
+        std::vector<std::thread> workers;
+
+        for (size_t t = 0; t < work.size(); t++)
+        {
+            workers.emplace_back([&, t]()
+            {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                size_t local = 0;
+                for (uintptr_t id : work[t])
+                {
+                    if (set.InsertIfAbsent(id))
+                        local++;
+                }
+                newIds.fetch_add(local);
+            });
+        }
+
+        while (ready.load() != work.size())
+            std::this_thread::yield();
+
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread& worker : workers)
+            worker.join();
+        auto end = std::chrono::steady_clock::now();
+
+        inserted = newIds.load();
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    // shared:   every thread sees the same IDs in its own order, like many threads
+    //           entering the same hot methods; most calls find the ID already there.
+    // disjoint: every thread inserts IDs nobody else has, starting from a small
+    //           table, so the concurrent set resizes under load.
+    std::vector<std::vector<uintptr_t>> MakeWork(bool shared, size_t threads, size_t idsPerThread, size_t& unique)
+    {
+        std::vector<std::vector<uintptr_t>> work(threads);
+        if (shared)
+        {
+            std::vector<uintptr_t> ids = MakeIds(idsPerThread, 1);
+            for (size_t t = 0; t < threads; t++)
+            {
+                work[t] = ids;
+                std::shuffle(work[t].begin(), work[t].end(), std::mt19937_64(100 + t));
+            }
+            unique = idsPerThread;
+        }
+        else
+        {
+            std::vector<uintptr_t> ids = MakeIds(idsPerThread * threads, 2);
+            for (size_t t = 0; t < threads; t++)
+                work[t].assign(ids.begin() + t * idsPerThread, ids.begin() + (t + 1) * idsPerThread);
+            unique = idsPerThread * threads;
+        }
+        return work;
+    }
+}
+
+int RunConcurrentIdSetBench()
+{
+    const size_t threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    const size_t idsPerThread = 64 * 1024;
+    const int repetitions = 3;
+    int failures = 0;
+
+    printf("%-10s %8s %16s %16s %9s\n", "scenario", "threads", "locked ns/op", "concurrent ns/op", "speedup");
+
+    for (int scenario = 0; scenario < 2; scenario++)
+    {
+        const bool shared = scenario == 0;
+        for (size_t threads : threadCounts)
+        {
+            size_t unique = 0;
+            std::vector<std::vector<uintptr_t>> work = MakeWork(shared, threads, idsPerThread, unique);
+            const double operations = (double)threads * idsPerThread;
+
+            double bestLocked = 1e300;
+            double bestConcurrent = 1e300;
+            for (int r = 0; r < repetitions; r++)
+            {
+                size_t inserted = 0;
+
+                LockedIdSet locked;
+                bestLocked = std::min(bestLocked, RunPass(locked, work, inserted));
+                if (inserted != unique)
+                {
+                    printf("locked set reported %zu new IDs, expected %zu\n", inserted, unique);
+                    failures++;
+                }
+
+                // The plugin preallocates; the disjoint run starts small on purpose.
+                ConcurrentIdSet concurrent(shared ? 64 * 1024 : 1024);
+                bestConcurrent = std::min(bestConcurrent, RunPass(concurrent, work, inserted));
+                if (inserted != unique)
+                {
+                    printf("concurrent set reported %zu new IDs, expected %zu\n", inserted, unique);
+                    failures++;
+                }
+            }
+
+            printf("%-10s %8zu %16.1f %16.1f %8.2fx\n",
+                shared ? "shared" : "disjoint",
+                threads,
+                bestLocked * 1e9 / operations,
+                bestConcurrent * 1e9 / operations,
+                bestLocked / bestConcurrent);
+
+            std::string name = std::string("idset/") + (shared ? "shared" : "disjoint") + "/threads:" + std::to_string(threads);
+            ReportResult(name + "/locked", (uint64_t)operations, bestLocked * 1e9 / operations);
+            ReportResult(name + "/concurrent", (uint64_t)operations, bestConcurrent * 1e9 / operations);
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
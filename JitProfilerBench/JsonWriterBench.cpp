@@ -0,0 +1,368 @@
+#include "Bench.h"
+#include "../JitProfilerPlugin/JsonWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+    // Same shape as the plugin's flattened type argument list.
+    struct Entry
+    {
+        uint64_t moduleId;
+        uint32_t typeDef;
+        uint32_t childCount;
+    };
+
+    // Dictionary<string, List<KeyValuePair<int, Guid>>>.Add, the kind of record
+    // an Enter3 capture of generic collection code is made of.
+    struct Record
+    {
+        uint64_t functionId;
+        uint64_t moduleId;
+        uint32_t methodToken;
+        uint64_t typeModuleId;
+        uint32_t typeDefToken;
+        uint32_t rootCount;
+        std::vector<Entry> entries;
+    };
+
+    Record MakeRecord()
+    {
+        const uint64_t coreLib = 0x7ffa1c2b4000ULL;
+        Record record;
+        record.functionId = 0x7ffa1d30a5c8ULL;
+        record.moduleId = coreLib;
+        record.methodToken = 0x06001a2b;
+        record.typeModuleId = coreLib;
+        record.typeDefToken = 0x02000123;
+        record.rootCount = 2;
+        record.entries = {
+            { coreLib, 0x0200006d, 0 },
+            { coreLib, 0x0200012a, 1 },
+            { coreLib, 0x02000131, 2 },
+            { coreLib, 0x02000066, 0 },
+            { coreLib, 0x020000b4, 0 },
+        };
+        return record;
+    }
+
+    const wchar_t s_moduleName[] = L"C:\\Program Files\\dotnet\\shared\\Microsoft.NETCore.App\\8.0.8\\System.Private.CoreLib.dll";
+    const wchar_t s_assemblyName[] = L"System.Private.CoreLib";
+
+    // The path the plugin used to take: swprintf per field into a wstring, the
+    // finished line formatted once more through vswprintf, then converted to UTF-8.
+    class LegacyWriter
+    {
+    public:
+        LegacyWriter() : wideBuffer(1024) {}
+
+        void WriteRecord(const Record& record, std::string& out)
+        {
+            wchar_t buffer[256];
+            std::wstring json = L"{";
+
+            swprintf(buffer, 256, L"\"FunctionID\":%llu", (unsigned long long)record.functionId);
+            json += buffer;
+            swprintf(buffer, 256, L",\"ModuleID\":%llu", (unsigned long long)record.moduleId);
+            json += buffer;
+            swprintf(buffer, 256, L",\"MethodToken\":%u", record.methodToken);
+            json += buffer;
+            swprintf(buffer, 256, L",\"DeclaringTypeModuleID\":%llu", (unsigned long long)record.typeModuleId);
+            json += buffer;
+            swprintf(buffer, 256, L",\"DeclaringTypeToken\":%u", record.typeDefToken);
+            json += buffer;
+            swprintf(buffer, 256, L",\"DeclaringTypeArgCount\":%u", record.rootCount);
+            json += buffer;
+
+            json += L",\"DeclaringTypeArgs\":[";
+            for (size_t index = 0; index < record.entries.size();)
+            {
+                if (index > 0) json += L",";
+                AppendTypeArg(json, record.entries.data(), index);
+            }
+            json += L"]";
+
+            swprintf(buffer, 256, L",\"MethodTypeArgCount\":%u", 0u);
+            json += buffer;
+            json += L"}";
+
+            Format(out, L"%ls", json.c_str());
+        }
+
+        void WriteModule(uint64_t moduleId, uint64_t assemblyId, std::string& out)
+        {
+            std::wstring moduleName(s_moduleName);
+            std::wstring assemblyName(s_assemblyName);
+            std::wstring escapedModuleName = Escape(moduleName);
+            std::wstring escapedAssemblyName = Escape(assemblyName);
+
+            Format(out, L"{\"ModuleID\":%llu,\"ModuleName\":\"%ls\",\"AssemblyID\":%llu,\"AssemblyName\":\"%ls\"}",
+                (unsigned long long)moduleId, escapedModuleName.c_str(),
+                (unsigned long long)assemblyId, escapedAssemblyName.c_str());
+        }
+
+    private:
+        void AppendTypeArg(std::wstring& json, const Entry* entries, size_t& index)
+        {
+            const Entry& entry = entries[index++];
+
+            wchar_t buffer[512];
+            swprintf(buffer, 512, L"{\"ModuleID\":%llu,\"TypeDef\":%u,\"NestedCount\":%u",
+                (unsigned long long)entry.moduleId, entry.typeDef, entry.childCount);
+            json += buffer;
+
+            if (entry.childCount > 0)
+            {
+                json += L",\"Nested\":[";
+                for (uint32_t i = 0; i < entry.childCount; i++)
+                {
+                    if (i > 0) json += L",";
+                    AppendTypeArg(json, entries, index);
+                }
+                json += L"]";
+            }
+
+            json += L"}";
+        }
+
+        static std::wstring Escape(const std::wstring& str)
+        {
+            std::wstring result;
+            result.reserve(str.length());
+            for (wchar_t c : str)
+            {
+                switch (c)
+                {
+                case L'\"': result += L"\\\""; break;
+                case L'\\': result += L"\\\\"; break;
+                default: result += c; break;
+                }
+            }
+            return result;
+        }
+
+        void Format(std::string& out, const wchar_t* format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+            int length = vswprintf(wideBuffer.data(), wideBuffer.size() - 1, format, args);
+            va_end(args);
+            if (length < 0)
+                return;
+
+            wideBuffer[length++] = L'\n';
+#ifdef _WIN32
+            out.resize((size_t)length * 3);
+            int bytes = WideCharToMultiByte(CP_UTF8, 0, wideBuffer.data(), length, &out[0], (int)out.size(), NULL, NULL);
+            out.resize(bytes > 0 ? (size_t)bytes : 0);
+#else
+            out.clear();
+            for (int i = 0; i < length; i++)
+                out += (char)wideBuffer[i];
+#endif
+        }
+
+        std::vector<wchar_t> wideBuffer;
+    };
+
+    void WriteTypeArg(JsonWriter& writer, const Entry* entries, size_t& index)
+    {
+        const Entry& entry = entries[index++];
+
+        writer.BeginObject();
+        writer.Property("ModuleID", entry.moduleId);
+        writer.Property("TypeDef", entry.typeDef);
+        writer.Property("NestedCount", entry.childCount);
+        if (entry.childCount > 0)
+        {
+            writer.BeginArray("Nested");
+            for (uint32_t i = 0; i < entry.childCount; i++)
+                WriteTypeArg(writer, entries, index);
+            writer.EndArray();
+        }
+        writer.EndObject();
+    }
+
+    const char* WriteRecord(JsonWriter& writer, const Record& record, uint32_t& length)
+    {
+        writer.Begin();
+        writer.BeginObject();
+        writer.Property("FunctionID", record.functionId);
+        writer.Property("ModuleID", record.moduleId);
+        writer.Property("MethodToken", record.methodToken);
+        writer.Property("DeclaringTypeModuleID", record.typeModuleId);
+        writer.Property("DeclaringTypeToken", record.typeDefToken);
+        writer.Property("DeclaringTypeArgCount", record.rootCount);
+        writer.BeginArray("DeclaringTypeArgs");
+        for (size_t index = 0; index < record.entries.size();)
+            WriteTypeArg(writer, record.entries.data(), index);
+        writer.EndArray();
+        writer.Property("MethodTypeArgCount", 0);
+        writer.EndObject();
+        return writer.Finish(length);
+    }
+
+    const char* WriteModule(JsonWriter& writer, uint64_t moduleId, uint64_t assemblyId, uint32_t& length)
+    {
+        writer.Begin();
+        writer.BeginObject();
+        writer.Property("ModuleID", moduleId);
+        writer.Property("ModuleName", s_moduleName, wcslen(s_moduleName));
+        writer.Property("AssemblyID", assemblyId);
+        writer.Property("AssemblyName", s_assemblyName, wcslen(s_assemblyName));
+        writer.EndObject();
+        return writer.Finish(length);
+    }
+
+    // Formats 'count' records on each of 'threads' workers and returns the elapsed
+    // seconds. The byte total keeps the work from being optimized away.
+    template <typename Body>
+    double RunPass(size_t threads, size_t count, Body body, size_t& bytes)
+    {
+        std::atomic<size_t> ready(0);
+        std::atomic<bool> go(false);
+        std::atomic<size_t> totalBytes(0);
+        std::vector<std::thread> workers;
+
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&]()
+            {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                totalBytes.fetch_add(body(count));
+            });
+        }
+
+        while (ready.load() != threads)
+            std::this_thread::yield();
+
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread& worker : workers)
+            worker.join();
+        auto end = std::chrono::steady_clock::now();
+
+        bytes = totalBytes.load();
+        return std::chrono::duration<double>(end - start).count();
+    }
+}
+
+int RunJsonWriterBench()
+{
+    const size_t threadCounts[] = { 1, 2, 4, 8 };
+    const size_t recordsPerThread = 200 * 1000;
+    const int repetitions = 3;
+    int failures = 0;
+
+    const Record record = MakeRecord();
+    const uint64_t assemblyId = 0x1f2e3d4c5b6aULL;
+
+    // Both paths have to produce the same bytes before their speed means anything.
+    {
+        LegacyWriter legacy;
+        JsonWriter writer;
+        std::string expected;
+        uint32_t length;
+
+        legacy.WriteRecord(record, expected);
+        const char* line = WriteRecord(writer, record, length);
+        if (expected != std::string(line, length))
+        {
+            printf("enter3 record differs:\n  legacy: %s  writer: %.*s", expected.c_str(), (int)length, line);
+            failures++;
+        }
+
+        legacy.WriteModule(record.moduleId, assemblyId, expected);
+        line = WriteModule(writer, record.moduleId, assemblyId, length);
+        if (expected != std::string(line, length))
+        {
+            printf("module record differs:\n  legacy: %s  writer: %.*s", expected.c_str(), (int)length, line);
+            failures++;
+        }
+    }
+
+    printf("%-8s %8s %16s %16s %9s\n", "record", "threads", "legacy ns/rec", "writer ns/rec", "speedup");
+
+    for (int kind = 0; kind < 2; kind++)
+    {
+        const bool module = kind == 1;
+        for (size_t threads : threadCounts)
+        {
+            const double operations = (double)threads * recordsPerThread;
+            double bestLegacy = 1e300;
+            double bestWriter = 1e300;
+            size_t legacyBytes = 0;
+            size_t writerBytes = 0;
+
+            for (int r = 0; r < repetitions; r++)
+            {
+                bestLegacy = std::min(bestLegacy, RunPass(threads, recordsPerThread, [&](size_t count)
+                {
+                    LegacyWriter legacy;
+                    std::string line;
+                    size_t total = 0;
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        if (module)
+                            legacy.WriteModule(record.moduleId + i, assemblyId, line);
+                        else
+                            legacy.WriteRecord(record, line);
+                        total += line.size();
+                    }
+                    return total;
+                }, legacyBytes));
+
+                bestWriter = std::min(bestWriter, RunPass(threads, recordsPerThread, [&](size_t count)
+                {
+                    JsonWriter writer;
+                    uint32_t length;
+                    size_t total = 0;
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        if (module)
+                            WriteModule(writer, record.moduleId + i, assemblyId, length);
+                        else
+                            WriteRecord(writer, record, length);
+                        total += length;
+                    }
+                    return total;
+                }, writerBytes));
+            }
+
+            if (legacyBytes != writerBytes)
+            {
+                printf("legacy wrote %zu bytes, writer wrote %zu\n", legacyBytes, writerBytes);
+                failures++;
+            }
+
+            printf("%-8s %8zu %16.1f %16.1f %8.2fx\n",
+                module ? "module" : "enter3",
+                threads,
+                bestLegacy * 1e9 / operations,
+                bestWriter * 1e9 / operations,
+                bestLegacy / bestWriter);
+
+            std::string name = std::string("json/") + (module ? "module" : "enter3") + "/threads:" + std::to_string(threads);
+            ReportResult(name + "/legacy", (uint64_t)operations, bestLegacy * 1e9 / operations, (double)legacyBytes / operations);
+            ReportResult(name + "/writer", (uint64_t)operations, bestWriter * 1e9 / operations, (double)writerBytes / operations);
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+struct BenchEntry
+{
+    const char* name;
+    int (*run)();
+};
+
+static const BenchEntry s_benches[] = {
+    { "idset", RunConcurrentIdSetBench },
+    { "json", RunJsonWriterBench },
+#ifdef JITPROFILERBENCH_PROFILER
+    { "profiler", RunProfilerBench },
+#endif
+};
+
+static std::vector<BenchResult> s_results;
+
+void ReportResult(const std::string& name, uint64_t iterations, double nanosecondsPerOp, double bytesPerItem)
+{
+    s_results.push_back({ name, iterations, nanosecondsPerOp, bytesPerItem });
+}
+
+// Same layout as Google Benchmark's --benchmark_out, so results from
+// different builds can be diffed and tracked by the same scripts.
+static bool WriteResults(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == nullptr)
+        return false;
+
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    fprintf(file, "{\n  \"context\": {\n");
+    fprintf(file, "    \"date\": \"%s\",\n", date);
+    fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+    fprintf(file, "    \"library_build_type\": \"release\"\n");
+#else
+    fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#endif
+    fprintf(file, "  },\n  \"benchmarks\": [");
+
+    for (size_t i = 0; i < s_results.size(); i++)
+    {
+        const BenchResult& result = s_results[i];
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %llu, \"real_time\": %.3f, \"time_unit\": \"ns\"",
+            i == 0 ? "" : ",", result.name.c_str(), (unsigned long long)result.iterations, result.nanosecondsPerOp);
+        if (result.bytesPerItem >= 0)
+            fprintf(file, ", \"bytes_per_item\": %.2f", result.bytesPerItem);
+        fprintf(file, "}");
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+// Usage: JitProfilerBench [--json file] [name...]; runs every benchmark when
+// no name is given.
+int main(int argc, char** argv)
+{
+    const char* jsonPath = nullptr;
+    std::vector<const char*> names;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else
+            names.push_back(argv[i]);
+    }
+
+    int result = 0;
+    for (const BenchEntry& bench : s_benches)
+    {
+        bool selected = names.empty();
+        for (const char* name : names)
+        {
+            if (strcmp(name, bench.name) == 0)
+                selected = true;
+        }
+
+        if (!selected)
+            continue;
+
+        printf("== %s ==\n", bench.name);
+        if (bench.run() != 0)
+            result = 1;
+        printf("\n");
+    }
+
+    if (jsonPath != nullptr && !WriteResults(jsonPath))
+    {
+        printf("could not write %s\n", jsonPath);
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,401 @@
+#include "Bench.h"
+#include "../JitProfilerHarness/FakeProfilerInfo.h"
+#include "../JitProfilerHarness/SyntheticGraph.h"
+#include "JitProfilerPlugin.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The profiler's callbacks driven through FakeProfilerInfo: the cost of the
+// first call of a function (dedup miss, resolution, formatting, logging)
+// against every call after it (dedup hit), over 1 to N threads; the cost of
+// resolving type arguments nested up to and past SIG_JIT_PROFILER_MAX_RECURSE;
+// and ProfilerLogger on its own. The "counts" mode is enter3 with
+// SIG_JIT_PROFILER_CALL_COUNTS=1, whose cost shows in every repeated call.
+// Latencies are per call on one thread: elapsed time times threads over
+// calls.
+
+namespace
+{
+    void SetSetting(const char* name, const std::string& value)
+    {
+#ifdef _WIN32
+        _putenv_s(name, value.c_str());
+#else
+        setenv(name, value.c_str(), 1);
+#endif
+    }
+
+    std::vector<size_t> MakeThreadCounts()
+    {
+        size_t processors = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<size_t> counts;
+        for (size_t threads = 1; threads < processors; threads *= 2)
+            counts.push_back(threads);
+        counts.push_back(processors);
+        return counts;
+    }
+
+    // Bytes and non-empty lines of one log file.
+    void MeasureFile(const std::filesystem::path& path, uint64_t& bytes, uint64_t& lines)
+    {
+        bytes = 0;
+        lines = 0;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            bytes += line.size() + 1;
+            if (!line.empty())
+                lines++;
+        }
+    }
+
+    // A profiler attached to the fake for one measurement, logging to its own
+    // directory.
+    class Session
+    {
+    public:
+        Session(FakeProfilerInfo& info, const char* captureMode, const char* format, const std::filesystem::path& directory)
+            : plugin(nullptr)
+        {
+            std::filesystem::remove_all(directory);
+            std::filesystem::create_directories(directory);
+            SetSetting("SIG_JIT_PROFILER_LOG_PATH", directory.string());
+            SetSetting("SIG_JIT_PROFILER_CAPTURE_MODE", captureMode);
+            SetSetting("SIG_JIT_PROFILER_FORMAT", format);
+
+            info.Reset();
+            ProfilerLogger::Initialize();
+            JitProfilerPlugin::InitializeMaxRecurseDepth();
+
+            plugin = new JitProfilerPlugin();
+            if (FAILED(plugin->Initialize(&info)))
+            {
+                plugin->Release();
+                plugin = nullptr;
+                ProfilerLogger::Shutdown(false);
+            }
+        }
+
+        ~Session() { Stop(); }
+
+        JitProfilerPlugin* Plugin() const { return plugin; }
+
+        // Writes out everything buffered, so the log files are complete.
+        void Stop()
+        {
+            if (plugin == nullptr)
+                return;
+
+            plugin->Shutdown();
+            plugin->Release();
+            plugin = nullptr;
+        }
+
+    private:
+        JitProfilerPlugin* plugin;
+    };
+
+    // Runs body(thread) on each of 'threads' workers released together and
+    // returns the elapsed seconds. Each worker runs warmUp(thread) first,
+    // untimed.
+    template <typename WarmUp, typename Body>
+    double RunThreads(size_t threads, WarmUp warmUp, Body body)
+    {
+        std::atomic<size_t> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]()
+            {
+                warmUp(t);
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                body(t);
+                // What DLL_THREAD_DETACH does for the runtime's threads.
+                ProfilerLogger::ReleaseThreadBuffer();
+            });
+        }
+
+        while (ready.load() != threads)
+            std::this_thread::yield();
+
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread& worker : workers)
+            worker.join();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    template <typename Body>
+    double RunThreads(size_t threads, Body body)
+    {
+        return RunThreads(threads, [](size_t) {}, body);
+    }
+
+    double Latency(double seconds, size_t threads, double calls)
+    {
+        return seconds * 1e9 * threads / calls;
+    }
+
+    struct HookTimes
+    {
+        double jitFirst = 1e300;
+        double jitRepeat = 1e300;
+        double enterFirst = 1e300;
+        double enterRepeat = 1e300;
+        double bytesPerRecord = 0;
+    };
+
+    // JITs and then calls every function once, spread over the threads, then
+    // has each thread JIT and call all of them again in its own order.
+    int RunHookBench(const std::filesystem::path& root, int repetitions)
+    {
+        FakeProfilerInfo info;
+        SyntheticGraphOptions options;
+        options.functionCount = 16 * 1024;
+        std::vector<FunctionID> functions = BuildSyntheticGraph(info, options);
+        const double functionCount = (double)functions.size();
+
+        std::vector<size_t> threadCounts = MakeThreadCounts();
+        std::vector<std::vector<FunctionID>> orders(threadCounts.back(), functions);
+        for (size_t t = 0; t < orders.size(); t++)
+            std::shuffle(orders[t].begin(), orders[t].end(), std::mt19937(100 + (uint32_t)t));
+
+        static const char* const captureModes[] = { "enter3", "mapper", "jit", "counts" };
+        int failures = 0;
+
+        printf("%-7s %8s %14s %14s %14s %14s %9s\n",
+            "mode", "threads", "jit first ns", "jit repeat ns", "enter first ns", "enter rep. ns", "B/record");
+
+        for (const char* captureMode : captureModes)
+        {
+            bool counting = strcmp(captureMode, "counts") == 0;
+            SetSetting("SIG_JIT_PROFILER_CALL_COUNTS", counting ? "1" : "0");
+
+            for (size_t threads : threadCounts)
+            {
+                HookTimes best;
+                for (int r = 0; r < repetitions; r++)
+                {
+                    std::filesystem::path directory = root / "hooks";
+                    Session session(info, counting ? "enter3" : captureMode, "json", directory);
+                    JitProfilerPlugin* plugin = session.Plugin();
+                    if (plugin == nullptr)
+                    {
+                        printf("%s: Initialize failed\n", captureMode);
+                        return 1;
+                    }
+
+                    best.jitFirst = std::min(best.jitFirst, RunThreads(threads, [&](size_t t)
+                    {
+                        for (size_t i = t; i < functions.size(); i += threads)
+                            plugin->JITCompilationStarted(functions[i], TRUE);
+                    }));
+                    best.jitRepeat = std::min(best.jitRepeat, RunThreads(threads, [&](size_t t)
+                    {
+                        for (FunctionID functionId : orders[t])
+                            plugin->JITCompilationStarted(functionId, TRUE);
+                    }));
+                    best.enterFirst = std::min(best.enterFirst, RunThreads(threads, [&](size_t t)
+                    {
+                        for (size_t i = t; i < functions.size(); i += threads)
+                            info.Enter(functions[i]);
+                    }));
+                    // Workers are new threads, so each first calls every function
+                    // once untimed, as a long-lived thread would have.
+                    auto enterAll = [&](size_t t)
+                    {
+                        for (FunctionID functionId : orders[t])
+                            info.Enter(functionId);
+                    };
+                    best.enterRepeat = std::min(best.enterRepeat, RunThreads(threads, enterAll, enterAll));
+
+                    session.Stop();
+
+                    uint64_t bytes;
+                    uint64_t lines;
+                    MeasureFile(directory / "enter3.json", bytes, lines);
+                    if (lines != functions.size())
+                    {
+                        printf("%s: %llu enter3 records for %zu functions\n", captureMode, (unsigned long long)lines, functions.size());
+                        failures++;
+                    }
+                    best.bytesPerRecord = lines != 0 ? (double)bytes / lines : 0;
+                }
+
+                double repeatCalls = functionCount * threads;
+                printf("%-7s %8zu %14.1f %14.1f %14.1f %14.1f %9.1f\n",
+                    captureMode,
+                    threads,
+                    Latency(best.jitFirst, threads, functionCount),
+                    Latency(best.jitRepeat, threads, repeatCalls),
+                    Latency(best.enterFirst, threads, functionCount),
+                    Latency(best.enterRepeat, threads, repeatCalls),
+                    best.bytesPerRecord);
+
+                std::string name = std::string("profiler/") + captureMode;
+                std::string suffix = "/threads:" + std::to_string(threads);
+                // The enter3 records are written by whichever callback captures.
+                bool capturedAtJit = strcmp(captureMode, "jit") == 0;
+                ReportResult(name + "/jit_first" + suffix, functions.size(), Latency(best.jitFirst, threads, functionCount),
+                    capturedAtJit ? best.bytesPerRecord : -1);
+                ReportResult(name + "/jit_repeat" + suffix, (uint64_t)repeatCalls, Latency(best.jitRepeat, threads, repeatCalls));
+                ReportResult(name + "/enter_first" + suffix, functions.size(), Latency(best.enterFirst, threads, functionCount),
+                    capturedAtJit ? -1 : best.bytesPerRecord);
+                ReportResult(name + "/enter_repeat" + suffix, (uint64_t)repeatCalls, Latency(best.enterRepeat, threads, repeatCalls));
+            }
+        }
+
+        SetSetting("SIG_JIT_PROFILER_CALL_COUNTS", "0");
+
+        return failures;
+    }
+
+    // First calls of functions declared on Box<Box<...<Leaf>>>, 'depth' levels
+    // deep, each over its own leaf type so that nothing is cached.
+    int RunDepthBench(const std::filesystem::path& root, int repetitions)
+    {
+        JitProfilerPlugin::InitializeMaxRecurseDepth();
+        const uint32_t maxRecurse = (uint32_t)JitProfilerPlugin::GetMaxRecurseDepth();
+        const size_t functionCount = 2048;
+
+        std::vector<uint32_t> depths = { 0, 1, 2, 4, 8, 16, maxRecurse, maxRecurse + 8 };
+        std::sort(depths.begin(), depths.end());
+        depths.erase(std::unique(depths.begin(), depths.end()), depths.end());
+
+        int failures = 0;
+        printf("%-7s %14s %9s  (SIG_JIT_PROFILER_MAX_RECURSE=%u)\n", "depth", "enter first ns", "B/record", maxRecurse);
+
+        for (uint32_t depth : depths)
+        {
+            FakeProfilerInfo info;
+            ModuleID moduleId = info.AddModule(L"Synthetic.dll", L"Synthetic");
+            std::vector<FunctionID> functions;
+            for (size_t i = 0; i < functionCount; i++)
+            {
+                ClassID declaringClass = info.AddClass(moduleId, 0x02000100 + (mdTypeDef)i, {});
+                for (uint32_t level = 0; level < depth; level++)
+                    declaringClass = info.AddClass(moduleId, 0x02000002, { declaringClass });
+                functions.push_back(info.AddFunction(moduleId, 0x06000001 + (mdMethodDef)i, declaringClass, {}, declaringClass, {}));
+            }
+
+            double best = 1e300;
+            double bytesPerRecord = 0;
+            for (int r = 0; r < repetitions; r++)
+            {
+                std::filesystem::path directory = root / "depth";
+                Session session(info, "enter3", "json", directory);
+                if (session.Plugin() == nullptr)
+                    return 1;
+
+                best = std::min(best, RunThreads(1, [&](size_t)
+                {
+                    for (FunctionID functionId : functions)
+                        info.Enter(functionId);
+                }));
+                session.Stop();
+
+                uint64_t bytes;
+                uint64_t lines;
+                MeasureFile(directory / "enter3.json", bytes, lines);
+                if (lines != functions.size())
+                {
+                    printf("depth %u: %llu enter3 records for %zu functions\n", depth, (unsigned long long)lines, functions.size());
+                    failures++;
+                }
+                bytesPerRecord = lines != 0 ? (double)bytes / lines : 0;
+            }
+
+            printf("%-7u %14.1f %9.1f\n", depth, Latency(best, 1, (double)functionCount), bytesPerRecord);
+            ReportResult("profiler/depth:" + std::to_string(depth) + "/enter_first", functionCount,
+                Latency(best, 1, (double)functionCount), bytesPerRecord);
+        }
+
+        return failures;
+    }
+
+    // ProfilerLogger alone: a typical enter3 line appended from each thread,
+    // through the thread buffers and through the mapped files.
+    int RunLoggerBench(const std::filesystem::path& root, int repetitions)
+    {
+        static const char line[] =
+            "{\"FunctionID\":140736301531512,\"ModuleID\":140736300000000,\"MethodToken\":100663297,"
+            "\"DeclaringTypeModuleID\":140736300000000,\"DeclaringTypeToken\":33554434,"
+            "\"DeclaringTypeArgCount\":0,\"MethodTypeArgCount\":0}\n";
+        const uint32_t length = (uint32_t)(sizeof(line) - 1);
+        const size_t recordsPerThread = 200 * 1000;
+
+        printf("%-9s %8s %14s %12s\n", "sink", "threads", "ns/record", "MB/s");
+
+        static const char* const sinks[] = { "buffered", "mapped" };
+        for (const char* sink : sinks)
+        {
+            for (size_t threads : MakeThreadCounts())
+            {
+                double best = 1e300;
+                for (int r = 0; r < repetitions; r++)
+                {
+                    std::filesystem::path directory = root / "logger";
+                    std::filesystem::remove_all(directory);
+                    std::filesystem::create_directories(directory);
+                    SetSetting("SIG_JIT_PROFILER_LOG_PATH", directory.string());
+                    SetSetting("SIG_JIT_PROFILER_FORMAT", "json");
+                    SetSetting("SIG_JIT_PROFILER_SINK", sink);
+
+                    ProfilerLogger::Initialize();
+                    best = std::min(best, RunThreads(threads, [&](size_t)
+                    {
+                        for (size_t i = 0; i < recordsPerThread; i++)
+                            ProfilerLogger::LogJson(LogStream::Enter3, line, length);
+                    }));
+                    ProfilerLogger::Shutdown(false);
+                }
+
+                double records = (double)recordsPerThread * threads;
+                printf("%-9s %8zu %14.1f %12.1f\n", sink, threads,
+                    Latency(best, threads, records), records * length / best / (1024 * 1024));
+                ReportResult(std::string("profiler/logger/") + sink + "/threads:" + std::to_string(threads), (uint64_t)records,
+                    Latency(best, threads, records), (double)length);
+            }
+        }
+
+        return 0;
+    }
+}
+
+int RunProfilerBench()
+{
+    const int repetitions = 3;
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "JitProfilerBench";
+
+    // Point the profiler at a control block nobody created.
+    SetSetting("SIG_JIT_PROFILER_MAP_ID", "JitProfilerBench_" + std::to_string(Platform::GetProcessId()));
+
+    int failures = RunHookBench(root, repetitions);
+    printf("\n");
+    failures += RunDepthBench(root, repetitions);
+    printf("\n");
+    failures += RunLoggerBench(root, repetitions);
+
+    std::error_code error;
+    std::filesystem::remove_all(root, error);
+    return failures == 0 ? 0 : 1;
+}
@@ -3,16 +3,61 @@
     using System;
     using System.IO.MemoryMappedFiles;
     using System.IO;
+    using System.Threading;
 
+    // Live counters the plugin publishes in the control block.
+    public class JitProfilerStats
+    {
+        public uint AttachedProcessId { get; set; }
+        public int AppliedFilterGeneration { get; set; }
+        public ulong JitEvents { get; set; }
+        public ulong Enter3Records { get; set; }
+        public ulong ModuleRecords { get; set; }
+        public ulong DedupHits { get; set; }
+        public ulong SampledOut { get; set; }
+        public ulong RateLimited { get; set; }
+        public ulong Deferred { get; set; }
+        public ulong BytesBuffered { get; set; }
+        public ulong BytesWritten { get; set; }
+        public ulong DroppedRecords { get; set; }
+        public ulong FlushCount { get; set; }
+        public ulong FlushTotalMicroseconds { get; set; }
+        public ulong FlushMaxMicroseconds { get; set; }
+        public ulong LastFlushMicroseconds { get; set; }
+    }
+
+    // Writes the plugin's shared-memory control block and reads the statistics
+    // the plugin keeps in it. The offsets mirror ControlBlock in
+    // JitProfilerPlugin/ControlBlock.h.
     public class IpcFlagMap : IDisposable
     {
         public const string DefaultJitProfilerId = "SIG_JITPROFILER";
+        public const int MaxSampleRulesLength = 1024;
+        public const uint EventJit = 1u << 0;
+        public const uint EventEnter3 = 1u << 1;
+        public const uint AllEvents = EventJit | EventEnter3;
         private readonly string mapName;
         private MemoryMappedFile mmf;
         private MemoryMappedViewAccessor accessor;
 
-        // Length for 1 int32 = 4 bytes
-        private const long FLAG_LENGTH = 4;
+        private const uint Magic = 0x42435053; // "SPCB"
+        private const uint Version = 1;
+
+        private const long EnabledOffset = 0;
+        private const long MagicOffset = 4;
+        private const long VersionOffset = 8;
+        private const long SizeOffset = 12;
+        private const long EventMaskOffset = 16;
+        private const long FilterGenerationOffset = 20;
+        private const long MaxRecordsPerSecondOffset = 24;
+        private const long BurstOffset = 28;
+        private const long DeferResolutionOffset = 32;
+        private const long SampleRulesOffset = 40;
+        private const long AttachedProcessIdOffset = SampleRulesOffset + MaxSampleRulesLength * 2;
+        private const long AppliedFilterGenerationOffset = AttachedProcessIdOffset + 4;
+        private const long StatsOffset = AppliedFilterGenerationOffset + 4;
+        private const int StatsCount = 14;
+        private const long BLOCK_LENGTH = StatsOffset + StatsCount * 8;
 
         public IpcFlagMap(string mapName = DefaultJitProfilerId)
         {
@@ -24,16 +69,63 @@
         private void Initialize()
         {
             // Try to open if already exists, else create
-            mmf = MemoryMappedFile.CreateOrOpen(mapName, FLAG_LENGTH);
-            accessor = mmf.CreateViewAccessor(0, FLAG_LENGTH);
+            mmf = MemoryMappedFile.CreateOrOpen(mapName, BLOCK_LENGTH);
+            accessor = mmf.CreateViewAccessor(0, BLOCK_LENGTH);
             SetFlag(0);
+
+            // The plugin checks these when it attaches; without them it treats
+            // the block as a plain on/off flag.
+            accessor.Write(EventMaskOffset, AllEvents);
+            accessor.Write(VersionOffset, Version);
+            accessor.Write(SizeOffset, (uint)BLOCK_LENGTH);
+            Thread.MemoryBarrier();
+            accessor.Write(MagicOffset, Magic);
+            accessor.Flush();
         }
 
         // Set the int32 flag at offset 0
         public void SetFlag(int value)
         {
             if (accessor == null) throw new InvalidOperationException("Not initialized");
-            accessor.Write(0, value);
+            accessor.Write(EnabledOffset, value);
+            accessor.Flush();
+        }
+
+        // Selects which events are recorded while the flag is set; see EventJit
+        // and EventEnter3.
+        public void SetEventMask(uint mask)
+        {
+            if (accessor == null) throw new InvalidOperationException("Not initialized");
+            accessor.Write(EventMaskOffset, mask);
+            accessor.Flush();
+        }
+
+        // Replaces the plugin's sampling rules, rate cap and deferral setting,
+        // which otherwise come from SIG_JIT_PROFILER_SAMPLE, _MAX_RATE, _BURST
+        // and _DEFER. A maxRecordsPerSecond of 0 removes the cap; a burst of 0
+        // allows one second's worth.
+        public void SetAdmission(string sampleRules, int maxRecordsPerSecond, int burst, bool deferResolution)
+        {
+            if (accessor == null) throw new InvalidOperationException("Not initialized");
+            sampleRules ??= string.Empty;
+            if (sampleRules.Length >= MaxSampleRulesLength)
+                throw new ArgumentException($"Sampling rules are limited to {MaxSampleRulesLength - 1} characters", nameof(sampleRules));
+
+            // An odd generation tells the plugin the fields are being written.
+            int generation = accessor.ReadInt32(FilterGenerationOffset);
+            generation += (generation & 1) + 1;
+            accessor.Write(FilterGenerationOffset, generation);
+            Thread.MemoryBarrier();
+
+            accessor.Write(MaxRecordsPerSecondOffset, maxRecordsPerSecond);
+            accessor.Write(BurstOffset, burst);
+            accessor.Write(DeferResolutionOffset, deferResolution ? 1 : 0);
+            var rules = new char[MaxSampleRulesLength];
+            sampleRules.CopyTo(0, rules, 0, sampleRules.Length);
+            accessor.WriteArray(SampleRulesOffset, rules, 0, rules.Length);
+
+            Thread.MemoryBarrier();
+            accessor.Write(FilterGenerationOffset, generation + 1);
             accessor.Flush();
         }
 
@@ -41,7 +133,35 @@
         public int GetFlag()
         {
             if (accessor == null) throw new InvalidOperationException("Not initialized");
-            return accessor.ReadInt32(0);
+            return accessor.ReadInt32(EnabledOffset);
+        }
+
+        // Reads the plugin's counters. Each one is read on its own, so they may be
+        // a few records apart from one another.
+        public JitProfilerStats ReadStats()
+        {
+            if (accessor == null) throw new InvalidOperationException("Not initialized");
+            var values = new ulong[StatsCount];
+            accessor.ReadArray(StatsOffset, values, 0, StatsCount);
+            return new JitProfilerStats
+            {
+                AttachedProcessId = accessor.ReadUInt32(AttachedProcessIdOffset),
+                AppliedFilterGeneration = accessor.ReadInt32(AppliedFilterGenerationOffset),
+                JitEvents = values[0],
+                Enter3Records = values[1],
+                ModuleRecords = values[2],
+                DedupHits = values[3],
+                SampledOut = values[4],
+                RateLimited = values[5],
+                Deferred = values[6],
+                BytesBuffered = values[7],
+                BytesWritten = values[8],
+                DroppedRecords = values[9],
+                FlushCount = values[10],
+                FlushTotalMicroseconds = values[11],
+                FlushMaxMicroseconds = values[12],
+                LastFlushMicroseconds = values[13],
+            };
         }
 
         // Clean up resources
@@ -8,6 +8,7 @@ using System.Reflection;
 using System.Text;
 using System.Text.Json;
 using System.Threading;
+using System.Threading.Tasks;
 using System.Windows;
 using System.Windows.Controls;
 using System.Windows.Data;
@@ -17,6 +18,7 @@ using System.Windows.Media;
 using System.Windows.Media.Imaging;
 using System.Windows.Navigation;
 using System.Windows.Shapes;
+using System.Windows.Threading;
 using TestApplication;
 using static JitLogParser.MethodBaseSerializer;
 
@@ -30,11 +32,21 @@ namespace JitProfilerController
         public MainWindow()
         {
             InitializeComponent();
+            statsTimer = new DispatcherTimer { Interval = TimeSpan.FromMilliseconds(500) };
+            statsTimer.Tick += StatsTimer_Tick;
+            collectTimer = new DispatcherTimer { Interval = TimeSpan.FromSeconds(2) };
+            collectTimer.Tick += CollectTimer_Tick;
         }
 
         Process p;
         IpcFlagMap ipcFlagMap;
         string logFolder;
+        readonly DispatcherTimer statsTimer;
+        JitProfilerStats lastStats;
+        DateTime lastStatsTime;
+        readonly DispatcherTimer collectTimer;
+        IncrementalCollector collector;
+        Task collectPass = Task.CompletedTask;
         private void Button_Click(object sender, RoutedEventArgs e)
         {
             //Collect(@"C:\siglocal\JitProfilerPlugin\20251118_200121");
@@ -67,12 +79,31 @@ namespace JitProfilerController
                 procInfo.EnvironmentVariables.Add("DOTNET_EnableDiagnostics_Profiler", "1");
                 procInfo.EnvironmentVariables.Add("SIG_JIT_PROFILER_LOG_PATH", logFolder);
                 procInfo.EnvironmentVariables.Add("SIG_JIT_PROFILER_MAP_ID", IpcFlagMap.DefaultJitProfilerId);
+                // The target is killed on Collect; mapped logs keep everything it wrote
+                procInfo.EnvironmentVariables.Add("SIG_JIT_PROFILER_SINK", "mapped");
                 p = Process.Start(procInfo);
                 p.EnableRaisingEvents = true;
                 p.Exited += P_Exited;
 
                 ProfileControl.IsEnabled = true;
+                ApplyAdmission.IsEnabled = true;
+                EventJit.IsEnabled = true;
+                EventEnter3.IsEnabled = true;
                 TargetExec.IsEnabled = false;
+                lastStats = null;
+                StatsText.Text = string.Empty;
+                statsTimer.Start();
+                if (TailCollect.IsChecked == true)
+                {
+                    collector = new IncrementalCollector(logFolder, System.IO.Path.GetDirectoryName(TargetExec.Text), MetadataOnly.IsChecked == true);
+                    output.Text = string.Empty;
+                    errorLog.Text = string.Empty;
+                    collectTimer.Start();
+                }
+                else
+                {
+                    collector = null;
+                }
                 btLaunchKill.Content = "Collect";
             }
             else
@@ -90,24 +121,72 @@ namespace JitProfilerController
             }
         }
 
-        private void HandleKill()
+        private async void HandleKill()
         {
             ProfileControl.IsEnabled = false;
+            ApplyAdmission.IsEnabled = false;
+            EventJit.IsEnabled = false;
+            EventEnter3.IsEnabled = false;
+            statsTimer.Stop();
+            StatsTimer_Tick(this, EventArgs.Empty);
             ProfileControl.Content = "Start Profiling";
             btLaunchKill.Content = "Launch";
+            if (collector != null)
+            {
+                // Only what the last pass has not seen yet is left to collect
+                collectTimer.Stop();
+                await collectPass;
+                await RunCollectPass(true);
+                TargetExec.IsEnabled = true;
+                return;
+            }
             Collect(logFolder);
         }
 
+        private void CollectTimer_Tick(object sender, EventArgs e)
+        {
+            if (collectPass.IsCompleted)
+                collectPass = RunCollectPass(false);
+        }
+
+        private async Task RunCollectPass(bool processExited)
+        {
+            var pass = collector;
+            string erros = null;
+            var nodes = await Task.Run(() => pass.Collect(processExited, out erros));
+            if (nodes.Length > 0)
+                output.AppendText(string.Join("\r\n", nodes.Select(FormatNode)) + "\r\n");
+            if (!string.IsNullOrEmpty(erros))
+                errorLog.AppendText(erros + "\r\n");
+        }
+
         private void Collect(string folder)
         {
+            if (MetadataOnly.IsChecked == true)
+            {
+                CollectFromMetadata(folder);
+                return;
+            }
+
             var path = System.IO.Path.GetDirectoryName(TargetExec.Text);
-            var methods = JitProfilerLogParser.ParseProfilerLogs(
-               System.IO.Path.Combine(folder, "jit.json"),
-               System.IO.Path.Combine(folder, "modules.json"),
-               System.IO.Path.Combine(folder, "enter3.json"),
-               path,
-               out string erros
-               );
+            var tracePath = System.IO.Path.Combine(folder, BinaryTraceReader.DefaultFileName);
+            string erros;
+            MethodBase[] methods;
+            var jitPath = System.IO.Path.Combine(folder, "jit.json");
+            if (JitProfilerLogParser.IsBinaryRun(folder))
+            {
+                methods = JitProfilerLogParser.ParseProfilerTrace(tracePath, path, out erros);
+            }
+            else
+            {
+                methods = JitProfilerLogParser.ParseProfilerLogs(
+                   jitPath,
+                   System.IO.Path.Combine(folder, "modules.json"),
+                   System.IO.Path.Combine(folder, "enter3.json"),
+                   path,
+                   out erros
+                   );
+            }
             output.Text = string.Join("\r\n", methods.Select(x => x.ToPrettySignature()));
             errorLog.Text = erros;
             using (var tw = File.AppendText(System.IO.Path.Combine(folder, "jitManifest.json")))
@@ -127,6 +206,52 @@ namespace JitProfilerController
             TargetExec.IsEnabled = true;
         }
 
+        // Same manifest, resolved from PE metadata; nothing of the target is loaded into this process
+        private void CollectFromMetadata(string folder)
+        {
+            var path = System.IO.Path.GetDirectoryName(TargetExec.Text);
+            var tracePath = System.IO.Path.Combine(folder, BinaryTraceReader.DefaultFileName);
+            string erros;
+            MethodNode[] nodes;
+            var jitPath = System.IO.Path.Combine(folder, "jit.json");
+            if (JitProfilerLogParser.IsBinaryRun(folder))
+            {
+                nodes = JitProfilerLogParser.ParseProfilerTraceToManifest(tracePath, path, out erros);
+            }
+            else
+            {
+                nodes = JitProfilerLogParser.ParseProfilerLogsToManifest(
+                   jitPath,
+                   System.IO.Path.Combine(folder, "modules.json"),
+                   System.IO.Path.Combine(folder, "enter3.json"),
+                   path,
+                   out erros
+                   );
+            }
+            output.Text = string.Join("\r\n", nodes.Select(FormatNode));
+            errorLog.Text = erros;
+            var options = new JsonSerializerOptions { WriteIndented = true };
+            using (var tw = File.AppendText(System.IO.Path.Combine(folder, "jitManifest.json")))
+            {
+                tw.WriteLine("[");
+                bool started = false;
+                foreach (var node in nodes)
+                {
+                    if (started)
+                        tw.WriteLine(",");
+                    started = true;
+                    tw.WriteLine(JsonSerializer.Serialize(node, options));
+                }
+                tw.WriteLine("]");
+            }
+            TargetExec.IsEnabled = true;
+        }
+
+        private static string FormatNode(MethodNode node)
+        {
+            return $"{node.DeclaringType.Name}.{node.Name}({string.Join(", ", node.ParameterTypes.Select(p => p.Name))})";
+        }
+
         private void P_Exited(object sender, System.EventArgs e)
         {
             this.Dispatcher.Invoke(HandleKill);
@@ -146,5 +271,57 @@ namespace JitProfilerController
             }
         }
 
+        private void ApplyAdmission_Click(object sender, RoutedEventArgs e)
+        {
+            if (!int.TryParse(MaxRate.Text, out var maxRate) || maxRate < 0)
+            {
+                MessageBox.Show(this, "Max rate must be a number of functions per second, 0 for no cap.", Title);
+                return;
+            }
+
+            // Takes effect for functions the plugin has not seen yet.
+            ipcFlagMap.SetAdmission(SampleRules.Text, maxRate, 0, DeferResolution.IsChecked == true);
+        }
+
+        private void EventMask_Click(object sender, RoutedEventArgs e)
+        {
+            uint mask = 0;
+            if (EventJit.IsChecked == true)
+                mask |= IpcFlagMap.EventJit;
+            if (EventEnter3.IsChecked == true)
+                mask |= IpcFlagMap.EventEnter3;
+            ipcFlagMap.SetEventMask(mask);
+        }
+
+        // Shows the plugin's counters and their rates since the previous tick.
+        private void StatsTimer_Tick(object sender, EventArgs e)
+        {
+            var stats = ipcFlagMap.ReadStats();
+            var now = DateTime.UtcNow;
+            if (stats.AttachedProcessId == 0)
+            {
+                StatsText.Text = "Waiting for the plugin to attach";
+                return;
+            }
+
+            double seconds = lastStats == null ? 0 : (now - lastStatsTime).TotalSeconds;
+            string Rate(Func<JitProfilerStats, ulong> counter) =>
+                seconds > 0 ? $"{(counter(stats) - counter(lastStats)) / seconds:N0}/s" : "-";
+
+            double averageFlush = stats.FlushCount > 0 ? (double)stats.FlushTotalMicroseconds / stats.FlushCount : 0;
+            StatsText.Text =
+                $"JIT {stats.JitEvents:N0} ({Rate(x => x.JitEvents)})   Enter3 {stats.Enter3Records:N0} ({Rate(x => x.Enter3Records)})   " +
+                $"Modules {stats.ModuleRecords:N0}   Dedup {stats.DedupHits:N0} ({Rate(x => x.DedupHits)})\n" +
+                $"Sampled out {stats.SampledOut:N0}   Rate limited {stats.RateLimited:N0}   Deferred {stats.Deferred:N0}   " +
+                $"Filter generation {stats.AppliedFilterGeneration}\n" +
+                $"Buffered {stats.BytesBuffered:N0} B ({Rate(x => x.BytesBuffered)})   Written {stats.BytesWritten:N0} B   " +
+                $"Dropped {stats.DroppedRecords:N0}\n" +
+                $"Flushes {stats.FlushCount:N0}   avg {averageFlush:N0} us   max {stats.FlushMaxMicroseconds:N0} us   " +
+                $"last {stats.LastFlushMicroseconds:N0} us";
+
+            lastStats = stats;
+            lastStatsTime = now;
+        }
+
     }
 }
\ No newline at end of file
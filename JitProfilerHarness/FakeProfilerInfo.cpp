@@ -0,0 +1,372 @@
+#include "FakeProfilerInfo.h"
+
+FakeProfilerInfo::FakeProfilerInfo()
+    : refCount(1), mappingCount(0), eventMask(0),
+      enterHook(nullptr), mapper(nullptr), mapperData(nullptr)
+{
+    mapperLock.Initialize();
+}
+
+// WCHAR is UTF-16 on every platform; wchar_t is UTF-32 outside Windows.
+std::vector<WCHAR> FakeProfilerInfo::ToRuntimeString(const std::wstring& text)
+{
+    std::vector<WCHAR> result;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        uint32_t c = (uint32_t)text[i];
+        if (c > 0xFFFF)
+        {
+            c -= 0x10000;
+            result.push_back((WCHAR)(0xD800 + (c >> 10)));
+            result.push_back((WCHAR)(0xDC00 + (c & 0x3FF)));
+        }
+        else
+        {
+            result.push_back((WCHAR)c);
+        }
+    }
+    result.push_back(0);
+    return result;
+}
+
+ModuleID FakeProfilerInfo::AddModule(const std::wstring& path, const std::wstring& assemblyName)
+{
+    Module module;
+    module.path = ToRuntimeString(path);
+    module.assemblyName = ToRuntimeString(assemblyName);
+    modules.push_back(module);
+    return ModuleBase + (modules.size() - 1) * IdStride;
+}
+
+ClassID FakeProfilerInfo::AddClass(ModuleID moduleId, mdTypeDef typeDef, const std::vector<ClassID>& typeArgs)
+{
+    auto key = std::make_pair(std::make_pair(moduleId, typeDef), typeArgs);
+    auto found = classIndex.find(key);
+    if (found != classIndex.end())
+        return found->second;
+
+    Class added;
+    added.moduleId = moduleId;
+    added.typeDef = typeDef;
+    added.typeArgs = typeArgs;
+    classes.push_back(added);
+
+    ClassID classId = ClassBase + (classes.size() - 1) * IdStride;
+    classIndex.emplace(key, classId);
+    return classId;
+}
+
+FunctionID FakeProfilerInfo::AddFunction(ModuleID moduleId, mdMethodDef token,
+    ClassID declaringClass, const std::vector<ClassID>& methodTypeArgs,
+    ClassID canonicalClass, const std::vector<ClassID>& canonicalTypeArgs)
+{
+    Function function;
+    function.moduleId = moduleId;
+    function.token = token;
+    function.declaringClass = declaringClass;
+    function.methodTypeArgs = methodTypeArgs;
+    function.canonicalClass = canonicalClass;
+    function.canonicalTypeArgs = canonicalTypeArgs;
+    functions.push_back(function);
+    return FunctionBase + (functions.size() - 1) * IdStride;
+}
+
+const FakeProfilerInfo::Module* FakeProfilerInfo::FindModule(ModuleID moduleId) const
+{
+    size_t index = (moduleId - ModuleBase) / IdStride;
+    if (moduleId < ModuleBase || (moduleId - ModuleBase) % IdStride != 0 || index >= modules.size())
+        return nullptr;
+    return &modules[index];
+}
+
+const FakeProfilerInfo::Class* FakeProfilerInfo::FindClass(ClassID classId) const
+{
+    size_t index = (classId - ClassBase) / IdStride;
+    if (classId < ClassBase || (classId - ClassBase) % IdStride != 0 || index >= classes.size())
+        return nullptr;
+    return &classes[index];
+}
+
+const FakeProfilerInfo::Function* FakeProfilerInfo::FindFunction(FunctionID functionId) const
+{
+    size_t index = (functionId - FunctionBase) / IdStride;
+    if (functionId < FunctionBase || (functionId - FunctionBase) % IdStride != 0 || index >= functions.size())
+        return nullptr;
+    return &functions[index];
+}
+
+ULONG32 FakeProfilerInfo::GetDeclaringTypeArgCount(FunctionID functionId, bool canonical) const
+{
+    const Function* function = FindFunction(functionId);
+    if (function == nullptr)
+        return 0;
+
+    const Class* declaring = FindClass(canonical ? function->canonicalClass : function->declaringClass);
+    return declaring != nullptr ? (ULONG32)declaring->typeArgs.size() : 0;
+}
+
+ULONG32 FakeProfilerInfo::GetMethodTypeArgCount(FunctionID functionId, bool canonical) const
+{
+    const Function* function = FindFunction(functionId);
+    if (function == nullptr)
+        return 0;
+    return (ULONG32)(canonical ? function->canonicalTypeArgs : function->methodTypeArgs).size();
+}
+
+void FakeProfilerInfo::Reset()
+{
+    eventMask = 0;
+    enterHook = nullptr;
+    mapper = nullptr;
+    mapperData = nullptr;
+    mappings.reset();
+    mappingCount = 0;
+}
+
+void FakeProfilerInfo::MapOnFirstCall(FunctionID functionId, FunctionIDOrClientID& id, bool& hooked)
+{
+    size_t index = (functionId - FunctionBase) / IdStride;
+    if (index >= mappingCount)
+    {
+        hooked = true;
+        return;
+    }
+
+    Mapping& mapping = mappings[index];
+    uint8_t state = mapping.state.load(std::memory_order_acquire);
+    if (state == Unmapped || state == InProgress)
+    {
+        // The runtime maps each function once, whichever thread calls it first.
+        mapperLock.Enter();
+        state = mapping.state.load(std::memory_order_relaxed);
+        if (state == Unmapped)
+        {
+            mapping.state.store(InProgress, std::memory_order_relaxed);
+            BOOL hookFunction = TRUE;
+            mapping.clientId = mapper(functionId, mapperData, &hookFunction);
+            state = hookFunction ? Hooked : NotHooked;
+            mapping.state.store(state, std::memory_order_release);
+        }
+        mapperLock.Leave();
+    }
+
+    hooked = state == Hooked;
+    id.clientID = mapping.clientId;
+}
+
+void FakeProfilerInfo::Enter(FunctionID functionId)
+{
+    if ((eventMask & COR_PRF_MONITOR_ENTERLEAVE) == 0 || enterHook == nullptr)
+        return;
+
+    FunctionIDOrClientID id;
+    id.functionID = functionId;
+    if (mapper != nullptr)
+    {
+        bool hooked;
+        MapOnFirstCall(functionId, id, hooked);
+        if (!hooked)
+            return;
+    }
+
+    // The ELT handle doubles as the frame: it is the FunctionID, which
+    // GetFunctionInfo2 takes to mean the exact instantiation.
+    enterHook(id, (COR_PRF_ELT_INFO)functionId);
+}
+
+HRESULT FakeProfilerInfo::CopyRuntimeString(const std::vector<WCHAR>& text, ULONG cchName, ULONG* pcchName, WCHAR szName[])
+{
+    // Lengths include the terminator, as the runtime reports them.
+    ULONG length = (ULONG)text.size();
+    if (pcchName != nullptr)
+        *pcchName = length;
+
+    if (cchName > 0 && szName != nullptr)
+    {
+        ULONG count = cchName < length ? cchName : length;
+        for (ULONG i = 0; i < count; i++)
+            szName[i] = text[i];
+        szName[count - 1] = 0;
+    }
+    return S_OK;
+}
+
+HRESULT FakeProfilerInfo::CopyClassIds(const std::vector<ClassID>& ids, ULONG32 count, ULONG32* pCount, ClassID target[])
+{
+    if (pCount != nullptr)
+        *pCount = (ULONG32)ids.size();
+
+    if (count > 0 && target != nullptr)
+    {
+        for (ULONG32 i = 0; i < count && i < ids.size(); i++)
+            target[i] = ids[i];
+    }
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if (ppvObject == nullptr)
+        return E_INVALIDARG;
+
+    if (riid == __uuidof(ICorProfilerInfo3) ||
+        riid == __uuidof(ICorProfilerInfo2) ||
+        riid == __uuidof(ICorProfilerInfo) ||
+        riid == IID_IUnknown)
+    {
+        *ppvObject = this;
+        AddRef();
+        return S_OK;
+    }
+
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetEventMask(DWORD* pdwEvents)
+{
+    if (pdwEvents == nullptr)
+        return E_INVALIDARG;
+
+    *pdwEvents = eventMask;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::SetEventMask(DWORD dwEvents)
+{
+    eventMask = dwEvents;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::SetEnterLeaveFunctionHooks3WithInfo(
+    FunctionEnter3WithInfo* pFuncEnter3WithInfo,
+    FunctionLeave3WithInfo* pFuncLeave3WithInfo,
+    FunctionTailcall3WithInfo* pFuncTailcall3WithInfo)
+{
+    enterHook = pFuncEnter3WithInfo;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::SetFunctionIDMapper2(FunctionIDMapper2* pFunc, void* clientData)
+{
+    mapper = pFunc;
+    mapperData = clientData;
+    mappingCount = functions.size();
+    mappings.reset(new Mapping[mappingCount]);
+    for (size_t i = 0; i < mappingCount; i++)
+    {
+        mappings[i].state.store(Unmapped, std::memory_order_relaxed);
+        mappings[i].clientId = 0;
+    }
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetFunctionEnter3Info(
+    FunctionID functionId,
+    COR_PRF_ELT_INFO eltInfo,
+    COR_PRF_FRAME_INFO* pFrameInfo,
+    ULONG* pcbArgumentInfo,
+    COR_PRF_FUNCTION_ARGUMENT_INFO* pArgumentInfo)
+{
+    if (pFrameInfo == nullptr || FindFunction(functionId) == nullptr)
+        return E_INVALIDARG;
+
+    *pFrameInfo = (COR_PRF_FRAME_INFO)eltInfo;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetClassIDInfo(ClassID classId, ModuleID* pModuleId, mdTypeDef* pTypeDefToken)
+{
+    return GetClassIDInfo2(classId, pModuleId, pTypeDefToken, nullptr, 0, nullptr, nullptr);
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetClassIDInfo2(
+    ClassID classId,
+    ModuleID* pModuleId,
+    mdTypeDef* pTypeDefToken,
+    ClassID* pParentClassId,
+    ULONG32 cNumTypeArgs,
+    ULONG32* pcNumTypeArgs,
+    ClassID typeArgs[])
+{
+    const Class* found = FindClass(classId);
+    if (found == nullptr)
+        return E_INVALIDARG;
+
+    if (pModuleId != nullptr)
+        *pModuleId = found->moduleId;
+    if (pTypeDefToken != nullptr)
+        *pTypeDefToken = found->typeDef;
+    if (pParentClassId != nullptr)
+        *pParentClassId = 0;
+    return CopyClassIds(found->typeArgs, cNumTypeArgs, pcNumTypeArgs, typeArgs);
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetFunctionInfo(FunctionID functionId, ClassID* pClassId, ModuleID* pModuleId, mdToken* pToken)
+{
+    return GetFunctionInfo2(functionId, 0, pClassId, pModuleId, pToken, 0, nullptr, nullptr);
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetFunctionInfo2(
+    FunctionID funcId,
+    COR_PRF_FRAME_INFO frameInfo,
+    ClassID* pClassId,
+    ModuleID* pModuleId,
+    mdToken* pToken,
+    ULONG32 cTypeArgs,
+    ULONG32* pcTypeArgs,
+    ClassID typeArgs[])
+{
+    const Function* function = FindFunction(funcId);
+    if (function == nullptr)
+        return E_INVALIDARG;
+
+    // Without a frame, shared code only knows its canonical instantiation.
+    bool exact = frameInfo != 0;
+    if (pClassId != nullptr)
+        *pClassId = exact ? function->declaringClass : function->canonicalClass;
+    if (pModuleId != nullptr)
+        *pModuleId = function->moduleId;
+    if (pToken != nullptr)
+        *pToken = function->token;
+    return CopyClassIds(exact ? function->methodTypeArgs : function->canonicalTypeArgs, cTypeArgs, pcTypeArgs, typeArgs);
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetModuleInfo(
+    ModuleID moduleId,
+    LPCBYTE* ppBaseLoadAddress,
+    ULONG cchName,
+    ULONG* pcchName,
+    WCHAR szName[],
+    AssemblyID* pAssemblyId)
+{
+    const Module* module = FindModule(moduleId);
+    if (module == nullptr)
+        return E_INVALIDARG;
+
+    if (ppBaseLoadAddress != nullptr)
+        *ppBaseLoadAddress = nullptr;
+    // One assembly per module; the AssemblyID is the ModuleID.
+    if (pAssemblyId != nullptr)
+        *pAssemblyId = moduleId;
+    return CopyRuntimeString(module->path, cchName, pcchName, szName);
+}
+
+HRESULT STDMETHODCALLTYPE FakeProfilerInfo::GetAssemblyInfo(
+    AssemblyID assemblyId,
+    ULONG cchName,
+    ULONG* pcchName,
+    WCHAR szName[],
+    AppDomainID* pAppDomainId,
+    ModuleID* pModuleId)
+{
+    const Module* module = FindModule(assemblyId);
+    if (module == nullptr)
+        return E_INVALIDARG;
+
+    if (pAppDomainId != nullptr)
+        *pAppDomainId = 1;
+    if (pModuleId != nullptr)
+        *pModuleId = assemblyId;
+    return CopyRuntimeString(module->assemblyName, cchName, pcchName, szName);
+}
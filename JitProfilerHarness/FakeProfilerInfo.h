@@ -0,0 +1,198 @@
+#pragma once
+
+#include "Platform.h"
+#include <cor.h>
+#include <corprof.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A scripted stand-in for the runtime's ICorProfilerInfo3. Modules, classes and
+// functions are added up front; the harness then plays the runtime's part by
+// calling the profiler's JIT callbacks and entering functions through the
+// hooks and mapper the profiler registered.
+//
+// Only the methods the profiler uses are implemented; the rest return
+// E_NOTIMPL. Once the script is built, every query is read-only and can be
+// made from any number of threads.
+class FakeProfilerInfo : public ICorProfilerInfo3
+{
+public:
+    FakeProfilerInfo();
+
+    FakeProfilerInfo(const FakeProfilerInfo&) = delete;
+    FakeProfilerInfo& operator=(const FakeProfilerInfo&) = delete;
+
+    // Script
+    ModuleID AddModule(const std::wstring& path, const std::wstring& assemblyName);
+    // Classes are interned like the runtime's: adding the same instantiation
+    // twice returns the same ClassID.
+    ClassID AddClass(ModuleID moduleId, mdTypeDef typeDef, const std::vector<ClassID>& typeArgs);
+    // canonicalClass/canonicalTypeArgs are what GetFunctionInfo2 reports without
+    // a frame; pass the exact ones again for code that is not shared.
+    FunctionID AddFunction(ModuleID moduleId, mdMethodDef token,
+        ClassID declaringClass, const std::vector<ClassID>& methodTypeArgs,
+        ClassID canonicalClass, const std::vector<ClassID>& canonicalTypeArgs);
+
+    size_t GetModuleCount() const { return modules.size(); }
+    size_t GetClassCount() const { return classes.size(); }
+    size_t GetFunctionCount() const { return functions.size(); }
+
+    // Type arguments as reported with a frame (exact) or without (canonical).
+    ULONG32 GetDeclaringTypeArgCount(FunctionID functionId, bool canonical) const;
+    ULONG32 GetMethodTypeArgCount(FunctionID functionId, bool canonical) const;
+
+    // Runtime
+    // Calls the FunctionIDMapper2 on the first call, as the runtime does when it
+    // prepares the enter hook, then the Enter3 hook if one is set.
+    void Enter(FunctionID functionId);
+    DWORD GetEventMask() const { return eventMask; }
+    // Forgets the hooks and mappings before the next profiler is attached.
+    void Reset();
+
+    // IUnknown
+    STDMETHOD_(ULONG, AddRef)() { return ++refCount; }
+    // The harness owns the object, so the count never deletes it.
+    STDMETHOD_(ULONG, Release)() { return --refCount; }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+
+    // ICorProfilerInfo
+    STDMETHOD(GetClassFromObject)(ObjectID objectId, ClassID* pClassId) { return E_NOTIMPL; }
+    STDMETHOD(GetClassFromToken)(ModuleID moduleId, mdTypeDef typeDef, ClassID* pClassId) { return E_NOTIMPL; }
+    STDMETHOD(GetCodeInfo)(FunctionID functionId, LPCBYTE* pStart, ULONG* pcSize) { return E_NOTIMPL; }
+    STDMETHOD(GetEventMask)(DWORD* pdwEvents);
+    STDMETHOD(GetFunctionFromIP)(LPCBYTE ip, FunctionID* pFunctionId) { return E_NOTIMPL; }
+    STDMETHOD(GetFunctionFromToken)(ModuleID moduleId, mdToken token, FunctionID* pFunctionId) { return E_NOTIMPL; }
+    STDMETHOD(GetHandleFromThread)(ThreadID threadId, HANDLE* phThread) { return E_NOTIMPL; }
+    STDMETHOD(GetObjectSize)(ObjectID objectId, ULONG* pcSize) { return E_NOTIMPL; }
+    STDMETHOD(IsArrayClass)(ClassID classId, CorElementType* pBaseElemType, ClassID* pBaseClassId, ULONG* pcRank) { return E_NOTIMPL; }
+    STDMETHOD(GetThreadInfo)(ThreadID threadId, DWORD* pdwWin32ThreadId) { return E_NOTIMPL; }
+    STDMETHOD(GetCurrentThreadID)(ThreadID* pThreadId) { return E_NOTIMPL; }
+    STDMETHOD(GetClassIDInfo)(ClassID classId, ModuleID* pModuleId, mdTypeDef* pTypeDefToken);
+    STDMETHOD(GetFunctionInfo)(FunctionID functionId, ClassID* pClassId, ModuleID* pModuleId, mdToken* pToken);
+    STDMETHOD(SetEventMask)(DWORD dwEvents);
+    STDMETHOD(SetEnterLeaveFunctionHooks)(FunctionEnter* pFuncEnter, FunctionLeave* pFuncLeave, FunctionTailcall* pFuncTailcall) { return E_NOTIMPL; }
+    STDMETHOD(SetFunctionIDMapper)(FunctionIDMapper* pFunc) { return E_NOTIMPL; }
+    STDMETHOD(GetTokenAndMetaDataFromFunction)(FunctionID functionId, REFIID riid, IUnknown** ppImport, mdToken* pToken) { return E_NOTIMPL; }
+    STDMETHOD(GetModuleInfo)(ModuleID moduleId, LPCBYTE* ppBaseLoadAddress, ULONG cchName, ULONG* pcchName, WCHAR szName[], AssemblyID* pAssemblyId);
+    STDMETHOD(GetModuleMetaData)(ModuleID moduleId, DWORD dwOpenFlags, REFIID riid, IUnknown** ppOut) { return E_NOTIMPL; }
+    STDMETHOD(GetILFunctionBody)(ModuleID moduleId, mdMethodDef methodId, LPCBYTE* ppMethodHeader, ULONG* pcbMethodSize) { return E_NOTIMPL; }
+    STDMETHOD(GetILFunctionBodyAllocator)(ModuleID moduleId, IMethodMalloc** ppMalloc) { return E_NOTIMPL; }
+    STDMETHOD(SetILFunctionBody)(ModuleID moduleId, mdMethodDef methodId, LPCBYTE pbNewILMethodHeader) { return E_NOTIMPL; }
+    STDMETHOD(GetAppDomainInfo)(AppDomainID appDomainId, ULONG cchName, ULONG* pcchName, WCHAR szName[], ProcessID* pProcessId) { return E_NOTIMPL; }
+    STDMETHOD(GetAssemblyInfo)(AssemblyID assemblyId, ULONG cchName, ULONG* pcchName, WCHAR szName[], AppDomainID* pAppDomainId, ModuleID* pModuleId);
+    STDMETHOD(SetFunctionReJIT)(FunctionID functionId) { return E_NOTIMPL; }
+    STDMETHOD(ForceGC)() { return E_NOTIMPL; }
+    STDMETHOD(SetILInstrumentedCodeMap)(FunctionID functionId, BOOL fStartJit, ULONG cILMapEntries, COR_IL_MAP rgILMapEntries[]) { return E_NOTIMPL; }
+    STDMETHOD(GetInprocInspectionInterface)(IUnknown** ppicd) { return E_NOTIMPL; }
+    STDMETHOD(GetInprocInspectionIThisThread)(IUnknown** ppicd) { return E_NOTIMPL; }
+    STDMETHOD(GetThreadContext)(ThreadID threadId, ContextID* pContextId) { return E_NOTIMPL; }
+    STDMETHOD(BeginInprocDebugging)(BOOL fThisThreadOnly, DWORD* pdwProfilerContext) { return E_NOTIMPL; }
+    STDMETHOD(EndInprocDebugging)(DWORD dwProfilerContext) { return E_NOTIMPL; }
+    STDMETHOD(GetILToNativeMapping)(FunctionID functionId, ULONG32 cMap, ULONG32* pcMap, COR_DEBUG_IL_TO_NATIVE_MAP map[]) { return E_NOTIMPL; }
+
+    // ICorProfilerInfo2
+    STDMETHOD(DoStackSnapshot)(ThreadID thread, StackSnapshotCallback* callback, ULONG32 infoFlags, void* clientData, BYTE context[], ULONG32 contextSize) { return E_NOTIMPL; }
+    STDMETHOD(SetEnterLeaveFunctionHooks2)(FunctionEnter2* pFuncEnter, FunctionLeave2* pFuncLeave, FunctionTailcall2* pFuncTailcall) { return E_NOTIMPL; }
+    STDMETHOD(GetFunctionInfo2)(FunctionID funcId, COR_PRF_FRAME_INFO frameInfo, ClassID* pClassId, ModuleID* pModuleId, mdToken* pToken, ULONG32 cTypeArgs, ULONG32* pcTypeArgs, ClassID typeArgs[]);
+    STDMETHOD(GetStringLayout)(ULONG* pBufferLengthOffset, ULONG* pStringLengthOffset, ULONG* pBufferOffset) { return E_NOTIMPL; }
+    STDMETHOD(GetClassLayout)(ClassID classID, COR_FIELD_OFFSET rFieldOffset[], ULONG cFieldOffset, ULONG* pcFieldOffset, ULONG* pulClassSize) { return E_NOTIMPL; }
+    STDMETHOD(GetClassIDInfo2)(ClassID classId, ModuleID* pModuleId, mdTypeDef* pTypeDefToken, ClassID* pParentClassId, ULONG32 cNumTypeArgs, ULONG32* pcNumTypeArgs, ClassID typeArgs[]);
+    STDMETHOD(GetCodeInfo2)(FunctionID functionID, ULONG32 cCodeInfos, ULONG32* pcCodeInfos, COR_PRF_CODE_INFO codeInfos[]) { return E_NOTIMPL; }
+    STDMETHOD(GetClassFromTokenAndTypeArgs)(ModuleID moduleID, mdTypeDef typeDef, ULONG32 cTypeArgs, ClassID typeArgs[], ClassID* pClassID) { return E_NOTIMPL; }
+    STDMETHOD(GetFunctionFromTokenAndTypeArgs)(ModuleID moduleID, mdMethodDef funcDef, ClassID classId, ULONG32 cTypeArgs, ClassID typeArgs[], FunctionID* pFunctionID) { return E_NOTIMPL; }
+    STDMETHOD(EnumModuleFrozenObjects)(ModuleID moduleID, ICorProfilerObjectEnum** ppEnum) { return E_NOTIMPL; }
+    STDMETHOD(GetArrayObjectInfo)(ObjectID objectId, ULONG32 cDimensions, ULONG32 pDimensionSizes[], int pDimensionLowerBounds[], BYTE** ppData) { return E_NOTIMPL; }
+    STDMETHOD(GetBoxClassLayout)(ClassID classId, ULONG32* pBufferOffset) { return E_NOTIMPL; }
+    STDMETHOD(GetThreadAppDomain)(ThreadID threadId, AppDomainID* pAppDomainId) { return E_NOTIMPL; }
+    STDMETHOD(GetRVAStaticAddress)(ClassID classId, mdFieldDef fieldToken, void** ppAddress) { return E_NOTIMPL; }
+    STDMETHOD(GetAppDomainStaticAddress)(ClassID classId, mdFieldDef fieldToken, AppDomainID appDomainId, void** ppAddress) { return E_NOTIMPL; }
+    STDMETHOD(GetThreadStaticAddress)(ClassID classId, mdFieldDef fieldToken, ThreadID threadId, void** ppAddress) { return E_NOTIMPL; }
+    STDMETHOD(GetContextStaticAddress)(ClassID classId, mdFieldDef fieldToken, ContextID contextId, void** ppAddress) { return E_NOTIMPL; }
+    STDMETHOD(GetStaticFieldInfo)(ClassID classId, mdFieldDef fieldToken, COR_PRF_STATIC_TYPE* pFieldInfo) { return E_NOTIMPL; }
+    STDMETHOD(GetGenerationBounds)(ULONG cObjectRanges, ULONG* pcObjectRanges, COR_PRF_GC_GENERATION_RANGE ranges[]) { return E_NOTIMPL; }
+    STDMETHOD(GetObjectGeneration)(ObjectID objectId, COR_PRF_GC_GENERATION_RANGE* range) { return E_NOTIMPL; }
+    STDMETHOD(GetNotifiedExceptionClauseInfo)(COR_PRF_EX_CLAUSE_INFO* pinfo) { return E_NOTIMPL; }
+
+    // ICorProfilerInfo3
+    STDMETHOD(EnumJITedFunctions)(ICorProfilerFunctionEnum** ppEnum) { return E_NOTIMPL; }
+    STDMETHOD(RequestProfilerDetach)(DWORD dwExpectedCompletionMilliseconds) { return E_NOTIMPL; }
+    STDMETHOD(SetFunctionIDMapper2)(FunctionIDMapper2* pFunc, void* clientData);
+    STDMETHOD(GetStringLayout2)(ULONG* pStringLengthOffset, ULONG* pBufferOffset) { return E_NOTIMPL; }
+    STDMETHOD(SetEnterLeaveFunctionHooks3)(FunctionEnter3* pFuncEnter3, FunctionLeave3* pFuncLeave3, FunctionTailcall3* pFuncTailcall3) { return E_NOTIMPL; }
+    STDMETHOD(SetEnterLeaveFunctionHooks3WithInfo)(FunctionEnter3WithInfo* pFuncEnter3WithInfo, FunctionLeave3WithInfo* pFuncLeave3WithInfo, FunctionTailcall3WithInfo* pFuncTailcall3WithInfo);
+    STDMETHOD(GetFunctionEnter3Info)(FunctionID functionId, COR_PRF_ELT_INFO eltInfo, COR_PRF_FRAME_INFO* pFrameInfo, ULONG* pcbArgumentInfo, COR_PRF_FUNCTION_ARGUMENT_INFO* pArgumentInfo);
+    STDMETHOD(GetFunctionLeave3Info)(FunctionID functionId, COR_PRF_ELT_INFO eltInfo, COR_PRF_FRAME_INFO* pFrameInfo, COR_PRF_FUNCTION_ARGUMENT_RANGE* pRetvalRange) { return E_NOTIMPL; }
+    STDMETHOD(GetFunctionTailcall3Info)(FunctionID functionId, COR_PRF_ELT_INFO eltInfo, COR_PRF_FRAME_INFO* pFrameInfo) { return E_NOTIMPL; }
+    STDMETHOD(EnumModules)(ICorProfilerModuleEnum** ppEnum) { return E_NOTIMPL; }
+    STDMETHOD(GetRuntimeInformation)(USHORT* pClrInstanceId, COR_PRF_RUNTIME_TYPE* pRuntimeType, USHORT* pMajorVersion, USHORT* pMinorVersion, USHORT* pBuildNumber, USHORT* pQFEVersion, ULONG cchVersionString, ULONG* pcchVersionString, WCHAR szVersionString[]) { return E_NOTIMPL; }
+    STDMETHOD(GetThreadStaticAddress2)(ClassID classId, mdFieldDef fieldToken, AppDomainID appDomainId, ThreadID threadId, void** ppAddress) { return E_NOTIMPL; }
+    STDMETHOD(GetAppDomainsContainingModule)(ModuleID moduleId, ULONG32 cAppDomainIds, ULONG32* pcAppDomainIds, AppDomainID appDomainIds[]) { return E_NOTIMPL; }
+    STDMETHOD(GetModuleInfo2)(ModuleID moduleId, LPCBYTE* ppBaseLoadAddress, ULONG cchName, ULONG* pcchName, WCHAR szName[], AssemblyID* pAssemblyId, DWORD* pdwModuleFlags) { return E_NOTIMPL; }
+
+private:
+    struct Module
+    {
+        std::vector<WCHAR> path;
+        std::vector<WCHAR> assemblyName;
+    };
+
+    struct Class
+    {
+        ModuleID moduleId;
+        mdTypeDef typeDef;
+        std::vector<ClassID> typeArgs;
+    };
+
+    struct Function
+    {
+        ModuleID moduleId;
+        mdMethodDef token;
+        ClassID declaringClass;
+        std::vector<ClassID> methodTypeArgs;
+        ClassID canonicalClass;
+        std::vector<ClassID> canonicalTypeArgs;
+    };
+
+    // What the mapper returned for a function: 0 until the first call.
+    enum MappingState : uint8_t { Unmapped = 0, InProgress, Hooked, NotHooked };
+
+    struct Mapping
+    {
+        std::atomic<uint8_t> state;
+        UINT_PTR clientId;
+    };
+
+    // IDs are distinct, aligned and never zero, like the runtime's pointers.
+    static const UINT_PTR ModuleBase = 0x10000000;
+    static const UINT_PTR ClassBase = 0x20000000;
+    static const UINT_PTR FunctionBase = 0x40000000;
+    static const UINT_PTR IdStride = 16;
+
+    const Module* FindModule(ModuleID moduleId) const;
+    const Class* FindClass(ClassID classId) const;
+    const Function* FindFunction(FunctionID functionId) const;
+    void MapOnFirstCall(FunctionID functionId, FunctionIDOrClientID& id, bool& hooked);
+
+    static std::vector<WCHAR> ToRuntimeString(const std::wstring& text);
+    static HRESULT CopyRuntimeString(const std::vector<WCHAR>& text, ULONG cchName, ULONG* pcchName, WCHAR szName[]);
+    static HRESULT CopyClassIds(const std::vector<ClassID>& ids, ULONG32 count, ULONG32* pCount, ClassID target[]);
+
+    std::atomic<long> refCount;
+    std::vector<Module> modules;
+    std::vector<Class> classes;
+    std::vector<Function> functions;
+    std::map<std::pair<std::pair<ModuleID, mdTypeDef>, std::vector<ClassID>>, ClassID> classIndex;
+    // Allocated when the mapper is set, once the script is complete.
+    std::unique_ptr<Mapping[]> mappings;
+    size_t mappingCount;
+
+    DWORD eventMask;
+    FunctionEnter3WithInfo* enterHook;
+    FunctionIDMapper2* mapper;
+    void* mapperData;
+    Platform::Mutex mapperLock;
+};
@@ -0,0 +1,686 @@
+#include "FakeProfilerInfo.h"
+#include "SyntheticGraph.h"
+#include "JitProfilerPlugin.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Drives the profiler through a synthetic program without a runtime: every
+// capture mode, output format and sink, with one and several threads, then checks
+// that each function was written exactly once with the type arguments the
+// fake reported. Further scenarios turn on JIT timing, inlining, thread tags
+// and call counts and check their records too.
+//
+// Usage: JitProfilerHarness [--functions N] [--calls N] [--depth N] [--threads N] [--seed N]
+
+namespace
+{
+    struct Scenario
+    {
+        const char* captureMode;
+        const char* format;
+        const char* sink;
+        unsigned threads;
+        // SIG_JIT_PROFILER_JIT_TIMING, _INLINING, _THREADS and _CALL_COUNTS
+        bool features;
+    };
+
+    struct Settings
+    {
+        SyntheticGraphOptions graph;
+        unsigned calls = 3;
+        unsigned maxThreads = 4;
+    };
+
+    void SetSetting(const char* name, const std::string& value)
+    {
+#ifdef _WIN32
+        _putenv_s(name, value.c_str());
+#else
+        setenv(name, value.c_str(), 1);
+#endif
+    }
+
+    std::vector<std::string> ReadLines(const std::filesystem::path& path)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty())
+                lines.push_back(line);
+        }
+        return lines;
+    }
+
+    bool ReadNumber(const std::string& line, const char* name, uint64_t& value)
+    {
+        std::string key = std::string("\"") + name + "\":";
+        size_t position = line.find(key);
+        if (position == std::string::npos)
+            return false;
+
+        value = strtoull(line.c_str() + position + key.size(), nullptr, 10);
+        return true;
+    }
+
+    std::string ReadEvent(const std::string& line)
+    {
+        static const char key[] = "\"Event\":\"";
+        size_t position = line.find(key);
+        if (position == std::string::npos)
+            return std::string();
+
+        position += sizeof(key) - 1;
+        return line.substr(position, line.find('"', position) - position);
+    }
+
+    struct Enter3Record
+    {
+        uint64_t functionId;
+        uint64_t declaringTypeArgCount;
+        uint64_t methodTypeArgCount;
+    };
+
+    // What a run wrote, whichever the format.
+    struct TraceRecords
+    {
+        std::vector<uint64_t> jit;
+        std::vector<Enter3Record> enter3;
+        std::vector<uint64_t> modules;
+        std::vector<uint64_t> jitFinished;
+        std::vector<std::pair<uint64_t, uint64_t>> inlinings;
+        std::vector<std::pair<uint64_t, uint64_t>> callCounts;
+        std::vector<uint64_t> threads;
+        // ThreadIndex and Sequence of each tagged JIT and Enter3 record.
+        std::vector<std::pair<uint64_t, uint64_t>> tags;
+        size_t untagged = 0;
+    };
+
+    void ReadTag(const std::string& line, TraceRecords& records)
+    {
+        uint64_t thread = 0;
+        uint64_t sequence = 0;
+        if (ReadNumber(line, "Thread", thread) && ReadNumber(line, "Seq", sequence))
+            records.tags.emplace_back(thread, sequence);
+        else
+            records.untagged++;
+    }
+
+    bool ReadJsonRecords(const std::filesystem::path& directory, TraceRecords& records)
+    {
+        for (const std::string& line : ReadLines(directory / "jit.json"))
+        {
+            std::string event = ReadEvent(line);
+            uint64_t functionId = 0;
+            uint64_t value = 0;
+            ReadNumber(line, "FunctionID", functionId);
+            if (event.empty())
+            {
+                records.jit.push_back(functionId);
+                ReadTag(line, records);
+            }
+            else if (event == "JitFinished")
+            {
+                records.jitFinished.push_back(functionId);
+            }
+            else if (event == "Inlined" && ReadNumber(line, "Callee", value))
+            {
+                records.inlinings.emplace_back(functionId, value);
+            }
+            else if (event == "CallCount" && ReadNumber(line, "Count", value))
+            {
+                records.callCounts.emplace_back(functionId, value);
+            }
+            else if (event == "Thread" && ReadNumber(line, "Thread", value))
+            {
+                records.threads.push_back(value);
+            }
+            else
+            {
+                printf("  jit.json: unexpected record %s\n", line.c_str());
+                return false;
+            }
+        }
+
+        for (const std::string& line : ReadLines(directory / "enter3.json"))
+        {
+            Enter3Record record = {};
+            if (!ReadNumber(line, "FunctionID", record.functionId))
+            {
+                printf("  enter3.json: unexpected record %s\n", line.c_str());
+                return false;
+            }
+            ReadNumber(line, "DeclaringTypeArgCount", record.declaringTypeArgCount);
+            ReadNumber(line, "MethodTypeArgCount", record.methodTypeArgCount);
+            records.enter3.push_back(record);
+            ReadTag(line, records);
+        }
+
+        for (const std::string& line : ReadLines(directory / "modules.json"))
+        {
+            uint64_t moduleId;
+            if (!ReadNumber(line, "ModuleID", moduleId) || !ReadEvent(line).empty())
+            {
+                printf("  modules.json: unexpected record %s\n", line.c_str());
+                return false;
+            }
+            records.modules.push_back(moduleId);
+        }
+        return true;
+    }
+
+    // Reads the payload of one binary record; any read past its end fails it.
+    class PayloadReader
+    {
+    public:
+        PayloadReader(const uint8_t* data, size_t length) : data(data), length(length), position(0), failed(false) {}
+
+        uint64_t ReadVarint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (position == length)
+                    break;
+
+                uint8_t byte = data[position++];
+                value |= (uint64_t)(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                    return value;
+            }
+            failed = true;
+            return 0;
+        }
+
+        void SkipString()
+        {
+            uint64_t byteCount = ReadVarint();
+            if (byteCount > length - position)
+                failed = true;
+            else
+                position += (size_t)byteCount;
+        }
+
+        void SkipTypeArg()
+        {
+            ReadVarint();
+            ReadVarint();
+            uint64_t nested = ReadVarint();
+            if ((nested & 1) == 0)
+            {
+                for (uint64_t i = 0; i < nested >> 1 && !failed; i++)
+                    SkipTypeArg();
+            }
+        }
+
+        void SkipTypeArgs(uint64_t count)
+        {
+            for (uint64_t i = 0; i < count && !failed; i++)
+                SkipTypeArg();
+        }
+
+        bool AtEnd() const { return position == length; }
+        bool Failed() const { return failed; }
+
+    private:
+        const uint8_t* data;
+        size_t length;
+        size_t position;
+        bool failed;
+    };
+
+    void ReadTag(PayloadReader& reader, TraceRecords& records)
+    {
+        if (reader.AtEnd())
+        {
+            records.untagged++;
+            return;
+        }
+
+        uint64_t thread = reader.ReadVarint();
+        uint64_t sequence = reader.ReadVarint();
+        reader.ReadVarint();
+        records.tags.emplace_back(thread, sequence);
+    }
+
+    // Decodes trace.bin by the TraceFormat layout. Every record must be complete
+    // and, for the types read here, hold exactly the fields the format lists.
+    bool ReadBinaryRecords(const std::filesystem::path& directory, TraceRecords& records)
+    {
+        std::ifstream file(directory / "trace.bin", std::ios::binary);
+        std::vector<uint8_t> trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        TraceFormat::FileHeader header;
+        if (trace.size() < sizeof(header))
+        {
+            printf("  trace.bin: no file header\n");
+            return false;
+        }
+        memcpy(&header, trace.data(), sizeof(header));
+        if (memcmp(header.magic, TraceFormat::Magic, sizeof(header.magic)) != 0 ||
+            header.version != TraceFormat::Version || header.headerSize < sizeof(header))
+        {
+            printf("  trace.bin: bad file header\n");
+            return false;
+        }
+
+        size_t offset = header.headerSize;
+        while (offset < trace.size())
+        {
+            TraceFormat::RecordHeader recordHeader;
+            if (trace.size() - offset < sizeof(recordHeader))
+            {
+                printf("  trace.bin: partial record header at %zu\n", offset);
+                return false;
+            }
+            memcpy(&recordHeader, trace.data() + offset, sizeof(recordHeader));
+            offset += sizeof(recordHeader);
+            if (recordHeader.type == 0 || trace.size() - offset < recordHeader.length)
+            {
+                printf("  trace.bin: unwritten or truncated record at %zu\n", offset - sizeof(recordHeader));
+                return false;
+            }
+
+            PayloadReader reader(trace.data() + offset, recordHeader.length);
+            offset += recordHeader.length;
+            switch (recordHeader.type)
+            {
+            case TraceFormat::RecordModule:
+                records.modules.push_back(reader.ReadVarint());
+                reader.ReadVarint();
+                reader.SkipString();
+                reader.SkipString();
+                reader.ReadVarint();
+                break;
+            case TraceFormat::RecordJit:
+                records.jit.push_back(reader.ReadVarint());
+                ReadTag(reader, records);
+                break;
+            case TraceFormat::RecordEnter3:
+            {
+                Enter3Record record = {};
+                record.functionId = reader.ReadVarint();
+                for (int i = 0; i < 4; i++)
+                    reader.ReadVarint();
+                record.declaringTypeArgCount = reader.ReadVarint();
+                reader.SkipTypeArgs(record.declaringTypeArgCount);
+                record.methodTypeArgCount = reader.ReadVarint();
+                reader.SkipTypeArgs(record.methodTypeArgCount);
+                records.enter3.push_back(record);
+                ReadTag(reader, records);
+                break;
+            }
+            case TraceFormat::RecordJitFinished:
+                records.jitFinished.push_back(reader.ReadVarint());
+                for (int i = 0; i < 4; i++)
+                    reader.ReadVarint();
+                break;
+            case TraceFormat::RecordInlining:
+            {
+                uint64_t caller = reader.ReadVarint();
+                records.inlinings.emplace_back(caller, reader.ReadVarint());
+                reader.ReadVarint();
+                reader.ReadVarint();
+                break;
+            }
+            case TraceFormat::RecordThread:
+                records.threads.push_back(reader.ReadVarint());
+                reader.ReadVarint();
+                reader.ReadVarint();
+                break;
+            case TraceFormat::RecordCallCount:
+            {
+                uint64_t functionId = reader.ReadVarint();
+                records.callCounts.emplace_back(functionId, reader.ReadVarint());
+                break;
+            }
+            default:
+                printf("  trace.bin: unexpected record type %u\n", (unsigned)recordHeader.type);
+                return false;
+            }
+
+            if (reader.Failed() || !reader.AtEnd())
+            {
+                printf("  trace.bin: record of type %u does not match its length\n", (unsigned)recordHeader.type);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Each record must name a distinct function that the graph contains, and
+    // every function in the graph must have one.
+    bool CheckFunctionIds(const std::vector<uint64_t>& functionIds, const char* kind, const std::unordered_set<uint64_t>& expected)
+    {
+        std::unordered_set<uint64_t> seen;
+        for (uint64_t functionId : functionIds)
+        {
+            if (expected.count(functionId) == 0)
+            {
+                printf("  %s: unexpected FunctionID %llu\n", kind, (unsigned long long)functionId);
+                return false;
+            }
+            if (!seen.insert(functionId).second)
+            {
+                printf("  %s: FunctionID %llu written twice\n", kind, (unsigned long long)functionId);
+                return false;
+            }
+        }
+
+        if (seen.size() != expected.size())
+        {
+            printf("  %s: %zu of %zu functions written\n", kind, seen.size(), expected.size());
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckTypeArgCounts(const std::vector<Enter3Record>& records, const FakeProfilerInfo& info, bool canonical)
+    {
+        for (const Enter3Record& record : records)
+        {
+            if (record.declaringTypeArgCount != info.GetDeclaringTypeArgCount((FunctionID)record.functionId, canonical) ||
+                record.methodTypeArgCount != info.GetMethodTypeArgCount((FunctionID)record.functionId, canonical))
+            {
+                printf("  Enter3: wrong type argument counts for FunctionID %llu\n", (unsigned long long)record.functionId);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // RunProgram reports each function inlining the next one, twice; each
+    // thread calls every function the same number of times; every JIT and
+    // Enter3 record is tagged with a thread that has a Thread record.
+    bool CheckFeatureRecords(const TraceRecords& records, const std::vector<FunctionID>& functions,
+        const std::unordered_set<uint64_t>& expected, uint64_t callsPerFunction)
+    {
+        if (!CheckFunctionIds(records.jitFinished, "JitFinished", expected))
+            return false;
+
+        std::set<std::pair<uint64_t, uint64_t>> edges(records.inlinings.begin(), records.inlinings.end());
+        if (edges.size() != records.inlinings.size() || edges.size() != functions.size())
+        {
+            printf("  Inlining: %zu records, %zu distinct, for %zu edges\n", records.inlinings.size(), edges.size(), functions.size());
+            return false;
+        }
+        for (size_t i = 0; i < functions.size(); i++)
+        {
+            if (edges.count({ functions[i], functions[(i + 1) % functions.size()] }) == 0)
+            {
+                printf("  Inlining: edge from FunctionID %llu missing\n", (unsigned long long)functions[i]);
+                return false;
+            }
+        }
+
+        // A function's records add up to its calls.
+        std::map<uint64_t, uint64_t> calls;
+        for (const auto& callCount : records.callCounts)
+            calls[callCount.first] += callCount.second;
+
+        std::vector<uint64_t> counted;
+        for (const auto& entry : calls)
+        {
+            if (entry.second != callsPerFunction)
+            {
+                printf("  CallCount: FunctionID %llu called %llu times, expected %llu\n",
+                    (unsigned long long)entry.first, (unsigned long long)entry.second, (unsigned long long)callsPerFunction);
+                return false;
+            }
+            counted.push_back(entry.first);
+        }
+        if (!CheckFunctionIds(counted, "CallCount", expected))
+            return false;
+
+        std::unordered_set<uint64_t> threads(records.threads.begin(), records.threads.end());
+        if (threads.empty() || threads.size() != records.threads.size())
+        {
+            printf("  Thread: %zu records, %zu distinct\n", records.threads.size(), threads.size());
+            return false;
+        }
+        if (records.untagged != 0)
+        {
+            printf("  Thread: %zu JIT and Enter3 records without a tag\n", records.untagged);
+            return false;
+        }
+        std::set<std::pair<uint64_t, uint64_t>> tags;
+        for (const auto& tag : records.tags)
+        {
+            if (threads.count(tag.first) == 0 || !tags.insert(tag).second)
+            {
+                printf("  Thread: tag %llu/%llu has no Thread record or is repeated\n",
+                    (unsigned long long)tag.first, (unsigned long long)tag.second);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CheckOutput(const std::filesystem::path& directory, const Scenario& scenario, const Settings& settings,
+        const FakeProfilerInfo& info, const std::vector<FunctionID>& functions)
+    {
+        TraceRecords records;
+        bool read = strcmp(scenario.format, "binary") == 0
+            ? ReadBinaryRecords(directory, records)
+            : ReadJsonRecords(directory, records);
+        if (!read)
+            return false;
+
+        std::unordered_set<uint64_t> expected(functions.begin(), functions.end());
+        if (!CheckFunctionIds(records.jit, "JIT", expected))
+            return false;
+
+        std::vector<uint64_t> captured;
+        for (const Enter3Record& record : records.enter3)
+            captured.push_back(record.functionId);
+        if (!CheckFunctionIds(captured, "Enter3", expected))
+            return false;
+
+        // Only JIT capture lacks the frames that reveal exact instantiations.
+        bool canonical = strcmp(scenario.captureMode, "jit") == 0;
+        if (!CheckTypeArgCounts(records.enter3, info, canonical))
+            return false;
+
+        std::unordered_set<uint64_t> modules(records.modules.begin(), records.modules.end());
+        if (modules.size() != records.modules.size() || modules.empty() || modules.size() > info.GetModuleCount())
+        {
+            printf("  Module: %zu records, %zu distinct, for %zu in the graph\n",
+                records.modules.size(), modules.size(), info.GetModuleCount());
+            return false;
+        }
+
+        if (scenario.features)
+            return CheckFeatureRecords(records, functions, expected, (uint64_t)settings.calls * scenario.threads);
+
+        if (!records.jitFinished.empty() || !records.inlinings.empty() || !records.callCounts.empty() ||
+            !records.threads.empty() || !records.tags.empty())
+        {
+            printf("  records of a feature that is off\n");
+            return false;
+        }
+        return true;
+    }
+
+    // JITs each function once, spread over the threads, then has every thread
+    // call every function 'calls' times in its own order. Returns the seconds
+    // spent calling. With 'features' each compilation also finishes and
+    // reports inlining the next function, twice as the JIT may.
+    double RunProgram(JitProfilerPlugin* plugin, FakeProfilerInfo& info,
+        const std::vector<FunctionID>& functions, unsigned threadCount, unsigned calls, uint32_t seed, bool features)
+    {
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (size_t i = t; i < functions.size(); i += threadCount)
+                {
+                    plugin->JITCompilationStarted(functions[i], TRUE);
+                    if (!features)
+                        continue;
+
+                    BOOL shouldInline = TRUE;
+                    FunctionID callee = functions[(i + 1) % functions.size()];
+                    plugin->JITInlining(functions[i], callee, &shouldInline);
+                    plugin->JITInlining(functions[i], callee, &shouldInline);
+                    plugin->JITCompilationFinished(functions[i], S_OK, TRUE);
+                }
+                // What DLL_THREAD_DETACH does for the runtime's threads.
+                ProfilerLogger::ReleaseThreadBuffer();
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        threads.clear();
+
+        std::vector<std::vector<FunctionID>> orders(threadCount, functions);
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            std::mt19937 random(seed + t);
+            std::shuffle(orders[t].begin(), orders[t].end(), random);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (unsigned call = 0; call < calls; call++)
+                {
+                    for (FunctionID functionId : orders[t])
+                        info.Enter(functionId);
+                }
+                ProfilerLogger::ReleaseThreadBuffer();
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool RunScenario(const Scenario& scenario, const Settings& settings, FakeProfilerInfo& info,
+        const std::vector<FunctionID>& functions, const std::filesystem::path& root)
+    {
+        std::filesystem::path directory = root /
+            (std::string(scenario.captureMode) + "-" + scenario.format + "-" + scenario.sink + "-" + std::to_string(scenario.threads) +
+            (scenario.features ? "-features" : ""));
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        SetSetting("SIG_JIT_PROFILER_LOG_PATH", directory.string());
+        SetSetting("SIG_JIT_PROFILER_CAPTURE_MODE", scenario.captureMode);
+        SetSetting("SIG_JIT_PROFILER_FORMAT", scenario.format);
+        SetSetting("SIG_JIT_PROFILER_SINK", scenario.sink);
+        const char* features = scenario.features ? "1" : "0";
+        SetSetting("SIG_JIT_PROFILER_JIT_TIMING", features);
+        SetSetting("SIG_JIT_PROFILER_INLINING", features);
+        SetSetting("SIG_JIT_PROFILER_THREADS", features);
+        SetSetting("SIG_JIT_PROFILER_CALL_COUNTS", features);
+
+        info.Reset();
+        ProfilerLogger::Initialize();
+        JitProfilerPlugin::InitializeMaxRecurseDepth();
+
+        JitProfilerPlugin* plugin = new JitProfilerPlugin();
+        if (FAILED(plugin->Initialize(&info)))
+        {
+            printf("%-7s %-7s %-8s %7u %-8s  Initialize failed\n", scenario.captureMode, scenario.format, scenario.sink, scenario.threads,
+                scenario.features ? "all" : "-");
+            plugin->Release();
+            ProfilerLogger::Shutdown(false);
+            return false;
+        }
+
+        double seconds = RunProgram(plugin, info, functions, scenario.threads, settings.calls, settings.graph.seed, scenario.features);
+        plugin->Shutdown();
+        plugin->Release();
+
+        double calls = (double)functions.size() * settings.calls * scenario.threads;
+        bool passed = CheckOutput(directory, scenario, settings, info, functions);
+        printf("%-7s %-7s %-8s %7u %-8s %12.1f %12s\n", scenario.captureMode, scenario.format, scenario.sink, scenario.threads,
+            scenario.features ? "all" : "-", seconds * 1e9 / calls, passed ? "ok" : "FAILED");
+        return passed;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings;
+    settings.graph.functionCount = 5000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        unsigned value = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+        if (strcmp(argv[i], "--functions") == 0)
+            settings.graph.functionCount = value;
+        else if (strcmp(argv[i], "--calls") == 0)
+            settings.calls = value;
+        else if (strcmp(argv[i], "--depth") == 0)
+            settings.graph.maxDepth = value;
+        else if (strcmp(argv[i], "--threads") == 0)
+            settings.maxThreads = value;
+        else if (strcmp(argv[i], "--seed") == 0)
+            settings.graph.seed = value;
+    }
+
+    FakeProfilerInfo info;
+    std::vector<FunctionID> functions = BuildSyntheticGraph(info, settings.graph);
+    printf("%zu functions, %zu classes, %zu modules\n\n", info.GetFunctionCount(), info.GetClassCount(), info.GetModuleCount());
+
+    // Point the profiler at a control block nobody created.
+    SetSetting("SIG_JIT_PROFILER_MAP_ID", "JitProfilerHarness_" + std::to_string(Platform::GetProcessId()));
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "JitProfilerHarness";
+
+    static const char* const captureModes[] = { "enter3", "mapper", "jit" };
+    static const char* const formats[] = { "json", "binary" };
+    static const char* const sinks[] = { "buffered", "mapped" };
+
+    std::vector<unsigned> threadCounts = { 1 };
+    if (settings.maxThreads > 1)
+        threadCounts.push_back(settings.maxThreads);
+
+    printf("%-7s %-7s %-8s %7s %-8s %12s %12s\n", "mode", "format", "sink", "threads", "features", "ns/call", "result");
+    int result = 0;
+    for (const char* sink : sinks)
+    {
+        for (const char* format : formats)
+        {
+            for (const char* captureMode : captureModes)
+            {
+                for (unsigned threads : threadCounts)
+                {
+                    Scenario scenario = { captureMode, format, sink, threads, false };
+                    if (!RunScenario(scenario, settings, info, functions, root))
+                        result = 1;
+                }
+            }
+
+            // Call counts take Enter3 capture whatever the mode, so the
+            // feature records are checked in that mode only.
+            for (unsigned threads : threadCounts)
+            {
+                Scenario scenario = { "enter3", format, sink, threads, true };
+                if (!RunScenario(scenario, settings, info, functions, root))
+                    result = 1;
+            }
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(root, error);
+    return result;
+}
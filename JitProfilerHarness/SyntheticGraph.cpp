@@ -0,0 +1,157 @@
+#include "SyntheticGraph.h"
+#include <random>
+#include <unordered_set>
+
+namespace
+{
+    struct GenericDefinition
+    {
+        ModuleID moduleId;
+        mdTypeDef typeDef;
+        uint32_t arity;
+        bool isValueType;
+    };
+
+    class GraphBuilder
+    {
+    public:
+        GraphBuilder(FakeProfilerInfo& info, const SyntheticGraphOptions& options)
+            : info(info), options(options), random(options.seed), canonClass(0)
+        {
+        }
+
+        std::vector<FunctionID> Build()
+        {
+            ModuleID coreLib = info.AddModule(L"System.Private.CoreLib.dll", L"System.Private.CoreLib");
+            canonClass = info.AddClass(coreLib, 0x02000001, {});
+            referenceTypes.insert(canonClass);
+
+            // A few primitives every program instantiates over.
+            for (mdTypeDef typeDef = 0x02000002; typeDef < 0x02000008; typeDef++)
+                AddLeaf(coreLib, typeDef, typeDef < 0x02000006, coreLibLeaves);
+
+            for (uint32_t m = 0; m < options.moduleCount; m++)
+            {
+                std::wstring name = L"Synthetic" + std::to_wstring(m);
+                ModuleID moduleId = info.AddModule(name + L".dll", name);
+                moduleIds.push_back(moduleId);
+                moduleLeaves.emplace_back();
+
+                for (uint32_t t = 0; t < options.typesPerModule; t++)
+                    AddLeaf(moduleId, 0x02000010 + t, Chance(30), moduleLeaves.back());
+
+                for (uint32_t g = 0; g < options.genericTypesPerModule; g++)
+                {
+                    GenericDefinition definition;
+                    definition.moduleId = moduleId;
+                    definition.typeDef = 0x02001000 + g;
+                    definition.arity = 1 + Next(3);
+                    definition.isValueType = Chance(20);
+                    genericDefinitions.push_back(definition);
+                }
+            }
+
+            std::vector<FunctionID> functions;
+            functions.reserve(options.functionCount);
+            for (uint32_t f = 0; f < options.functionCount; f++)
+                functions.push_back(AddFunction(0x06000001 + f));
+            return functions;
+        }
+
+    private:
+        FakeProfilerInfo& info;
+        const SyntheticGraphOptions& options;
+        std::mt19937 random;
+        ClassID canonClass;
+        std::unordered_set<ClassID> referenceTypes;
+        std::vector<ModuleID> moduleIds;
+        std::vector<ClassID> coreLibLeaves;
+        std::vector<std::vector<ClassID>> moduleLeaves;
+        std::vector<GenericDefinition> genericDefinitions;
+
+        uint32_t Next(uint32_t bound) { return bound == 0 ? 0 : (uint32_t)(random() % bound); }
+        bool Chance(uint32_t percent) { return Next(100) < percent; }
+
+        void AddLeaf(ModuleID moduleId, mdTypeDef typeDef, bool isValueType, std::vector<ClassID>& leaves)
+        {
+            ClassID classId = info.AddClass(moduleId, typeDef, {});
+            if (!isValueType)
+                referenceTypes.insert(classId);
+            leaves.push_back(classId);
+        }
+
+        ClassID RandomLeaf()
+        {
+            if (moduleLeaves.empty() || Chance(50))
+                return coreLibLeaves[Next((uint32_t)coreLibLeaves.size())];
+
+            const std::vector<ClassID>& leaves = moduleLeaves[Next((uint32_t)moduleLeaves.size())];
+            return leaves.empty() ? coreLibLeaves[0] : leaves[Next((uint32_t)leaves.size())];
+        }
+
+        // A type argument nested at most depth levels deep.
+        ClassID MakeType(uint32_t depth)
+        {
+            if (depth <= 1 || genericDefinitions.empty() || Chance(40))
+                return RandomLeaf();
+
+            const GenericDefinition& definition = genericDefinitions[Next((uint32_t)genericDefinitions.size())];
+            ClassID classId = info.AddClass(definition.moduleId, definition.typeDef, MakeTypeArgs(definition.arity, depth - 1));
+            if (!definition.isValueType)
+                referenceTypes.insert(classId);
+            return classId;
+        }
+
+        std::vector<ClassID> MakeTypeArgs(uint32_t count, uint32_t depth)
+        {
+            std::vector<ClassID> typeArgs;
+            for (uint32_t i = 0; i < count; i++)
+                typeArgs.push_back(MakeType(depth));
+            return typeArgs;
+        }
+
+        // Shared code is compiled once for all reference type arguments.
+        std::vector<ClassID> Canonicalize(const std::vector<ClassID>& typeArgs)
+        {
+            std::vector<ClassID> canonical = typeArgs;
+            for (ClassID& typeArg : canonical)
+            {
+                if (referenceTypes.count(typeArg) != 0)
+                    typeArg = canonClass;
+            }
+            return canonical;
+        }
+
+        FunctionID AddFunction(mdMethodDef token)
+        {
+            ModuleID moduleId = moduleIds.empty() ? info.AddModule(L"Synthetic.dll", L"Synthetic") : moduleIds[Next((uint32_t)moduleIds.size())];
+
+            ClassID declaringClass;
+            ClassID canonicalClass;
+            if (!genericDefinitions.empty() && Chance(options.genericPercent))
+            {
+                const GenericDefinition& definition = genericDefinitions[Next((uint32_t)genericDefinitions.size())];
+                std::vector<ClassID> typeArgs = MakeTypeArgs(definition.arity, options.maxDepth);
+                declaringClass = info.AddClass(definition.moduleId, definition.typeDef, typeArgs);
+                canonicalClass = info.AddClass(definition.moduleId, definition.typeDef, Canonicalize(typeArgs));
+            }
+            else
+            {
+                declaringClass = RandomLeaf();
+                canonicalClass = declaringClass;
+            }
+
+            std::vector<ClassID> methodTypeArgs;
+            if (Chance(options.genericPercent / 2))
+                methodTypeArgs = MakeTypeArgs(1 + Next(2), options.maxDepth);
+
+            return info.AddFunction(moduleId, token, declaringClass, methodTypeArgs, canonicalClass, Canonicalize(methodTypeArgs));
+        }
+    };
+}
+
+std::vector<FunctionID> BuildSyntheticGraph(FakeProfilerInfo& info, const SyntheticGraphOptions& options)
+{
+    GraphBuilder builder(info, options);
+    return builder.Build();
+}
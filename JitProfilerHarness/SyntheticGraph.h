@@ -0,0 +1,29 @@
+#pragma once
+
+#include "FakeProfilerInfo.h"
+#include <cstdint>
+#include <vector>
+
+// Shape of a generated program: modules full of plain and generic types, and
+// functions declared on instantiations nested up to maxDepth levels deep.
+struct SyntheticGraphOptions
+{
+    uint32_t seed = 1;
+    uint32_t moduleCount = 8;
+    uint32_t typesPerModule = 64;
+    uint32_t genericTypesPerModule = 16;
+    uint32_t functionCount = 20000;
+    // Nesting depth of generated type arguments; 1 is List<int>, 2 is
+    // List<List<int>>.
+    uint32_t maxDepth = 3;
+    // Share of functions declared on a generic instantiation, and half of that
+    // for functions with their own method type arguments.
+    uint32_t genericPercent = 40;
+};
+
+// Adds System.Private.CoreLib and options.moduleCount synthetic modules to info
+// and returns the FunctionIDs of the generated functions. The same options
+// always produce the same graph. Instantiations over reference types share
+// code, so without a frame they report System.__Canon in place of those
+// arguments, as the runtime does.
+std::vector<FunctionID> BuildSyntheticGraph(FakeProfilerInfo& info, const SyntheticGraphOptions& options);
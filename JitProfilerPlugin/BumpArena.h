@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Per-thread scratch allocator for data that lives only while one record is
+// built. Allocation bumps a pointer; Rewind releases everything allocated since
+// a Mark. Chunks are kept for reuse, so once a thread has seen its largest
+// record, building more records does not touch the heap.
+class BumpArena
+{
+public:
+    struct Mark
+    {
+        size_t chunk;
+        size_t offset;
+    };
+
+    explicit BumpArena(size_t chunkSize = 16 * 1024)
+        : chunkSize(chunkSize), current(0), offset(0)
+    {
+    }
+
+    ~BumpArena()
+    {
+        for (Chunk& chunk : chunks)
+            delete[] chunk.data;
+    }
+
+    BumpArena(const BumpArena&) = delete;
+    BumpArena& operator=(const BumpArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        for (;;)
+        {
+            if (current < chunks.size())
+            {
+                Chunk& chunk = chunks[current];
+                size_t start = (offset + alignment - 1) & ~(alignment - 1);
+                if (start + size <= chunk.size)
+                {
+                    offset = start + size;
+                    return chunk.data + start;
+                }
+
+                current++;
+                offset = 0;
+                continue;
+            }
+
+            size_t needed = size + alignment;
+            Chunk chunk;
+            chunk.size = needed > chunkSize ? needed : chunkSize;
+            chunk.data = new uint8_t[chunk.size];
+            chunks.push_back(chunk);
+        }
+    }
+
+    template <typename T>
+    T* Allocate(size_t count)
+    {
+        return (T*)Allocate(count * sizeof(T), alignof(T));
+    }
+
+    // Moves 'count' elements to a larger block; the old block is reclaimed on Rewind.
+    template <typename T>
+    T* Grow(T* items, size_t count, size_t newCount)
+    {
+        T* grown = Allocate<T>(newCount);
+        if (count > 0)
+            memcpy(grown, items, count * sizeof(T));
+        return grown;
+    }
+
+    Mark GetMark() const
+    {
+        Mark mark = { current, offset };
+        return mark;
+    }
+
+    void Rewind(const Mark& mark)
+    {
+        current = mark.chunk;
+        offset = mark.offset;
+    }
+
+private:
+    struct Chunk
+    {
+        uint8_t* data;
+        size_t size;
+    };
+
+    size_t chunkSize;
+    std::vector<Chunk> chunks;
+    size_t current;
+    size_t offset;
+};
+
+// Rewinds the arena when the record being built goes out of scope.
+class BumpArenaScope
+{
+public:
+    explicit BumpArenaScope(BumpArena& arena)
+        : arena(arena), mark(arena.GetMark())
+    {
+    }
+
+    ~BumpArenaScope()
+    {
+        arena.Rewind(mark);
+    }
+
+    BumpArenaScope(const BumpArenaScope&) = delete;
+    BumpArenaScope& operator=(const BumpArenaScope&) = delete;
+
+private:
+    BumpArena& arena;
+    BumpArena::Mark mark;
+};
@@ -1,12 +1,24 @@
-#include <windows.h>
+#include "JitProfilerPlugin.h"
+#ifdef _WIN32
 #include <unknwn.h>
 #include <objbase.h>
-#include "JitProfilerPlugin.h"
+#else
+#include <cstdlib>
+#include <mutex>
+#endif
+
+// {DF9EDC4B-25C1-4925-A3FB-6AAEB3E2FACD}, the value of CORECLR_PROFILER.
+static const CLSID CLSID_JitProfiler = { 0xDF9EDC4B, 0x25C1, 0x4925, { 0xA3, 0xFB, 0x6A, 0xAE, 0xB3, 0xE2, 0xFA, 0xCD } };
 
-class __declspec(uuid("{DF9EDC4B-25C1-4925-A3FB-6AAEB3E2FACD}")) ProfilerCLSID;
+#ifndef _WIN32
+// The PAL declares these but nothing a profiler links against defines them.
+const IID IID_IUnknown = { 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IClassFactory = { 0x00000001, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+const IID IID_IMetaDataImport = { 0x7DAC8207, 0xD3AE, 0x4C75, { 0x9B, 0x67, 0x92, 0x80, 0x1A, 0x49, 0x7D, 0x44 } };
+#endif
 
-static volatile long g_componentCount = 0;
-static volatile long g_lockCount = 0;
+static std::atomic<long> g_componentCount(0);
+static std::atomic<long> g_lockCount(0);
 
 //=============================================================================
 // ClassFactory for managing instances of the profiler
@@ -18,23 +30,23 @@ public:
     JitProfilerClassFactory()
         : refCount(1)
     {
-        InterlockedIncrement(&g_componentCount);
+        ++g_componentCount;
     }
 
     virtual ~JitProfilerClassFactory()
     {
-        InterlockedDecrement(&g_componentCount);
+        --g_componentCount;
     }
 
     // IUnknown methods
     ULONG STDMETHODCALLTYPE AddRef()
     {
-        return InterlockedIncrement(&refCount);
+        return ++refCount;
     }
 
     ULONG STDMETHODCALLTYPE Release()
     {
-        auto ret = InterlockedDecrement(&refCount);
+        auto ret = --refCount;
         if (ret == 0)
         {
             delete(this);
@@ -94,24 +106,26 @@ public:
     {
         if (bLock)
         {
-            InterlockedIncrement(&g_lockCount);
+            ++g_lockCount;
         }
         else
         {
-            InterlockedDecrement(&g_lockCount);
+            --g_lockCount;
         }
 
         return S_OK;
     }
 
 private:
-    long refCount;
+    std::atomic<long> refCount;
 };
 
 //=============================================================================
 // DLL Entry Points
 //=============================================================================
 
+#ifdef _WIN32
+
 BOOL WINAPI DllMain(HINSTANCE hInstance, DWORD dwReason, LPVOID lpReserved)
 {
     switch (dwReason)
@@ -122,19 +136,47 @@ BOOL WINAPI DllMain(HINSTANCE hInstance, DWORD dwReason, LPVOID lpReserved)
         break;
 
     case DLL_PROCESS_DETACH:
-        ProfilerLogger::CloseLogFiles();
+        // lpReserved is non-NULL when the whole process is terminating.
+        ProfilerLogger::Shutdown(lpReserved != NULL);
         break;
 
     case DLL_THREAD_ATTACH:
         break;
 
     case DLL_THREAD_DETACH:
+        ProfilerLogger::ReleaseThreadBuffer();
         break;
     }
 
     return TRUE;
 }
 
+#else
+
+// CoreCLR asks for the class factory right after loading the library, so the
+// logger starts there instead of in a load-time constructor, which could run
+// before the logger's own statics are constructed. Threads report their exit
+// through Platform::NotifyOnThreadExit.
+static void ShutdownLoggerAtExit()
+{
+    ProfilerLogger::Shutdown(true);
+}
+
+static void InitializeLibrary()
+{
+    static std::once_flag s_once;
+    std::call_once(s_once, []()
+    {
+        ProfilerLogger::Initialize();
+        JitProfilerPlugin::InitializeMaxRecurseDepth();
+
+        // Runs before the destructors of statics constructed earlier.
+        atexit(ShutdownLoggerAtExit);
+    });
+}
+
+#endif
+
 //=============================================================================
 // DLL Export Functions
 //=============================================================================
@@ -148,9 +190,13 @@ STDAPI DllCanUnloadNow(void)
 
 STDAPI DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID* ppv)
 {
-    if (rclsid != __uuidof(ProfilerCLSID))
+    if (rclsid != CLSID_JitProfiler)
         return CLASS_E_CLASSNOTAVAILABLE;
 
+#ifndef _WIN32
+    InitializeLibrary();
+#endif
+
     JitProfilerClassFactory* pFactory = new JitProfilerClassFactory();
     if (NULL == pFactory)
         return E_OUTOFMEMORY;
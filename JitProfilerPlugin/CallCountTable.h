@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Call counts of one thread, keyed by FunctionID (SIG_JIT_PROFILER_CALL_COUNTS).
+// Only the owning thread inserts and increments, so an increment is a plain
+// load and store with no locked instruction. A merger on another thread reads
+// the counts and remembers in 'merged' how much of each it has already taken.
+// 'merged' is only used, and the table only cleared, under the lock that
+// serializes merges.
+//
+// Once half its slots are used the owner moves to a table twice the size,
+// holding the same functions with no calls, and Retires this one. The merger
+// takes a retired table's counts a last time and frees it, so a thread pays
+// for a move once per doubling rather than for a merge every few thousand
+// new functions. The slot array starts on a cache line and fills whole ones,
+// as does the table object, so no two threads' counters share a line.
+//
+// A function the owner has counted before is Seen, which lets Enter3 skip
+// its dedup probe. One whose capture was refused is marked to Retry and is
+// Unseen on its next call.
+class alignas(64) CallCountTable
+{
+public:
+    static const size_t InitialCapacity = 1024;
+    static const size_t CacheLine = 64;
+
+    enum class Call
+    {
+        Seen,
+        Unseen,
+        // Unseen, and the table is now half full and should be moved out of.
+        UnseenAndHalfFull
+    };
+
+    // Returns nullptr without memory. 'capacity' is a power of two of at
+    // least CacheLine / sizeof(Slot).
+    static CallCountTable* Create(size_t capacity)
+    {
+        void* memory = ::operator new[](capacity * sizeof(Slot), std::align_val_t(CacheLine), std::nothrow);
+        if (memory == nullptr)
+            return nullptr;
+
+        Slot* slots = (Slot*)memory;
+        for (size_t i = 0; i < capacity; i++)
+            new (&slots[i]) Slot();
+
+        CallCountTable* table = new (std::nothrow) CallCountTable(slots, capacity);
+        if (table == nullptr)
+            FreeSlots(slots);
+        return table;
+    }
+
+    ~CallCountTable()
+    {
+        FreeSlots(slots);
+    }
+
+    CallCountTable(const CallCountTable&) = delete;
+    CallCountTable& operator=(const CallCountTable&) = delete;
+
+    // Owner only.
+    Call Increment(uintptr_t functionId)
+    {
+        size_t index = Hash(functionId) & (capacity - 1);
+        for (;;)
+        {
+            Slot& slot = slots[index];
+            uintptr_t key = slot.functionId.load(std::memory_order_relaxed);
+            if (key == functionId)
+            {
+                slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                if (!slot.retry)
+                    return Call::Seen;
+
+                slot.retry = false;
+                return Call::Unseen;
+            }
+
+            if (key == 0)
+            {
+                // The count first, so a merger that sees the key sees the call.
+                slot.count.store(1, std::memory_order_relaxed);
+                slot.functionId.store(functionId, std::memory_order_release);
+                return ++used >= capacity / 2 ? Call::UnseenAndHalfFull : Call::Unseen;
+            }
+
+            index = (index + 1) & (capacity - 1);
+        }
+    }
+
+    // Owner only. A function no longer in the table, as after Clear, is
+    // Unseen anyway.
+    void Retry(uintptr_t functionId)
+    {
+        size_t index = Hash(functionId) & (capacity - 1);
+        for (;;)
+        {
+            uintptr_t key = slots[index].functionId.load(std::memory_order_relaxed);
+            if (key == functionId)
+            {
+                slots[index].retry = true;
+                return;
+            }
+
+            if (key == 0)
+                return;
+
+            index = (index + 1) & (capacity - 1);
+        }
+    }
+
+    // Owner only, before this table is published. Takes the functions of
+    // 'from', whose counts stay there for the merger.
+    void CopyFunctions(const CallCountTable& from)
+    {
+        for (size_t i = 0; i < from.capacity; i++)
+        {
+            uintptr_t functionId = from.slots[i].functionId.load(std::memory_order_relaxed);
+            if (functionId == 0)
+                continue;
+
+            size_t index = Hash(functionId) & (capacity - 1);
+            while (slots[index].functionId.load(std::memory_order_relaxed) != 0)
+                index = (index + 1) & (capacity - 1);
+            slots[index].functionId.store(functionId, std::memory_order_relaxed);
+            slots[index].retry = from.slots[i].retry;
+            used++;
+        }
+    }
+
+    size_t GetCapacity() const
+    {
+        return capacity;
+    }
+
+    // Owner only, once it no longer counts here.
+    void Retire()
+    {
+        retired.store(true, std::memory_order_release);
+    }
+
+    // Read before the last Merge: every call counted in a retired table is then seen.
+    bool IsRetired() const
+    {
+        return retired.load(std::memory_order_acquire);
+    }
+
+    // Calls add(functionId, calls) with the calls since the previous merge.
+    // Under the merge lock.
+    template <typename Add>
+    void Merge(Add add)
+    {
+        for (size_t i = 0; i < capacity; i++)
+        {
+            Slot& slot = slots[i];
+            uintptr_t functionId = slot.functionId.load(std::memory_order_acquire);
+            if (functionId == 0)
+                continue;
+
+            uint64_t count = slot.count.load(std::memory_order_relaxed);
+            if (count != slot.merged)
+            {
+                add(functionId, count - slot.merged);
+                slot.merged = count;
+            }
+        }
+    }
+
+    // Owner only, under the merge lock, after Merge. For when there is no
+    // memory for a larger table.
+    void Clear()
+    {
+        for (size_t i = 0; i < capacity; i++)
+        {
+            slots[i].functionId.store(0, std::memory_order_relaxed);
+            slots[i].count.store(0, std::memory_order_relaxed);
+            slots[i].merged = 0;
+            slots[i].retry = false;
+        }
+        used = 0;
+    }
+
+    // Link in the list of all tables, which the merger walks.
+    CallCountTable* next;
+
+private:
+    struct Slot
+    {
+        Slot() : functionId(0), count(0), merged(0), retry(false)
+        {
+        }
+
+        std::atomic<uintptr_t> functionId;
+        std::atomic<uint64_t> count;
+        uint64_t merged;
+        // Owner only.
+        bool retry;
+    };
+    static_assert(CacheLine % sizeof(Slot) == 0, "slots must tile cache lines");
+
+    // Slots have no destructor to run.
+    static void FreeSlots(Slot* slots)
+    {
+        ::operator delete[](slots, std::align_val_t(CacheLine));
+    }
+
+    CallCountTable(Slot* slots, size_t capacity)
+        : next(nullptr), slots(slots), capacity(capacity), used(0), retired(false)
+    {
+    }
+
+    static uint64_t Hash(uintptr_t id)
+    {
+        uint64_t h = (uint64_t)id;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    Slot* slots;
+    size_t capacity;
+    size_t used;
+    std::atomic<bool> retired;
+};
@@ -0,0 +1,327 @@
+#include "CaptureAdmission.h"
+#include "JitProfilerPlugin.h"
+
+#include <chrono>
+
+static uint64_t NowNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool EndsWithNoCase(const std::wstring& text, const wchar_t* suffix)
+{
+    size_t suffixLength = wcslen(suffix);
+    return text.size() >= suffixLength && Platform::CompareNoCase(text.c_str() + text.size() - suffixLength, suffix) == 0;
+}
+
+static std::wstring Trim(const std::wstring& text)
+{
+    size_t start = text.find_first_not_of(L" \t");
+    if (start == std::wstring::npos)
+        return std::wstring();
+    size_t end = text.find_last_not_of(L" \t");
+    return text.substr(start, end - start + 1);
+}
+
+CaptureAdmission::CaptureAdmission()
+    : hasSampleRules(false), emissionIntervalNs(0), toleranceNs(0), theoreticalArrivalNs(0),
+      deferResolution(false), appliedGeneration(0), sampledOut(0), rateLimited(0), deferred(0)
+{
+    rulesLock.Initialize();
+    percentsLock.Initialize();
+}
+
+void CaptureAdmission::ReadEnvironment()
+{
+    AdmissionSettings settings;
+    std::wstring value;
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_SAMPLE", value))
+        settings.sampleRules = value;
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_MAX_RATE", value))
+    {
+        int rate = Platform::ParseInt(value);
+        if (rate > 0)
+            settings.maxRecordsPerSecond = (uint32_t)rate;
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_BURST", value))
+    {
+        int burst = Platform::ParseInt(value);
+        if (burst > 0)
+            settings.burst = (uint32_t)burst;
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_DEFER", value))
+        settings.deferResolution = Platform::ParseInt(value) != 0;
+
+    Apply(settings);
+}
+
+void CaptureAdmission::ApplyControlBlock(const ControlBlock* block)
+{
+    // The controller may start another update while this reads; keep reading
+    // until the generation is even and the same before and after.
+    AdmissionSettings settings;
+    int32_t generation;
+    for (;;)
+    {
+        generation = block->filterGeneration;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        int32_t rate = block->maxRecordsPerSecond;
+        int32_t burst = block->burst;
+        settings.maxRecordsPerSecond = rate > 0 ? (uint32_t)rate : 0;
+        settings.burst = burst > 0 ? (uint32_t)burst : 0;
+        settings.deferResolution = block->deferResolution != 0;
+
+        settings.sampleRules.clear();
+        for (uint32_t i = 0; i < ControlBlock::MaxSampleRulesLength && block->sampleRules[i] != 0; i++)
+        {
+            settings.sampleRules += (wchar_t)block->sampleRules[i];
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((generation & 1) == 0 && block->filterGeneration == generation)
+            break;
+
+        Platform::YieldThread();
+    }
+
+    // Threads that noticed the same change at once apply it only once.
+    if (appliedGeneration.exchange(generation) == generation)
+        return;
+
+    Apply(settings);
+}
+
+void CaptureAdmission::Apply(const AdmissionSettings& settings)
+{
+    std::vector<SampleRule> parsed = ParseSampleRules(settings.sampleRules);
+
+    rulesLock.AcquireExclusive();
+    rules.swap(parsed);
+    percents.clear();
+    hasSampleRules.store(!rules.empty(), std::memory_order_relaxed);
+    rulesLock.ReleaseExclusive();
+
+    uint64_t interval = 0;
+    uint64_t burst = settings.burst;
+    if (settings.maxRecordsPerSecond > 0)
+    {
+        interval = 1000000000ULL / settings.maxRecordsPerSecond;
+        if (burst == 0)
+            burst = settings.maxRecordsPerSecond;
+    }
+
+    toleranceNs.store(burst > 0 ? interval * (burst - 1) : 0, std::memory_order_relaxed);
+    theoreticalArrivalNs.store(0, std::memory_order_relaxed);
+    emissionIntervalNs.store(interval, std::memory_order_relaxed);
+    deferResolution.store(settings.deferResolution, std::memory_order_relaxed);
+}
+
+std::vector<CaptureAdmission::SampleRule> CaptureAdmission::ParseSampleRules(const std::wstring& text)
+{
+    std::vector<SampleRule> parsed;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find(L';', start);
+        if (end == std::wstring::npos)
+            end = text.size();
+
+        std::wstring entry = text.substr(start, end - start);
+        start = end + 1;
+
+        size_t separator = entry.rfind(L'=');
+        if (separator == std::wstring::npos)
+            continue;
+
+        SampleRule rule;
+        rule.pattern = Trim(entry.substr(0, separator));
+        int percent = Platform::ParseInt(Trim(entry.substr(separator + 1)));
+        rule.percent = percent < 0 ? 0 : percent > 100 ? 100 : (uint32_t)percent;
+
+        // An empty pattern stands for "*".
+        if (rule.pattern == L"*")
+            rule.pattern.clear();
+        rule.matchesModule = EndsWithNoCase(rule.pattern, L".dll") || EndsWithNoCase(rule.pattern, L".exe");
+
+        parsed.push_back(rule);
+    }
+    return parsed;
+}
+
+bool CaptureAdmission::TryAcquire()
+{
+    uint64_t interval = emissionIntervalNs.load(std::memory_order_relaxed);
+    if (interval == 0)
+        return true;
+
+    // The bucket is full when the theoretical arrival time is in the past and
+    // empty when it is more than 'tolerance' ahead of now.
+    uint64_t tolerance = toleranceNs.load(std::memory_order_relaxed);
+    uint64_t now = NowNs();
+    uint64_t arrival = theoreticalArrivalNs.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        uint64_t start = arrival > now ? arrival : now;
+        if (start - now > tolerance)
+        {
+            rateLimited.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (theoreticalArrivalNs.compare_exchange_weak(arrival, start + interval, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+bool CaptureAdmission::IsSampled(ICorProfilerInfo3* profilerInfo, FunctionID functionId, ModuleID moduleId, mdTypeDef typeDef)
+{
+    rulesLock.AcquireShared();
+    if (rules.empty())
+    {
+        rulesLock.ReleaseShared();
+        return true;
+    }
+
+    TypeKey key = { moduleId, typeDef };
+    uint32_t percent = 100;
+
+    percentsLock.AcquireShared();
+    auto found = percents.find(key);
+    bool cached = found != percents.end();
+    if (cached)
+        percent = found->second;
+    percentsLock.ReleaseShared();
+
+    if (!cached)
+    {
+        percent = ComputePercent(profilerInfo, moduleId, typeDef);
+
+        percentsLock.AcquireExclusive();
+        percents.emplace(key, percent);
+        percentsLock.ReleaseExclusive();
+    }
+    rulesLock.ReleaseShared();
+
+    // FunctionIDs are aligned pointers; the high bits of the product are well mixed.
+    uint64_t bucket = (((uint64_t)functionId * 0x9E3779B97F4A7C15ULL) >> 32) % 100;
+    if (bucket < percent)
+        return true;
+
+    sampledOut.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+uint32_t CaptureAdmission::ComputePercent(ICorProfilerInfo3* profilerInfo, ModuleID moduleId, mdTypeDef typeDef)
+{
+    // Names are read only once a rule needs them.
+    std::wstring moduleName;
+    std::wstring typeName;
+    bool moduleRead = false;
+    bool typeRead = false;
+    bool hasModuleName = false;
+    bool hasTypeName = false;
+
+    for (const SampleRule& rule : rules)
+    {
+        if (rule.pattern.empty())
+            return rule.percent;
+
+        if (rule.matchesModule)
+        {
+            if (!moduleRead)
+            {
+                hasModuleName = ReadModuleFileName(profilerInfo, moduleId, moduleName);
+                moduleRead = true;
+            }
+
+            if (hasModuleName && Platform::CompareNoCase(moduleName.c_str(), rule.pattern.c_str()) == 0)
+                return rule.percent;
+        }
+        else if (typeDef != mdTypeDefNil)
+        {
+            if (!typeRead)
+            {
+                hasTypeName = ReadTypeName(profilerInfo, moduleId, typeDef, typeName);
+                typeRead = true;
+            }
+
+            // "System.Collections" covers System.Collections.ArrayList and
+            // System.Collections.Generic, but not System.CollectionsExtra.
+            if (hasTypeName &&
+                typeName.compare(0, rule.pattern.size(), rule.pattern) == 0 &&
+                (typeName.size() == rule.pattern.size() || typeName[rule.pattern.size()] == L'.'))
+            {
+                return rule.percent;
+            }
+        }
+    }
+
+    return 100;
+}
+
+bool CaptureAdmission::ReadModuleFileName(ICorProfilerInfo3* profilerInfo, ModuleID moduleId, std::wstring& name)
+{
+    LPCBYTE baseLoadAddress;
+    AssemblyID assemblyId;
+    ULONG length = 0;
+
+    HRESULT hr = profilerInfo->GetModuleInfo(moduleId, &baseLoadAddress, 0, &length, nullptr, &assemblyId);
+    if (FAILED(hr) || length == 0)
+        return false;
+
+    std::vector<WCHAR> path(length);
+    hr = profilerInfo->GetModuleInfo(moduleId, &baseLoadAddress, length, &length, path.data(), &assemblyId);
+    if (FAILED(hr))
+        return false;
+
+    std::wstring fullPath = Platform::ToWideString(path.data(), Platform::StringLength(path.data(), path.size()));
+    size_t slash = fullPath.find_last_of(L"\\/");
+    name = slash == std::wstring::npos ? fullPath : fullPath.substr(slash + 1);
+    return true;
+}
+
+bool CaptureAdmission::ReadTypeName(ICorProfilerInfo3* profilerInfo, ModuleID moduleId, mdTypeDef typeDef, std::wstring& name)
+{
+    IMetaDataImport* metadata = nullptr;
+    HRESULT hr = profilerInfo->GetModuleMetaData(moduleId, ofRead, IID_IMetaDataImport, (IUnknown**)&metadata);
+    if (FAILED(hr) || metadata == nullptr)
+        return false;
+
+    // Nested types live in the namespace of their outermost enclosing type.
+    mdTypeDef outerType = typeDef;
+    mdTypeDef enclosingType = mdTypeDefNil;
+    for (int depth = 0; depth < 64; depth++)
+    {
+        if (FAILED(metadata->GetNestedClassProps(outerType, &enclosingType)) || enclosingType == mdTypeDefNil)
+            break;
+        outerType = enclosingType;
+    }
+
+    WCHAR buffer[1024];
+    ULONG length = 0;
+    DWORD flags = 0;
+    mdToken extends = mdTokenNil;
+    hr = metadata->GetTypeDefProps(outerType, buffer, 1024, &length, &flags, &extends);
+    metadata->Release();
+
+    if (FAILED(hr))
+        return false;
+
+    name = Platform::ToWideString(buffer, Platform::StringLength(buffer, 1024));
+    return true;
+}
+
+CaptureAdmission::Stats CaptureAdmission::GetStats() const
+{
+    Stats stats;
+    stats.sampledOut = sampledOut.load(std::memory_order_relaxed);
+    stats.rateLimited = rateLimited.load(std::memory_order_relaxed);
+    stats.deferred = deferred.load(std::memory_order_relaxed);
+    return stats;
+}
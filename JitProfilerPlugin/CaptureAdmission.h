@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Platform.h"
+#include <cor.h>
+#include <corprof.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ControlBlock.h"
+
+struct AdmissionSettings
+{
+    AdmissionSettings() : maxRecordsPerSecond(0), burst(0), deferResolution(false) {}
+
+    // "pattern=percent;..." as in SIG_JIT_PROFILER_SAMPLE.
+    std::wstring sampleRules;
+    uint32_t maxRecordsPerSecond;
+    uint32_t burst;
+    bool deferResolution;
+};
+
+// Decides which newly seen functions go through resolution, and when.
+//
+// Sampling: SIG_JIT_PROFILER_SAMPLE holds rules such as
+//   System.Private.CoreLib.dll=5;Microsoft.Extensions=25;*=100
+// A pattern ending in .dll or .exe matches the module file name; any other
+// pattern matches a namespace and the namespaces and types under it. The
+// first matching rule gives the percentage of functions recorded; without a
+// match every function is. The choice is a hash of the FunctionID, so it is
+// stable for the life of the function.
+//
+// Rate cap: SIG_JIT_PROFILER_MAX_RATE limits resolutions per second, with
+// bursts of up to SIG_JIT_PROFILER_BURST (default: one second's worth).
+//
+// Deferral: SIG_JIT_PROFILER_DEFER=1 leaves resolution to a background
+// worker, so the hook only queues the FunctionID. Deferred functions are
+// resolved without a call frame, so shared generic code is recorded in its
+// canonical form, as in CaptureMode::Jit.
+//
+// The controller can replace all of these at run time through ControlBlock.
+class CaptureAdmission
+{
+public:
+    struct Stats
+    {
+        uint64_t sampledOut;
+        uint64_t rateLimited;
+        uint64_t deferred;
+    };
+
+    CaptureAdmission();
+
+    CaptureAdmission(const CaptureAdmission&) = delete;
+    CaptureAdmission& operator=(const CaptureAdmission&) = delete;
+
+    void ReadEnvironment();
+
+    // Picks up settings the controller published since the last call. Cheap
+    // when nothing changed.
+    void Refresh(const ControlBlock* block)
+    {
+        int32_t generation = block->filterGeneration;
+        if (generation != 0 && (generation & 1) == 0 && generation != appliedGeneration.load(std::memory_order_relaxed))
+            ApplyControlBlock(block);
+    }
+
+    // Takes a token from the rate cap; always succeeds when there is no cap.
+    bool TryAcquire();
+
+    bool ShouldDefer() const { return deferResolution.load(std::memory_order_relaxed); }
+    bool HasSampleRules() const { return hasSampleRules.load(std::memory_order_relaxed); }
+
+    // typeDef is the declaring type, or mdTypeDefNil when it is not known;
+    // namespace rules then do not match.
+    bool IsSampled(ICorProfilerInfo3* profilerInfo, FunctionID functionId, ModuleID moduleId, mdTypeDef typeDef);
+
+    void CountDeferred() { deferred.fetch_add(1, std::memory_order_relaxed); }
+
+    // The control block generation in effect, 0 while the environment settings apply.
+    int32_t GetAppliedGeneration() const { return appliedGeneration.load(std::memory_order_relaxed); }
+
+    Stats GetStats() const;
+
+private:
+    struct SampleRule
+    {
+        std::wstring pattern;
+        bool matchesModule;
+        uint32_t percent;
+    };
+
+    struct TypeKey
+    {
+        ModuleID moduleId;
+        mdTypeDef typeDef;
+
+        bool operator==(const TypeKey& other) const
+        {
+            return moduleId == other.moduleId && typeDef == other.typeDef;
+        }
+    };
+
+    struct TypeKeyHash
+    {
+        size_t operator()(const TypeKey& key) const
+        {
+            return (size_t)(((uint64_t)key.moduleId * 0x9E3779B97F4A7C15ULL) ^ key.typeDef);
+        }
+    };
+
+    void Apply(const AdmissionSettings& settings);
+    void ApplyControlBlock(const ControlBlock* block);
+    uint32_t ComputePercent(ICorProfilerInfo3* profilerInfo, ModuleID moduleId, mdTypeDef typeDef);
+
+    static std::vector<SampleRule> ParseSampleRules(const std::wstring& text);
+    static bool ReadModuleFileName(ICorProfilerInfo3* profilerInfo, ModuleID moduleId, std::wstring& name);
+    static bool ReadTypeName(ICorProfilerInfo3* profilerInfo, ModuleID moduleId, mdTypeDef typeDef, std::wstring& name);
+
+    // Held shared while a decision is computed and cached, and exclusively to
+    // replace the rules, so a settings change never leaves a stale decision behind.
+    Platform::ReaderWriterLock rulesLock;
+    std::vector<SampleRule> rules;
+
+    // Percentage per declaring type; readers share rulesLock, so this has its own lock.
+    Platform::ReaderWriterLock percentsLock;
+    std::unordered_map<TypeKey, uint32_t, TypeKeyHash> percents;
+    std::atomic<bool> hasSampleRules;
+
+    // Rate cap as a generic cell rate algorithm: a single timestamp stands for
+    // the whole bucket.
+    std::atomic<uint64_t> emissionIntervalNs;
+    std::atomic<uint64_t> toleranceNs;
+    std::atomic<uint64_t> theoreticalArrivalNs;
+
+    std::atomic<bool> deferResolution;
+    std::atomic<int32_t> appliedGeneration;
+
+    std::atomic<uint64_t> sampledOut;
+    std::atomic<uint64_t> rateLimited;
+    std::atomic<uint64_t> deferred;
+};
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Insert-only concurrent set of pointer-sized IDs (FunctionID, ModuleID, ...),
+// used to log each ID once. The set is split into shards, each an
+// open-addressing table with linear probing. InsertIfAbsent claims a slot with
+// a single compare-and-swap and never blocks.
+//
+// When a shard's table passes half full, a table twice the size is published
+// and the old one is migrated incrementally: every caller that touches the
+// shard copies a small chunk of old slots before doing its own work. Empty old
+// slots are sealed with MovedKey so that a late insert into the old table
+// retries in the new one. Because of that, an ID is reported as new exactly
+// once, even while a resize is running. New IDs may fill only a quarter of the
+// new table before the migration is done. A caller that hits that limit copies
+// the rest of the old table itself, so a preempted helper cannot stall
+// everyone. Old tables are freed with the set. Their total size is bounded by
+// the size of the current tables.
+//
+// The values 0 and ~0 are reserved and cannot be stored. The runtime never
+// hands those out as IDs.
+class ConcurrentIdSet
+{
+public:
+    explicit ConcurrentIdSet(size_t initialCapacity = 64 * 1024, size_t shardCount = 64)
+        : shards(nullptr), shardShift(0)
+    {
+        size_t count = 1;
+        while (count < shardCount)
+            count <<= 1;
+
+        unsigned bits = 0;
+        while (((size_t)1 << bits) < count)
+            bits++;
+        shardShift = 64 - bits;
+
+        // Keep every shard at most half full at the requested capacity.
+        size_t perShard = MinTableCapacity;
+        while (perShard < (initialCapacity * 2) / count)
+            perShard <<= 1;
+
+        shards = new Shard[count];
+        shardMask = count - 1;
+        for (size_t i = 0; i < count; i++)
+        {
+            shards[i].current.store(new Table(perShard, nullptr), std::memory_order_relaxed);
+        }
+    }
+
+    ~ConcurrentIdSet()
+    {
+        for (size_t i = 0; i <= shardMask; i++)
+        {
+            delete shards[i].current.load(std::memory_order_relaxed);
+            Table* retired = shards[i].retired.load(std::memory_order_relaxed);
+            while (retired != nullptr)
+            {
+                Table* next = retired->retiredNext;
+                delete retired;
+                retired = next;
+            }
+        }
+        delete[] shards;
+    }
+
+    ConcurrentIdSet(const ConcurrentIdSet&) = delete;
+    ConcurrentIdSet& operator=(const ConcurrentIdSet&) = delete;
+
+    // Returns true if the ID was not in the set and this call added it.
+    bool InsertIfAbsent(uintptr_t id)
+    {
+        const uint64_t hash = Hash(id);
+        Shard& shard = shards[(size_t)(hash >> shardShift) & shardMask];
+
+        for (;;)
+        {
+            Table* table = shard.current.load(std::memory_order_acquire);
+            Table* previous = table->previous.load(std::memory_order_acquire);
+
+            if (previous != nullptr)
+            {
+                HelpMigrate(shard, table, previous);
+                if (SealOrFind(previous, id, hash))
+                    return false;
+
+                // Old IDs may take half of the new table; keep room for them.
+                if (table->migrationInserts.fetch_add(1, std::memory_order_relaxed) >= table->capacity / 4)
+                {
+                    FinishMigration(shard, table, previous);
+                    continue;
+                }
+            }
+
+            InsertResult result = Insert(table, id, hash);
+            if (result == InsertResult::Exists)
+                return false;
+
+            if (result == InsertResult::Inserted)
+            {
+                size_t count = table->count.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (count > table->capacity / 2)
+                    Grow(shard, table);
+                return true;
+            }
+
+            // Retry: the table was sealed by a resize, or it is full and
+            // must grow before the insert can land.
+            if (result == InsertResult::Full)
+                Grow(shard, table);
+        }
+    }
+
+    bool Contains(uintptr_t id) const
+    {
+        const uint64_t hash = Hash(id);
+        const Shard& shard = shards[(size_t)(hash >> shardShift) & shardMask];
+
+        Table* table = shard.current.load(std::memory_order_acquire);
+        Table* previous = table->previous.load(std::memory_order_acquire);
+        return (previous != nullptr && Find(previous, id, hash)) || Find(table, id, hash);
+    }
+
+    // Number of IDs in the current tables. Approximate while a resize runs.
+    size_t Size() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i <= shardMask; i++)
+        {
+            total += shards[i].current.load(std::memory_order_acquire)->count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    static const uintptr_t EmptyKey = 0;
+    static const uintptr_t MovedKey = ~(uintptr_t)0;
+    static const size_t MinTableCapacity = 64;
+    static const size_t MigrationChunk = 64;
+
+    enum class InsertResult
+    {
+        Inserted,
+        Exists,
+        Retry,
+        Full
+    };
+
+    struct Table
+    {
+        Table(size_t size, Table* from)
+            : capacity(size), mask(size - 1), slots(new std::atomic<uintptr_t>[size]),
+              previous(from), count(0), migrateCursor(0), migrateDone(0), migrationInserts(0),
+              retiredNext(nullptr)
+        {
+            for (size_t i = 0; i < size; i++)
+                slots[i].store(EmptyKey, std::memory_order_relaxed);
+        }
+
+        ~Table()
+        {
+            delete[] slots;
+        }
+
+        const size_t capacity;
+        const size_t mask;
+        std::atomic<uintptr_t>* const slots;
+
+        // Table still being migrated into this one; null once migration is done.
+        std::atomic<Table*> previous;
+        std::atomic<size_t> count;
+        std::atomic<size_t> migrateCursor;
+        std::atomic<size_t> migrateDone;
+        std::atomic<size_t> migrationInserts;
+        Table* retiredNext;
+    };
+
+    struct alignas(64) Shard
+    {
+        Shard() : current(nullptr), growing(false), retired(nullptr) {}
+
+        std::atomic<Table*> current;
+        std::atomic<bool> growing;
+        std::atomic<Table*> retired;
+    };
+
+    static uint64_t Hash(uintptr_t id)
+    {
+        uint64_t h = (uint64_t)id;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static InsertResult Insert(Table* table, uintptr_t id, uint64_t hash)
+    {
+        size_t index = (size_t)hash & table->mask;
+        for (size_t probe = 0; probe < table->capacity; probe++)
+        {
+            std::atomic<uintptr_t>& slot = table->slots[index];
+            uintptr_t value = slot.load(std::memory_order_acquire);
+
+            if (value == EmptyKey)
+            {
+                if (slot.compare_exchange_strong(value, id, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return InsertResult::Inserted;
+                // Lost the race; 'value' now holds the winner.
+            }
+
+            if (value == id)
+                return InsertResult::Exists;
+            if (value == MovedKey)
+                return InsertResult::Retry;
+
+            index = (index + 1) & table->mask;
+        }
+        return InsertResult::Full;
+    }
+
+    static bool Find(const Table* table, uintptr_t id, uint64_t hash)
+    {
+        size_t index = (size_t)hash & table->mask;
+        for (size_t probe = 0; probe < table->capacity; probe++)
+        {
+            uintptr_t value = table->slots[index].load(std::memory_order_acquire);
+            if (value == id)
+                return true;
+            if (value == EmptyKey || value == MovedKey)
+                return false;
+            index = (index + 1) & table->mask;
+        }
+        return false;
+    }
+
+    // Looks the ID up in a table being migrated away from. The empty slot
+    // that ends the probe is sealed, so nobody can add the ID there afterwards.
+    static bool SealOrFind(Table* table, uintptr_t id, uint64_t hash)
+    {
+        size_t index = (size_t)hash & table->mask;
+        for (size_t probe = 0; probe < table->capacity; probe++)
+        {
+            std::atomic<uintptr_t>& slot = table->slots[index];
+            uintptr_t value = slot.load(std::memory_order_acquire);
+
+            if (value == EmptyKey)
+            {
+                if (slot.compare_exchange_strong(value, MovedKey, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return false;
+            }
+
+            if (value == id)
+                return true;
+            if (value == MovedKey)
+                return false;
+
+            index = (index + 1) & table->mask;
+        }
+        return false;
+    }
+
+    void Grow(Shard& shard, Table* table)
+    {
+        // One resize at a time per shard, and only once the last one has finished.
+        if (table->previous.load(std::memory_order_acquire) != nullptr)
+            return;
+
+        bool expected = false;
+        if (!shard.growing.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            return;
+
+        if (shard.current.load(std::memory_order_acquire) == table &&
+            table->previous.load(std::memory_order_acquire) == nullptr)
+        {
+            Table* next = new Table(table->capacity * 2, table);
+            shard.current.store(next, std::memory_order_release);
+        }
+
+        shard.growing.store(false, std::memory_order_release);
+    }
+
+    // Copies one old slot into the new table, sealing it if it is empty.
+    static void MigrateSlot(Table* table, std::atomic<uintptr_t>& slot)
+    {
+        uintptr_t value = slot.load(std::memory_order_acquire);
+        if (value == EmptyKey &&
+            slot.compare_exchange_strong(value, MovedKey, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return;
+        }
+
+        // The cap on new inserts leaves room for every old ID, and the new table
+        // cannot be sealed before this migration is done.
+        if (value != MovedKey && Insert(table, value, Hash(value)) == InsertResult::Inserted)
+            table->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void HelpMigrate(Shard& shard, Table* table, Table* previous)
+    {
+        size_t start = table->migrateCursor.fetch_add(MigrationChunk, std::memory_order_relaxed);
+        if (start >= previous->capacity)
+            return;
+
+        size_t end = start + MigrationChunk;
+        if (end > previous->capacity)
+            end = previous->capacity;
+
+        for (size_t i = start; i < end; i++)
+            MigrateSlot(table, previous->slots[i]);
+
+        size_t done = table->migrateDone.fetch_add(end - start, std::memory_order_acq_rel) + (end - start);
+        if (done == previous->capacity)
+            Retire(shard, table, previous);
+    }
+
+    // Copies the whole old table without waiting for the helpers that claimed
+    // chunks of it. Copying an ID twice is harmless.
+    void FinishMigration(Shard& shard, Table* table, Table* previous)
+    {
+        if (table->previous.load(std::memory_order_acquire) != previous)
+            return;
+
+        for (size_t i = 0; i < previous->capacity; i++)
+            MigrateSlot(table, previous->slots[i]);
+
+        Retire(shard, table, previous);
+    }
+
+    static void Retire(Shard& shard, Table* table, Table* previous)
+    {
+        // Whoever detaches the old table first keeps it alive until the set is destroyed.
+        if (!table->previous.compare_exchange_strong(previous, nullptr, std::memory_order_acq_rel))
+            return;
+
+        Table* head = shard.retired.load(std::memory_order_relaxed);
+        do
+        {
+            previous->retiredNext = head;
+        } while (!shard.retired.compare_exchange_weak(head, previous, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    Shard* shards;
+    size_t shardMask;
+    unsigned shardShift;
+};
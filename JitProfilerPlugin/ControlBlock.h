@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the shared memory named by SIG_JIT_PROFILER_MAP_ID. The
+// controller creates it and owns the first part; the plugin owns the
+// statistics after it and updates them with relaxed atomics, so the
+// controller can watch overhead without reading the log files. IpcFlagMap in
+// JitProfilerController mirrors these offsets.
+//
+// A mapping that holds only the first int32 (or whose magic or version does
+// not match) still works as the on/off flag: every event type is then on and
+// admission settings come from the environment alone.
+struct ControlBlock
+{
+    static const uint32_t Magic = 0x42435053; // "SPCB"
+    static const uint32_t CurrentVersion = 1;
+    static const uint32_t MaxSampleRulesLength = 1024;
+
+    // Bits of eventMask.
+    static const uint32_t EventJit = 1u << 0;
+    static const uint32_t EventEnter3 = 1u << 1;
+
+    // Written by the controller.
+
+    // Non-zero while capture is on.
+    volatile int32_t enabled;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    volatile uint32_t eventMask;
+
+    // Odd while the controller writes the filter fields below, even and new
+    // once they are complete. While it is 0 the environment settings apply.
+    volatile int32_t filterGeneration;
+
+    // Functions resolved per second, 0 for no cap.
+    volatile int32_t maxRecordsPerSecond;
+    volatile int32_t burst;
+    volatile int32_t deferResolution;
+    volatile int32_t reserved;
+
+    // Same syntax as SIG_JIT_PROFILER_SAMPLE, NUL-terminated UTF-16.
+    volatile uint16_t sampleRules[MaxSampleRulesLength];
+
+    // Written by the plugin.
+
+    std::atomic<uint32_t> attachedProcessId;
+    // The filterGeneration the plugin is running with.
+    std::atomic<int32_t> appliedFilterGeneration;
+
+    std::atomic<uint64_t> jitEvents;
+    std::atomic<uint64_t> enter3Records;
+    std::atomic<uint64_t> moduleRecords;
+    // Callbacks for functions that were already recorded.
+    std::atomic<uint64_t> dedupHits;
+    std::atomic<uint64_t> sampledOut;
+    std::atomic<uint64_t> rateLimited;
+    std::atomic<uint64_t> deferred;
+    // Bytes handed to the logger and bytes it has written to the files; the
+    // difference is still buffered.
+    std::atomic<uint64_t> bytesBuffered;
+    std::atomic<uint64_t> bytesWritten;
+    std::atomic<uint64_t> droppedRecords;
+    // Time the flusher spent draining the thread buffers into the files.
+    std::atomic<uint64_t> flushCount;
+    std::atomic<uint64_t> flushTotalMicroseconds;
+    std::atomic<uint64_t> flushMaxMicroseconds;
+    std::atomic<uint64_t> lastFlushMicroseconds;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "statistics are shared across processes");
+static_assert(offsetof(ControlBlock, sampleRules) == 40, "IpcFlagMap mirrors this layout");
+static_assert(offsetof(ControlBlock, attachedProcessId) == 2088, "IpcFlagMap mirrors this layout");
+static_assert(offsetof(ControlBlock, jitEvents) == 2096, "IpcFlagMap mirrors this layout");
+static_assert(sizeof(ControlBlock) == 2208, "IpcFlagMap mirrors this layout");
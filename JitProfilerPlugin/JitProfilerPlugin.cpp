@@ -1,60 +1,564 @@
 #include "JitProfilerPlugin.h"
 
-CRITICAL_SECTION ProfilerLogger::g_jitLogLock;
-CRITICAL_SECTION ProfilerLogger::g_enter3LogLock;
-CRITICAL_SECTION ProfilerLogger::g_moduleLogLock;
-
-FILE* ProfilerLogger::g_jitLogFile = nullptr;
-FILE* ProfilerLogger::g_enter3LogFile = nullptr;
-FILE* ProfilerLogger::g_moduleLogFile = nullptr;
-
+FILE* ProfilerLogger::g_logFiles[(size_t)LogStream::Count] = {};
+Platform::Mutex ProfilerLogger::g_fileLocks[(size_t)LogStream::Count];
+std::vector<char> ProfilerLogger::g_staging[(size_t)LogStream::Count];
+MappedLogFile ProfilerLogger::g_mappedFiles[(size_t)LogStream::Count];
+std::atomic<bool> ProfilerLogger::g_mappedOpen(false);
+
+Platform::Mutex ProfilerLogger::g_threadBufferLock;
+Platform::Mutex ProfilerLogger::g_drainLock;
+std::vector<ProfilerLogger::ThreadBuffer*> ProfilerLogger::g_drainBuffers;
+std::vector<ProfilerLogger::ThreadBuffer*> ProfilerLogger::g_retiredBuffers;
+ProfilerLogger::ThreadBuffer* ProfilerLogger::g_threadBuffers = nullptr;
+thread_local ProfilerLogger::ThreadBuffer* ProfilerLogger::t_threadBuffer = nullptr;
+
+Platform::Thread ProfilerLogger::g_flusherThread;
+Platform::Event ProfilerLogger::g_flushEvent;
+std::atomic<bool> ProfilerLogger::g_flusherRunning(false);
+std::atomic<bool> ProfilerLogger::g_stopFlusher(false);
+std::atomic<long long> ProfilerLogger::g_droppedRecords(0);
+
+Platform::Mutex ProfilerLogger::g_threadStatsLock;
+bool ProfilerLogger::g_threadStatsReady = false;
+ProfilerLogger::ThreadStats* ProfilerLogger::g_threadStats = nullptr;
+thread_local ProfilerLogger::ThreadStats* ProfilerLogger::t_threadStats = nullptr;
+uint64_t ProfilerLogger::g_retiredCounters[(size_t)StatCounter::Count] = {};
+
+std::atomic<uint64_t> ProfilerLogger::g_bytesWritten(0);
+std::atomic<uint64_t> ProfilerLogger::g_flushCount(0);
+std::atomic<uint64_t> ProfilerLogger::g_flushTotalMicroseconds(0);
+std::atomic<uint64_t> ProfilerLogger::g_flushMaxMicroseconds(0);
+std::atomic<uint64_t> ProfilerLogger::g_lastFlushMicroseconds(0);
+
+OverflowPolicy ProfilerLogger::g_overflowPolicy = OverflowPolicy::Block;
+size_t ProfilerLogger::g_threadBufferSize = 256 * 1024;
+DWORD ProfilerLogger::g_flushIntervalMs = 100;
+bool ProfilerLogger::g_binaryFormat = false;
+bool ProfilerLogger::g_mappedSink = false;
+size_t ProfilerLogger::g_extentSize = 16 * 1024 * 1024;
 bool ProfilerLogger::g_initialized = false;
 
 JitProfilerPlugin* JitProfilerPlugin::s_instance = nullptr;
+thread_local BumpArena t_recordArena;
+thread_local JitTimingStack t_jitTimings;
+// SIG_JIT_PROFILER_THREADS: 0 until the thread's first tagged record.
+thread_local uint32_t t_threadIndex = 0;
+thread_local uint64_t t_threadSequence = 0;
+// SIG_JIT_PROFILER_CALL_COUNTS: created on the thread's first counted call.
+thread_local CallCountTable* t_callCounts = nullptr;
+thread_local uint64_t t_callCountSession = 0;
+static std::atomic<uint64_t> s_callCountSessions(0);
+
 int JitProfilerPlugin::s_maxRecurseDepth = 20;
 
+// Writes one record in the configured format: 'binary' fills in the payload of
+// a record of the given type, 'json' the properties of a line of 'stream'.
+// Each call site gets its own builders, so a record may be logged while
+// another is being built, as TagRecord does.
+template <typename Binary, typename Json>
+static void EmitRecord(TraceFormat::RecordType type, LogStream stream, Binary binary, Json json)
+{
+    if (ProfilerLogger::IsBinaryFormat())
+    {
+        thread_local BinaryRecordBuilder builder;
+        uint32_t length;
+        builder.Begin(type);
+        binary(builder);
+        const uint8_t* record = builder.Finish(length);
+        ProfilerLogger::LogBinary(record, length);
+    }
+    else
+    {
+        thread_local JsonWriter writer;
+        uint32_t length;
+        writer.Begin();
+        writer.BeginObject();
+        json(writer);
+        writer.EndObject();
+        const char* line = writer.Finish(length);
+        ProfilerLogger::LogJson(stream, line, length);
+    }
+}
+
+// Staged bytes per stream are written out once they pass this size, even in
+// the middle of a drain pass.
+static const size_t c_stagingFlushThreshold = 1024 * 1024;
+
 bool ProfilerLogger::OpenLogFiles()
 {
-    std::wstring jitPath, enter3Path, modulePath;
-    wchar_t pathBuffer[1024];
+    static const wchar_t* const fileNames[(size_t)LogStream::Count] = {
+        L"jit.json",
+        L"enter3.json",
+        L"modules.json",
+        L"trace.bin"
+    };
+
+    bool succeeded = true;
 
-    GetLogPath(L"jit.json", pathBuffer, sizeof(pathBuffer) / sizeof(wchar_t));
-    jitPath = pathBuffer;
+    for (size_t i = 0; i < (size_t)LogStream::Count; i++)
+    {
+        if (g_binaryFormat != (i == (size_t)LogStream::Binary))
+            continue;
 
-    GetLogPath(L"enter3.json", pathBuffer, sizeof(pathBuffer) / sizeof(wchar_t));
-    enter3Path = pathBuffer;
+        if (g_mappedSink)
+        {
+            succeeded = g_mappedFiles[i].Open(GetLogPath(fileNames[i]), g_extentSize) && succeeded;
+            continue;
+        }
 
-    GetLogPath(L"modules.json", pathBuffer, sizeof(pathBuffer) / sizeof(wchar_t));
-    modulePath = pathBuffer;
+        g_logFiles[i] = Platform::OpenFileForWriting(GetLogPath(fileNames[i]));
+        succeeded = succeeded && g_logFiles[i] != nullptr;
+    }
 
-    errno_t err_jit = _wfopen_s(&g_jitLogFile, jitPath.c_str(), L"w");
-    errno_t err_enter3 = _wfopen_s(&g_enter3LogFile, enter3Path.c_str(), L"w");
-    errno_t err_module = _wfopen_s(&g_moduleLogFile, modulePath.c_str(), L"w");
+    TraceFormat::FileHeader header = TraceFormat::MakeFileHeader();
+    FILE* traceFile = g_logFiles[(size_t)LogStream::Binary];
+    if (traceFile != nullptr)
+    {
+        fwrite(&header, sizeof(header), 1, traceFile);
+        fflush(traceFile);
+    }
+    if (g_mappedFiles[(size_t)LogStream::Binary].IsOpen())
+        g_mappedFiles[(size_t)LogStream::Binary].Write(&header, sizeof(header));
 
-    return (err_jit == 0) && (err_enter3 == 0) && (err_module == 0);
+    g_mappedOpen = g_mappedSink;
+    return succeeded;
 }
 
 void ProfilerLogger::CloseLogFiles()
 {
-    if (g_jitLogFile != nullptr)
+    // Producers must have stopped writing to the mapped files; see Shutdown.
+    g_mappedOpen = false;
+
+    for (size_t i = 0; i < (size_t)LogStream::Count; i++)
+    {
+        if (g_mappedFiles[i].IsOpen())
+            g_mappedFiles[i].Close();
+
+        g_fileLocks[i].Enter();
+        if (g_logFiles[i] != nullptr)
+        {
+            fflush(g_logFiles[i]);
+            fclose(g_logFiles[i]);
+            g_logFiles[i] = nullptr;
+        }
+        g_fileLocks[i].Leave();
+    }
+}
+
+void ProfilerLogger::ReadSettings()
+{
+    std::wstring value;
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_OVERFLOW", value))
+    {
+        if (Platform::CompareNoCase(value.c_str(), L"drop") == 0)
+            g_overflowPolicy = OverflowPolicy::Drop;
+        else if (Platform::CompareNoCase(value.c_str(), L"spill") == 0)
+            g_overflowPolicy = OverflowPolicy::Spill;
+        else
+            g_overflowPolicy = OverflowPolicy::Block;
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_FORMAT", value))
+    {
+        g_binaryFormat = (Platform::CompareNoCase(value.c_str(), L"binary") == 0);
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_SINK", value))
+    {
+        g_mappedSink = (Platform::CompareNoCase(value.c_str(), L"mapped") == 0);
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_EXTENT_MB", value))
+    {
+        int mb = Platform::ParseInt(value);
+        if (mb > 0)
+            g_extentSize = (size_t)mb * 1024 * 1024;
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_BUFFER_KB", value))
+    {
+        int kb = Platform::ParseInt(value);
+        if (kb > 0)
+            g_threadBufferSize = (size_t)kb * 1024;
+    }
+
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_FLUSH_MS", value))
+    {
+        int ms = Platform::ParseInt(value);
+        if (ms > 0)
+            g_flushIntervalMs = (DWORD)ms;
+    }
+}
+
+void ProfilerLogger::Initialize()
+{
+    if (g_initialized)
+        return;
+
+    for (size_t i = 0; i < (size_t)LogStream::Count; i++)
+    {
+        g_fileLocks[i].Initialize();
+    }
+    g_threadBufferLock.Initialize();
+    g_drainLock.Initialize();
+    if (!g_threadStatsReady)
+    {
+        g_threadStatsLock.Initialize();
+        g_threadStatsReady = true;
+    }
+
+    ReadSettings();
+    OpenLogFiles();
+
+    // Until the flusher is up, records are written synchronously. Mapped
+    // files need no flusher.
+    if (!g_mappedSink && g_flushEvent.Create())
+    {
+        g_stopFlusher = false;
+        if (g_flusherThread.Start(FlusherThreadProc, nullptr))
+            g_flusherRunning = true;
+    }
+
+    g_initialized = true;
+}
+
+void ProfilerLogger::Shutdown(bool processTerminating)
+{
+    if (!g_initialized)
+        return;
+
+    // New records go straight to the files from here on.
+    g_flusherRunning = false;
+
+    if (g_flusherThread.IsStarted())
+    {
+        g_stopFlusher = true;
+        g_flushEvent.Set();
+        if (processTerminating)
+            g_flusherThread.Detach();
+        else
+            g_flusherThread.Join();
+    }
+
+    // From here on records to the mapped files are dropped.
+    g_mappedOpen = false;
+
+    // Wait out producers that saw the flusher running, or the mapped files
+    // open, and are still appending.
+    if (!processTerminating)
+    {
+        g_threadBufferLock.Enter();
+        for (ThreadBuffer* buffer = g_threadBuffers; buffer != nullptr; buffer = buffer->next)
+        {
+            while (buffer->writing.load())
+                Platform::YieldThread();
+        }
+        g_threadBufferLock.Leave();
+
+        g_threadStatsLock.Enter();
+        for (ThreadStats* stats = g_threadStats; stats != nullptr; stats = stats->next)
+        {
+            while (stats->writing.load())
+                Platform::YieldThread();
+        }
+        g_threadStatsLock.Leave();
+    }
+
+    DrainThreadBuffers();
+    CloseLogFiles();
+
+    long long dropped = g_droppedRecords.load();
+    if (dropped > 0)
+    {
+        wchar_t message[128];
+        swprintf(message, 128, L"JitProfilerPlugin: %lld log records dropped on full thread buffers or mapped files that could not grow\n", dropped);
+        Platform::DebugOutput(message);
+    }
+
+    // A detached flusher may still be waiting on the event while the process exits.
+    if (!processTerminating)
+        g_flushEvent.Close();
+
+    g_initialized = false;
+}
+
+void ProfilerLogger::ReleaseThreadBuffer()
+{
+    if (t_threadBuffer != nullptr)
+    {
+        t_threadBuffer->retired.store(true, std::memory_order_release);
+        t_threadBuffer = nullptr;
+    }
+
+    if (t_threadStats != nullptr)
+    {
+        t_threadStats->retired.store(true, std::memory_order_release);
+        t_threadStats = nullptr;
+    }
+}
+
+ProfilerLogger::ThreadStats* ProfilerLogger::CreateThreadStats()
+{
+    if (!g_initialized)
+        return nullptr;
+
+    ThreadStats* stats = new (std::nothrow) ThreadStats();
+    if (stats == nullptr)
+        return nullptr;
+
+    g_threadStatsLock.Enter();
+    stats->next = g_threadStats;
+    g_threadStats = stats;
+    g_threadStatsLock.Leave();
+
+    t_threadStats = stats;
+    Platform::NotifyOnThreadExit(ReleaseThreadBuffer);
+    return stats;
+}
+
+void ProfilerLogger::GetStats(Stats& stats)
+{
+    for (size_t i = 0; i < (size_t)StatCounter::Count; i++)
+        stats.counters[i] = 0;
+
+    // Still valid after Shutdown, so the final totals can be published.
+    if (g_threadStatsReady)
+    {
+        g_threadStatsLock.Enter();
+        ThreadStats** link = &g_threadStats;
+        while (*link != nullptr)
+        {
+            ThreadStats* threadStats = *link;
+
+            // A retired thread no longer counts; fold its totals in and free it.
+            bool retired = threadStats->retired.load(std::memory_order_acquire);
+            for (size_t i = 0; i < (size_t)StatCounter::Count; i++)
+            {
+                uint64_t value = threadStats->counters[i].load(std::memory_order_relaxed);
+                if (retired)
+                    g_retiredCounters[i] += value;
+                else
+                    stats.counters[i] += value;
+            }
+
+            if (retired)
+            {
+                *link = threadStats->next;
+                delete threadStats;
+            }
+            else
+            {
+                link = &threadStats->next;
+            }
+        }
+
+        for (size_t i = 0; i < (size_t)StatCounter::Count; i++)
+            stats.counters[i] += g_retiredCounters[i];
+        g_threadStatsLock.Leave();
+    }
+
+    stats.bytesWritten = g_bytesWritten.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < (size_t)LogStream::Count; i++)
+        stats.bytesWritten += g_mappedFiles[i].Length();
+    stats.droppedRecords = (uint64_t)g_droppedRecords.load(std::memory_order_relaxed);
+    stats.flushCount = g_flushCount.load(std::memory_order_relaxed);
+    stats.flushTotalMicroseconds = g_flushTotalMicroseconds.load(std::memory_order_relaxed);
+    stats.flushMaxMicroseconds = g_flushMaxMicroseconds.load(std::memory_order_relaxed);
+    stats.lastFlushMicroseconds = g_lastFlushMicroseconds.load(std::memory_order_relaxed);
+}
+
+ProfilerLogger::ThreadBuffer* ProfilerLogger::GetThreadBuffer()
+{
+    ThreadBuffer* buffer = t_threadBuffer;
+    if (buffer != nullptr)
+        return buffer;
+
+    buffer = new (std::nothrow) ThreadBuffer(g_threadBufferSize);
+    if (buffer == nullptr)
+        return nullptr;
+
+    g_threadBufferLock.Enter();
+    buffer->next = g_threadBuffers;
+    g_threadBuffers = buffer;
+    g_threadBufferLock.Leave();
+
+    t_threadBuffer = buffer;
+    Platform::NotifyOnThreadExit(ReleaseThreadBuffer);
+    return buffer;
+}
+
+void ProfilerLogger::Append(LogStream stream, const char* data, uint32_t length)
+{
+    Count(StatCounter::BytesBuffered, length);
+
+    if (g_mappedSink)
+    {
+        WriteMapped(stream, data, length);
+        return;
+    }
+
+    ThreadBuffer* buffer = g_flusherRunning ? GetThreadBuffer() : nullptr;
+    if (buffer == nullptr || length > buffer->ring.MaxRecordLength())
+    {
+        WriteDirect(stream, data, length);
+        return;
+    }
+
+    // Shutdown flips g_flusherRunning and then waits for 'writing' to clear,
+    // so a record is either in the ring before the final drain or written directly.
+    buffer->writing.store(true);
+    if (!g_flusherRunning.load())
+    {
+        buffer->writing.store(false, std::memory_order_release);
+        WriteDirect(stream, data, length);
+        return;
+    }
+
+    bool written = buffer->ring.TryWrite((uint32_t)stream, data, length);
+    while (!written)
+    {
+        if (g_overflowPolicy == OverflowPolicy::Drop)
+        {
+            g_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+
+        if (g_overflowPolicy == OverflowPolicy::Spill || !g_flusherRunning.load(std::memory_order_relaxed))
+        {
+            WriteDirect(stream, data, length);
+            break;
+        }
+
+        g_flushEvent.Set();
+        Platform::YieldThread();
+        written = buffer->ring.TryWrite((uint32_t)stream, data, length);
+    }
+
+    buffer->writing.store(false, std::memory_order_release);
+
+    if (written && buffer->ring.Used() > buffer->ring.Capacity() / 2)
+        g_flushEvent.Set();
+}
+
+void ProfilerLogger::WriteDirect(LogStream stream, const char* data, size_t length)
+{
+    size_t index = (size_t)stream;
+    g_fileLocks[index].Enter();
+    if (g_logFiles[index] != nullptr)
+    {
+        fwrite(data, 1, length, g_logFiles[index]);
+        fflush(g_logFiles[index]);
+        g_bytesWritten.fetch_add(length, std::memory_order_relaxed);
+    }
+    g_fileLocks[index].Leave();
+}
+
+void ProfilerLogger::WriteMapped(LogStream stream, const char* data, uint32_t length)
+{
+    // Count has created the thread's stats unless the logger is not running.
+    ThreadStats* stats = t_threadStats;
+    if (stats == nullptr)
+        return;
+
+    // Same handshake as the thread buffers: Shutdown clears g_mappedOpen and
+    // then waits for 'writing' to clear before it unmaps the files.
+    stats->writing.store(true);
+    if (g_mappedOpen.load() && !g_mappedFiles[(size_t)stream].Write(data, length))
+        g_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+    stats->writing.store(false, std::memory_order_release);
+}
+
+size_t ProfilerLogger::DrainThreadBuffers()
+{
+    // The rings are single-consumer: only one drain pass may run at a time.
+    g_drainLock.Enter();
+
+    size_t records = 0;
+    auto stage = [](uint32_t stream, const char* data, size_t length)
+    {
+        if (stream < (uint32_t)LogStream::Count)
+            g_staging[stream].insert(g_staging[stream].end(), data, data + length);
+    };
+
+    // Only the drain unlinks buffers, so the copy stays valid once the lock is
+    // released; a thread registering its first buffer never waits on a write.
+    g_drainBuffers.clear();
+    g_threadBufferLock.Enter();
+    for (ThreadBuffer* buffer = g_threadBuffers; buffer != nullptr; buffer = buffer->next)
+        g_drainBuffers.push_back(buffer);
+    g_threadBufferLock.Leave();
+
+    g_retiredBuffers.clear();
+    for (ThreadBuffer* buffer : g_drainBuffers)
     {
-        fflush(g_jitLogFile);
-        fclose(g_jitLogFile);
-        g_jitLogFile = nullptr;
+        // Read before draining: anything the thread wrote before retiring is drained below.
+        bool retired = buffer->retired.load(std::memory_order_acquire);
+        records += buffer->ring.Drain(stage);
+        if (retired)
+            g_retiredBuffers.push_back(buffer);
+
+        for (size_t i = 0; i < (size_t)LogStream::Count; i++)
+        {
+            if (g_staging[i].size() >= c_stagingFlushThreshold)
+            {
+                WriteDirect((LogStream)i, g_staging[i].data(), g_staging[i].size());
+                g_staging[i].clear();
+            }
+        }
     }
 
-    if (g_enter3LogFile != nullptr)
+    if (!g_retiredBuffers.empty())
     {
-        fflush(g_enter3LogFile);
-        fclose(g_enter3LogFile);
-        g_enter3LogFile = nullptr;
+        g_threadBufferLock.Enter();
+        ThreadBuffer** link = &g_threadBuffers;
+        while (*link != nullptr)
+        {
+            ThreadBuffer* buffer = *link;
+            if (std::find(g_retiredBuffers.begin(), g_retiredBuffers.end(), buffer) != g_retiredBuffers.end())
+                *link = buffer->next;
+            else
+                link = &buffer->next;
+        }
+        g_threadBufferLock.Leave();
+
+        for (ThreadBuffer* buffer : g_retiredBuffers)
+            delete buffer;
     }
 
-    if (g_moduleLogFile != nullptr)
+    for (size_t i = 0; i < (size_t)LogStream::Count; i++)
     {
-        fflush(g_moduleLogFile);
-        fclose(g_moduleLogFile);
-        g_moduleLogFile = nullptr;
+        if (!g_staging[i].empty())
+        {
+            WriteDirect((LogStream)i, g_staging[i].data(), g_staging[i].size());
+            g_staging[i].clear();
+        }
+    }
+
+    g_drainLock.Leave();
+    return records;
+}
+
+void ProfilerLogger::FlusherThreadProc(void* parameter)
+{
+    while (!g_stopFlusher.load())
+    {
+        g_flushEvent.Wait(g_flushIntervalMs);
+
+        auto start = std::chrono::steady_clock::now();
+        size_t records = DrainThreadBuffers();
+        if (records == 0)
+            continue;
+
+        // Only the flusher writes these, so plain stores are enough.
+        uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        g_flushCount.store(g_flushCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        g_flushTotalMicroseconds.store(g_flushTotalMicroseconds.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+        if (elapsed > g_flushMaxMicroseconds.load(std::memory_order_relaxed))
+            g_flushMaxMicroseconds.store(elapsed, std::memory_order_relaxed);
+        g_lastFlushMicroseconds.store(elapsed, std::memory_order_relaxed);
     }
 }
 
@@ -67,20 +571,26 @@ void __stdcall GlobalEnter3Callback(FunctionIDOrClientID functionIDOrClientID, C
     }
 }
 
+UINT_PTR __stdcall GlobalFunctionIDMapper(FunctionID functionId, void* clientData, BOOL* pbHookFunction)
+{
+    return ((JitProfilerPlugin*)clientData)->MapFunction(functionId, pbHookFunction);
+}
+
 JitProfilerPlugin::JitProfilerPlugin()
-    : profilerInfo(NULL), refCount(1), hMapFile(NULL), pSharedFlag(nullptr)
+    : profilerInfo(NULL), refCount(1),
+      jitLoggedFunctions(64 * 1024), enter3LoggedFunctions(64 * 1024), moduleLoggedFunctions(1024, 8),
+      captureMode(CaptureMode::Enter3), jitTiming(false), sizedFunctions(64 * 1024), tierTracking(false), cachedFunctions(64 * 1024), inliningGraph(false), inliningEdges(16 * 1024),
+      threadTagging(false), threadCount(0), callCounting(false), callCountTables(nullptr),
+      callCountSession(s_callCountSessions.fetch_add(1, std::memory_order_relaxed) + 1), loggedCalls(0), stopWorker(false),
+      pControlBlock(nullptr), hasFullControlBlock(false)
 {
-    InitializeCriticalSection(&jitLock);
-    InitializeCriticalSection(&enter3Lock);
-    InitializeCriticalSection(&moduleLock);
+    callCountLock.Initialize();
     SetInstance(this);
 }
 
 JitProfilerPlugin::~JitProfilerPlugin()
 {
-    DeleteCriticalSection(&jitLock);
-    DeleteCriticalSection(&enter3Lock);
-    DeleteCriticalSection(&moduleLock);
+    StopWorker();
 
     if (profilerInfo != NULL)
     {
@@ -88,39 +598,36 @@ JitProfilerPlugin::~JitProfilerPlugin()
         profilerInfo = NULL;
     }
 
-    if (pSharedFlag != nullptr)
-    {
-        UnmapViewOfFile((LPCVOID)pSharedFlag);
-        pSharedFlag = nullptr;
-    }
+    controlMemory.Close();
+    pControlBlock = nullptr;
 
-    if (hMapFile != NULL)
+    while (callCountTables != nullptr)
     {
-        CloseHandle(hMapFile);
-        hMapFile = NULL;
+        CallCountTable* next = callCountTables->next;
+        delete callCountTables;
+        callCountTables = next;
     }
 
     SetInstance(nullptr);
 }
 
-bool JitProfilerPlugin::IsProfilingEnabled() const
+bool JitProfilerPlugin::IsEventEnabled(uint32_t eventBit) const
 {
-    if (pSharedFlag == nullptr)
+    if (pControlBlock == nullptr)
         return true;
-    return (*pSharedFlag != 0);
+    if (pControlBlock->enabled == 0)
+        return false;
+    return !hasFullControlBlock || (pControlBlock->eventMask & eventBit) != 0;
 }
 
 void JitProfilerPlugin::InitializeMaxRecurseDepth()
 {
     s_maxRecurseDepth = 20;
-    DWORD envLen = GetEnvironmentVariableW(L"SIG_JIT_PROFILER_MAX_RECURSE", nullptr, 0);
-    if (envLen > 0) {
-        std::wstring buffer(envLen, L'\0');
-        if (GetEnvironmentVariableW(L"SIG_JIT_PROFILER_MAX_RECURSE", &buffer[0], envLen) > 0) {
-            int value = _wtoi(buffer.c_str());
-            if (value > 0) {
-                s_maxRecurseDepth = value;
-            }
+    std::wstring setting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_MAX_RECURSE", setting)) {
+        int value = Platform::ParseInt(setting);
+        if (value > 0) {
+            s_maxRecurseDepth = value;
         }
     }
 }
@@ -132,13 +639,47 @@ HRESULT STDMETHODCALLTYPE JitProfilerPlugin::Initialize(IUnknown* pICorProfilerI
 
 HRESULT STDMETHODCALLTYPE JitProfilerPlugin::Shutdown()
 {
+    TypeArgCache::Stats cacheStats = typeArgCache.GetStats();
+    wchar_t message[160];
+    swprintf(message, 160, L"JitProfilerPlugin: type argument cache %llu hits, %llu misses, %llu invalidations\n",
+        (unsigned long long)cacheStats.hits, (unsigned long long)cacheStats.misses, (unsigned long long)cacheStats.invalidations);
+    Platform::DebugOutput(message);
+
+    // Deferred functions are resolved while the runtime can still answer.
+    StopWorker();
+
+    CaptureAdmission::Stats admissionStats = admission.GetStats();
+    swprintf(message, 160, L"JitProfilerPlugin: %llu functions sampled out, %llu rate limited, %llu deferred\n",
+        (unsigned long long)admissionStats.sampledOut, (unsigned long long)admissionStats.rateLimited, (unsigned long long)admissionStats.deferred);
+    Platform::DebugOutput(message);
+
+    if (callCounting)
+    {
+        MergeCallCounts();
+        LogCallCounts();
+        swprintf(message, 160, L"JitProfilerPlugin: %llu calls counted\n", (unsigned long long)loggedCalls);
+        Platform::DebugOutput(message);
+    }
+
+    if (inliningGraph)
+    {
+        ProfilerLogger::Stats loggerStats;
+        ProfilerLogger::GetStats(loggerStats);
+        swprintf(message, 160, L"JitProfilerPlugin: %llu inlining callbacks, %llu edges, %llu us in the callback\n",
+            (unsigned long long)loggerStats.counters[(size_t)StatCounter::InliningCallbacks],
+            (unsigned long long)loggerStats.counters[(size_t)StatCounter::InliningEdges],
+            (unsigned long long)(loggerStats.counters[(size_t)StatCounter::InliningNanoseconds] / 1000));
+        Platform::DebugOutput(message);
+    }
+
     if (profilerInfo != NULL)
     {
         profilerInfo->Release();
         profilerInfo = NULL;
     }
 
-    ProfilerLogger::CloseLogFiles();
+    ProfilerLogger::Shutdown(false);
+    PublishStats();
     return S_OK;
 }
 
@@ -162,10 +703,60 @@ HRESULT STDMETHODCALLTYPE JitProfilerPlugin::InitializeForAttach(
         return E_FAIL;
     }
 
-    DWORD eventMask =
-        COR_PRF_MONITOR_JIT_COMPILATION |
-        COR_PRF_MONITOR_ENTERLEAVE |
-        COR_PRF_ENABLE_FRAME_INFO;
+    std::wstring captureSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_CAPTURE_MODE", captureSetting))
+    {
+        if (Platform::CompareNoCase(captureSetting.c_str(), L"mapper") == 0)
+            captureMode = CaptureMode::Mapper;
+        else if (Platform::CompareNoCase(captureSetting.c_str(), L"jit") == 0)
+            captureMode = CaptureMode::Jit;
+    }
+
+    std::wstring timingSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_JIT_TIMING", timingSetting))
+        jitTiming = Platform::ParseInt(timingSetting) != 0;
+
+    std::wstring tierSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_TIERS", tierSetting))
+        tierTracking = Platform::ParseInt(tierSetting) != 0;
+    if (tierTracking)
+        jitTiming = true;
+
+    std::wstring inliningSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_INLINING", inliningSetting))
+        inliningGraph = Platform::ParseInt(inliningSetting) != 0;
+
+    std::wstring callCountSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_CALL_COUNTS", callCountSetting))
+        callCounting = Platform::ParseInt(callCountSetting) != 0;
+
+    // Counting needs every call to reach the hook, which only Enter3 mode does.
+    if (callCounting)
+        captureMode = CaptureMode::Enter3;
+
+    std::wstring threadSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_THREADS", threadSetting))
+        threadTagging = Platform::ParseInt(threadSetting) != 0;
+
+    // Class loads are monitored so that unloaded ClassIDs leave the type argument cache.
+    // Module loads are monitored so that module records are written off the capture path.
+    DWORD eventMask = COR_PRF_MONITOR_JIT_COMPILATION | COR_PRF_MONITOR_CLASS_LOADS | COR_PRF_MONITOR_MODULE_LOADS;
+    if (captureMode != CaptureMode::Jit)
+    {
+        eventMask |= COR_PRF_MONITOR_ENTERLEAVE | COR_PRF_ENABLE_FRAME_INFO;
+    }
+
+    // Cache searches show which functions ran precompiled code before their
+    // first JIT. Tier-up recompilations arrive as further JITCompilationStarted calls.
+    if (jitTiming)
+    {
+        eventMask |= COR_PRF_MONITOR_CACHE_SEARCHES;
+    }
+
+    if (threadTagging)
+    {
+        eventMask |= COR_PRF_MONITOR_THREADS;
+    }
 
     hr = profilerInfo->SetEventMask(eventMask);
     if (FAILED(hr))
@@ -175,145 +766,475 @@ HRESULT STDMETHODCALLTYPE JitProfilerPlugin::InitializeForAttach(
         return hr;
     }
 
-    hr = profilerInfo->SetEnterLeaveFunctionHooks3WithInfo(GlobalEnter3Callback, NULL, NULL);
-    if (FAILED(hr))
+    if (captureMode != CaptureMode::Jit)
+    {
+        hr = profilerInfo->SetEnterLeaveFunctionHooks3WithInfo(GlobalEnter3Callback, NULL, NULL);
+        if (FAILED(hr))
+        {
+            profilerInfo->Release();
+            profilerInfo = NULL;
+            return hr;
+        }
+    }
+
+    if (captureMode == CaptureMode::Mapper)
+    {
+        hr = profilerInfo->SetFunctionIDMapper2(GlobalFunctionIDMapper, this);
+        if (FAILED(hr))
+        {
+            captureMode = CaptureMode::Enter3;
+        }
+    }
+
+    std::wstring mapName(L"SIG_JITPROFILER");
+    std::wstring mapSetting;
+    if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_MAP_ID", mapSetting)) {
+        mapName = mapSetting;
+    }
+
+    // Older controllers create only the 4-byte flag.
+    size_t mappedSize = 0;
+    pControlBlock = (ControlBlock*)controlMemory.Open(mapName, mappedSize);
+    if (pControlBlock != nullptr)
+    {
+        hasFullControlBlock =
+            mappedSize >= sizeof(ControlBlock) &&
+            pControlBlock->magic == ControlBlock::Magic &&
+            pControlBlock->version >= ControlBlock::CurrentVersion &&
+            pControlBlock->size >= sizeof(ControlBlock);
+
+        if (hasFullControlBlock)
+            pControlBlock->attachedProcessId.store(Platform::GetProcessId(), std::memory_order_relaxed);
+    }
+
+    admission.ReadEnvironment();
+    RefreshAdmission();
+    StartWorker();
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::JITCompilationStarted(FunctionID functionId, BOOL fIsSafeToBlock)
+{
+    if (!IsEventEnabled(ControlBlock::EventJit))
+        return S_OK;
+
+    LogJitStarted(functionId);
+
+    // Taken last so that logging is not counted as JIT time. Tier-up
+    // recompilations are timed too, although only the first is logged.
+    if (jitTiming)
+        t_jitTimings.Push(functionId, Platform::GetTimestampNs());
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::JITCompilationFinished(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock)
+{
+    if (!jitTiming)
+        return S_OK;
+
+    uint64_t finish = Platform::GetTimestampNs();
+    uint64_t start;
+    if (!t_jitTimings.Pop(functionId, start))
+        return S_OK;
+
+    if (IsEventEnabled(ControlBlock::EventJit))
+        LogJitFinished(functionId, start, finish, hrStatus);
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::JITCachedFunctionSearchStarted(FunctionID functionId, BOOL* pbUseCachedFunction)
+{
+    // Watching the search must not change its outcome.
+    if (pbUseCachedFunction != nullptr)
+        *pbUseCachedFunction = TRUE;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::JITCachedFunctionSearchFinished(FunctionID functionId, COR_PRF_JIT_CACHE result)
+{
+    if (!jitTiming || result != COR_PRF_CACHED_FUNCTION_FOUND || !IsEventEnabled(ControlBlock::EventJit))
+        return S_OK;
+
+    if (!cachedFunctions.InsertIfAbsent(functionId))
+        ProfilerLogger::Count(StatCounter::DedupHits);
+    else if (tierTracking)
+        LogCacheHit(functionId, Platform::GetTimestampNs());
+
+    return S_OK;
+}
+
+// Fills in the calling thread's index, its next sequence number and the time.
+// A thread's first tag also logs the Thread record that maps the index to its
+// ThreadID. Enter3 records of deferred functions are captured, and so tagged,
+// on the worker thread.
+void JitProfilerPlugin::TagRecord(RecordTag& tag)
+{
+    if (t_threadIndex == 0)
+    {
+        t_threadIndex = threadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        ThreadID threadId = 0;
+        if (profilerInfo == NULL || FAILED(profilerInfo->GetCurrentThreadID(&threadId)))
+            threadId = 0;
+
+        uint64_t time = Platform::GetTimestampNs();
+        EmitRecord(TraceFormat::RecordThread, LogStream::Jit,
+            [&](BinaryRecordBuilder& builder)
+            {
+                builder.WriteVarint(t_threadIndex);
+                builder.WriteVarint(threadId);
+                builder.WriteVarint(time);
+            },
+            [&](JsonWriter& writer)
+            {
+                writer.Property("Event", "Thread", 6);
+                writer.Property("Thread", t_threadIndex);
+                writer.Property("ThreadID", threadId);
+                writer.Property("Time", time);
+            });
+    }
+
+    tag.threadIndex = t_threadIndex;
+    tag.sequence = ++t_threadSequence;
+    tag.time = Platform::GetTimestampNs();
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ThreadCreated(ThreadID threadId)
+{
+    if (threadTagging && IsCaptureEnabled())
+        LogThreadEvent(TraceFormat::RecordThreadCreated, "ThreadCreated", 13, threadId, Platform::GetTimestampNs());
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ThreadDestroyed(ThreadID threadId)
+{
+    if (threadTagging && IsCaptureEnabled())
+        LogThreadEvent(TraceFormat::RecordThreadDestroyed, "ThreadDestroyed", 15, threadId, Platform::GetTimestampNs());
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ThreadAssignedToOSThread(ThreadID managedThreadId, DWORD osThreadId)
+{
+    if (!threadTagging || !IsCaptureEnabled())
+        return S_OK;
+
+    EmitRecord(TraceFormat::RecordThreadAssigned, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(managedThreadId);
+            builder.WriteVarint(osThreadId);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("Event", "ThreadAssigned", 14);
+            writer.Property("ThreadID", managedThreadId);
+            writer.Property("OSThreadID", osThreadId);
+        });
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ThreadNameChanged(ThreadID threadId, ULONG cchName, WCHAR* name)
+{
+    if (!threadTagging || !IsCaptureEnabled())
+        return S_OK;
+
+    // A cleared name comes as null.
+    size_t nameChars = name != nullptr ? Platform::StringLength(name, cchName) : 0;
+    EmitRecord(TraceFormat::RecordThreadName, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(threadId);
+            builder.WriteString(name, nameChars);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("Event", "ThreadName", 10);
+            writer.Property("ThreadID", threadId);
+            writer.Property("Name", name, nameChars);
+        });
+    return S_OK;
+}
+
+void JitProfilerPlugin::LogThreadEvent(TraceFormat::RecordType type, const char* eventName, size_t eventNameLength, ThreadID threadId, uint64_t time)
+{
+    EmitRecord(type, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(threadId);
+            builder.WriteVarint(time);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("Event", eventName, eventNameLength);
+            writer.Property("ThreadID", threadId);
+            writer.Property("Time", time);
+        });
+}
+
+// Both IDs are mixed into one set key. Two pairs with the same key would
+// lose the second edge, which at 64 bits is too rare to matter.
+static uintptr_t InliningEdgeKey(FunctionID callerId, FunctionID calleeId)
+{
+    uint64_t key = (uint64_t)callerId * 0x9E3779B97F4A7C15ULL;
+    key ^= (uint64_t)calleeId + 0x632BE59BD9B4E019ULL + (key << 6) + (key >> 2);
+
+    // 0 and ~0 are reserved by ConcurrentIdSet.
+    if (key == 0 || key == ~(uint64_t)0)
+        key = 1;
+    return (uintptr_t)key;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::JITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline)
+{
+    // The JIT's decision stands; *pfShouldInline is left as it is.
+    if (!inliningGraph || !IsEventEnabled(ControlBlock::EventJit))
+        return S_OK;
+
+    uint64_t start = Platform::GetTimestampNs();
+    ProfilerLogger::Count(StatCounter::InliningCallbacks);
+
+    if (inliningEdges.InsertIfAbsent(InliningEdgeKey(callerId, calleeId)))
+    {
+        ProfilerLogger::Count(StatCounter::InliningEdges);
+        LogInlining(callerId, calleeId);
+    }
+
+    ProfilerLogger::Count(StatCounter::InliningNanoseconds, Platform::GetTimestampNs() - start);
+    return S_OK;
+}
+
+void JitProfilerPlugin::LogJitStarted(FunctionID functionId)
+{
+    ProfilerLogger::Count(StatCounter::JitEvents);
+    if (!jitLoggedFunctions.InsertIfAbsent(functionId))
     {
-        profilerInfo->Release();
-        profilerInfo = NULL;
-        return hr;
+        ProfilerLogger::Count(StatCounter::DedupHits);
+        return;
     }
 
-    std::wstring mapName(L"SIG_JITPROFILER");
-    DWORD envLen = GetEnvironmentVariableW(L"SIG_JIT_PROFILER_MAP_ID", nullptr, 0);
-    if (envLen > 0) {
-        std::wstring buffer(envLen, L'\0');
-        if (GetEnvironmentVariableW(L"SIG_JIT_PROFILER_MAP_ID", &buffer[0], envLen) > 0) {
-            mapName = buffer.substr(0, wcsnlen_s(buffer.c_str(), buffer.size()));
-        }
+    EmitRecord(TraceFormat::RecordJit, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(functionId);
+            if (threadTagging)
+            {
+                RecordTag tag;
+                TagRecord(tag);
+                builder.WriteVarint(tag.threadIndex);
+                builder.WriteVarint(tag.sequence);
+                builder.WriteVarint(tag.time);
+            }
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("FunctionID", functionId);
+            if (threadTagging)
+            {
+                RecordTag tag;
+                TagRecord(tag);
+                writer.Property("Thread", tag.threadIndex);
+                writer.Property("Seq", tag.sequence);
+                writer.Property("Time", tag.time);
+            }
+        });
+
+    // Without a call frame, code shared between instantiations resolves to
+    // its canonical form, with System.__Canon for reference type arguments.
+    if (captureMode == CaptureMode::Jit && profilerInfo != NULL && IsEventEnabled(ControlBlock::EventEnter3) &&
+        enter3LoggedFunctions.InsertIfAbsent(functionId))
+    {
+        RefreshAdmission();
+        CaptureWithoutFrame(functionId);
     }
+}
 
-    hMapFile = OpenFileMappingW(FILE_MAP_READ, FALSE, mapName.c_str());
-    if (hMapFile != NULL)
+void JitProfilerPlugin::LogJitFinished(FunctionID functionId, uint64_t start, uint64_t finish, HRESULT hrStatus)
+{
+    // Hot and cold regions; a failed compilation has no code. GetCodeInfo2
+    // finds the code the function runs now, which is what its first
+    // compilation produced, but is still precompiled code or the previous
+    // tier's while a recompile finishes, so only the first is sized.
+    uint64_t codeSize = 0;
+    if (SUCCEEDED(hrStatus) && profilerInfo != NULL && !cachedFunctions.Contains(functionId) &&
+        sizedFunctions.InsertIfAbsent(functionId))
     {
-        pSharedFlag = (volatile int32_t*)MapViewOfFile(hMapFile, FILE_MAP_READ, 0, 0, sizeof(int32_t));
-        if (pSharedFlag == NULL)
+        COR_PRF_CODE_INFO codeInfos[4];
+        ULONG32 count = 0;
+        if (SUCCEEDED(profilerInfo->GetCodeInfo2(functionId, 4, &count, codeInfos)))
         {
-            CloseHandle(hMapFile);
-            hMapFile = NULL;
+            for (ULONG32 i = 0; i < count && i < 4; i++)
+                codeSize += codeInfos[i].size;
         }
     }
 
-    return S_OK;
+    EmitRecord(TraceFormat::RecordJitFinished, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(functionId);
+            builder.WriteVarint(start);
+            builder.WriteVarint(finish - start);
+            builder.WriteVarint(codeSize);
+            builder.WriteVarint((uint32_t)hrStatus);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("FunctionID", functionId);
+            writer.Property("Event", "JitFinished", 11);
+            writer.Property("Start", start);
+            writer.Property("Finish", finish);
+            writer.Property("CodeSize", codeSize);
+            writer.Property("HResult", (uint64_t)(uint32_t)hrStatus);
+        });
 }
 
-HRESULT STDMETHODCALLTYPE JitProfilerPlugin::JITCompilationStarted(FunctionID functionId, BOOL fIsSafeToBlock)
+void JitProfilerPlugin::LogCacheHit(FunctionID functionId, uint64_t time)
 {
-    if (!IsProfilingEnabled())
-        return S_OK;
+    EmitRecord(TraceFormat::RecordCacheHit, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(functionId);
+            builder.WriteVarint(time);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("FunctionID", functionId);
+            writer.Property("Event", "CacheHit", 8);
+            writer.Property("Time", time);
+        });
+}
 
-    EnterCriticalSection(&jitLock);
-    if (jitLoggedFunctions.find(functionId) != jitLoggedFunctions.end())
+// An inlined callee is often never called on its own, so it may have no Enter3
+// record. Its definition is logged with the edge so the parser can still name it.
+void JitProfilerPlugin::LogInlining(FunctionID callerId, FunctionID calleeId)
+{
+    ClassID classId = 0;
+    ModuleID moduleId = 0;
+    mdToken methodToken = 0;
+    if (profilerInfo == NULL || FAILED(profilerInfo->GetFunctionInfo2(calleeId, 0, &classId, &moduleId, &methodToken, 0, nullptr, nullptr)))
     {
-        LeaveCriticalSection(&jitLock);
-        return S_OK;
+        moduleId = 0;
+        methodToken = 0;
     }
 
-    jitLoggedFunctions.insert(functionId);
-    LeaveCriticalSection(&jitLock);
+    EnsureModuleLogged(moduleId);
 
-    ProfilerLogger::LogJIT(L"{\"FunctionID\":%llu}", (unsigned long long)functionId);
-    return S_OK;
+    EmitRecord(TraceFormat::RecordInlining, LogStream::Jit,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(callerId);
+            builder.WriteVarint(calleeId);
+            builder.WriteVarint(moduleId);
+            builder.WriteToken(methodToken);
+        },
+        [&](JsonWriter& writer)
+        {
+            // FunctionID is the caller, which is being JIT compiled, so older
+            // readers that ignore "Event" only see it again.
+            writer.Property("FunctionID", callerId);
+            writer.Property("Event", "Inlined", 7);
+            writer.Property("Callee", calleeId);
+            writer.Property("CalleeModuleID", moduleId);
+            writer.Property("CalleeToken", (uint64_t)methodToken);
+        });
 }
 
-std::wstring JitProfilerPlugin::EscapeJson(const std::wstring& str)
+static TypeArgEntry& AppendTypeArgEntry(BumpArena& arena, TypeArgList& list, ULONG32& capacity)
 {
-    std::wstring result;
-    result.reserve(str.length());
-    for (wchar_t c : str)
+    if (list.entryCount == capacity)
     {
-        switch (c)
-        {
-        case L'\"': result += L"\\\""; break;
-        case L'\\': result += L"\\\\"; break;
-        case L'\b': result += L"\\b"; break;
-        case L'\f': result += L"\\f"; break;
-        case L'\n': result += L"\\n"; break;
-        case L'\r': result += L"\\r"; break;
-        case L'\t': result += L"\\t"; break;
-        default: result += c; break;
-        }
+        ULONG32 newCapacity = capacity == 0 ? 16 : capacity * 2;
+        list.entries = arena.Grow(list.entries, list.entryCount, newCapacity);
+        capacity = newCapacity;
     }
-    return result;
+    return list.entries[list.entryCount++];
 }
 
-TypeArgInfo JitProfilerPlugin::ResolveTypeArgument(ClassID classId)
+static void AppendTypeArgTree(const TypeArgNode* node, int depth, int maxDepth, BumpArena& arena, TypeArgList& list, ULONG32& capacity)
 {
-    TypeArgInfo info;
-    ModuleID moduleId;
-    mdTypeDef typeDef;
-    ClassID parentClassId;
-    ULONG32 typeArgCount = 0;
-
-    if (profilerInfo == NULL)
+    TypeArgEntry& entry = AppendTypeArgEntry(arena, list, capacity);
+    if (node == nullptr)
     {
-        return info;
+        entry = TypeArgEntry();
+        return;
     }
 
-    HRESULT hr = profilerInfo->GetClassIDInfo2(
-        classId,
-        &moduleId,
-        &typeDef,
-        &parentClassId,
-        0,
-        &typeArgCount,
-        nullptr);
-
-    if (FAILED(hr))
-        return info;
+    entry.moduleId = node->moduleId;
+    entry.typeDef = node->typeDef;
+    entry.childCount = node->childCount;
+    entry.truncated = depth >= maxDepth && node->childCount > 0;
 
-    info.moduleId = moduleId;
-    info.typeDef = typeDef;
+    if (entry.truncated)
+        return;
 
-    if (typeArgCount > 0)
+    for (ULONG32 i = 0; i < node->childCount; i++)
     {
-        std::vector<ClassID> typeArgs(typeArgCount);
-        hr = profilerInfo->GetClassIDInfo2(
-            classId,
-            &moduleId,
-            &typeDef,
-            &parentClassId,
-            typeArgCount,
-            &typeArgCount,
-            typeArgs.data());
-
-        if (SUCCEEDED(hr))
-        {
-            for (ULONG32 i = 0; i < typeArgCount; i++)
-            {
-                info.nestedTypeArgs.push_back(ResolveTypeArgument(typeArgs[i]));
-            }
-        }
+        AppendTypeArgTree(node->children[i], depth + 1, maxDepth, arena, list, capacity);
     }
-
-    return info;
 }
 
-void JitProfilerPlugin::LogModuleInfo(ModuleID moduleId)
+void JitProfilerPlugin::ResolveTypeArguments(const ClassID* classIds, ULONG32 count, BumpArena& arena, TypeArgList& list)
 {
-    if (moduleLock.DebugInfo == NULL)
+    list = TypeArgList();
+    list.rootCount = count;
+
+    ULONG32 capacity = 0;
+    for (ULONG32 i = 0; i < count; i++)
     {
-        return;
+        AppendTypeArgTree(typeArgCache.Resolve(profilerInfo, classIds[i]), 0, s_maxRecurseDepth, arena, list, capacity);
     }
+}
 
-    EnterCriticalSection(&moduleLock);
-    if (moduleLoggedFunctions.find(moduleId) != moduleLoggedFunctions.end())
-    {
-        LeaveCriticalSection(&moduleLock);
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ClassUnloadStarted(ClassID classId)
+{
+    typeArgCache.Invalidate(classId);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ModuleLoadFinished(ModuleID moduleId, HRESULT hrStatus)
+{
+    // While capture is off the module is left to EnsureModuleLogged.
+    if (FAILED(hrStatus) || !IsCaptureEnabled())
+        return S_OK;
+
+    LogModuleInfo(moduleId, Platform::GetTimestampNs());
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE JitProfilerPlugin::ModuleUnloadStarted(ModuleID moduleId)
+{
+    if (!moduleLoggedFunctions.Contains(moduleId) || !IsCaptureEnabled())
+        return S_OK;
+
+    uint64_t time = Platform::GetTimestampNs();
+    EmitRecord(TraceFormat::RecordModuleUnload, LogStream::Module,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(moduleId);
+            builder.WriteVarint(time);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("ModuleID", moduleId);
+            writer.Property("Event", "Unloaded", 8);
+            writer.Property("Time", time);
+        });
+    return S_OK;
+}
+
+// loadTime is 0 when the module is logged on first use rather than at load.
+void JitProfilerPlugin::LogModuleInfo(ModuleID moduleId, uint64_t loadTime)
+{
+    // 0 stands for a type argument that could not be resolved.
+    if (moduleId == 0)
         return;
-    }
 
-    moduleLoggedFunctions.insert(moduleId);
-    LeaveCriticalSection(&moduleLock);
+    // The runtime can hand out a ModuleID again after an unload, so a load is
+    // logged even when the ID is already known.
+    if (!moduleLoggedFunctions.InsertIfAbsent(moduleId) && loadTime == 0)
+        return;
 
     if (profilerInfo == NULL)
     {
@@ -335,13 +1256,15 @@ void JitProfilerPlugin::LogModuleInfo(ModuleID moduleId)
     if (FAILED(hr) || moduleNameLen == 0)
         return;
 
-    std::wstring moduleName(moduleNameLen, L'\0');
+    BumpArenaScope scope(t_recordArena);
+
+    WCHAR* moduleName = t_recordArena.Allocate<WCHAR>(moduleNameLen);
     hr = profilerInfo->GetModuleInfo(
         moduleId,
         &baseLoadAddress,
         moduleNameLen,
         &moduleNameLen,
-        &moduleName[0],
+        moduleName,
         &assemblyId);
 
     if (FAILED(hr))
@@ -362,94 +1285,423 @@ void JitProfilerPlugin::LogModuleInfo(ModuleID moduleId)
     if (FAILED(hr) || assemblyNameLen == 0)
         return;
 
-    std::wstring assemblyName(assemblyNameLen, L'\0');
+    WCHAR* assemblyName = t_recordArena.Allocate<WCHAR>(assemblyNameLen);
     hr = profilerInfo->GetAssemblyInfo(
         assemblyId,
         assemblyNameLen,
         &assemblyNameLen,
-        &assemblyName[0],
+        assemblyName,
         &appDomainId,
         &manifestModuleId);
 
-    if (SUCCEEDED(hr))
-    {
-        std::wstring escapedModuleName = EscapeJson(moduleName);
-        std::wstring escapedAssemblyName = EscapeJson(assemblyName);
+    if (FAILED(hr))
+        return;
 
-        ProfilerLogger::LogModule(
-            L"{\"ModuleID\":%llu,\"ModuleName\":\"%s\",\"AssemblyID\":%llu,\"AssemblyName\":\"%s\"}",
-            (unsigned long long)moduleId, escapedModuleName.c_str(),
-            (unsigned long long)assemblyId, escapedAssemblyName.c_str());
-    }
+    // The reported lengths include the terminator.
+    size_t moduleNameChars = Platform::StringLength(moduleName, moduleNameLen);
+    size_t assemblyNameChars = Platform::StringLength(assemblyName, assemblyNameLen);
+
+    EmitRecord(TraceFormat::RecordModule, LogStream::Module,
+        [&](BinaryRecordBuilder& builder)
+        {
+            builder.WriteVarint(moduleId);
+            builder.WriteVarint(assemblyId);
+            builder.WriteString(moduleName, moduleNameChars);
+            builder.WriteString(assemblyName, assemblyNameChars);
+            builder.WriteVarint(loadTime);
+        },
+        [&](JsonWriter& writer)
+        {
+            writer.Property("ModuleID", moduleId);
+            writer.Property("ModuleName", moduleName, moduleNameChars);
+            writer.Property("AssemblyID", assemblyId);
+            writer.Property("AssemblyName", assemblyName, assemblyNameChars);
+            if (loadTime != 0)
+                writer.Property("LoadTime", loadTime);
+        });
+
+    ProfilerLogger::Count(StatCounter::ModuleRecords);
 }
 
-void JitProfilerPlugin::LogModuleMappingRecursive(const TypeArgInfo& typeArg, int currentDepth)
+void JitProfilerPlugin::LogTypeArgModules(const TypeArgList& typeArgs)
 {
-    if (currentDepth >= s_maxRecurseDepth) {
-        return;  
-    }
-
-    LogModuleInfo(typeArg.moduleId);
-    for (const auto& nested : typeArg.nestedTypeArgs)
+    for (ULONG32 i = 0; i < typeArgs.entryCount; i++)
     {
-        LogModuleMappingRecursive(nested, currentDepth + 1);
+        EnsureModuleLogged(typeArgs.entries[i].moduleId);
     }
 }
 
-std::wstring JitProfilerPlugin::FormatTypeArgInfoJson(const TypeArgInfo& typeArg, int currentDepth)
+void JitProfilerPlugin::WriteTypeArgJson(JsonWriter& writer, const TypeArgEntry* entries, ULONG32& index)
 {
-    wchar_t buffer[512];
-    swprintf_s(buffer, 512, L"{\"ModuleID\":%llu,\"TypeDef\":%u,\"NestedCount\":%u",
-        (unsigned long long)typeArg.moduleId, typeArg.typeDef, (unsigned int)typeArg.nestedTypeArgs.size());
-    std::wstring result = buffer;
+    const TypeArgEntry& entry = entries[index++];
 
-    if (currentDepth >= s_maxRecurseDepth) {
-        result += L"}";
-        return result;
-    }
+    writer.BeginObject();
+    writer.Property("ModuleID", entry.moduleId);
+    writer.Property("TypeDef", entry.typeDef);
+    writer.Property("NestedCount", entry.childCount);
 
-    if (!typeArg.nestedTypeArgs.empty())
+    if (entry.childCount > 0 && !entry.truncated)
     {
-        result += L",\"Nested\":[";
-        for (size_t i = 0; i < typeArg.nestedTypeArgs.size(); i++)
+        writer.BeginArray("Nested");
+        for (ULONG32 i = 0; i < entry.childCount; i++)
         {
-            if (i > 0) result += L",";
-            result += FormatTypeArgInfoJson(typeArg.nestedTypeArgs[i], currentDepth + 1);
+            WriteTypeArgJson(writer, entries, index);
         }
-        result += L"]";
+        writer.EndArray();
     }
 
-    result += L"}";
-    return result;
+    writer.EndObject();
 }
 
-void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID, COR_PRF_ELT_INFO eltInfo)
+void JitProfilerPlugin::WriteTypeArgBinary(BinaryRecordBuilder& builder, const TypeArgEntry* entries, ULONG32& index)
 {
-    if (!IsProfilingEnabled())
+    const TypeArgEntry& entry = entries[index++];
+    builder.WriteVarint(entry.moduleId);
+    builder.WriteToken(entry.typeDef);
+    builder.WriteVarint(((uint64_t)entry.childCount << 1) | (entry.truncated ? 1 : 0));
+
+    if (entry.truncated)
         return;
 
-    if (profilerInfo == NULL)
+    for (ULONG32 i = 0; i < entry.childCount; i++)
     {
-        return;
+        WriteTypeArgBinary(builder, entries, index);
     }
+}
+
+void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID, COR_PRF_ELT_INFO eltInfo)
+{
+    FunctionID functionId;
+    if (captureMode == CaptureMode::Mapper)
+    {
+        // The runtime hands back what MapFunction returned.
+        MappedFunction* mapped = (MappedFunction*)functionIDOrClientID.clientID;
+        if (mapped->logged.load(std::memory_order_relaxed))
+        {
+            ProfilerLogger::Count(StatCounter::DedupHits);
+            return;
+        }
+
+        if (!IsEventEnabled(ControlBlock::EventEnter3) || profilerInfo == NULL)
+            return;
+
+        // Over the rate cap the function stays unlogged and is tried again on a later call.
+        RefreshAdmission();
+        if (!admission.TryAcquire())
+            return;
 
-    FunctionID functionId = functionIDOrClientID.functionID;
+        if (mapped->logged.exchange(true, std::memory_order_acq_rel))
+            return;
 
-    EnterCriticalSection(&enter3Lock);
-    if (enter3LoggedFunctions.find(functionId) != enter3LoggedFunctions.end())
+        functionId = (FunctionID)mapped->functionId;
+    }
+    else
     {
-        LeaveCriticalSection(&enter3Lock);
-        return;
+        if (!IsEventEnabled(ControlBlock::EventEnter3))
+            return;
+
+        if (profilerInfo == NULL)
+        {
+            return;
+        }
+
+        functionId = functionIDOrClientID.functionID;
+
+        // A function this thread has already called went through the checks
+        // below then, so its counted call is all there is to do.
+        if (callCounting && CountCall(functionId))
+            return;
+
+        if (enter3LoggedFunctions.Contains(functionId))
+        {
+            ProfilerLogger::Count(StatCounter::DedupHits);
+            return;
+        }
+
+        RefreshAdmission();
+        if (!admission.TryAcquire())
+        {
+            // Over the rate cap the function stays unlogged; this thread tries
+            // it again on its next call.
+            if (callCounting && t_callCountSession == callCountSession)
+                t_callCounts->Retry(functionId);
+            return;
+        }
+
+        if (!enter3LoggedFunctions.InsertIfAbsent(functionId))
+            return;
     }
 
-    enter3LoggedFunctions.insert(functionId);
-    LeaveCriticalSection(&enter3Lock);
+    if (admission.ShouldDefer() && DeferCapture(functionId))
+        return;
 
     COR_PRF_FRAME_INFO frameInfo = 0;
     HRESULT hr = profilerInfo->GetFunctionEnter3Info(functionId, eltInfo, &frameInfo, nullptr, nullptr);
     if (FAILED(hr))
         frameInfo = 0;
 
+    CaptureFunction(functionId, frameInfo);
+}
+
+// Returns true when the calling thread has seen the function before.
+bool JitProfilerPlugin::CountCall(FunctionID functionId)
+{
+    CallCountTable* table = t_callCountSession == callCountSession ? t_callCounts : CreateCallCountTable(nullptr);
+    if (table == nullptr)
+        return false;
+
+    CallCountTable::Call call = table->Increment(functionId);
+    if (call != CallCountTable::Call::UnseenAndHalfFull)
+        return call == CallCountTable::Call::Seen;
+
+    // Half full: count on in a table twice the size and leave this one to
+    // the worker. Without memory for it, hand the counts over and start
+    // again empty.
+    if (CreateCallCountTable(table) != nullptr)
+    {
+        table->Retire();
+        return false;
+    }
+
+    callCountLock.Enter();
+    table->Merge([this](uintptr_t id, uint64_t calls) { unloggedCallCounts[id] += calls; });
+    table->Clear();
+    callCountLock.Leave();
+    return false;
+}
+
+// A table outlives its thread; the worker keeps merging what it counted.
+// With 'from', the new table replaces it for the calling thread.
+CallCountTable* JitProfilerPlugin::CreateCallCountTable(CallCountTable* from)
+{
+    CallCountTable* table = CallCountTable::Create(from != nullptr ? from->GetCapacity() * 2 : CallCountTable::InitialCapacity);
+    if (table == nullptr)
+        return nullptr;
+
+    if (from != nullptr)
+        table->CopyFunctions(*from);
+
+    callCountLock.Enter();
+    table->next = callCountTables;
+    callCountTables = table;
+    callCountLock.Leave();
+
+    t_callCounts = table;
+    t_callCountSession = callCountSession;
+    return table;
+}
+
+void JitProfilerPlugin::MergeCallCounts()
+{
+    callCountLock.Enter();
+    CallCountTable** link = &callCountTables;
+    while (*link != nullptr)
+    {
+        CallCountTable* table = *link;
+        bool retired = table->IsRetired();
+        table->Merge([this](uintptr_t id, uint64_t calls) { unloggedCallCounts[id] += calls; });
+        if (retired)
+        {
+            *link = table->next;
+            delete table;
+        }
+        else
+        {
+            link = &table->next;
+        }
+    }
+    callCountLock.Leave();
+}
+
+// Logs the calls merged since the previous time, one record per function
+// called in between; a function's records add up to its calls. The records
+// are written outside the lock, which CountCall may need.
+void JitProfilerPlugin::LogCallCounts()
+{
+    std::unordered_map<FunctionID, uint64_t> callCounts;
+    callCountLock.Enter();
+    callCounts.swap(unloggedCallCounts);
+    callCountLock.Leave();
+
+    for (const auto& entry : callCounts)
+    {
+        loggedCalls += entry.second;
+        EmitRecord(TraceFormat::RecordCallCount, LogStream::Jit,
+            [&](BinaryRecordBuilder& builder)
+            {
+                builder.WriteVarint(entry.first);
+                builder.WriteVarint(entry.second);
+            },
+            [&](JsonWriter& writer)
+            {
+                writer.Property("FunctionID", entry.first);
+                writer.Property("Event", "CallCount", 9);
+                writer.Property("Count", entry.second);
+            });
+    }
+}
+
+UINT_PTR JitProfilerPlugin::MapFunction(FunctionID functionId, BOOL* pbHookFunction)
+{
+    // Functions compiled while capture is off are not in jit.json either, so
+    // they get no hook at all.
+    *pbHookFunction = FALSE;
+    if (!IsEventEnabled(ControlBlock::EventEnter3) || profilerInfo == NULL)
+        return functionId;
+
+    RefreshAdmission();
+
+    if (!NeedsCallFrame(functionId))
+    {
+        if (enter3LoggedFunctions.InsertIfAbsent(functionId))
+            CaptureWithoutFrame(functionId);
+        return functionId;
+    }
+
+    MappedFunction* mapped = mappedFunctions.Add(functionId);
+    if (mapped == nullptr)
+    {
+        // Out of records: keep what can be resolved without a frame.
+        if (enter3LoggedFunctions.InsertIfAbsent(functionId))
+            CaptureWithoutFrame(functionId);
+        return functionId;
+    }
+
+    *pbHookFunction = TRUE;
+    return (UINT_PTR)mapped;
+}
+
+// Code shared between generic instantiations only reveals its exact type
+// arguments through the frame of a call. Anything that is not generic, or
+// whose class cannot be read yet, is treated conservatively.
+bool JitProfilerPlugin::NeedsCallFrame(FunctionID functionId)
+{
+    ClassID classId = 0;
+    ModuleID moduleId = 0;
+    mdToken methodToken = 0;
+    ULONG32 methodTypeArgCount = 0;
+
+    HRESULT hr = profilerInfo->GetFunctionInfo2(functionId, 0, &classId, &moduleId, &methodToken, 0, &methodTypeArgCount, nullptr);
+    if (FAILED(hr) || classId == 0 || methodTypeArgCount > 0)
+        return true;
+
+    ModuleID typeModuleId = 0;
+    mdTypeDef typeDefToken = 0;
+    ClassID parentClassId = 0;
+    ULONG32 declaringTypeArgCount = 0;
+    hr = profilerInfo->GetClassIDInfo2(classId, &typeModuleId, &typeDefToken, &parentClassId, 0, &declaringTypeArgCount, nullptr);
+    return FAILED(hr) || declaringTypeArgCount > 0;
+}
+
+// For captures that happen once per function (JIT events, the mapper's
+// non-generic functions) there is no later call to retry on, so over the rate
+// cap the function is deferred rather than skipped.
+void JitProfilerPlugin::CaptureWithoutFrame(FunctionID functionId)
+{
+    if ((admission.ShouldDefer() || !admission.TryAcquire()) && DeferCapture(functionId))
+        return;
+
+    CaptureFunction(functionId, 0);
+}
+
+// Returns false when the queue is full; the caller then captures inline.
+bool JitProfilerPlugin::DeferCapture(FunctionID functionId)
+{
+    if (!workerThread.IsStarted() || !deferredFunctions.TryPush(functionId))
+        return false;
+
+    admission.CountDeferred();
+    return true;
+}
+
+void JitProfilerPlugin::StartWorker()
+{
+    if (!workerEvent.Create())
+        return;
+
+    stopWorker = false;
+    workerThread.Start(WorkerThreadProc, this);
+}
+
+void JitProfilerPlugin::StopWorker()
+{
+    if (workerThread.IsStarted())
+    {
+        stopWorker = true;
+        workerEvent.Set();
+        workerThread.Join();
+    }
+
+    workerEvent.Close();
+}
+
+void JitProfilerPlugin::DrainDeferredCaptures()
+{
+    uintptr_t functionId;
+    while (profilerInfo != NULL && deferredFunctions.TryPop(functionId))
+    {
+        CaptureFunction((FunctionID)functionId, 0);
+    }
+}
+
+void JitProfilerPlugin::PublishStats()
+{
+    if (!hasFullControlBlock)
+        return;
+
+    ProfilerLogger::Stats loggerStats;
+    ProfilerLogger::GetStats(loggerStats);
+    CaptureAdmission::Stats admissionStats = admission.GetStats();
+
+    ControlBlock* block = pControlBlock;
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    block->appliedFilterGeneration.store(admission.GetAppliedGeneration(), relaxed);
+    block->jitEvents.store(loggerStats.counters[(size_t)StatCounter::JitEvents], relaxed);
+    block->enter3Records.store(loggerStats.counters[(size_t)StatCounter::Enter3Records], relaxed);
+    block->moduleRecords.store(loggerStats.counters[(size_t)StatCounter::ModuleRecords], relaxed);
+    block->dedupHits.store(loggerStats.counters[(size_t)StatCounter::DedupHits], relaxed);
+    block->sampledOut.store(admissionStats.sampledOut, relaxed);
+    block->rateLimited.store(admissionStats.rateLimited, relaxed);
+    block->deferred.store(admissionStats.deferred, relaxed);
+    block->bytesBuffered.store(loggerStats.counters[(size_t)StatCounter::BytesBuffered], relaxed);
+    block->bytesWritten.store(loggerStats.bytesWritten, relaxed);
+    block->droppedRecords.store(loggerStats.droppedRecords, relaxed);
+    block->flushCount.store(loggerStats.flushCount, relaxed);
+    block->flushTotalMicroseconds.store(loggerStats.flushTotalMicroseconds, relaxed);
+    block->flushMaxMicroseconds.store(loggerStats.flushMaxMicroseconds, relaxed);
+    block->lastFlushMicroseconds.store(loggerStats.lastFlushMicroseconds, relaxed);
+}
+
+// Resolves deferred functions, and publishes statistics and logs call counts
+// a few times a second.
+void JitProfilerPlugin::WorkerThreadProc(void* parameter)
+{
+    JitProfilerPlugin* plugin = (JitProfilerPlugin*)parameter;
+    uint64_t lastPublish = 0;
+    while (!plugin->stopWorker.load())
+    {
+        plugin->workerEvent.Wait(10);
+        plugin->DrainDeferredCaptures();
+
+        uint64_t now = Platform::GetTickCountMs();
+        if (now - lastPublish >= 250)
+        {
+            plugin->PublishStats();
+            if (plugin->callCounting)
+            {
+                plugin->MergeCallCounts();
+                plugin->LogCallCounts();
+            }
+            lastPublish = now;
+        }
+    }
+
+    plugin->DrainDeferredCaptures();
+}
+
+void JitProfilerPlugin::CaptureFunction(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo)
+{
+    HRESULT hr;
     ClassID classId;
     ModuleID moduleId;
     mdToken methodToken;
@@ -468,7 +1720,18 @@ void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID,
     if (FAILED(hr))
         return;
 
-    std::vector<ClassID> methodTypeArgs(methodTypeArgCount);
+    if (admission.HasSampleRules())
+    {
+        const TypeArgNode* declaringType = classId != 0 ? typeArgCache.Resolve(profilerInfo, classId) : nullptr;
+        mdTypeDef declaringTypeDef = declaringType != nullptr ? declaringType->typeDef : mdTypeDefNil;
+        if (!admission.IsSampled(profilerInfo, functionId, moduleId, declaringTypeDef))
+            return;
+    }
+
+    BumpArena& arena = t_recordArena;
+    BumpArenaScope arenaScope(arena);
+
+    ClassID* methodTypeArgs = arena.Allocate<ClassID>(methodTypeArgCount);
     if (methodTypeArgCount > 0)
     {
         hr = profilerInfo->GetFunctionInfo2(
@@ -479,7 +1742,7 @@ void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID,
             &methodToken,
             methodTypeArgCount,
             &methodTypeArgCount,
-            methodTypeArgs.data());
+            methodTypeArgs);
 
         if (FAILED(hr))
             return;
@@ -489,7 +1752,7 @@ void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID,
     mdTypeDef typeDefToken = 0;
     ClassID parentClassId = 0;
     ULONG32 declaringTypeArgCount = 0;
-    std::vector<ClassID> declaringTypeArgs;
+    ClassID* declaringTypeArgs = nullptr;
 
     if (classId != 0)
     {
@@ -504,7 +1767,7 @@ void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID,
 
         if (SUCCEEDED(hr) && declaringTypeArgCount > 0)
         {
-            declaringTypeArgs.resize(declaringTypeArgCount);
+            declaringTypeArgs = arena.Allocate<ClassID>(declaringTypeArgCount);
             hr = profilerInfo->GetClassIDInfo2(
                 classId,
                 &typeModuleId,
@@ -512,90 +1775,105 @@ void JitProfilerPlugin::HandleEnter3(FunctionIDOrClientID functionIDOrClientID,
                 &parentClassId,
                 declaringTypeArgCount,
                 &declaringTypeArgCount,
-                declaringTypeArgs.data());
+                declaringTypeArgs);
 
             if (FAILED(hr))
             {
-                declaringTypeArgs.clear();
                 declaringTypeArgCount = 0;
             }
         }
     }
 
-    std::vector<TypeArgInfo> resolvedDeclaringTypeArgs;
-    for (ULONG32 i = 0; i < declaringTypeArgCount; i++)
-    {
-        resolvedDeclaringTypeArgs.push_back(ResolveTypeArgument(declaringTypeArgs[i]));
-    }
+    TypeArgList resolvedDeclaringTypeArgs;
+    ResolveTypeArguments(declaringTypeArgs, declaringTypeArgCount, arena, resolvedDeclaringTypeArgs);
 
-    std::vector<TypeArgInfo> resolvedMethodTypeArgs;
-    for (ULONG32 i = 0; i < methodTypeArgCount; i++)
-    {
-        resolvedMethodTypeArgs.push_back(ResolveTypeArgument(methodTypeArgs[i]));
-    }
+    TypeArgList resolvedMethodTypeArgs;
+    ResolveTypeArguments(methodTypeArgs, methodTypeArgCount, arena, resolvedMethodTypeArgs);
 
-    LogModuleInfo(moduleId);
-    if (typeModuleId != 0)
-    {
-        LogModuleInfo(typeModuleId);
-    }
+    EnsureModuleLogged(moduleId);
+    EnsureModuleLogged(typeModuleId);
 
-    for (const auto& typeArg : resolvedDeclaringTypeArgs)
-    {
-        LogModuleMappingRecursive(typeArg, 0);
-    }
+    LogTypeArgModules(resolvedDeclaringTypeArgs);
+    LogTypeArgModules(resolvedMethodTypeArgs);
 
-    for (const auto& typeArg : resolvedMethodTypeArgs)
+    if (ProfilerLogger::IsBinaryFormat())
     {
-        LogModuleMappingRecursive(typeArg, 0);
+        thread_local BinaryRecordBuilder builder;
+        uint32_t length;
+        builder.Begin(TraceFormat::RecordEnter3);
+        builder.WriteVarint(functionId);
+        builder.WriteVarint(moduleId);
+        builder.WriteToken(methodToken);
+        builder.WriteVarint(typeModuleId);
+        builder.WriteToken(typeDefToken);
+        builder.WriteVarint(resolvedDeclaringTypeArgs.rootCount);
+        for (ULONG32 index = 0; index < resolvedDeclaringTypeArgs.entryCount;)
+        {
+            WriteTypeArgBinary(builder, resolvedDeclaringTypeArgs.entries, index);
+        }
+        builder.WriteVarint(resolvedMethodTypeArgs.rootCount);
+        for (ULONG32 index = 0; index < resolvedMethodTypeArgs.entryCount;)
+        {
+            WriteTypeArgBinary(builder, resolvedMethodTypeArgs.entries, index);
+        }
+        if (threadTagging)
+        {
+            RecordTag tag;
+            TagRecord(tag);
+            builder.WriteVarint(tag.threadIndex);
+            builder.WriteVarint(tag.sequence);
+            builder.WriteVarint(tag.time);
+        }
+        const uint8_t* record = builder.Finish(length);
+        ProfilerLogger::LogBinary(record, length);
+        ProfilerLogger::Count(StatCounter::Enter3Records);
+        return;
     }
 
-    wchar_t buffer[256];
-    std::wstring json = L"{";
-
-    swprintf_s(buffer, 256, L"\"FunctionID\":%llu", (unsigned long long)functionId);
-    json += buffer;
-
-    swprintf_s(buffer, 256, L",\"ModuleID\":%llu", (unsigned long long)moduleId);
-    json += buffer;
-
-    swprintf_s(buffer, 256, L",\"MethodToken\":%u", methodToken);
-    json += buffer;
-
-    swprintf_s(buffer, 256, L",\"DeclaringTypeModuleID\":%llu", (unsigned long long)typeModuleId);
-    json += buffer;
-
-    swprintf_s(buffer, 256, L",\"DeclaringTypeToken\":%u", typeDefToken);
-    json += buffer;
-
-    swprintf_s(buffer, 256, L",\"DeclaringTypeArgCount\":%u", declaringTypeArgCount);
-    json += buffer;
-
-    if (!resolvedDeclaringTypeArgs.empty())
+    thread_local JsonWriter writer;
+    uint32_t length;
+    writer.Begin();
+    writer.BeginObject();
+    writer.Property("FunctionID", functionId);
+    writer.Property("ModuleID", moduleId);
+    writer.Property("MethodToken", methodToken);
+    writer.Property("DeclaringTypeModuleID", typeModuleId);
+    writer.Property("DeclaringTypeToken", typeDefToken);
+    writer.Property("DeclaringTypeArgCount", declaringTypeArgCount);
+
+    if (resolvedDeclaringTypeArgs.rootCount > 0)
     {
-        json += L",\"DeclaringTypeArgs\":[";
-        for (size_t i = 0; i < resolvedDeclaringTypeArgs.size(); i++)
+        writer.BeginArray("DeclaringTypeArgs");
+        for (ULONG32 index = 0; index < resolvedDeclaringTypeArgs.entryCount;)
         {
-            if (i > 0) json += L",";
-            json += FormatTypeArgInfoJson(resolvedDeclaringTypeArgs[i], 0);
+            WriteTypeArgJson(writer, resolvedDeclaringTypeArgs.entries, index);
         }
-        json += L"]";
+        writer.EndArray();
     }
 
-    swprintf_s(buffer, 256, L",\"MethodTypeArgCount\":%u", methodTypeArgCount);
-    json += buffer;
+    writer.Property("MethodTypeArgCount", methodTypeArgCount);
 
-    if (!resolvedMethodTypeArgs.empty())
+    if (resolvedMethodTypeArgs.rootCount > 0)
     {
-        json += L",\"MethodTypeArgs\":[";
-        for (size_t i = 0; i < resolvedMethodTypeArgs.size(); i++)
+        writer.BeginArray("MethodTypeArgs");
+        for (ULONG32 index = 0; index < resolvedMethodTypeArgs.entryCount;)
         {
-            if (i > 0) json += L",";
-            json += FormatTypeArgInfoJson(resolvedMethodTypeArgs[i], 0);
+            WriteTypeArgJson(writer, resolvedMethodTypeArgs.entries, index);
         }
-        json += L"]";
+        writer.EndArray();
+    }
+
+    if (threadTagging)
+    {
+        RecordTag tag;
+        TagRecord(tag);
+        writer.Property("Thread", tag.threadIndex);
+        writer.Property("Seq", tag.sequence);
+        writer.Property("Time", tag.time);
     }
 
-    json += L"}";
-    ProfilerLogger::LogEnter3(L"%s", json.c_str());
+    writer.EndObject();
+    const char* line = writer.Finish(length);
+    ProfilerLogger::LogJson(LogStream::Enter3, line, length);
+    ProfilerLogger::Count(StatCounter::Enter3Records);
 }
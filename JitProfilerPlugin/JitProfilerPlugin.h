@@ -1,113 +1,260 @@
 #pragma once
 
-#include <windows.h>
+#include "Platform.h"
 #include <cor.h>
 #include <corprof.h>
-#include <atlbase.h>
-#include <atlcom.h>
+#include <algorithm>
 #include <vector>
-#include <unordered_set>
 #include <string>
 #include <cstdio>
 #include <cstdarg>
 #include <cstring>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <unordered_map>
+#include "BumpArena.h"
+#include "CallCountTable.h"
+#include "CaptureAdmission.h"
+#include "ConcurrentIdSet.h"
+#include "ControlBlock.h"
+#include "FunctionIdQueue.h"
+#include "JitTimingStack.h"
+#include "JsonWriter.h"
+#include "MappedLogFile.h"
+#include "MappedFunctionTable.h"
+#include "TypeArgCache.h"
+#include "ThreadRingBuffer.h"
+#include "TraceFormat.h"
 
 void __stdcall GlobalEnter3Callback(FunctionIDOrClientID functionIDOrClientID, COR_PRF_ELT_INFO eltInfo);
+UINT_PTR __stdcall GlobalFunctionIDMapper(FunctionID functionId, void* clientData, BOOL* pbHookFunction);
 
-struct TypeArgInfo {
+// One node of a resolved type argument, in preorder: the subtrees of its
+// childCount type arguments follow it directly, unless SIG_JIT_PROFILER_MAX_RECURSE
+// was reached at this node and they were left out.
+struct TypeArgEntry {
     ModuleID moduleId;
     mdTypeDef typeDef;
-    std::vector<TypeArgInfo> nestedTypeArgs;
+    ULONG32 childCount;
+    bool truncated;
 };
 
+// The type arguments of a class or method: rootCount trees stored back to back,
+// allocated from the per-thread record arena.
+struct TypeArgList {
+    TypeArgEntry* entries;
+    ULONG32 entryCount;
+    ULONG32 rootCount;
+};
+
+// Where and when a JIT or Enter3 record was made, with SIG_JIT_PROFILER_THREADS=1.
+// threadIndex is dense and starts at 1; sequence counts the tagged records of
+// that thread.
+struct RecordTag {
+    uint32_t threadIndex;
+    uint64_t sequence;
+    uint64_t time;
+};
+
+// SIG_JIT_PROFILER_CAPTURE_MODE
+enum class CaptureMode
+{
+    // Every method entry goes through the Enter3 hook (default).
+    Enter3,
+    // A FunctionIDMapper2 records non-generic functions when they are mapped and
+    // hooks only generic ones, which need the frame of their first call.
+    Mapper,
+    // No enter/leave hooks: everything is resolved in JITCompilationStarted.
+    // Shared generic code is recorded with System.__Canon type arguments.
+    Jit
+};
+
+enum class LogStream : uint32_t
+{
+    Jit = 0,
+    Enter3,
+    Module,
+    Binary,
+    Count
+};
+
+// Events counted per thread and published to the control block.
+enum class StatCounter : uint32_t
+{
+    JitEvents = 0,
+    Enter3Records,
+    ModuleRecords,
+    DedupHits,
+    BytesBuffered,
+    // SIG_JIT_PROFILER_INLINING cost: every JITInlining callback, the new
+    // edges among them, and the time spent in the callback.
+    InliningCallbacks,
+    InliningEdges,
+    InliningNanoseconds,
+    Count
+};
+
+// What a producer does when its thread buffer is full.
+enum class OverflowPolicy
+{
+    Block,  // wait for the flusher to make room
+    Drop,   // discard the record and count it
+    Spill   // bypass the buffer and write the record straight to the file
+};
+
+// Log records are formatted on the calling thread into UTF-8 lines, appended to
+// a per-thread ThreadRingBuffer without taking any lock, and written to the
+// log files in large batches by a single flusher thread. With
+// SIG_JIT_PROFILER_SINK=mapped they are copied straight into MappedLogFiles
+// instead, which keeps what was logged when the process is killed.
 class ProfilerLogger
 {
 public:
-    static FILE* g_jitLogFile;
-    static FILE* g_enter3LogFile;
-    static FILE* g_moduleLogFile;
-
     static bool OpenLogFiles();
     static void CloseLogFiles();
 
-    static void LogJIT(const wchar_t* format, ...)
+    // Appends a line built by JsonWriter to the stream's JSON file.
+    static void LogJson(LogStream stream, const char* line, uint32_t length)
     {
-        if (!format) return;
-        EnterCriticalSection(&g_jitLogLock);
-        if (g_jitLogFile != nullptr)
-        {
-            va_list args;
-            va_start(args, format);
-            vfwprintf(g_jitLogFile, format, args);
-            fwprintf(g_jitLogFile, L"\n");
-            fflush(g_jitLogFile);
-            va_end(args);
-        }
-        LeaveCriticalSection(&g_jitLogLock);
+        Append(stream, line, length);
     }
 
-    static void LogEnter3(const wchar_t* format, ...)
+    // Appends a record built by BinaryRecordBuilder to trace.bin.
+    static void LogBinary(const uint8_t* record, uint32_t length)
     {
-        if (!format) return;
-        EnterCriticalSection(&g_enter3LogLock);
-        if (g_enter3LogFile != nullptr)
-        {
-            va_list args;
-            va_start(args, format);
-            vfwprintf(g_enter3LogFile, format, args);
-            fwprintf(g_enter3LogFile, L"\n");
-            fflush(g_enter3LogFile);
-            va_end(args);
-        }
-        LeaveCriticalSection(&g_enter3LogLock);
+        Append(LogStream::Binary, (const char*)record, length);
     }
 
-    static void LogModule(const wchar_t* format, ...)
+    // SIG_JIT_PROFILER_FORMAT=binary writes every record to trace.bin instead
+    // of the three JSON files.
+    static bool IsBinaryFormat() { return g_binaryFormat; }
+
+    static bool IsMappedSink() { return g_mappedSink; }
+
+    static void Initialize();
+
+    // Stops the flusher and writes out everything still buffered. When the
+    // process is terminating the other threads are already gone, so nothing
+    // is waited on.
+    static void Shutdown(bool processTerminating);
+
+    // Called on DLL_THREAD_DETACH; the flusher frees the buffer once drained.
+    static void ReleaseThreadBuffer();
+
+    static long long GetDroppedRecordCount() { return g_droppedRecords.load(std::memory_order_relaxed); }
+
+    struct Stats
     {
-        if (!format) return;
-        EnterCriticalSection(&g_moduleLogLock);
-        if (g_moduleLogFile != nullptr)
-        {
-            va_list args;
-            va_start(args, format);
-            vfwprintf(g_moduleLogFile, format, args);
-            fwprintf(g_moduleLogFile, L"\n");
-            fflush(g_moduleLogFile);
-            va_end(args);
-        }
-        LeaveCriticalSection(&g_moduleLogLock);
+        uint64_t counters[(size_t)StatCounter::Count];
+        uint64_t bytesWritten;
+        uint64_t droppedRecords;
+        uint64_t flushCount;
+        uint64_t flushTotalMicroseconds;
+        uint64_t flushMaxMicroseconds;
+        uint64_t lastFlushMicroseconds;
+    };
+
+    // Counters are per thread, so counting in a hook costs no shared cache line.
+    static void Count(StatCounter counter, uint64_t amount = 1)
+    {
+        ThreadStats* stats = t_threadStats != nullptr ? t_threadStats : CreateThreadStats();
+        if (stats == nullptr)
+            return;
+
+        // Only the owning thread writes; no locked add is needed.
+        std::atomic<uint64_t>& value = stats->counters[(size_t)counter];
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
     }
 
-    static void Initialize()
+    // Sums the counters of all threads, including the ones that have exited.
+    static void GetStats(Stats& stats);
+
+private:
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(size_t capacity) : ring(capacity), writing(false), retired(false), next(nullptr) {}
+
+        ThreadRingBuffer ring;
+        std::atomic<bool> writing;
+        std::atomic<bool> retired;
+        ThreadBuffer* next;
+    };
+
+    struct ThreadStats
     {
-        if (!g_initialized)
+        ThreadStats() : writing(false), retired(false), next(nullptr)
         {
-            InitializeCriticalSection(&g_jitLogLock);
-            InitializeCriticalSection(&g_enter3LogLock);
-            InitializeCriticalSection(&g_moduleLogLock);
-            OpenLogFiles();
-            g_initialized = true;
+            for (size_t i = 0; i < (size_t)StatCounter::Count; i++)
+                counters[i].store(0, std::memory_order_relaxed);
         }
-    }
 
-private:
-    static void GetLogPath(const wchar_t* filename, wchar_t* outPath, size_t maxLen)
+        std::atomic<uint64_t> counters[(size_t)StatCounter::Count];
+        // Set while the thread copies a record into a mapped file.
+        std::atomic<bool> writing;
+        std::atomic<bool> retired;
+        ThreadStats* next;
+    };
+
+    static ThreadStats* CreateThreadStats();
+    static void Append(LogStream stream, const char* data, uint32_t length);
+    static void WriteDirect(LogStream stream, const char* data, size_t length);
+    static void WriteMapped(LogStream stream, const char* data, uint32_t length);
+    static ThreadBuffer* GetThreadBuffer();
+    static size_t DrainThreadBuffers();
+    static void ReadSettings();
+    static void FlusherThreadProc(void* parameter);
+
+    static std::wstring GetLogPath(const wchar_t* filename)
     {
-        std::wstring basePath = L"C:\\siglocal";
-        DWORD envLen = GetEnvironmentVariableW(L"SIG_JIT_PROFILER_LOG_PATH", nullptr, 0);
-        if (envLen > 0) {
-            std::wstring envPath(envLen, L'\0');
-            GetEnvironmentVariableW(L"SIG_JIT_PROFILER_LOG_PATH", &envPath[0], envLen);
-            basePath = envPath.substr(0, wcsnlen_s(envPath.c_str(), envPath.size()));
+        std::wstring basePath = Platform::DefaultLogPath;
+        std::wstring envPath;
+        if (GetEnvironmentSetting(L"SIG_JIT_PROFILER_LOG_PATH", envPath)) {
+            basePath = envPath;
         }
 
-        std::wstring fullPath = basePath + L"\\" + filename;
-        wcsncpy_s(outPath, maxLen, fullPath.c_str(), _TRUNCATE);
+        return basePath + Platform::PathSeparator + filename;
     }
 
-    static CRITICAL_SECTION g_jitLogLock;
-    static CRITICAL_SECTION g_enter3LogLock;
-    static CRITICAL_SECTION g_moduleLogLock;
+    static FILE* g_logFiles[(size_t)LogStream::Count];
+    static Platform::Mutex g_fileLocks[(size_t)LogStream::Count];
+    static std::vector<char> g_staging[(size_t)LogStream::Count];
+    static MappedLogFile g_mappedFiles[(size_t)LogStream::Count];
+    static std::atomic<bool> g_mappedOpen;
+
+    static Platform::Mutex g_threadBufferLock;
+    static Platform::Mutex g_drainLock;
+    static ThreadBuffer* g_threadBuffers;
+    // The drain's copy of g_threadBuffers, so no file is written under g_threadBufferLock.
+    static std::vector<ThreadBuffer*> g_drainBuffers;
+    static std::vector<ThreadBuffer*> g_retiredBuffers;
+    static thread_local ThreadBuffer* t_threadBuffer;
+
+    static Platform::Thread g_flusherThread;
+    static Platform::Event g_flushEvent;
+    static std::atomic<bool> g_flusherRunning;
+    static std::atomic<bool> g_stopFlusher;
+    static std::atomic<long long> g_droppedRecords;
+
+    static Platform::Mutex g_threadStatsLock;
+    static bool g_threadStatsReady;
+    static ThreadStats* g_threadStats;
+    static thread_local ThreadStats* t_threadStats;
+    // Counters of threads that have exited.
+    static uint64_t g_retiredCounters[(size_t)StatCounter::Count];
+
+    static std::atomic<uint64_t> g_bytesWritten;
+    static std::atomic<uint64_t> g_flushCount;
+    static std::atomic<uint64_t> g_flushTotalMicroseconds;
+    static std::atomic<uint64_t> g_flushMaxMicroseconds;
+    static std::atomic<uint64_t> g_lastFlushMicroseconds;
+
+    static OverflowPolicy g_overflowPolicy;
+    static size_t g_threadBufferSize;
+    static DWORD g_flushIntervalMs;
+    static bool g_binaryFormat;
+    static bool g_mappedSink;
+    static size_t g_extentSize;
     static bool g_initialized;
 };
 
@@ -120,12 +267,12 @@ public:
     // IUnknown
     STDMETHOD_(ULONG, AddRef)()
     {
-        return InterlockedIncrement(&refCount);
+        return ++refCount;
     }
 
     STDMETHOD_(ULONG, Release)()
     {
-        auto ret = InterlockedDecrement(&refCount);
+        auto ret = --refCount;
         if (ret == 0)
             delete(this);
         return ret;
@@ -164,32 +311,32 @@ public:
     STDMETHOD(AssemblyUnloadStarted)(AssemblyID assemblyId) { return S_OK; }
     STDMETHOD(AssemblyUnloadFinished)(AssemblyID assemblyId, HRESULT hrStatus) { return S_OK; }
 
-    // Module events - not logged
+    // Module events - loads and unloads are logged with their time
     STDMETHOD(ModuleLoadStarted)(ModuleID moduleId) { return S_OK; }
-    STDMETHOD(ModuleLoadFinished)(ModuleID moduleId, HRESULT hrStatus) { return S_OK; }
-    STDMETHOD(ModuleUnloadStarted)(ModuleID moduleId) { return S_OK; }
+    STDMETHOD(ModuleLoadFinished)(ModuleID moduleId, HRESULT hrStatus);
+    STDMETHOD(ModuleUnloadStarted)(ModuleID moduleId);
     STDMETHOD(ModuleUnloadFinished)(ModuleID moduleId, HRESULT hrStatus) { return S_OK; }
     STDMETHOD(ModuleAttachedToAssembly)(ModuleID moduleId, AssemblyID assemblyId) { return S_OK; }
 
     // Class events - not logged
     STDMETHOD(ClassLoadStarted)(ClassID classId) { return S_OK; }
     STDMETHOD(ClassLoadFinished)(ClassID classId, HRESULT hrStatus) { return S_OK; }
-    STDMETHOD(ClassUnloadStarted)(ClassID classId) { return S_OK; }
+    STDMETHOD(ClassUnloadStarted)(ClassID classId);
     STDMETHOD(ClassUnloadFinished)(ClassID classId, HRESULT hrStatus) { return S_OK; }
 
     // Function events
     STDMETHOD(FunctionUnloadStarted)(FunctionID functionId) { return S_OK; }
     STDMETHOD(JITCompilationStarted)(FunctionID functionId, BOOL fIsSafeToBlock);
-    STDMETHOD(JITCompilationFinished)(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock) { return S_OK; }
-    STDMETHOD(JITCachedFunctionSearchStarted)(FunctionID functionId, BOOL* pbUseCachedFunction) { return S_OK; }
-    STDMETHOD(JITCachedFunctionSearchFinished)(FunctionID functionId, COR_PRF_JIT_CACHE result) { return S_OK; }
+    STDMETHOD(JITCompilationFinished)(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock);
+    STDMETHOD(JITCachedFunctionSearchStarted)(FunctionID functionId, BOOL* pbUseCachedFunction);
+    STDMETHOD(JITCachedFunctionSearchFinished)(FunctionID functionId, COR_PRF_JIT_CACHE result);
     STDMETHOD(JITFunctionPitched)(FunctionID functionId) { return S_OK; }
-    STDMETHOD(JITInlining)(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline) { return S_OK; }
+    STDMETHOD(JITInlining)(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline);
 
-    // Thread events - not logged
-    STDMETHOD(ThreadCreated)(ThreadID threadId) { return S_OK; }
-    STDMETHOD(ThreadDestroyed)(ThreadID threadId) { return S_OK; }
-    STDMETHOD(ThreadAssignedToOSThread)(ThreadID managedThreadId, DWORD osThreadId) { return S_OK; }
+    // Thread events - logged with SIG_JIT_PROFILER_THREADS=1
+    STDMETHOD(ThreadCreated)(ThreadID threadId);
+    STDMETHOD(ThreadDestroyed)(ThreadID threadId);
+    STDMETHOD(ThreadAssignedToOSThread)(ThreadID managedThreadId, DWORD osThreadId);
 
     // Remoting events - not logged
     STDMETHOD(RemotingClientInvocationStarted)() { return S_OK; }
@@ -228,8 +375,8 @@ public:
     STDMETHOD(ExceptionSearchFilterEnter)(FunctionID functionId) { return S_OK; }
     STDMETHOD(ExceptionSearchFilterLeave)() { return S_OK; }
     STDMETHOD(ExceptionSearchCatcherFound)(FunctionID functionId) { return S_OK; }
-    STDMETHOD(ExceptionOSHandlerEnter)(UINT_PTR __unused) { return S_OK; }
-    STDMETHOD(ExceptionOSHandlerLeave)(UINT_PTR __unused) { return S_OK; }
+    STDMETHOD(ExceptionOSHandlerEnter)(UINT_PTR) { return S_OK; }
+    STDMETHOD(ExceptionOSHandlerLeave)(UINT_PTR) { return S_OK; }
     STDMETHOD(ExceptionUnwindFunctionEnter)(FunctionID functionId) { return S_OK; }
     STDMETHOD(ExceptionUnwindFunctionLeave)() { return S_OK; }
     STDMETHOD(ExceptionUnwindFinallyEnter)(FunctionID functionId) { return S_OK; }
@@ -244,7 +391,7 @@ public:
     STDMETHOD(ExceptionCLRCatcherExecute)() { return S_OK; }
 
     // ICorProfilerCallback2
-    STDMETHOD(ThreadNameChanged)(ThreadID threadId, ULONG cchName, WCHAR* name) { return S_OK; }
+    STDMETHOD(ThreadNameChanged)(ThreadID threadId, ULONG cchName, WCHAR* name);
     STDMETHOD(GarbageCollectionStarted)(int cGenerations, BOOL generationCollected[], COR_PRF_GC_REASON reason) { return S_OK; }
     STDMETHOD(SurvivingReferences)(ULONG cSurvivingObjectIDRanges, ObjectID objectIDRangeStart[], ULONG cObjectIDRangeLength[]) { return S_OK; }
     STDMETHOD(GarbageCollectionFinished)() { return S_OK; }
@@ -269,32 +416,119 @@ public:
     // Public method to handle Enter3 callback
     void HandleEnter3(FunctionIDOrClientID functionIDOrClientID, COR_PRF_ELT_INFO eltInfo);
 
+    // FunctionIDMapper2 callback used in CaptureMode::Mapper
+    UINT_PTR MapFunction(FunctionID functionId, BOOL* pbHookFunction);
+
     // Global singleton instance accessor
     static JitProfilerPlugin* GetInstance() { return s_instance; }
     static void SetInstance(JitProfilerPlugin* instance) { s_instance = instance; }
     static void InitializeMaxRecurseDepth();
+    static int GetMaxRecurseDepth() { return s_maxRecurseDepth; }
 private:
     ICorProfilerInfo3* profilerInfo;
-    long refCount;
-    std::unordered_set<FunctionID> jitLoggedFunctions;
-    std::unordered_set<FunctionID> enter3LoggedFunctions;
-    std::unordered_set<ModuleID> moduleLoggedFunctions;
-    CRITICAL_SECTION jitLock;
-    CRITICAL_SECTION enter3Lock;
-    CRITICAL_SECTION moduleLock;
+    std::atomic<long> refCount;
+    ConcurrentIdSet jitLoggedFunctions;
+    ConcurrentIdSet enter3LoggedFunctions;
+    ConcurrentIdSet moduleLoggedFunctions;
+    CaptureMode captureMode;
+    // SIG_JIT_PROFILER_JIT_TIMING=1 also logs every JITCompilationFinished
+    // with its duration, code size and status. sizedFunctions holds the
+    // functions whose code size is already logged.
+    bool jitTiming;
+    ConcurrentIdSet sizedFunctions;
+    // SIG_JIT_PROFILER_TIERS=1 turns on jitTiming and also logs each function
+    // the runtime takes precompiled (ReadyToRun) code for, once, so that the
+    // parser counts its first JIT as a recompilation. cachedFunctions is
+    // kept with jitTiming alone too, as such a JIT's code size is unknown.
+    bool tierTracking;
+    ConcurrentIdSet cachedFunctions;
+    // SIG_JIT_PROFILER_INLINING=1 logs each caller/callee pair the JIT
+    // inlines, once; inliningEdges holds a key per pair already logged.
+    bool inliningGraph;
+    ConcurrentIdSet inliningEdges;
+    // SIG_JIT_PROFILER_THREADS=1 tags JIT and Enter3 records with a RecordTag
+    // and logs thread creation, names and OS threads.
+    bool threadTagging;
+    std::atomic<uint32_t> threadCount;
+    // SIG_JIT_PROFILER_CALL_COUNTS=1 counts every call in per-thread tables.
+    // The worker merges them into unloggedCallCounts and logs those as
+    // CallCount records a few times a second, and once more at shutdown, so
+    // a killed process keeps all but its last counts. A thread that outgrows
+    // its table moves to a larger one; the worker frees the old one after
+    // its last merge.
+    bool callCounting;
+    Platform::Mutex callCountLock;
+    CallCountTable* callCountTables;
+    // Tells this instance's tables from those a thread kept from an earlier
+    // instance in the same process, as the harness creates one per run.
+    uint64_t callCountSession;
+    std::unordered_map<FunctionID, uint64_t> unloggedCallCounts;
+    // Worker, then Shutdown.
+    uint64_t loggedCalls;
+    MappedFunctionTable mappedFunctions;
+    TypeArgCache typeArgCache;
+    CaptureAdmission admission;
+
+    // Functions waiting for the worker thread, which also publishes statistics.
+    FunctionIdQueue deferredFunctions;
+    Platform::Thread workerThread;
+    Platform::Event workerEvent;
+    std::atomic<bool> stopWorker;
 
     static JitProfilerPlugin* s_instance;
 
-    HANDLE hMapFile;
-    volatile int32_t* pSharedFlag;
+    Platform::SharedMemory controlMemory;
+    ControlBlock* pControlBlock;
+    // False when the mapping holds only the enabled flag.
+    bool hasFullControlBlock;
 
     static int s_maxRecurseDepth;
 
-    bool IsProfilingEnabled() const;
+    // eventBit is one of the ControlBlock::Event* bits.
+    bool IsEventEnabled(uint32_t eventBit) const;
+
+    void RefreshAdmission()
+    {
+        if (hasFullControlBlock)
+            admission.Refresh(pControlBlock);
+    }
+
+    void LogJitStarted(FunctionID functionId);
+    void LogJitFinished(FunctionID functionId, uint64_t start, uint64_t finish, HRESULT hrStatus);
+    void LogCacheHit(FunctionID functionId, uint64_t time);
+    void LogInlining(FunctionID callerId, FunctionID calleeId);
+    void TagRecord(RecordTag& tag);
+    bool CountCall(FunctionID functionId);
+    CallCountTable* CreateCallCountTable(CallCountTable* from);
+    void MergeCallCounts();
+    void LogCallCounts();
+    void LogThreadEvent(TraceFormat::RecordType type, const char* eventName, size_t eventNameLength, ThreadID threadId, uint64_t time);
+    void CaptureFunction(FunctionID functionId, COR_PRF_FRAME_INFO frameInfo);
+    void CaptureWithoutFrame(FunctionID functionId);
+    bool DeferCapture(FunctionID functionId);
+    void StartWorker();
+    void StopWorker();
+    void DrainDeferredCaptures();
+    void PublishStats();
+    static void WorkerThreadProc(void* parameter);
+    bool NeedsCallFrame(FunctionID functionId);
+    void ResolveTypeArguments(const ClassID* classIds, ULONG32 count, BumpArena& arena, TypeArgList& list);
+    void LogModuleInfo(ModuleID moduleId, uint64_t loadTime);
+
+    // Modules are logged when they load, so on the capture path this is only a
+    // lookup. A module that loaded while capture was off is logged here instead.
+    void EnsureModuleLogged(ModuleID moduleId)
+    {
+        if (moduleId != 0 && !moduleLoggedFunctions.Contains(moduleId))
+            LogModuleInfo(moduleId, 0);
+    }
+
+    bool IsCaptureEnabled() const
+    {
+        return IsEventEnabled(ControlBlock::EventJit) || IsEventEnabled(ControlBlock::EventEnter3);
+    }
 
-    TypeArgInfo ResolveTypeArgument(ClassID classId);
-    void LogModuleInfo(ModuleID moduleId);
-    void LogModuleMappingRecursive(const TypeArgInfo& typeArg, int currentDepth);
-    std::wstring FormatTypeArgInfoJson(const TypeArgInfo& typeArg, int currentDepth);
-    std::wstring EscapeJson(const std::wstring& str);
+    void LogTypeArgModules(const TypeArgList& typeArgs);
+    void WriteTypeArgJson(JsonWriter& writer, const TypeArgEntry* entries, ULONG32& index);
+    void WriteTypeArgBinary(BinaryRecordBuilder& builder, const TypeArgEntry* entries, ULONG32& index);
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// The JIT compilations in progress on one thread, innermost last. Compiling a
+// method can run a class constructor whose callees are compiled first, so
+// Started/Finished pairs nest; each Finished takes the start time of its own
+// Started. Compilations nested deeper than Capacity are not timed.
+class JitTimingStack
+{
+public:
+    static const uint32_t Capacity = 32;
+
+    JitTimingStack() : depth(0) {}
+
+    void Push(uintptr_t functionId, uint64_t start)
+    {
+        if (depth == Capacity)
+            return;
+
+        entries[depth].functionId = functionId;
+        entries[depth].start = start;
+        depth++;
+    }
+
+    // False when functionId has no entry, e.g. it started before timing was
+    // on or past Capacity. Entries above it never finished and are dropped.
+    bool Pop(uintptr_t functionId, uint64_t& start)
+    {
+        for (uint32_t i = depth; i > 0; i--)
+        {
+            if (entries[i - 1].functionId == functionId)
+            {
+                start = entries[i - 1].start;
+                depth = i - 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Entry
+    {
+        uintptr_t functionId;
+        uint64_t start;
+    };
+
+    Entry entries[Capacity];
+    uint32_t depth;
+};
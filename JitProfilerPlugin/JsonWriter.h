@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Utf8.h"
+
+// Writes one JSON record as a UTF-8 line into a reusable buffer. Integers are
+// formatted by hand and strings are escaped while they are transcoded from
+// UTF-16, so nothing goes through printf and no wide string is built. Keep
+// one per thread: once the buffer has grown to the largest record, writing a
+// record does not allocate.
+class JsonWriter
+{
+public:
+    JsonWriter() : length(0), needComma(false)
+    {
+        buffer.resize(1024);
+    }
+
+    void Begin()
+    {
+        length = 0;
+        needComma = false;
+    }
+
+    void BeginObject()
+    {
+        Separator();
+        Put('{');
+        needComma = false;
+    }
+
+    void EndObject()
+    {
+        Put('}');
+        needComma = true;
+    }
+
+    void BeginArray(const char* name)
+    {
+        Name(name);
+        Put('[');
+        needComma = false;
+    }
+
+    void EndArray()
+    {
+        Put(']');
+        needComma = true;
+    }
+
+    void Property(const char* name, uint64_t value)
+    {
+        Name(name);
+        WriteUnsigned(value);
+        needComma = true;
+    }
+
+    template <typename Char>
+    void Property(const char* name, const Char* text, size_t textLength)
+    {
+        Name(name);
+        WriteString(text, textLength);
+        needComma = true;
+    }
+
+    // Terminates the line and returns it; valid until the next Begin.
+    const char* Finish(uint32_t& outLength)
+    {
+        Put('\n');
+        outLength = (uint32_t)length;
+        return buffer.data();
+    }
+
+private:
+    void Reserve(size_t count)
+    {
+        if (length + count > buffer.size())
+        {
+            size_t newSize = buffer.size() * 2;
+            if (newSize < length + count)
+                newSize = length + count;
+            buffer.resize(newSize);
+        }
+    }
+
+    void Put(char c)
+    {
+        Reserve(1);
+        buffer[length++] = c;
+    }
+
+    void Separator()
+    {
+        if (needComma)
+            Put(',');
+    }
+
+    void Name(const char* name)
+    {
+        size_t nameLength = strlen(name);
+        Separator();
+        Reserve(nameLength + 3);
+        char* out = buffer.data() + length;
+        *out++ = '"';
+        memcpy(out, name, nameLength);
+        out += nameLength;
+        *out++ = '"';
+        *out++ = ':';
+        length += nameLength + 3;
+    }
+
+    void WriteUnsigned(uint64_t value)
+    {
+        static const char s_digitPairs[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+        // Digits are produced from the right, two at a time.
+        char digits[20];
+        size_t pos = sizeof(digits);
+        while (value >= 100)
+        {
+            size_t pair = (size_t)(value % 100) * 2;
+            value /= 100;
+            digits[--pos] = s_digitPairs[pair + 1];
+            digits[--pos] = s_digitPairs[pair];
+        }
+        if (value >= 10)
+        {
+            size_t pair = (size_t)value * 2;
+            digits[--pos] = s_digitPairs[pair + 1];
+            digits[--pos] = s_digitPairs[pair];
+        }
+        else
+        {
+            digits[--pos] = (char)('0' + value);
+        }
+
+        size_t count = sizeof(digits) - pos;
+        Reserve(count);
+        memcpy(buffer.data() + length, digits + pos, count);
+        length += count;
+    }
+
+    template <typename Char>
+    void WriteString(const Char* text, size_t textLength)
+    {
+        static const char s_hex[] = "0123456789abcdef";
+
+        // A UTF-16 unit needs at most 6 bytes (\u00XX); a surrogate pair or a
+        // UTF-32 unit needs 4.
+        Reserve(textLength * 6 + 2);
+        char* out = buffer.data() + length;
+        *out++ = '"';
+        for (size_t i = 0; i < textLength;)
+        {
+            uint32_t c = Utf8::NextCodePoint(text, textLength, i);
+            switch (c)
+            {
+            case '"': *out++ = '\\'; *out++ = '"'; break;
+            case '\\': *out++ = '\\'; *out++ = '\\'; break;
+            case '\b': *out++ = '\\'; *out++ = 'b'; break;
+            case '\f': *out++ = '\\'; *out++ = 'f'; break;
+            case '\n': *out++ = '\\'; *out++ = 'n'; break;
+            case '\r': *out++ = '\\'; *out++ = 'r'; break;
+            case '\t': *out++ = '\\'; *out++ = 't'; break;
+            default:
+                if (c < 0x20)
+                {
+                    memcpy(out, "\\u00", 4);
+                    out[4] = s_hex[c >> 4];
+                    out[5] = s_hex[c & 0xF];
+                    out += 6;
+                }
+                else
+                {
+                    out += Utf8::Encode(c, (uint8_t*)out);
+                }
+                break;
+            }
+        }
+        *out++ = '"';
+        length = out - buffer.data();
+    }
+
+    std::vector<char> buffer;
+    size_t length;
+    bool needComma;
+};
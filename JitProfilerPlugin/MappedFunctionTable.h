@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Per-function record handed to the runtime as the ClientID in mapper capture
+// mode (SIG_JIT_PROFILER_CAPTURE_MODE=mapper). The Enter3 hook gets this
+// pointer back instead of the FunctionID. Once 'logged' is set, a call costs
+// one load and a branch.
+struct MappedFunction
+{
+    uintptr_t functionId;
+    uint32_t index;
+    std::atomic<bool> logged;
+};
+
+// Append-only storage for MappedFunction records. Records get dense indices
+// and never move: ClientIDs stay valid for the life of the process. Blocks are
+// allocated on demand; adding a record takes no lock.
+class MappedFunctionTable
+{
+public:
+    static const size_t BlockSize = 4096;
+    static const size_t MaxBlocks = 4096;
+
+    MappedFunctionTable()
+        : next(0)
+    {
+        for (size_t i = 0; i < MaxBlocks; i++)
+            blocks[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~MappedFunctionTable()
+    {
+        for (size_t i = 0; i < MaxBlocks; i++)
+            delete[] blocks[i].load(std::memory_order_relaxed);
+    }
+
+    MappedFunctionTable(const MappedFunctionTable&) = delete;
+    MappedFunctionTable& operator=(const MappedFunctionTable&) = delete;
+
+    // Returns nullptr once BlockSize * MaxBlocks records exist.
+    MappedFunction* Add(uintptr_t functionId)
+    {
+        size_t index = next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= BlockSize * MaxBlocks)
+            return nullptr;
+
+        std::atomic<MappedFunction*>& slot = blocks[index / BlockSize];
+        MappedFunction* block = slot.load(std::memory_order_acquire);
+        if (block == nullptr)
+        {
+            MappedFunction* fresh = new MappedFunction[BlockSize]();
+            if (slot.compare_exchange_strong(block, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+                block = fresh;
+            else
+                delete[] fresh;
+        }
+
+        MappedFunction* record = &block[index % BlockSize];
+        record->functionId = functionId;
+        record->index = (uint32_t)index;
+        return record;
+    }
+
+    // Upper bound on the number of records. Entries still being added read as functionId 0.
+    size_t Count() const
+    {
+        size_t count = next.load(std::memory_order_acquire);
+        return count < BlockSize * MaxBlocks ? count : BlockSize * MaxBlocks;
+    }
+
+    // Valid for index < Count(); nullptr if the block is not allocated yet.
+    MappedFunction* Get(size_t index) const
+    {
+        MappedFunction* block = blocks[index / BlockSize].load(std::memory_order_acquire);
+        return block == nullptr ? nullptr : &block[index % BlockSize];
+    }
+
+private:
+    std::atomic<size_t> next;
+    std::atomic<MappedFunction*> blocks[MaxBlocks];
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Platform.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Log file written through a memory mapping, used by ProfilerLogger when
+// SIG_JIT_PROFILER_SINK=mapped. Producers reserve their bytes with one
+// fetch-add on the write cursor and copy the record into the view, so nothing
+// on the write path enters the kernel. The file grows in extents; Close cuts it
+// to the bytes written. A killed process leaves the pages to the OS, so the
+// records survive, followed by zeros up to the end of the last extent.
+class MappedLogFile
+{
+public:
+    MappedLogFile() : extentSize(0), current(nullptr), cursor(0), viewCount(0)
+    {
+        growLock.Initialize();
+    }
+
+    MappedLogFile(const MappedLogFile&) = delete;
+    MappedLogFile& operator=(const MappedLogFile&) = delete;
+
+    bool Open(const std::wstring& path, size_t extent)
+    {
+        extentSize = extent;
+        cursor.store(0, std::memory_order_relaxed);
+        viewCount = 0;
+        current.store(nullptr, std::memory_order_relaxed);
+        return file.Create(path) && Grow(extent) != nullptr;
+    }
+
+    bool IsOpen() const { return current.load(std::memory_order_acquire) != nullptr; }
+
+    // Bytes reserved so far, which is the file length once Close has run.
+    uint64_t Length() const { return cursor.load(std::memory_order_relaxed); }
+
+    // Returns false when the file could not grow to hold the record; its
+    // reserved bytes are then left as zeros.
+    bool Write(const void* data, size_t length)
+    {
+        uint64_t offset = cursor.fetch_add(length, std::memory_order_relaxed);
+        uint64_t end = offset + length;
+
+        const View* view = current.load(std::memory_order_acquire);
+        if (view == nullptr)
+            return false;
+        if (end > view->size)
+        {
+            view = Grow(end);
+            if (view == nullptr)
+                return false;
+        }
+
+        memcpy(view->data + offset, data, length);
+        return true;
+    }
+
+    // No Write may be running or start after this.
+    void Close()
+    {
+        current.store(nullptr, std::memory_order_relaxed);
+        file.Close((size_t)cursor.load(std::memory_order_relaxed));
+    }
+
+private:
+    // Each growth maps the whole file again. The views are published as a
+    // unit, so a writer never pairs one view's base with another's size.
+    struct View
+    {
+        uint8_t* data;
+        uint64_t size;
+    };
+
+    static const size_t MaxViews = 64;
+
+    const View* Grow(uint64_t needed)
+    {
+        growLock.Enter();
+        const View* view = current.load(std::memory_order_acquire);
+        if (view == nullptr || view->size < needed)
+        {
+            // Double at least, so the views stay few and the total mapped
+            // address space under twice the file size.
+            uint64_t size = view != nullptr ? view->size * 2 : 0;
+            if (size < needed)
+                size = needed;
+            size = (size + extentSize - 1) / extentSize * extentSize;
+
+            uint8_t* data = viewCount < MaxViews ? file.Map((size_t)size) : nullptr;
+            if (data != nullptr)
+            {
+                views[viewCount] = { data, size };
+                view = &views[viewCount++];
+                current.store(view, std::memory_order_release);
+            }
+            else
+            {
+                view = nullptr;
+            }
+        }
+        growLock.Leave();
+        return view;
+    }
+
+    Platform::MappedFile file;
+    Platform::Mutex growLock;
+    uint64_t extentSize;
+    std::atomic<const View*> current;
+    std::atomic<uint64_t> cursor;
+    View views[MaxViews];
+    size_t viewCount;
+};
@@ -0,0 +1,517 @@
+#include "Platform.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdlib>
+#include <cwchar>
+#include <cwctype>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+// Our own strings are wchar_t; file names and environment values are UTF-8.
+static std::string ToUtf8(const std::wstring& text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size();)
+    {
+        uint8_t bytes[4];
+        size_t count = Utf8::Encode(Utf8::NextCodePoint(text.c_str(), text.size(), i), bytes);
+        result.append((const char*)bytes, count);
+    }
+    return result;
+}
+
+static std::wstring FromUtf8(const char* text)
+{
+    std::wstring result;
+    const uint8_t* p = (const uint8_t*)text;
+    while (*p != 0)
+    {
+        uint32_t c = *p++;
+        int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        if (extra > 0)
+            c &= 0x3F >> extra;
+        for (; extra > 0 && (*p & 0xC0) == 0x80; extra--)
+            c = (c << 6) | (*p++ & 0x3F);
+        result += (wchar_t)(extra == 0 ? c : 0xFFFD);
+    }
+    return result;
+}
+#endif
+
+bool GetEnvironmentSetting(const wchar_t* name, std::wstring& value)
+{
+#ifdef _WIN32
+    DWORD envLen = GetEnvironmentVariableW(name, nullptr, 0);
+    if (envLen == 0)
+        return false;
+
+    std::wstring buffer(envLen, L'\0');
+    if (GetEnvironmentVariableW(name, &buffer[0], envLen) == 0)
+        return false;
+
+    value = buffer.substr(0, wcsnlen_s(buffer.c_str(), buffer.size()));
+#else
+    const char* setting = getenv(ToUtf8(name).c_str());
+    if (setting == nullptr)
+        return false;
+
+    value = FromUtf8(setting);
+#endif
+    return !value.empty();
+}
+
+namespace Platform
+{
+#ifdef _WIN32
+
+    void Mutex::Initialize() { InitializeSRWLock(&lock); }
+    void Mutex::Enter() { AcquireSRWLockExclusive(&lock); }
+    void Mutex::Leave() { ReleaseSRWLockExclusive(&lock); }
+
+    void ReaderWriterLock::Initialize() { InitializeSRWLock(&lock); }
+    void ReaderWriterLock::AcquireShared() { AcquireSRWLockShared(&lock); }
+    void ReaderWriterLock::ReleaseShared() { ReleaseSRWLockShared(&lock); }
+    void ReaderWriterLock::AcquireExclusive() { AcquireSRWLockExclusive(&lock); }
+    void ReaderWriterLock::ReleaseExclusive() { ReleaseSRWLockExclusive(&lock); }
+
+    Event::Event() : created(false), handle(NULL) {}
+    Event::~Event() { Close(); }
+
+    bool Event::Create()
+    {
+        handle = CreateEventW(NULL, FALSE, FALSE, NULL);
+        created = handle != NULL;
+        return created;
+    }
+
+    void Event::Close()
+    {
+        if (created)
+        {
+            CloseHandle(handle);
+            handle = NULL;
+            created = false;
+        }
+    }
+
+    void Event::Set() { SetEvent(handle); }
+    void Event::Wait(uint32_t timeoutMs) { WaitForSingleObject(handle, timeoutMs); }
+
+    Thread::Thread() : started(false), procedure(nullptr), parameter(nullptr), handle(NULL) {}
+    Thread::~Thread() { Detach(); }
+
+    DWORD WINAPI Thread::Run(LPVOID self)
+    {
+        Thread* thread = (Thread*)self;
+        thread->procedure(thread->parameter);
+        return 0;
+    }
+
+    bool Thread::Start(Procedure procedure, void* parameter)
+    {
+        this->procedure = procedure;
+        this->parameter = parameter;
+        handle = CreateThread(NULL, 0, Run, this, 0, NULL);
+        started = handle != NULL;
+        return started;
+    }
+
+    void Thread::Join()
+    {
+        if (started)
+        {
+            WaitForSingleObject(handle, INFINITE);
+            Detach();
+        }
+    }
+
+    void Thread::Detach()
+    {
+        if (started)
+        {
+            CloseHandle(handle);
+            handle = NULL;
+            started = false;
+        }
+    }
+
+    SharedMemory::SharedMemory() : view(nullptr), viewSize(0), mapping(NULL) {}
+    SharedMemory::~SharedMemory() { Close(); }
+
+    void* SharedMemory::Open(const std::wstring& name, size_t& size)
+    {
+        mapping = OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name.c_str());
+        if (mapping == NULL)
+            return nullptr;
+
+        view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+        if (view == nullptr)
+        {
+            CloseHandle(mapping);
+            mapping = NULL;
+            return nullptr;
+        }
+
+        // Views are whole pages, so this is at least what the creator asked for.
+        MEMORY_BASIC_INFORMATION info;
+        viewSize = VirtualQuery(view, &info, sizeof(info)) != 0 ? info.RegionSize : 0;
+        size = viewSize;
+        return view;
+    }
+
+    void SharedMemory::Close()
+    {
+        if (view != nullptr)
+        {
+            UnmapViewOfFile(view);
+            view = nullptr;
+        }
+        if (mapping != NULL)
+        {
+            CloseHandle(mapping);
+            mapping = NULL;
+        }
+    }
+
+    MappedFile::MappedFile() : viewCount(0), file(INVALID_HANDLE_VALUE) {}
+    MappedFile::~MappedFile() { Close(0); }
+
+    bool MappedFile::Create(const std::wstring& path)
+    {
+        file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+            NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        return file != INVALID_HANDLE_VALUE;
+    }
+
+    bool MappedFile::IsOpen() const { return file != INVALID_HANDLE_VALUE; }
+
+    uint8_t* MappedFile::Map(size_t size)
+    {
+        if (file == INVALID_HANDLE_VALUE || viewCount == MaxViews)
+            return nullptr;
+
+        // A mapping larger than the file extends it.
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+        if (mapping == NULL)
+            return nullptr;
+
+        // The view keeps the mapping alive.
+        void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+        CloseHandle(mapping);
+        if (view == nullptr)
+            return nullptr;
+
+        views[viewCount] = view;
+        viewSizes[viewCount] = size;
+        viewCount++;
+        return (uint8_t*)view;
+    }
+
+    void MappedFile::Close(size_t length)
+    {
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        for (size_t i = 0; i < viewCount; i++)
+            UnmapViewOfFile(views[i]);
+        viewCount = 0;
+
+        // Only possible once no view is left.
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)length;
+        if (SetFilePointerEx(file, end, NULL, FILE_BEGIN))
+            SetEndOfFile(file);
+
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+
+    void NotifyOnThreadExit(void (*callback)())
+    {
+    }
+
+    void YieldThread() { SwitchToThread(); }
+    uint64_t GetTickCountMs() { return GetTickCount64(); }
+
+    uint64_t GetTimestampNs()
+    {
+        static LARGE_INTEGER frequency = {};
+        if (frequency.QuadPart == 0)
+            QueryPerformanceFrequency(&frequency);
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+
+        // Split so the multiplication cannot overflow
+        uint64_t ticks = (uint64_t)counter.QuadPart;
+        uint64_t perSecond = (uint64_t)frequency.QuadPart;
+        return ticks / perSecond * 1000000000 + ticks % perSecond * 1000000000 / perSecond;
+    }
+    uint32_t GetProcessId() { return GetCurrentProcessId(); }
+    void DebugOutput(const wchar_t* message) { OutputDebugStringW(message); }
+
+    FILE* OpenFileForWriting(const std::wstring& path)
+    {
+        FILE* file = nullptr;
+        if (_wfopen_s(&file, path.c_str(), L"wb") != 0)
+            return nullptr;
+        return file;
+    }
+
+    int ParseInt(const std::wstring& text) { return _wtoi(text.c_str()); }
+    int CompareNoCase(const wchar_t* left, const wchar_t* right) { return _wcsicmp(left, right); }
+
+#else
+
+    void Mutex::Initialize() { pthread_mutex_init(&lock, nullptr); }
+    void Mutex::Enter() { pthread_mutex_lock(&lock); }
+    void Mutex::Leave() { pthread_mutex_unlock(&lock); }
+
+    void ReaderWriterLock::Initialize() { pthread_rwlock_init(&lock, nullptr); }
+    void ReaderWriterLock::AcquireShared() { pthread_rwlock_rdlock(&lock); }
+    void ReaderWriterLock::ReleaseShared() { pthread_rwlock_unlock(&lock); }
+    void ReaderWriterLock::AcquireExclusive() { pthread_rwlock_wrlock(&lock); }
+    void ReaderWriterLock::ReleaseExclusive() { pthread_rwlock_unlock(&lock); }
+
+    Event::Event() : created(false), signaled(false) {}
+    Event::~Event() { Close(); }
+
+    bool Event::Create()
+    {
+        pthread_condattr_t attributes;
+        pthread_condattr_init(&attributes);
+        pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+        bool conditionCreated = pthread_cond_init(&condition, &attributes) == 0;
+        pthread_condattr_destroy(&attributes);
+        if (!conditionCreated)
+            return false;
+
+        pthread_mutex_init(&mutex, nullptr);
+        signaled = false;
+        created = true;
+        return true;
+    }
+
+    void Event::Close()
+    {
+        if (created)
+        {
+            pthread_cond_destroy(&condition);
+            pthread_mutex_destroy(&mutex);
+            created = false;
+        }
+    }
+
+    void Event::Set()
+    {
+        pthread_mutex_lock(&mutex);
+        signaled = true;
+        pthread_cond_signal(&condition);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    void Event::Wait(uint32_t timeoutMs)
+    {
+        timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeoutMs / 1000;
+        deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_mutex_lock(&mutex);
+        while (!signaled)
+        {
+            if (pthread_cond_timedwait(&condition, &mutex, &deadline) == ETIMEDOUT)
+                break;
+        }
+        signaled = false;
+        pthread_mutex_unlock(&mutex);
+    }
+
+    Thread::Thread() : started(false), procedure(nullptr), parameter(nullptr), handle() {}
+    Thread::~Thread() { Detach(); }
+
+    void* Thread::Run(void* self)
+    {
+        Thread* thread = (Thread*)self;
+        thread->procedure(thread->parameter);
+        return nullptr;
+    }
+
+    bool Thread::Start(Procedure procedure, void* parameter)
+    {
+        this->procedure = procedure;
+        this->parameter = parameter;
+        started = pthread_create(&handle, nullptr, Run, this) == 0;
+        return started;
+    }
+
+    void Thread::Join()
+    {
+        if (started)
+        {
+            pthread_join(handle, nullptr);
+            started = false;
+        }
+    }
+
+    void Thread::Detach()
+    {
+        if (started)
+        {
+            pthread_detach(handle);
+            started = false;
+        }
+    }
+
+    SharedMemory::SharedMemory() : view(nullptr), viewSize(0) {}
+    SharedMemory::~SharedMemory() { Close(); }
+
+    void* SharedMemory::Open(const std::wstring& name, size_t& size)
+    {
+        int fd = shm_open(("/" + ToUtf8(name)).c_str(), O_RDWR, 0);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size <= 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        void* mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+            return nullptr;
+
+        view = mapped;
+        viewSize = (size_t)status.st_size;
+        size = viewSize;
+        return view;
+    }
+
+    void SharedMemory::Close()
+    {
+        if (view != nullptr)
+        {
+            munmap(view, viewSize);
+            view = nullptr;
+            viewSize = 0;
+        }
+    }
+
+    MappedFile::MappedFile() : viewCount(0), file(-1) {}
+    MappedFile::~MappedFile() { Close(0); }
+
+    bool MappedFile::Create(const std::wstring& path)
+    {
+        file = open(ToUtf8(path).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        return file >= 0;
+    }
+
+    bool MappedFile::IsOpen() const { return file >= 0; }
+
+    uint8_t* MappedFile::Map(size_t size)
+    {
+        if (file < 0 || viewCount == MaxViews || ftruncate(file, (off_t)size) != 0)
+            return nullptr;
+
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (view == MAP_FAILED)
+            return nullptr;
+
+        views[viewCount] = view;
+        viewSizes[viewCount] = size;
+        viewCount++;
+        return (uint8_t*)view;
+    }
+
+    void MappedFile::Close(size_t length)
+    {
+        if (file < 0)
+            return;
+
+        for (size_t i = 0; i < viewCount; i++)
+            munmap(views[i], viewSizes[i]);
+        viewCount = 0;
+
+        if (ftruncate(file, (off_t)length) != 0)
+            DebugOutput(L"JitProfilerPlugin: could not truncate a mapped log file\n");
+        close(file);
+        file = -1;
+    }
+
+    namespace
+    {
+        struct ThreadExitHook
+        {
+            void (*callback)() = nullptr;
+
+            ~ThreadExitHook()
+            {
+                if (callback != nullptr)
+                    callback();
+            }
+        };
+
+        thread_local ThreadExitHook t_threadExitHook;
+    }
+
+    void NotifyOnThreadExit(void (*callback)())
+    {
+        t_threadExitHook.callback = callback;
+    }
+
+    void YieldThread() { sched_yield(); }
+
+    uint64_t GetTickCountMs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+    }
+
+    uint64_t GetTimestampNs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+    }
+
+    uint32_t GetProcessId() { return (uint32_t)getpid(); }
+
+    void DebugOutput(const wchar_t* message)
+    {
+        static const bool verbose = []()
+        {
+            std::wstring value;
+            return GetEnvironmentSetting(L"SIG_JIT_PROFILER_VERBOSE", value) && ParseInt(value) != 0;
+        }();
+
+        if (verbose)
+            fputs(ToUtf8(message).c_str(), stderr);
+    }
+
+    FILE* OpenFileForWriting(const std::wstring& path)
+    {
+        return fopen(ToUtf8(path).c_str(), "wb");
+    }
+
+    int ParseInt(const std::wstring& text) { return (int)wcstol(text.c_str(), nullptr, 10); }
+    int CompareNoCase(const wchar_t* left, const wchar_t* right) { return wcscasecmp(left, right); }
+
+#endif
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+// The operating system services the profiler uses. On Windows they map to
+// Win32; elsewhere to POSIX. CoreCLR's PAL headers declare Win32 names of their
+// own on Linux without an implementation a profiler can link against, so the
+// profiler calls these instead of the Win32 names.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "Utf8.h"
+
+// Reads an environment variable; false when it is unset or empty.
+bool GetEnvironmentSetting(const wchar_t* name, std::wstring& value);
+
+namespace Platform
+{
+#ifdef _WIN32
+    const wchar_t PathSeparator = L'\\';
+    const wchar_t* const DefaultLogPath = L"C:\\siglocal";
+#else
+    const wchar_t PathSeparator = L'/';
+    const wchar_t* const DefaultLogPath = L"/tmp/siglocal";
+#endif
+
+    // Non-recursive lock. Like CRITICAL_SECTION it has no constructor, so a
+    // static one can be used before static constructors have run; call
+    // Initialize first.
+    class Mutex
+    {
+    public:
+        void Initialize();
+        void Enter();
+        void Leave();
+
+    private:
+#ifdef _WIN32
+        SRWLOCK lock;
+#else
+        pthread_mutex_t lock;
+#endif
+    };
+
+    class ReaderWriterLock
+    {
+    public:
+        void Initialize();
+        void AcquireShared();
+        void ReleaseShared();
+        void AcquireExclusive();
+        void ReleaseExclusive();
+
+    private:
+#ifdef _WIN32
+        SRWLOCK lock;
+#else
+        pthread_rwlock_t lock;
+#endif
+    };
+
+    // Auto-reset event: Set wakes one Wait, or the next one if nobody waits.
+    class Event
+    {
+    public:
+        Event();
+        ~Event();
+
+        Event(const Event&) = delete;
+        Event& operator=(const Event&) = delete;
+
+        bool Create();
+        void Close();
+        bool IsCreated() const { return created; }
+        void Set();
+        void Wait(uint32_t timeoutMs);
+
+    private:
+        bool created;
+#ifdef _WIN32
+        HANDLE handle;
+#else
+        pthread_mutex_t mutex;
+        pthread_cond_t condition;
+        bool signaled;
+#endif
+    };
+
+    class Thread
+    {
+    public:
+        typedef void (*Procedure)(void* parameter);
+
+        Thread();
+        ~Thread();
+
+        Thread(const Thread&) = delete;
+        Thread& operator=(const Thread&) = delete;
+
+        bool Start(Procedure procedure, void* parameter);
+        bool IsStarted() const { return started; }
+        // Waits for the thread to return.
+        void Join();
+        // Lets the thread run on without waiting, e.g. while the process exits.
+        void Detach();
+
+    private:
+        bool started;
+        Procedure procedure;
+        void* parameter;
+#ifdef _WIN32
+        HANDLE handle;
+        static DWORD WINAPI Run(LPVOID self);
+#else
+        pthread_t handle;
+        static void* Run(void* self);
+#endif
+    };
+
+    // A named shared memory block created by the controller: a file mapping on
+    // Windows, a POSIX shared memory object (/dev/shm/<name>) elsewhere.
+    class SharedMemory
+    {
+    public:
+        SharedMemory();
+        ~SharedMemory();
+
+        SharedMemory(const SharedMemory&) = delete;
+        SharedMemory& operator=(const SharedMemory&) = delete;
+
+        // Maps the whole block for reading and writing. size is the number of
+        // bytes that can be accessed, which may be more than the creator asked for.
+        void* Open(const std::wstring& name, size_t& size);
+        void Close();
+
+    private:
+        void* view;
+        size_t viewSize;
+#ifdef _WIN32
+        HANDLE mapping;
+#endif
+    };
+
+    // A file written through memory mappings. Each Map call extends the file
+    // and maps all of it again; earlier views stay mapped until Close, so a
+    // writer still holding one is not disturbed when the file grows.
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Creates or truncates the file.
+        bool Create(const std::wstring& path);
+        bool IsOpen() const;
+        // Extends the file to size bytes and returns a view of all of it.
+        uint8_t* Map(size_t size);
+        // Unmaps every view and cuts the file to length bytes.
+        void Close(size_t length);
+
+    private:
+        static const size_t MaxViews = 64;
+
+        void* views[MaxViews];
+        size_t viewSizes[MaxViews];
+        size_t viewCount;
+#ifdef _WIN32
+        HANDLE file;
+#else
+        int file;
+#endif
+    };
+
+    // Runs callback when the calling thread exits. On Windows DllMain sees
+    // thread exits, so this does nothing there.
+    void NotifyOnThreadExit(void (*callback)());
+
+    void YieldThread();
+    uint64_t GetTickCountMs();
+    // Monotonic clock with sub-microsecond resolution, in nanoseconds.
+    uint64_t GetTimestampNs();
+    uint32_t GetProcessId();
+    // The debugger output on Windows. Elsewhere stderr, which belongs to the
+    // profiled process, so only with SIG_JIT_PROFILER_VERBOSE=1.
+    void DebugOutput(const wchar_t* message);
+
+    FILE* OpenFileForWriting(const std::wstring& path);
+
+    int ParseInt(const std::wstring& text);
+    int CompareNoCase(const wchar_t* left, const wchar_t* right);
+
+    // Length of a runtime string (WCHAR, UTF-16 on every platform) of at most
+    // maxLength units.
+    template <typename Char>
+    size_t StringLength(const Char* text, size_t maxLength)
+    {
+        size_t length = 0;
+        while (length < maxLength && text[length] != 0)
+            length++;
+        return length;
+    }
+
+    // Converts a runtime string to wchar_t, which is UTF-32 outside Windows.
+    template <typename Char>
+    std::wstring ToWideString(const Char* text, size_t length)
+    {
+        if (sizeof(Char) == sizeof(wchar_t))
+            return std::wstring((const wchar_t*)text, length);
+
+        std::wstring result;
+        result.reserve(length);
+        for (size_t i = 0; i < length;)
+            result += (wchar_t)Utf8::NextCodePoint(text, length, i);
+        return result;
+    }
+}
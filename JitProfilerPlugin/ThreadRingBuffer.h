@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Single-producer/single-consumer byte ring used by ProfilerLogger. The owning
+// thread appends length-prefixed records with TryWrite and the flusher thread
+// drains them with Drain; neither side takes a lock.
+class ThreadRingBuffer
+{
+public:
+    struct RecordHeader
+    {
+        uint32_t length;
+        uint32_t stream;
+    };
+
+    explicit ThreadRingBuffer(size_t requestedCapacity)
+        : data(nullptr), capacity(0), mask(0), writePos(0), readPos(0)
+    {
+        size_t size = 4096;
+        while (size < requestedCapacity)
+            size <<= 1;
+
+        data = new uint8_t[size];
+        capacity = size;
+        mask = size - 1;
+    }
+
+    ~ThreadRingBuffer()
+    {
+        delete[] data;
+    }
+
+    ThreadRingBuffer(const ThreadRingBuffer&) = delete;
+    ThreadRingBuffer& operator=(const ThreadRingBuffer&) = delete;
+
+    size_t Capacity() const { return capacity; }
+
+    // Records larger than this never fit, whatever the consumer does.
+    size_t MaxRecordLength() const { return capacity / 2 - sizeof(RecordHeader); }
+
+    size_t Used() const
+    {
+        return (size_t)(writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire));
+    }
+
+    // Producer side. Returns false when the ring does not have room for the record.
+    bool TryWrite(uint32_t stream, const void* record, uint32_t length)
+    {
+        const size_t needed = sizeof(RecordHeader) + length;
+        const uint64_t head = writePos.load(std::memory_order_relaxed);
+        const uint64_t tail = readPos.load(std::memory_order_acquire);
+        if (capacity - (size_t)(head - tail) < needed)
+            return false;
+
+        RecordHeader header = { length, stream };
+        CopyIn(head, &header, sizeof(header));
+        CopyIn(head + sizeof(header), record, length);
+        writePos.store(head + needed, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Calls sink(stream, bytes, length) for every pending record;
+    // a record that wraps around the end of the ring is delivered in two calls.
+    template <typename Sink>
+    size_t Drain(Sink&& sink)
+    {
+        uint64_t tail = readPos.load(std::memory_order_relaxed);
+        const uint64_t head = writePos.load(std::memory_order_acquire);
+        size_t records = 0;
+
+        while (tail != head)
+        {
+            RecordHeader header;
+            CopyOut(tail, &header, sizeof(header));
+            tail += sizeof(header);
+
+            size_t offset = (size_t)(tail & mask);
+            size_t first = capacity - offset;
+            if (first >= header.length)
+            {
+                sink(header.stream, (const char*)data + offset, (size_t)header.length);
+            }
+            else
+            {
+                sink(header.stream, (const char*)data + offset, first);
+                sink(header.stream, (const char*)data, (size_t)header.length - first);
+            }
+
+            tail += header.length;
+            records++;
+        }
+
+        readPos.store(tail, std::memory_order_release);
+        return records;
+    }
+
+private:
+    void CopyIn(uint64_t position, const void* source, size_t length)
+    {
+        size_t offset = (size_t)(position & mask);
+        size_t first = capacity - offset;
+        if (first >= length)
+        {
+            memcpy(data + offset, source, length);
+        }
+        else
+        {
+            memcpy(data + offset, source, first);
+            memcpy(data, (const uint8_t*)source + first, length - first);
+        }
+    }
+
+    void CopyOut(uint64_t position, void* destination, size_t length) const
+    {
+        size_t offset = (size_t)(position & mask);
+        size_t first = capacity - offset;
+        if (first >= length)
+        {
+            memcpy(destination, data + offset, length);
+        }
+        else
+        {
+            memcpy(destination, data + offset, first);
+            memcpy((uint8_t*)destination + first, data, length - first);
+        }
+    }
+
+    uint8_t* data;
+    size_t capacity;
+    size_t mask;
+
+    // Producer and consumer cursors live on separate cache lines.
+    alignas(64) std::atomic<uint64_t> writePos;
+    alignas(64) std::atomic<uint64_t> readPos;
+};
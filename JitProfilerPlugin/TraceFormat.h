@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Utf8.h"
+
+// Binary trace format (SIG_JIT_PROFILER_FORMAT=binary).
+//
+// trace.bin starts with a FileHeader followed by an append-only sequence of
+// records. Every record is a fixed-size RecordHeader and 'length' payload
+// bytes. Integers in the payload are LEB128 varints; metadata tokens are
+// stored as (rid << 8) | table so that small rids stay small. Strings are a
+// varint byte count followed by UTF-8. A TypeArg tree is written in preorder:
+//
+//   varint ModuleID, token TypeDef, varint (NestedCount << 1) | truncated
+//
+// followed by its NestedCount children unless the truncated bit is set (the
+// SIG_JIT_PROFILER_MAX_RECURSE limit was hit). With SIG_JIT_PROFILER_THREADS=1
+// JIT and Enter3 records end with a Tag:
+//
+//   varint ThreadIndex, varint Sequence, varint Time
+//
+// Readers skip unknown record types by length; the version is bumped only for
+// incompatible changes.
+namespace TraceFormat
+{
+    const char Magic[4] = { 'S', 'J', 'P', 'T' };
+    const uint16_t Version = 1;
+
+    enum RecordType : uint8_t
+    {
+        // ModuleID, AssemblyID, ModuleName, AssemblyName, LoadTime; LoadTime
+        // is 0 for a module that loaded while capture was off and was logged
+        // when a record first referred to it.
+        RecordModule = 1,
+        // FunctionID[, Tag]
+        RecordJit = 2,
+        // FunctionID, ModuleID, MethodToken, DeclaringTypeModuleID, DeclaringTypeToken,
+        // DeclaringTypeArgCount, TypeArg[], MethodTypeArgCount, TypeArg[][, Tag]
+        RecordEnter3 = 3,
+        // FunctionID, Start, Duration, CodeSize, HRESULT; nanoseconds on the
+        // monotonic clock, one per compilation, recompilations included.
+        // CodeSize is 0 but for a function's first successful compilation, as
+        // the runtime only reports the code a function currently runs, which
+        // is precompiled code or an earlier tier's until a recompile is used.
+        // Only written with SIG_JIT_PROFILER_JIT_TIMING=1 or SIG_JIT_PROFILER_TIERS=1.
+        RecordJitFinished = 4,
+        // Caller FunctionID, callee FunctionID, callee ModuleID, callee MethodDef;
+        // one per pair inlined. Only written with SIG_JIT_PROFILER_INLINING=1.
+        RecordInlining = 5,
+        // FunctionID, Time; the first time precompiled code was used for the
+        // function. Only written with SIG_JIT_PROFILER_TIERS=1.
+        RecordCacheHit = 6,
+        // 7 is not used.
+        // ModuleID, Time; written in ModuleUnloadStarted for logged modules.
+        RecordModuleUnload = 8,
+        // ThreadIndex, ThreadID, Time; written before the first record tagged
+        // with the index. ThreadID is 0 for a thread the runtime does not
+        // manage, e.g. the profiler's own worker resolving deferred functions.
+        RecordThread = 9,
+        // ThreadID, Time
+        RecordThreadCreated = 10,
+        // ThreadID, Time
+        RecordThreadDestroyed = 11,
+        // ThreadID, OS thread ID
+        RecordThreadAssigned = 12,
+        // ThreadID, Name
+        RecordThreadName = 13,
+        // FunctionID, Count; the calls since the function's previous record,
+        // written a few times a second and at shutdown. A function's records
+        // add up to its calls. Only written with SIG_JIT_PROFILER_CALL_COUNTS=1.
+        RecordCallCount = 14,
+    };
+
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t headerSize;
+        uint64_t reserved;
+    };
+
+    struct RecordHeader
+    {
+        uint8_t type;
+        uint8_t reserved[3];
+        uint32_t length;
+    };
+#pragma pack(pop)
+
+    inline FileHeader MakeFileHeader()
+    {
+        FileHeader header = {};
+        memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.headerSize = (uint16_t)sizeof(FileHeader);
+        return header;
+    }
+
+    inline uint32_t EncodeToken(uint32_t token)
+    {
+        return ((token & 0x00FFFFFF) << 8) | (token >> 24);
+    }
+}
+
+// Builds one binary record into a reusable buffer. Owned per thread, so after
+// the first few records no allocation happens on the logging path.
+class BinaryRecordBuilder
+{
+public:
+    BinaryRecordBuilder()
+    {
+        buffer.reserve(256);
+    }
+
+    void Begin(TraceFormat::RecordType type)
+    {
+        buffer.resize(sizeof(TraceFormat::RecordHeader));
+        TraceFormat::RecordHeader header = {};
+        header.type = type;
+        memcpy(buffer.data(), &header, sizeof(header));
+    }
+
+    void WriteVarint(uint64_t value)
+    {
+        uint8_t bytes[10];
+        size_t count = 0;
+        while (value >= 0x80)
+        {
+            bytes[count++] = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        bytes[count++] = (uint8_t)value;
+        buffer.insert(buffer.end(), bytes, bytes + count);
+    }
+
+    void WriteToken(uint32_t token)
+    {
+        WriteVarint(TraceFormat::EncodeToken(token));
+    }
+
+    // UTF-16 in, UTF-8 out; unpaired surrogates become U+FFFD.
+    template <typename Char>
+    void WriteString(const Char* text, size_t length)
+    {
+        size_t utf8Length = 0;
+        for (size_t i = 0; i < length;)
+        {
+            utf8Length += Utf8::EncodedLength(Utf8::NextCodePoint(text, length, i));
+        }
+
+        WriteVarint(utf8Length);
+        size_t start = buffer.size();
+        buffer.resize(start + utf8Length);
+        uint8_t* out = buffer.data() + start;
+        for (size_t i = 0; i < length;)
+        {
+            out += Utf8::Encode(Utf8::NextCodePoint(text, length, i), out);
+        }
+    }
+
+    // Patches the payload length into the header and returns the whole record.
+    const uint8_t* Finish(uint32_t& length)
+    {
+        uint32_t payloadLength = (uint32_t)(buffer.size() - sizeof(TraceFormat::RecordHeader));
+        memcpy(buffer.data() + offsetof(TraceFormat::RecordHeader, length), &payloadLength, sizeof(payloadLength));
+        length = (uint32_t)buffer.size();
+        return buffer.data();
+    }
+
+private:
+    std::vector<uint8_t> buffer;
+};
@@ -0,0 +1,162 @@
+#include "TypeArgCache.h"
+
+#include <new>
+
+// Stands in for a type argument whose class could not be read, so that child
+// counts still match what the runtime reported.
+static const TypeArgNode s_unresolvedNode = { 0, 0, 0, nullptr };
+
+TypeArgCache::TypeArgCache()
+    : hits(0), misses(0), invalidations(0)
+{
+    for (size_t i = 0; i < ShardCount; i++)
+    {
+        shards[i].lock.Initialize();
+    }
+    allocationLock.Initialize();
+}
+
+TypeArgCache::~TypeArgCache()
+{
+    for (uint8_t* allocation : allocations)
+    {
+        delete[] allocation;
+    }
+}
+
+TypeArgCache::Shard& TypeArgCache::GetShard(ClassID classId)
+{
+    // ClassIDs are MethodTable pointers; the low bits carry no information.
+    uint64_t h = (uint64_t)classId * 0x9E3779B97F4A7C15ULL;
+    return shards[(size_t)(h >> 60) & (ShardCount - 1)];
+}
+
+const TypeArgNode* TypeArgCache::CreateNode(ModuleID moduleId, mdTypeDef typeDef, const std::vector<const TypeArgNode*>& children)
+{
+    size_t size = sizeof(TypeArgNode) + children.size() * sizeof(const TypeArgNode*);
+    uint8_t* memory = new uint8_t[size];
+
+    const TypeArgNode** childArray = (const TypeArgNode**)(memory + sizeof(TypeArgNode));
+    for (size_t i = 0; i < children.size(); i++)
+    {
+        childArray[i] = children[i];
+    }
+
+    TypeArgNode* node = new (memory) TypeArgNode();
+    node->moduleId = moduleId;
+    node->typeDef = typeDef;
+    node->childCount = (ULONG32)children.size();
+    node->children = childArray;
+
+    allocationLock.AcquireExclusive();
+    allocations.push_back(memory);
+    allocationLock.ReleaseExclusive();
+
+    return node;
+}
+
+const TypeArgNode* TypeArgCache::Resolve(ICorProfilerInfo3* profilerInfo, ClassID classId)
+{
+    Shard& shard = GetShard(classId);
+
+    shard.lock.AcquireShared();
+    auto found = shard.entries.find(classId);
+    const TypeArgNode* node = found != shard.entries.end() ? found->second : nullptr;
+    shard.lock.ReleaseShared();
+
+    if (node != nullptr)
+    {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    if (profilerInfo == NULL)
+        return nullptr;
+
+    // Most types have few type arguments; read them in the same call as the definition.
+    ModuleID moduleId = 0;
+    mdTypeDef typeDef = 0;
+    ClassID parentClassId = 0;
+    ClassID inlineTypeArgs[8];
+    ULONG32 typeArgCount = 0;
+
+    HRESULT hr = profilerInfo->GetClassIDInfo2(
+        classId,
+        &moduleId,
+        &typeDef,
+        &parentClassId,
+        (ULONG32)(sizeof(inlineTypeArgs) / sizeof(inlineTypeArgs[0])),
+        &typeArgCount,
+        inlineTypeArgs);
+
+    if (FAILED(hr))
+        return nullptr;
+
+    const ClassID* typeArgs = inlineTypeArgs;
+    std::vector<ClassID> largeTypeArgs;
+    if (typeArgCount > sizeof(inlineTypeArgs) / sizeof(inlineTypeArgs[0]))
+    {
+        largeTypeArgs.resize(typeArgCount);
+        hr = profilerInfo->GetClassIDInfo2(
+            classId,
+            &moduleId,
+            &typeDef,
+            &parentClassId,
+            typeArgCount,
+            &typeArgCount,
+            largeTypeArgs.data());
+
+        if (FAILED(hr))
+            return nullptr;
+        typeArgs = largeTypeArgs.data();
+    }
+
+    bool complete = true;
+    std::vector<const TypeArgNode*> children(typeArgCount);
+    for (ULONG32 i = 0; i < typeArgCount; i++)
+    {
+        children[i] = Resolve(profilerInfo, typeArgs[i]);
+        if (children[i] == nullptr)
+        {
+            children[i] = &s_unresolvedNode;
+            complete = false;
+        }
+    }
+
+    node = CreateNode(moduleId, typeDef, children);
+
+    // A node with unresolved parts is returned once but not remembered.
+    if (!complete)
+        return node;
+
+    shard.lock.AcquireExclusive();
+    auto inserted = shard.entries.emplace(classId, node);
+    node = inserted.first->second;
+    shard.lock.ReleaseExclusive();
+
+    return node;
+}
+
+void TypeArgCache::Invalidate(ClassID classId)
+{
+    Shard& shard = GetShard(classId);
+
+    shard.lock.AcquireExclusive();
+    size_t removed = shard.entries.erase(classId);
+    shard.lock.ReleaseExclusive();
+
+    if (removed != 0)
+    {
+        invalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+TypeArgCache::Stats TypeArgCache::GetStats() const
+{
+    Stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.invalidations = invalidations.load(std::memory_order_relaxed);
+    return stats;
+}
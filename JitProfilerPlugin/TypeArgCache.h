@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Platform.h"
+#include <cor.h>
+#include <corprof.h>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Immutable, interned description of a loaded type: its definition and the
+// nodes of its type arguments. Nodes are shared, so List<string> and
+// Dictionary<string, int> point at the same node for string.
+struct TypeArgNode
+{
+    ModuleID moduleId;
+    mdTypeDef typeDef;
+    ULONG32 childCount;
+    const TypeArgNode* const* children;
+};
+
+// Concurrent ClassID -> TypeArgNode cache. A hit is one shared-lock lookup; a
+// miss reads the class with a single GetClassIDInfo2 call in the common case
+// and resolves its type arguments through the cache as well. Entries are
+// dropped in ClassUnloadStarted because ClassIDs can be reused afterwards.
+// Dropped nodes stay allocated until the cache is destroyed, since readers
+// and parent nodes may still point at them.
+class TypeArgCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t invalidations;
+    };
+
+    TypeArgCache();
+    ~TypeArgCache();
+
+    TypeArgCache(const TypeArgCache&) = delete;
+    TypeArgCache& operator=(const TypeArgCache&) = delete;
+
+    // Returns nullptr if the class cannot be read (yet); failures are not cached.
+    const TypeArgNode* Resolve(ICorProfilerInfo3* profilerInfo, ClassID classId);
+
+    void Invalidate(ClassID classId);
+
+    Stats GetStats() const;
+
+private:
+    static const size_t ShardCount = 16;
+
+    struct alignas(64) Shard
+    {
+        Platform::ReaderWriterLock lock;
+        std::unordered_map<ClassID, const TypeArgNode*> entries;
+    };
+
+    Shard& GetShard(ClassID classId);
+    const TypeArgNode* CreateNode(ModuleID moduleId, mdTypeDef typeDef, const std::vector<const TypeArgNode*>& children);
+
+    Shard shards[ShardCount];
+
+    // Every node ever created, freed by the destructor.
+    Platform::ReaderWriterLock allocationLock;
+    std::vector<uint8_t*> allocations;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> invalidations;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// UTF-16 -> UTF-8 helpers shared by the JSON and binary writers. The runtime
+// reports names as UTF-16 (WCHAR) on every platform; wchar_t strings of our
+// own are UTF-32 outside Windows.
+namespace Utf8
+{
+    // Reads the code point at text[i] and advances i past it. Unpaired
+    // surrogates decode as U+FFFD.
+    template <typename Char>
+    inline uint32_t NextCodePoint(const Char* text, size_t length, size_t& i)
+    {
+        if (sizeof(Char) == 4)
+        {
+            uint32_t unit = (uint32_t)text[i++];
+            return unit > 0x10FFFF || (unit >= 0xD800 && unit <= 0xDFFF) ? 0xFFFD : unit;
+        }
+
+        uint32_t c = (uint32_t)(uint16_t)text[i++];
+        if (c >= 0xD800 && c <= 0xDBFF && i < length &&
+            (uint16_t)text[i] >= 0xDC00 && (uint16_t)text[i] <= 0xDFFF)
+        {
+            return 0x10000 + ((c - 0xD800) << 10) + ((uint16_t)text[i++] - 0xDC00);
+        }
+        if (c >= 0xD800 && c <= 0xDFFF)
+            return 0xFFFD;
+        return c;
+    }
+
+    // Writes the encoding of c to out, which needs room for 4 bytes, and returns its length.
+    inline size_t Encode(uint32_t c, uint8_t* out)
+    {
+        if (c < 0x80)
+        {
+            out[0] = (uint8_t)c;
+            return 1;
+        }
+        if (c < 0x800)
+        {
+            out[0] = (uint8_t)(0xC0 | (c >> 6));
+            out[1] = (uint8_t)(0x80 | (c & 0x3F));
+            return 2;
+        }
+        if (c < 0x10000)
+        {
+            out[0] = (uint8_t)(0xE0 | (c >> 12));
+            out[1] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+            out[2] = (uint8_t)(0x80 | (c & 0x3F));
+            return 3;
+        }
+        out[0] = (uint8_t)(0xF0 | (c >> 18));
+        out[1] = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+        out[2] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+        out[3] = (uint8_t)(0x80 | (c & 0x3F));
+        return 4;
+    }
+
+    inline size_t EncodedLength(uint32_t c)
+    {
+        return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+    }
+}
@@ -0,0 +1,227 @@
+﻿namespace TestApplication
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Diagnostics;
+    using System.IO;
+    using System.IO.MemoryMappedFiles;
+    using System.Linq;
+    using System.Text;
+    using System.Text.Json;
+
+    /// <summary>
+    /// End-to-end cost of the profiler on a real runtime. Runs each workload of
+    /// <see cref="OverheadWorkloads"/> in a child process in three modes:
+    ///   off      - no profiler
+    ///   disabled - profiler attached, its control flag created and left at 0
+    ///   enabled  - profiler attached and capturing
+    /// and reports wall time, CPU time, p50/p99 per-call latency and trace size.
+    ///
+    /// Usage: overhead [--profiler path] [--workloads generics,hotloop,burst]
+    ///                 [--modes off,disabled,enabled] [--size N] [--threads N]
+    ///                 [--runs N] [--json file]
+    /// Other SIG_JIT_PROFILER_* settings (capture mode, format...) are passed to
+    /// the children as they are.
+    /// </summary>
+    public static class OverheadBenchmark
+    {
+        private const string ProfilerClsid = "{DF9EDC4B-25C1-4925-A3FB-6AAEB3E2FACD}";
+
+        public static readonly string[] Modes = { "off", "disabled", "enabled" };
+
+        public sealed class ModeResult
+        {
+            public string Workload { get; set; }
+            public string Mode { get; set; }
+            public int Runs { get; set; }
+            public long Calls { get; set; }
+            public double WallMilliseconds { get; set; }
+            public double CpuMilliseconds { get; set; }
+            public double P50Nanoseconds { get; set; }
+            public double P99Nanoseconds { get; set; }
+            public long TraceBytes { get; set; }
+        }
+
+        private sealed class Settings
+        {
+            public string ProfilerPath = Path.Combine(AppContext.BaseDirectory,
+                OperatingSystem.IsWindows() ? "JitProfilerPlugin.dll" : "libJitProfilerPlugin.so");
+            public string[] Workloads = OverheadWorkloads.Names;
+            public string[] Modes = OverheadBenchmark.Modes;
+            public int Size = 2000;
+            public int Threads = Environment.ProcessorCount;
+            public int Runs = 3;
+            public string JsonFile;
+        }
+
+        public static int Run(string[] args)
+        {
+            var settings = new Settings();
+            for (int i = 0; i + 1 < args.Length; i += 2)
+            {
+                switch (args[i])
+                {
+                    case "--profiler": settings.ProfilerPath = Path.GetFullPath(args[i + 1]); break;
+                    case "--workloads": settings.Workloads = args[i + 1].Split(','); break;
+                    case "--modes": settings.Modes = args[i + 1].Split(','); break;
+                    case "--size": settings.Size = int.Parse(args[i + 1]); break;
+                    case "--threads": settings.Threads = int.Parse(args[i + 1]); break;
+                    case "--runs": settings.Runs = Math.Max(1, int.Parse(args[i + 1])); break;
+                    case "--json": settings.JsonFile = args[i + 1]; break;
+                    default:
+                        Console.Error.WriteLine($"unknown option {args[i]}");
+                        return 2;
+                }
+            }
+
+            var unknown = settings.Workloads.Except(OverheadWorkloads.Names).Concat(settings.Modes.Except(Modes)).ToList();
+            if (unknown.Count > 0)
+            {
+                Console.Error.WriteLine($"unknown workload or mode: {string.Join(", ", unknown)}");
+                return 2;
+            }
+            if (settings.Modes.Any(m => m != "off") && !File.Exists(settings.ProfilerPath))
+            {
+                Console.Error.WriteLine($"profiler not found: {settings.ProfilerPath} (use --profiler)");
+                return 2;
+            }
+
+            var results = new List<ModeResult>();
+            foreach (var workload in settings.Workloads)
+            {
+                foreach (var mode in settings.Modes)
+                {
+                    var runs = new List<(WorkloadResult Result, long TraceBytes)>();
+                    for (int run = 0; run < settings.Runs; run++)
+                        runs.Add(RunChild(settings, workload, mode));
+                    results.Add(Median(workload, mode, runs));
+                }
+            }
+
+            Console.WriteLine(ToReport(results));
+            if (settings.JsonFile != null)
+                File.WriteAllText(settings.JsonFile, JsonSerializer.Serialize(results, new JsonSerializerOptions { WriteIndented = true }));
+            return 0;
+        }
+
+        public static string ToReport(IReadOnlyList<ModeResult> results)
+        {
+            var report = new StringBuilder();
+            report.AppendLine($"{"workload",-9} {"mode",-9} {"calls",10} {"wall ms",10} {"cpu ms",10} {"p50 ns",10} {"p99 ns",10} {"trace KB",10} {"wall x",7}");
+            foreach (var result in results)
+            {
+                var off = results.FirstOrDefault(r => r.Workload == result.Workload && r.Mode == "off");
+                string slowdown = off != null && off.WallMilliseconds > 0 ? (result.WallMilliseconds / off.WallMilliseconds).ToString("F2") : "-";
+                report.AppendLine($"{result.Workload,-9} {result.Mode,-9} {result.Calls,10} {result.WallMilliseconds,10:F1} {result.CpuMilliseconds,10:F1} " +
+                    $"{result.P50Nanoseconds,10:F0} {result.P99Nanoseconds,10:F0} {result.TraceBytes / 1024.0,10:F1} {slowdown,7}");
+            }
+            return report.ToString();
+        }
+
+        // Each metric is the median over the runs, which keeps one slow start
+        // from deciding the result.
+        private static ModeResult Median(string workload, string mode, List<(WorkloadResult Result, long TraceBytes)> runs)
+        {
+            double MedianOf(Func<WorkloadResult, double> metric)
+            {
+                var values = runs.Select(r => metric(r.Result)).OrderBy(v => v).ToList();
+                return values[values.Count / 2];
+            }
+
+            return new ModeResult
+            {
+                Workload = workload,
+                Mode = mode,
+                Runs = runs.Count,
+                Calls = runs[0].Result.Calls,
+                WallMilliseconds = MedianOf(r => r.WallMilliseconds),
+                CpuMilliseconds = MedianOf(r => r.CpuMilliseconds),
+                P50Nanoseconds = MedianOf(r => r.P50Nanoseconds),
+                P99Nanoseconds = MedianOf(r => r.P99Nanoseconds),
+                TraceBytes = runs.Select(r => r.TraceBytes).OrderBy(v => v).ElementAt(runs.Count / 2),
+            };
+        }
+
+        private static (WorkloadResult Result, long TraceBytes) RunChild(Settings settings, string workload, string mode)
+        {
+            string mapId = $"JitProfilerOverhead_{Environment.ProcessId}_{workload}_{mode}";
+            string logPath = Path.Combine(Path.GetTempPath(), "JitProfilerOverhead", $"{workload}-{mode}");
+            if (Directory.Exists(logPath))
+                Directory.Delete(logPath, true);
+            Directory.CreateDirectory(logPath);
+
+            var startInfo = new ProcessStartInfo(Environment.ProcessPath)
+            {
+                RedirectStandardOutput = true,
+                UseShellExecute = false,
+            };
+            // Under "dotnet TestApplication.dll" the host needs the assembly again.
+            if (Path.GetFileNameWithoutExtension(Environment.ProcessPath) == "dotnet")
+                startInfo.ArgumentList.Add(typeof(OverheadBenchmark).Assembly.Location);
+            startInfo.ArgumentList.Add("workload");
+            startInfo.ArgumentList.Add(workload);
+            startInfo.ArgumentList.Add(settings.Size.ToString());
+            startInfo.ArgumentList.Add(settings.Threads.ToString());
+
+            startInfo.Environment.Remove("CORECLR_ENABLE_PROFILING");
+            if (mode != "off")
+            {
+                startInfo.Environment["CORECLR_ENABLE_PROFILING"] = "1";
+                startInfo.Environment["CORECLR_PROFILER"] = ProfilerClsid;
+                startInfo.Environment["CORECLR_PROFILER_PATH"] = settings.ProfilerPath;
+                startInfo.Environment["SIG_JIT_PROFILER_LOG_PATH"] = logPath;
+                // With no mapping by this name the plugin captures everything.
+                startInfo.Environment["SIG_JIT_PROFILER_MAP_ID"] = mapId;
+            }
+
+            using (var flag = mode == "disabled" ? DisabledFlag.Create(mapId) : null)
+            using (var process = Process.Start(startInfo))
+            {
+                string output = process.StandardOutput.ReadToEnd();
+                process.WaitForExit();
+
+                string last = output.Split('\n', StringSplitOptions.RemoveEmptyEntries).LastOrDefault()?.Trim();
+                if (process.ExitCode != 0 || last == null || !last.StartsWith("{"))
+                    throw new InvalidOperationException($"{workload}/{mode} failed with exit code {process.ExitCode}:\n{output}");
+
+                var result = JsonSerializer.Deserialize<WorkloadResult>(last);
+                long traceBytes = new DirectoryInfo(logPath).EnumerateFiles("*", SearchOption.AllDirectories).Sum(f => f.Length);
+                Directory.Delete(logPath, true);
+                return (result, traceBytes);
+            }
+        }
+
+        /// <summary>
+        /// The plugin's control mapping holding only the enabled flag, set to 0,
+        /// for as long as this object lives. A named mapping on Windows, a POSIX
+        /// shared memory object (shm_open name under /dev/shm) elsewhere.
+        /// </summary>
+        private sealed class DisabledFlag : IDisposable
+        {
+            private MemoryMappedFile mapping;
+            private string shmPath;
+
+            public static DisabledFlag Create(string name)
+            {
+                var flag = new DisabledFlag();
+                if (OperatingSystem.IsWindows())
+                {
+                    flag.mapping = MemoryMappedFile.CreateNew(name, sizeof(int));
+                }
+                else
+                {
+                    flag.shmPath = Path.Combine("/dev/shm", name);
+                    File.WriteAllBytes(flag.shmPath, new byte[sizeof(int)]);
+                }
+                return flag;
+            }
+
+            public void Dispose()
+            {
+                mapping?.Dispose();
+                if (shmPath != null)
+                    File.Delete(shmPath);
+            }
+        }
+    }
+}
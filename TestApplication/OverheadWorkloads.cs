@@ -0,0 +1,219 @@
+﻿namespace TestApplication
+{
+    using System;
+    using System.Collections.Generic;
+    using System.Diagnostics;
+    using System.Linq;
+    using System.Reflection;
+    using System.Runtime.CompilerServices;
+    using System.Text.Json;
+    using System.Threading;
+
+    /// <summary>
+    /// What one workload run measured, written by the child process as a single
+    /// JSON line and read back by <see cref="OverheadBenchmark"/>.
+    /// </summary>
+    public sealed class WorkloadResult
+    {
+        public string Workload { get; set; }
+        public long Calls { get; set; }
+        public double WallMilliseconds { get; set; }
+        public double CpuMilliseconds { get; set; }
+        public double P50Nanoseconds { get; set; }
+        public double P99Nanoseconds { get; set; }
+    }
+
+    /// <summary>
+    /// The workloads timed by the overhead benchmark. Each one runs in a fresh
+    /// process so that every method it calls is JIT compiled (and seen by the
+    /// profiler) for the first time inside the measured region.
+    ///   generics - a startup-heavy explosion of distinct value type instantiations
+    ///   hotloop  - steady-state calls to methods that are already compiled
+    ///   burst    - several threads making the same first calls at the same time
+    /// </summary>
+    public static class OverheadWorkloads
+    {
+        public static readonly string[] Names = { "generics", "hotloop", "burst" };
+
+        public struct Box<T> { public T Value; }
+
+        public struct Pair<T1, T2> { public T1 First; public T2 Second; }
+
+        private static readonly Type[] s_primitives =
+        {
+            typeof(int), typeof(long), typeof(short), typeof(byte), typeof(double), typeof(float),
+            typeof(char), typeof(bool), typeof(decimal), typeof(Guid), typeof(DateTime), typeof(TimeSpan),
+        };
+
+        // Runs one workload and prints its result as the last line of output.
+        public static int Run(string[] args)
+        {
+            if (args.Length < 1 || !Names.Contains(args[0]))
+            {
+                Console.Error.WriteLine($"usage: workload <{string.Join("|", Names)}> [size] [threads]");
+                return 2;
+            }
+
+            int size = args.Length > 1 ? int.Parse(args[1]) : 2000;
+            int threads = args.Length > 2 ? int.Parse(args[2]) : Environment.ProcessorCount;
+
+            WorkloadResult result = args[0] switch
+            {
+                "generics" => RunGenerics(size),
+                "hotloop" => RunHotLoop(size),
+                _ => RunBurst(size, Math.Max(1, threads)),
+            };
+            Console.WriteLine(JsonSerializer.Serialize(result));
+            return 0;
+        }
+
+        [MethodImpl(MethodImplOptions.NoInlining)]
+        public static int Explode<T1, T2>(int seed) => seed + Unsafe.SizeOf<T1>() - Unsafe.SizeOf<T2>();
+
+        [MethodImpl(MethodImplOptions.NoInlining)]
+        public static int Burst<T1, T2>(int seed) => seed ^ (Unsafe.SizeOf<T1>() * 31 + Unsafe.SizeOf<T2>());
+
+        [MethodImpl(MethodImplOptions.NoInlining)]
+        public static int Hot<T>(int seed, T value) => seed + (value == null ? 0 : 1);
+
+        [MethodImpl(MethodImplOptions.NoInlining)]
+        public static int HotPlain(int seed) => seed * 7 + 1;
+
+        // Every pair of value types gives its own compiled code, so each delegate's
+        // first call goes through the JIT.
+        private static List<Func<int, int>> MakeInstantiations(string methodName, int count)
+        {
+            var types = new List<Type>(s_primitives);
+            types.AddRange(s_primitives.Select(t => typeof(Box<>).MakeGenericType(t)));
+            foreach (var first in s_primitives)
+                types.AddRange(s_primitives.Select(second => typeof(Pair<,>).MakeGenericType(first, second)));
+
+            var definition = typeof(OverheadWorkloads).GetMethod(methodName);
+            var delegates = new List<Func<int, int>>(count);
+            for (int i = 0; delegates.Count < count && i < types.Count; i++)
+            {
+                for (int j = 0; delegates.Count < count && j < types.Count; j++)
+                    delegates.Add(definition.MakeGenericMethod(types[i], types[j]).CreateDelegate<Func<int, int>>());
+            }
+            return delegates;
+        }
+
+        private static WorkloadResult RunGenerics(int size)
+        {
+            var delegates = MakeInstantiations(nameof(Explode), size);
+            var samples = new long[delegates.Count];
+
+            var measure = Measurement.Start();
+            int sink = 0;
+            for (int i = 0; i < delegates.Count; i++)
+            {
+                long start = Stopwatch.GetTimestamp();
+                sink += delegates[i](i);
+                samples[i] = Stopwatch.GetTimestamp() - start;
+            }
+            GC.KeepAlive(sink);
+            return measure.Stop("generics", samples, 1);
+        }
+
+        private static WorkloadResult RunHotLoop(int size)
+        {
+            const int CallsPerBatch = 1000;
+
+            // Compile everything before the clock starts.
+            int sink = HotPlain(0) + Hot(0, 1) + Hot(0, "x") + Hot(0, 1L);
+            var samples = new long[size];
+
+            var measure = Measurement.Start();
+            for (int batch = 0; batch < size; batch++)
+            {
+                long start = Stopwatch.GetTimestamp();
+                for (int i = 0; i < CallsPerBatch / 4; i++)
+                {
+                    sink = HotPlain(sink);
+                    sink = Hot(sink, i);
+                    sink = Hot(sink, "x");
+                    sink = Hot(sink, (long)i);
+                }
+                samples[batch] = Stopwatch.GetTimestamp() - start;
+            }
+            GC.KeepAlive(sink);
+            return measure.Stop("hotloop", samples, CallsPerBatch);
+        }
+
+        private static WorkloadResult RunBurst(int size, int threadCount)
+        {
+            var delegates = MakeInstantiations(nameof(Burst), size);
+            var samples = new long[threadCount][];
+            var barrier = new Barrier(threadCount + 1);
+
+            var threads = new Thread[threadCount];
+            for (int t = 0; t < threadCount; t++)
+            {
+                int index = t;
+                threads[t] = new Thread(() =>
+                {
+                    // Each thread walks the same methods from a different start.
+                    var mine = new long[delegates.Count];
+                    barrier.SignalAndWait();
+                    int sink = 0;
+                    for (int i = 0; i < delegates.Count; i++)
+                    {
+                        int k = (i + index * delegates.Count / threadCount) % delegates.Count;
+                        long start = Stopwatch.GetTimestamp();
+                        sink += delegates[k](i);
+                        mine[i] = Stopwatch.GetTimestamp() - start;
+                    }
+                    GC.KeepAlive(sink);
+                    samples[index] = mine;
+                });
+                threads[t].Start();
+            }
+
+            var measure = Measurement.Start();
+            barrier.SignalAndWait();
+            foreach (var thread in threads)
+                thread.Join();
+            return measure.Stop("burst", samples.SelectMany(s => s).ToArray(), 1);
+        }
+
+        private readonly struct Measurement
+        {
+            private readonly long wallStart;
+            private readonly TimeSpan cpuStart;
+
+            private Measurement(long wallStart, TimeSpan cpuStart)
+            {
+                this.wallStart = wallStart;
+                this.cpuStart = cpuStart;
+            }
+
+            public static Measurement Start() => new Measurement(Stopwatch.GetTimestamp(), Process.GetCurrentProcess().TotalProcessorTime);
+
+            // Each sample is the Stopwatch ticks taken by callsPerSample calls.
+            public WorkloadResult Stop(string workload, long[] samples, int callsPerSample)
+            {
+                long wallTicks = Stopwatch.GetTimestamp() - wallStart;
+                var cpu = Process.GetCurrentProcess().TotalProcessorTime - cpuStart;
+
+                Array.Sort(samples);
+                double nanosecondsPerTick = 1e9 / Stopwatch.Frequency / callsPerSample;
+                return new WorkloadResult
+                {
+                    Workload = workload,
+                    Calls = (long)samples.Length * callsPerSample,
+                    WallMilliseconds = wallTicks * 1000.0 / Stopwatch.Frequency,
+                    CpuMilliseconds = cpu.TotalMilliseconds,
+                    P50Nanoseconds = Percentile(samples, 0.50) * nanosecondsPerTick,
+                    P99Nanoseconds = Percentile(samples, 0.99) * nanosecondsPerTick,
+                };
+            }
+
+            private static double Percentile(long[] sorted, double fraction)
+            {
+                if (sorted.Length == 0)
+                    return 0;
+                return sorted[(int)Math.Round((sorted.Length - 1) * fraction)];
+            }
+        }
+    }
+}
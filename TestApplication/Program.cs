@@ -16,6 +16,83 @@
     {
         static void Main(string[] args)
         {
+            // compare <baselineManifest> <candidateManifest>: reports which instantiations
+            // two captures of TestCases found, e.g. SIG_JIT_PROFILER_CAPTURE_MODE=enter3 vs jit
+            if (args.Length == 3 && args[0] == "compare")
+            {
+                Console.WriteLine(CompareManifests(args[1], args[2]));
+                return;
+            }
+
+            // mibc <logFolder> <executableFolder> <output.mibc>: the captured methods as a
+            // profile for crossgen2 --mibc
+            if (args.Length == 4 && args[0] == "mibc")
+            {
+                Console.WriteLine(WriteMibc(args[1], args[2], args[3]));
+                return;
+            }
+
+            // jittime <logFolder> <executableFolder> [top]: methods ranked by JIT time, from a
+            // run with SIG_JIT_PROFILER_JIT_TIMING=1
+            if ((args.Length == 3 || args.Length == 4) && args[0] == "jittime")
+            {
+                Console.WriteLine(Report(args[1], (run, errors) => JitTimeReport.Rank(run, args[2], errors).ToReport(args.Length == 4 ? int.Parse(args[3]) : 50)));
+                return;
+            }
+
+            // inlining <logFolder> <executableFolder> [top]: which methods the JIT inlined into
+            // which, from a run with SIG_JIT_PROFILER_INLINING=1
+            if ((args.Length == 3 || args.Length == 4) && args[0] == "inlining")
+            {
+                Console.WriteLine(Report(args[1], (run, errors) => InliningGraph.Build(run, args[2], errors).ToReport(args.Length == 4 ? int.Parse(args[3]) : 50)));
+                return;
+            }
+
+            // tiers <logFolder> <executableFolder> [top]: when each method was recompiled, from a run
+            // with SIG_JIT_PROFILER_TIERS=1
+            if ((args.Length == 3 || args.Length == 4) && args[0] == "tiers")
+            {
+                Console.WriteLine(Report(args[1], (run, errors) => TierReport.Build(run, args[2], errors).ToReport(args.Length == 4 ? int.Parse(args[3]) : 50)));
+                return;
+            }
+
+            // modules <logFolder> [top]: when each module loaded and unloaded
+            if ((args.Length == 2 || args.Length == 3) && args[0] == "modules")
+            {
+                Console.WriteLine(Report(args[1], (run, errors) => ModuleTimeline.Build(run).ToReport(args.Length == 3 ? int.Parse(args[2]) : 200)));
+                return;
+            }
+
+            // threads <logFolder> [top]: what each thread compiled and called first, from a run
+            // with SIG_JIT_PROFILER_THREADS=1
+            if ((args.Length == 2 || args.Length == 3) && args[0] == "threads")
+            {
+                Console.WriteLine(Report(args[1], (run, errors) => ThreadTimeline.Build(run).ToReport(args.Length == 3 ? int.Parse(args[2]) : 50)));
+                return;
+            }
+
+            // callcounts <logFolder> <executableFolder> [top]: methods ranked by calls, from a run
+            // with SIG_JIT_PROFILER_CALL_COUNTS=1
+            if ((args.Length == 3 || args.Length == 4) && args[0] == "callcounts")
+            {
+                Console.WriteLine(Report(args[1], (run, errors) => CallCountReport.Rank(run, args[2], errors).ToReport(args.Length == 4 ? int.Parse(args[3]) : 50)));
+                return;
+            }
+
+            // overhead [options]: profiler cost per workload, see OverheadBenchmark
+            if (args.Length >= 1 && args[0] == "overhead")
+            {
+                Environment.ExitCode = OverheadBenchmark.Run(args.Skip(1).ToArray());
+                return;
+            }
+
+            // workload <name> [size] [threads]: one measured run, started by "overhead"
+            if (args.Length >= 1 && args[0] == "workload")
+            {
+                Environment.ExitCode = OverheadWorkloads.Run(args.Skip(1).ToArray());
+                return;
+            }
+
             Prime(@"C:\siglocal\JitProfilerPlugin\OLD_jitManifest.json", out int totalLoaded, out int totalPrimed, out string errors);
             Console.WriteLine($"totalLoaded={totalLoaded}, totalPrimed={totalPrimed}");
             if (!string.IsNullOrEmpty(errors))
@@ -56,6 +133,67 @@
             string Text = string.Join("\r\n", methodBaseList.Select(x => x.ToPrettySignature()));
             Console.WriteLine(Text);
         }
+        public static string CompareManifests(string baselineManifest, string candidateManifest)
+        {
+            var baseline = LoadManifest(baselineManifest, out string baselineErrors);
+            var candidate = LoadManifest(candidateManifest, out string candidateErrors);
+            var comparison = CaptureComparison.Compare(baseline, candidate);
+            return comparison.ToReport(ManifestLabel(baselineManifest), ManifestLabel(candidateManifest)) + baselineErrors + candidateErrors;
+        }
+
+        public static string WriteMibc(string logFolder, string executableFolder, string mibcFile)
+        {
+            string errors;
+            int count = JitProfilerLogParser.IsBinaryRun(logFolder)
+                ? JitProfilerLogParser.ParseProfilerTraceToMibc(Path.Combine(logFolder, BinaryTraceReader.DefaultFileName), executableFolder, mibcFile, out errors)
+                : JitProfilerLogParser.ParseProfilerLogsToMibc(
+                    Path.Combine(logFolder, "jit.json"),
+                    Path.Combine(logFolder, "modules.json"),
+                    Path.Combine(logFolder, "enter3.json"),
+                    executableFolder,
+                    mibcFile,
+                    out errors);
+            return $"{count} methods written to {mibcFile}" + (string.IsNullOrEmpty(errors) ? "" : Environment.NewLine + errors);
+        }
+
+        // Reads the run in logFolder once and appends the read and naming errors to its report
+        public static string Report(string logFolder, Func<ProfilerRun, List<string>, string> build)
+        {
+            var run = JitProfilerLogParser.ReadEvents(logFolder, out string readErrors);
+            var errors = new List<string>();
+            if (!string.IsNullOrEmpty(readErrors))
+                errors.Add(readErrors);
+
+            var report = build(run, errors);
+            return report + (errors.Count == 0 ? "" : Environment.NewLine + string.Join(Environment.NewLine, errors));
+        }
+
+        // Runs are usually kept side by side as <mode>\jitManifest.json
+        private static string ManifestLabel(string manifestFile)
+        {
+            var folder = Path.GetFileName(Path.GetDirectoryName(Path.GetFullPath(manifestFile)));
+            return string.IsNullOrEmpty(folder) ? manifestFile : folder;
+        }
+
+        private static List<MethodBase> LoadManifest(string manifestFile, out string errors)
+        {
+            errors = string.Empty;
+            var methods = new List<MethodBase>();
+            var nodes = JsonSerializer.Deserialize<MethodBaseSerializer.MethodNode[]>(File.ReadAllText(manifestFile), new JsonSerializerOptions());
+            foreach (var node in nodes)
+            {
+                try
+                {
+                    methods.Add(MethodBaseSerializer.FromNode(node));
+                }
+                catch (Exception ex)
+                {
+                    errors += $"{manifestFile}: failed to resolve {node.DeclaringType?.Name}.{node.Name}: {ex.Message}\r\n";
+                }
+            }
+            return methods;
+        }
+
         public static void Prime(string manifestFile, out int totalLoaded, out int totalPrimed, out string errors)
         {
             totalLoaded = 0;